@@ -0,0 +1,286 @@
+/*
+* adaptive: One pass adaptive huffman mode with periodic rebuilds from decayed
+* counts. See adaptive.h for the layout of the payload.
+*/
+
+#include "adaptive.h"
+#include "format.h"
+
+
+/*
+* description: Creates model where all chars are equally likely.
+* param[in]: periodKiB - Longest interval between rebuilds, in KiB.
+* return: The model.
+*/
+adaptiveModel *adaptiveEmpty (int64_t periodKiB) {
+
+	adaptiveModel *model = malloc(sizeof(adaptiveModel));
+
+	for (int s = 0; s < ADAPTIVESYMBOLS; s++) {
+
+		model -> freq[s] = 1;
+	}
+	model -> dec = NULL;
+	model -> period = periodKiB * 1024;
+	model -> interval = ADAPTIVEFIRST / 2;
+
+	//First rebuild gives the flat code, counts of 1 are not decayed.
+	adaptiveRebuild(model);
+	return model;
+}
+
+
+/*
+* description: Frees memory of model.
+* param[in]: model - The model.
+*/
+void adaptiveKill (adaptiveModel *model) {
+
+	canonicalDecoderKill(model -> dec);
+	free(model);
+}
+
+
+/*
+* description: Encodes chars and updates model. Can be called again with the
+* next chars of a stream.
+* param[in]: model - The model.
+* param[in]: bs - The bitString.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+*/
+void adaptiveEncode (adaptiveModel *model, bitString *bs,
+					 const unsigned char *text, int64_t length) {
+
+	for (int64_t i = 0; i < length; i++) {
+
+		huffCode hc = model -> codes[text[i]];
+
+		bitStringAddCode(bs, hc.code, hc.len);
+		model -> freq[text[i]]++;
+		model -> untilRebuild--;
+		if (model -> untilRebuild == 0) {
+
+			adaptiveRebuild(model);
+		}
+	}
+}
+
+
+/*
+* description: Decodes chars and updates model the same way as encoder did.
+* param[in]: model - The model.
+* param[in]: bs - The bitString.
+* param[in]: bitPos - Position of next bit to read. Moved past the chars.
+* param[out]: text - Array to store atleast length chars in.
+* param[in]: length - Number of chars to decode.
+* return: 1 if all chars could be decoded, else 0.
+*/
+int adaptiveDecode (adaptiveModel *model, bitString *bs, int64_t *bitPos,
+					unsigned char *text, int64_t length) {
+
+	for (int64_t i = 0; i < length; i++) {
+
+		int key = canonicalDecodeKey(model -> dec, bs, bitPos);
+
+		if (key < 0) {
+
+			return 0;
+		}
+		text[i] = (unsigned char)key;
+		model -> freq[key]++;
+		model -> untilRebuild--;
+		if (model -> untilRebuild == 0) {
+
+			adaptiveRebuild(model);
+		}
+	}
+	return 1;
+}
+
+
+/*
+* description: Reads file a block at a time, encodes it and writes the block
+* as soon as it is done, so pipes are coded in constant memory.
+* param[in]: file1 - Name of file to be read and encoded, "-" for stdin.
+* param[in]: file2 - Name of file to be written, "-" for stdout.
+* param[in]: periodKiB - Longest interval between rebuilds, in KiB.
+* return: 1 if file2 was written, else 0.
+*/
+int adaptiveEncodeFile (char const *file1, char const *file2,
+						int64_t periodKiB) {
+
+	stream *in = streamOpenRead(file1);
+	stream *out = streamOpenWrite(file2);
+	adaptiveModel *model = adaptiveEmpty(periodKiB);
+	bitString *bs = bitStringEmpty();
+	unsigned char *buffer = malloc(ADAPTIVEBLOCKSIZE);
+	unsigned char field[8];
+	uint64_t originalLength = 0;
+	int64_t got = 0;
+
+	//Length is given by the end marker, so header is written once.
+	int valid = formatWriteHeader(out, FORMATMODEADAPTIVE, 0);
+	formatPutU32(field, (uint32_t)periodKiB);
+	valid = valid && streamWrite(out, field, 4);
+
+	while (valid && (got = streamRead(in, buffer, ADAPTIVEBLOCKSIZE)) > 0) {
+
+		adaptiveEncode(model, bs, buffer, got);
+		valid = adaptiveWriteBlock(bs, got, out);
+		originalLength = originalLength + got;
+	}
+
+	formatPutU32(field, 0);
+	valid = valid && streamWrite(out, field, 4);
+	formatPutU64(field, originalLength);
+	valid = valid && streamWrite(out, field, 8);
+
+	valid = streamClose(out) && valid;
+	if (!valid) {
+
+		fprintf(stderr, "Could not write %s\n", file2);
+	}
+	streamClose(in);
+	free(buffer);
+	bitStringKill(bs);
+	adaptiveKill(model);
+	return valid;
+}
+
+
+/*
+* description: Decodes payload of an adaptive mode file as it is read.
+* param[in]: in - Encoded stream, positioned after file header.
+* param[in]: file2 - Name of file to be written, "-" for stdout.
+* return: 1 if a whole valid stream was decoded and written, else 0.
+*/
+int adaptiveDecodeStream (stream *in, char const *file2) {
+
+	unsigned char field[8];
+	if (streamRead(in, field, 4) != 4) {
+
+		return 0;
+	}
+	uint32_t periodKiB = formatGetU32(field);
+	if (periodKiB == 0 || periodKiB > ADAPTIVEMAXPERIOD) {
+
+		return 0;
+	}
+
+	stream *out = streamOpenWrite(file2);
+	if (out == NULL) {
+
+		return 0;
+	}
+
+	adaptiveModel *model = adaptiveEmpty(periodKiB);
+	bitString *bs = bitStringEmpty();
+	unsigned char *codes = malloc(ADAPTIVEBLOCKBYTES);
+	unsigned char *text = malloc(ADAPTIVEBLOCKSIZE);
+	uint64_t originalLength = 0;
+	int valid = 1;
+
+	while (valid) {
+
+		if (streamRead(in, field, 4) != 4) {
+
+			valid = 0;
+			break;
+		}
+		uint32_t nrOfChars = formatGetU32(field);
+		if (nrOfChars == 0) {
+
+			break;
+		}
+		if (nrOfChars > ADAPTIVEBLOCKSIZE || streamRead(in, field, 4) != 4) {
+
+			valid = 0;
+			break;
+		}
+		uint32_t size = formatGetU32(field);
+		if (size == 0 || size > ADAPTIVEBLOCKBYTES ||
+			streamRead(in, codes, size) != size) {
+
+			valid = 0;
+			break;
+		}
+
+		//Codes of the block must end in its last byte.
+		int64_t bitPos = 0;
+		bitStringClear(bs);
+		bitStringAddBytes(bs, codes, size);
+		valid = adaptiveDecode(model, bs, &bitPos, text, nrOfChars) &&
+				(bitPos + 7) / 8 == size &&
+				streamWrite(out, text, nrOfChars);
+		originalLength = originalLength + nrOfChars;
+	}
+
+	//Input after end of stream is not valid.
+	valid = valid && streamRead(in, field, 8) == 8 &&
+			formatGetU64(field) == originalLength &&
+			streamRead(in, field, 1) == 0;
+
+	valid = streamClose(out) && valid;
+	free(text);
+	free(codes);
+	bitStringKill(bs);
+	adaptiveKill(model);
+	return valid;
+}
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN ADAPTIVE.C
+
+
+/* support function for adaptiveEncode and adaptiveDecode!
+* description: Rebuilds code from counts, halves counts and schedules next
+* rebuild.
+* param[in]: model - The model.
+*/
+void adaptiveRebuild (adaptiveModel *model) {
+
+	canonicalCodeLengths(model -> freq, ADAPTIVESYMBOLS, HUFFMAXCODELEN,
+						 model -> lengths);
+	canonicalAssignCodes(model -> lengths, ADAPTIVESYMBOLS, model -> codes);
+	if (model -> dec != NULL) {
+
+		canonicalDecoderKill(model -> dec);
+	}
+	model -> dec = canonicalDecoderBuild(model -> lengths, ADAPTIVESYMBOLS);
+
+	//Halving keeps every char codable, counts never go below 1.
+	for (int s = 0; s < ADAPTIVESYMBOLS; s++) {
+
+		model -> freq[s] = model -> freq[s] - (model -> freq[s] >> 1);
+	}
+
+	model -> interval = model -> interval * 2;
+	if (model -> interval > model -> period) {
+
+		model -> interval = model -> period;
+	}
+	model -> untilRebuild = model -> interval;
+}
+
+
+/* support function for adaptiveEncodeFile!
+* description: Pads codes of a block to a whole byte, writes the block and
+* empties bitString.
+* param[in]: bs - The bitString with codes of the block.
+* param[in]: nrOfChars - Number of chars in block.
+* param[in]: out - Stream to write to.
+* return: 1 if block was written, else 0.
+*/
+int adaptiveWriteBlock (bitString *bs, int64_t nrOfChars, stream *out) {
+
+	unsigned char field[8];
+	unsigned char *codes = bitStringGetEncode(bs);
+	int64_t size = bitStringGetSize(bs);
+
+	formatPutU32(field, (uint32_t)nrOfChars);
+	formatPutU32(&field[4], (uint32_t)size);
+	int valid = streamWrite(out, field, 8) && streamWrite(out, codes, size);
+	bitStringClear(bs);
+	return valid;
+}
@@ -0,0 +1,143 @@
+/*
+* adaptive: One pass adaptive huffman mode. Encoder and decoder start with
+* the same flat model and count chars as they are coded. The code is rebuilt
+* from the counts at fixed points, first after ADAPTIVEFIRST chars and then
+* at doubling intervals up to period chars, and counts are halved at each
+* rebuild so old chars weigh less. Both sides rebuild at the same chars, so
+* no analysis file, pre-pass or code table is needed and input can be coded
+* as it is read.
+*
+* Codes are written in blocks of atmost ADAPTIVEBLOCKSIZE chars, each padded
+* to a whole byte, so neither side needs the length of the input before it
+* ends and both code a stream in constant memory. The model goes on from one
+* block to the next.
+*
+* Payload after file header, length in file header being 0:
+*   4 bytes   period in KiB, 1 to ADAPTIVEMAXPERIOD
+* for each block:
+*   4 bytes   number of chars in block, 1 to ADAPTIVEBLOCKSIZE
+*   4 bytes   number of bytes of codes
+*   codes of the chars, padded to a whole byte
+* and after the last block:
+*   4 bytes   0, end of stream marker
+*   8 bytes   number of chars in all blocks
+* Integers are little endian.
+*/
+
+#ifndef ADAPTIVE
+#define ADAPTIVE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "huffTree.h"
+#include "bitString.h"
+#include "canonical.h"
+#include "stream.h"
+
+#define ADAPTIVESYMBOLS 256
+#define ADAPTIVEFIRST 256
+#define ADAPTIVEDEFAULTPERIOD 16
+#define ADAPTIVEMAXPERIOD (1 << 20)
+#define ADAPTIVEBLOCKSIZE (1 << 16)
+//Bytes of codes of a full block, codes being atmost HUFFMAXCODELEN bits each.
+#define ADAPTIVEBLOCKBYTES (ADAPTIVEBLOCKSIZE * (HUFFMAXCODELEN / 8))
+
+
+typedef struct adaptiveModel {
+
+	uint64_t freq[ADAPTIVESYMBOLS];
+	uint8_t lengths[ADAPTIVESYMBOLS];
+	huffCode codes[ADAPTIVESYMBOLS];
+	canonicalDecoder *dec;
+	int64_t period;
+	int64_t interval;
+	int64_t untilRebuild;
+} adaptiveModel;
+
+
+/*
+* description: Creates model where all chars are equally likely.
+* param[in]: periodKiB - Longest interval between rebuilds, in KiB.
+* return: The model.
+*/
+adaptiveModel *adaptiveEmpty (int64_t periodKiB);
+
+
+/*
+* description: Frees memory of model.
+* param[in]: model - The model.
+*/
+void adaptiveKill (adaptiveModel *model);
+
+
+/*
+* description: Encodes chars and updates model. Can be called again with the
+* next chars of a stream.
+* param[in]: model - The model.
+* param[in]: bs - The bitString.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+*/
+void adaptiveEncode (adaptiveModel *model, bitString *bs,
+					 const unsigned char *text, int64_t length);
+
+
+/*
+* description: Decodes chars and updates model the same way as encoder did.
+* param[in]: model - The model.
+* param[in]: bs - The bitString.
+* param[in]: bitPos - Position of next bit to read. Moved past the chars.
+* param[out]: text - Array to store atleast length chars in.
+* param[in]: length - Number of chars to decode.
+* return: 1 if all chars could be decoded, else 0.
+*/
+int adaptiveDecode (adaptiveModel *model, bitString *bs, int64_t *bitPos,
+					unsigned char *text, int64_t length);
+
+
+/*
+* description: Reads file a block at a time, encodes it and writes the block
+* as soon as it is done, so pipes are coded in constant memory.
+* param[in]: file1 - Name of file to be read and encoded, "-" for stdin.
+* param[in]: file2 - Name of file to be written, "-" for stdout.
+* param[in]: periodKiB - Longest interval between rebuilds, in KiB.
+* return: 1 if file2 was written, else 0.
+*/
+int adaptiveEncodeFile (char const *file1, char const *file2,
+						int64_t periodKiB);
+
+
+/*
+* description: Decodes payload of an adaptive mode file as it is read.
+* param[in]: in - Encoded stream, positioned after file header.
+* param[in]: file2 - Name of file to be written, "-" for stdout.
+* return: 1 if a whole valid stream was decoded and written, else 0.
+*/
+int adaptiveDecodeStream (stream *in, char const *file2);
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN ADAPTIVE.C
+
+
+/* support function for adaptiveEncode and adaptiveDecode!
+* description: Rebuilds code from counts, halves counts and schedules next
+* rebuild.
+* param[in]: model - The model.
+*/
+void adaptiveRebuild (adaptiveModel *model);
+
+
+/* support function for adaptiveEncodeFile!
+* description: Pads codes of a block to a whole byte, writes the block and
+* empties bitString.
+* param[in]: bs - The bitString with codes of the block.
+* param[in]: nrOfChars - Number of chars in block.
+* param[in]: out - Stream to write to.
+* return: 1 if block was written, else 0.
+*/
+int adaptiveWriteBlock (bitString *bs, int64_t nrOfChars, stream *out);
+
+
+#endif //ADAPTIVE
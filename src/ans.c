@@ -0,0 +1,619 @@
+/*
+* ans: Table based asymmetric numeral system (tANS) coder and block mode
+* picking tANS or huffman per block. See ans.h for the layout of the payload.
+*/
+
+#include "ans.h"
+#include "encode.h"
+
+
+/*
+* description: Normalizes histogram to 2^tableLog and builds encode and
+* decode tables. Every used char gets atleast one slot.
+* param[in]: freqTable - Number of times each char is used, see freqAnalysis.
+* param[in]: tableLog - ANSMINTABLELOG to ANSMAXTABLELOG.
+* return: The table, NULL if no char is used.
+*/
+ansTable *ansTableBuild (const uint64_t *freqTable, int tableLog) {
+
+	uint32_t norm[ANSSYMBOLS];
+
+	if (!ansNormalize(freqTable, tableLog, norm)) {
+
+		return NULL;
+	}
+	return ansTableFromNorm(tableLog, norm);
+}
+
+
+/*
+* description: Frees memory of table.
+* param[in]: table - The table.
+*/
+void ansTableKill (ansTable *table) {
+
+	free(table -> stateTable);
+	free(table -> decode);
+	free(table);
+}
+
+
+/*
+* description: Picks table size for a histogram, big enough to give each used
+* char a few slots and no bigger than the number of chars.
+* param[in]: freqTable - Number of times each char is used.
+* return: The tableLog.
+*/
+int ansTableLogFor (const uint64_t *freqTable) {
+
+	uint64_t total = 0;
+	int used = 0;
+	int tableLog = ANSMINTABLELOG;
+
+	for (int s = 0; s < ANSSYMBOLS; s++) {
+
+		total = total + freqTable[s];
+		used = used + (freqTable[s] > 0);
+	}
+
+	while (tableLog < ANSMAXTABLELOG &&
+		   (((uint64_t)1 << tableLog) < total ||
+			(1 << tableLog) < 4 * used)) {
+
+		tableLog++;
+	}
+	return tableLog;
+}
+
+
+/*
+* description: Writes tableLog and normalized counts to bitString.
+* param[in]: table - The table.
+* param[in]: bs - The bitString.
+*/
+void ansWriteTable (ansTable *table, bitString *bs) {
+
+	int used = 0;
+	int previous = -1;
+
+	for (int s = 0; s < ANSSYMBOLS; s++) {
+
+		used = used + (table -> norm[s] > 0);
+	}
+
+	bitStringAddCode(bs, table -> tableLog, 4);
+	canonicalWriteGamma(bs, used + 1);
+	for (int s = 0; s < ANSSYMBOLS; s++) {
+
+		if (table -> norm[s] > 0) {
+
+			canonicalWriteGamma(bs, s - previous);
+			canonicalWriteGamma(bs, table -> norm[s]);
+			previous = s;
+		}
+	}
+}
+
+
+/*
+* description: Reads tableLog and normalized counts from bitString and builds
+* the tables.
+* param[in]: bs - The bitString.
+* param[in]: bitPos - Position of next bit to read. Moved past the table.
+* return: The table, NULL if stored counts are invalid.
+*/
+ansTable *ansReadTable (bitString *bs, int64_t *bitPos) {
+
+	uint32_t norm[ANSSYMBOLS] = {0};
+	int tableLog = (int)canonicalReadBits(bs, bitPos, 4);
+	uint32_t used = canonicalReadGamma(bs, bitPos);
+	uint64_t sum = 0;
+	int64_t s = -1;
+
+	if (tableLog < ANSMINTABLELOG || tableLog > ANSMAXTABLELOG ||
+		used < 2 || used - 1 > ANSSYMBOLS) {
+
+		return NULL;
+	}
+
+	for (uint32_t j = 0; j < used - 1; j++) {
+
+		uint32_t gap = canonicalReadGamma(bs, bitPos);
+		uint32_t count = canonicalReadGamma(bs, bitPos);
+
+		s = s + gap;
+		if (gap == 0 || s >= ANSSYMBOLS || count == 0) {
+
+			return NULL;
+		}
+		norm[s] = count;
+		sum = sum + count;
+	}
+
+	//Slots must be filled exactly, else states are lost or overlap.
+	if (sum != (uint64_t)1 << tableLog) {
+
+		return NULL;
+	}
+	return ansTableFromNorm(tableLog, norm);
+}
+
+
+/*
+* description: Estimates bits needed to code chars of histogram with table,
+* table itself not included.
+* param[in]: table - The table.
+* param[in]: freqTable - Number of times each char is used.
+* return: Estimated number of bits.
+*/
+int64_t ansCodeCost (ansTable *table, const uint64_t *freqTable) {
+
+	uint64_t cost = table -> tableLog;
+
+	//A char with norm slots costs about tableLog - log2(norm) bits.
+	for (int s = 0; s < ANSSYMBOLS; s++) {
+
+		if (freqTable[s] > 0) {
+
+			uint32_t bits = (table -> tableLog << 8) -
+							ansLog2(table -> norm[s]);
+			cost = cost + (freqTable[s] * bits >> 8);
+		}
+	}
+	return cost;
+}
+
+
+/*
+* description: Estimates bits needed to write table.
+* param[in]: table - The table.
+* return: Number of bits.
+*/
+int64_t ansTableCost (ansTable *table) {
+
+	int64_t cost = 4;
+	int used = 0;
+	int previous = -1;
+
+	for (int s = 0; s < ANSSYMBOLS; s++) {
+
+		if (table -> norm[s] > 0) {
+
+			used++;
+			cost = cost + 2 * canonicalBitWidth(s - previous) - 1 +
+				   2 * canonicalBitWidth(table -> norm[s]) - 1;
+			previous = s;
+		}
+	}
+	return cost + 2 * canonicalBitWidth(used + 1) - 1;
+}
+
+
+/*
+* description: Encodes chars and adds start state and bits to bitString.
+* param[in]: table - Table built from a histogram containing all the chars.
+* param[in]: bs - The bitString.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars, atleast 1.
+*/
+void ansEncode (ansTable *table, bitString *bs, const unsigned char *text,
+				int64_t length) {
+
+	uint32_t *values = malloc(sizeof(uint32_t) * length);
+	uint8_t *nrOfBits = malloc(length);
+	uint32_t tableSize = (uint32_t)1 << table -> tableLog;
+
+	//Start state of last char is picked so no bits are needed for it.
+	int s = text[length - 1];
+	uint32_t bits = (table -> deltaNrOfBits[s] + (1 << 15)) >> 16;
+	uint32_t value = (bits << 16) - table -> deltaNrOfBits[s];
+	uint32_t state = table -> stateTable[(value >> bits) +
+										 table -> deltaFindState[s]];
+
+	//Chars are coded backwards and bits kept, so decoder can read them in
+	//order of chars.
+	for (int64_t i = length - 2; i >= 0; i--) {
+
+		s = text[i];
+		bits = (state + table -> deltaNrOfBits[s]) >> 16;
+		values[i] = state & ((1u << bits) - 1);
+		nrOfBits[i] = (uint8_t)bits;
+		state = table -> stateTable[(state >> bits) +
+									table -> deltaFindState[s]];
+	}
+
+	bitStringAddCode(bs, state - tableSize, table -> tableLog);
+	for (int64_t i = 0; i < length - 1; i++) {
+
+		bitStringAddCode(bs, values[i], nrOfBits[i]);
+	}
+
+	free(nrOfBits);
+	free(values);
+}
+
+
+/*
+* description: Decodes chars from bitString.
+* param[in]: table - The table.
+* param[in]: bs - The bitString.
+* param[in]: bitPos - Position of next bit to read. Moved past the chars.
+* param[out]: text - Array to store atleast length chars in.
+* param[in]: length - Number of chars to decode, atleast 1.
+*/
+void ansDecode (ansTable *table, bitString *bs, int64_t *bitPos,
+				unsigned char *text, int64_t length) {
+
+	const ansDecodeEntry *decode = table -> decode;
+	int64_t pos = *bitPos;
+	uint32_t state = bitStringGetBits(bs, pos, table -> tableLog);
+
+	pos = pos + table -> tableLog;
+	for (int64_t i = 0; i < length - 1; i++) {
+
+		ansDecodeEntry entry = decode[state];
+
+		text[i] = entry.symbol;
+		state = entry.newState + bitStringGetBits(bs, pos, entry.nrOfBits);
+		pos = pos + entry.nrOfBits;
+	}
+	text[length - 1] = decode[state].symbol;
+	*bitPos = pos;
+}
+
+
+/*
+* description: Encodes chars in memory block by block, each block with
+* backend of it's own.
+* param[in]: bs - The bitString.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[in]: blockSize - Largest number of chars in a block.
+* param[in]: backend - ANSBACKENDAUTO picks the cheaper backend per block,
+* else the backend to use for all blocks.
+*/
+void ansBlocksEncode (bitString *bs, const unsigned char *text,
+					  int64_t length, int64_t blockSize, int backend) {
+
+	for (int64_t pos = 0; pos < length; pos = pos + blockSize) {
+
+		int64_t n = length - pos < blockSize ? length - pos : blockSize;
+		ansEncodeBlock(bs, &text[pos], n, backend);
+	}
+}
+
+
+/*
+* description: Decodes blocks from bitString. A tANS block holds atmost
+* ANSBLOCKSIZE chars.
+* param[in]: bs - The bitString.
+* param[in]: bitPos - Position of next bit to read. Moved past the blocks.
+* param[out]: text - Array to store atleast length chars in.
+* param[in]: length - Number of chars to decode.
+* return: 1 if all chars could be decoded, else 0.
+*/
+int ansBlocksDecode (bitString *bs, int64_t *bitPos, unsigned char *text,
+					 int64_t length) {
+
+	int64_t pos = 0;
+	int valid = 1;
+
+	while (valid && pos < length) {
+
+		int64_t n = canonicalReadGamma(bs, bitPos);
+		int backend = bitStringGetBit(bs, *bitPos);
+
+		(*bitPos)++;
+		valid = n > 0 && n <= length - pos &&
+				(backend != ANSBACKENDTANS || n <= ANSBLOCKSIZE);
+		if (valid && backend == ANSBACKENDTANS) {
+
+			ansTable *table = ansReadTable(bs, bitPos);
+
+			valid = table != NULL;
+			if (valid) {
+
+				ansDecode(table, bs, bitPos, &text[pos], n);
+				ansTableKill(table);
+			}
+		} else if (valid) {
+
+			uint8_t lengths[ANSSYMBOLS];
+
+			valid = canonicalReadLengths(bs, bitPos, lengths, ANSSYMBOLS);
+			if (valid) {
+
+				canonicalDecoder *dec = canonicalDecoderBuild(lengths,
+															  ANSSYMBOLS);
+				for (int64_t i = 0; valid && i < n; i++) {
+
+					int key = canonicalDecodeKey(dec, bs, bitPos);
+
+					valid = key >= 0;
+					text[pos + i] = (unsigned char)key;
+				}
+				canonicalDecoderKill(dec);
+			}
+		}
+		pos = pos + n;
+	}
+
+	return valid;
+}
+
+
+/*
+* description: Reads file, encodes it block by block and writes encoded file.
+* param[in]: file1 - Name of file to be read and encoded.
+* param[in]: file2 - Name of file to be written as encoded file.
+* return: 1 if file2 was written, else 0.
+*/
+int ansEncodeFile (char const *file1, char const *file2) {
+
+	int64_t length = 0;
+	unsigned char *text = readPlainFile(file1, &length);
+	bitString *bs = bitStringEmpty();
+
+	ansBlocksEncode(bs, text, length, ANSBLOCKSIZE, ANSBACKENDAUTO);
+
+	unsigned char *encode = bitStringGetEncode(bs);
+	int valid = writeEncode(file2, FORMATMODEANS, length, encode,
+							bitStringGetSize(bs));
+
+	bitStringKill(bs);
+	free(text);
+	return valid;
+}
+
+
+/*
+* description: Decodes block payload and writes decoded file.
+* param[in]: file2 - Name of file to write decode.
+* param[in]: bs - The bitString with payload after file header.
+* param[in]: originalLength - Number of chars to decode.
+* return: 1 if payload could be decoded, else 0.
+*/
+int ansDecodeFile (char const *file2, bitString *bs, uint64_t originalLength) {
+
+	int64_t bitPos = 0;
+	unsigned char *text = NULL;
+
+	if (formatLengthFits(originalLength, bitStringGetSize(bs),
+						 ANSMAXPERBYTE)) {
+
+		text = malloc(originalLength > 0 ? originalLength : 1);
+	}
+	if (text == NULL) {
+
+		return 0;
+	}
+	int valid = ansBlocksDecode(bs, &bitPos, text, originalLength);
+
+	if (valid) {
+
+		valid = writePlainFile(file2, text, originalLength);
+	}
+
+	free(text);
+	return valid;
+}
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN ANS.C
+
+
+/* support function for ansTableBuild!
+* description: Normalizes histogram so counts sum to 2^tableLog.
+* param[in]: freqTable - Number of times each char is used.
+* param[in]: tableLog - Table size.
+* param[out]: norm - Normalized counts.
+* return: 1 if any char is used, else 0.
+*/
+int ansNormalize (const uint64_t *freqTable, int tableLog, uint32_t *norm) {
+
+	uint64_t total = 0;
+	int64_t tableSize = (int64_t)1 << tableLog;
+	int64_t sum = 0;
+
+	for (int s = 0; s < ANSSYMBOLS; s++) {
+
+		total = total + freqTable[s];
+	}
+	if (total == 0) {
+
+		return 0;
+	}
+
+	for (int s = 0; s < ANSSYMBOLS; s++) {
+
+		norm[s] = 0;
+		if (freqTable[s] > 0) {
+
+			norm[s] = (uint32_t)((double)freqTable[s] * tableSize / total + 0.5);
+			if (norm[s] == 0) {
+
+				norm[s] = 1;
+			}
+			sum = sum + norm[s];
+		}
+	}
+
+	//Rounding leaves the sum a few slots off. Slots are taken from the char
+	//with most of them, which loses least by it, and extra ones given to the
+	//most used char.
+	while (sum != tableSize) {
+
+		int best = -1;
+
+		for (int s = 0; s < ANSSYMBOLS; s++) {
+
+			if (sum > tableSize && norm[s] > 1 &&
+				(best < 0 || norm[s] > norm[best])) {
+
+				best = s;
+			} else if (sum < tableSize && freqTable[s] > 0 &&
+					   (best < 0 || freqTable[s] > freqTable[best])) {
+
+				best = s;
+			}
+		}
+
+		if (sum > tableSize) {
+
+			norm[best]--;
+			sum--;
+		} else {
+
+			norm[best]++;
+			sum++;
+		}
+	}
+	return 1;
+}
+
+
+/* support function for ansTableBuild and ansReadTable!
+* description: Spreads symbols over slots and builds encode and decode tables
+* from normalized counts.
+* param[in]: tableLog - Table size.
+* param[in]: norm - Normalized counts summing to 2^tableLog.
+* return: The table.
+*/
+ansTable *ansTableFromNorm (int tableLog, const uint32_t *norm) {
+
+	ansTable *table = malloc(sizeof(ansTable));
+	uint32_t tableSize = (uint32_t)1 << tableLog;
+	uint32_t mask = tableSize - 1;
+	uint32_t step = (tableSize >> 1) + (tableSize >> 3) + 3;
+	uint8_t *slotSymbol = malloc(tableSize);
+	uint32_t cumul[ANSSYMBOLS + 1];
+	uint32_t next[ANSSYMBOLS];
+	uint32_t slot = 0;
+
+	table -> tableLog = tableLog;
+	table -> decode = malloc(sizeof(ansDecodeEntry) * tableSize);
+	table -> stateTable = malloc(sizeof(uint16_t) * tableSize);
+
+	//Step is odd, so every slot is visited once and chars are spread out
+	//over the table.
+	cumul[0] = 0;
+	for (int s = 0; s < ANSSYMBOLS; s++) {
+
+		table -> norm[s] = norm[s];
+		cumul[s + 1] = cumul[s] + norm[s];
+		next[s] = norm[s];
+		for (uint32_t i = 0; i < norm[s]; i++) {
+
+			slotSymbol[slot] = (uint8_t)s;
+			slot = (slot + step) & mask;
+		}
+	}
+
+	for (uint32_t u = 0; u < tableSize; u++) {
+
+		int s = slotSymbol[u];
+		uint32_t x = next[s];
+		int bits = tableLog - (canonicalBitWidth(x) - 1);
+
+		next[s]++;
+		table -> decode[u].symbol = (uint8_t)s;
+		table -> decode[u].nrOfBits = (uint8_t)bits;
+		table -> decode[u].newState = (uint16_t)((x << bits) - tableSize);
+		table -> stateTable[cumul[s]] = (uint16_t)(tableSize + u);
+		cumul[s]++;
+	}
+
+	//Encoder state x in [tableSize, 2 * tableSize) of char s gives
+	//(x + deltaNrOfBits) >> 16 bits to write.
+	uint32_t start = 0;
+	for (int s = 0; s < ANSSYMBOLS; s++) {
+
+		table -> deltaNrOfBits[s] = 0;
+		table -> deltaFindState[s] = 0;
+		if (norm[s] > 0) {
+
+			int maxBits = tableLog - (canonicalBitWidth(norm[s] - 1) - 1);
+			table -> deltaNrOfBits[s] = (maxBits << 16) -
+										(int32_t)(norm[s] << maxBits);
+			table -> deltaFindState[s] = (int32_t)start - (int32_t)norm[s];
+			start = start + norm[s];
+		}
+	}
+
+	free(slotSymbol);
+	return table;
+}
+
+
+/* support function for ansCodeCost!
+* description: Computes base 2 logarithm in fixed point.
+* param[in]: value - Atleast 1.
+* return: log2(value) * 256, rounded down.
+*/
+uint32_t ansLog2 (uint32_t value) {
+
+	int high = canonicalBitWidth(value) - 1;
+	uint64_t mantissa = ((uint64_t)value << 16) >> high;
+	uint32_t result = high << 8;
+
+	//Squaring the mantissa doubles it's logarithm, so each overflow past 2
+	//is the next bit of the fraction.
+	for (uint32_t bit = 128; bit > 0; bit = bit >> 1) {
+
+		mantissa = (mantissa * mantissa) >> 16;
+		if (mantissa >= (1 << 17)) {
+
+			mantissa = mantissa >> 1;
+			result = result | bit;
+		}
+	}
+	return result;
+}
+
+
+/* support function for ansBlocksEncode!
+* description: Encodes one block with huffman or tANS.
+* param[in]: bs - The bitString.
+* param[in]: block - The chars of the block.
+* param[in]: n - Number of chars in block.
+* param[in]: backend - Backend to use, or ANSBACKENDAUTO.
+*/
+void ansEncodeBlock (bitString *bs, const unsigned char *block, int64_t n,
+					 int backend) {
+
+	uint64_t freqTable[ANSSYMBOLS] = {0};
+	uint8_t lengths[ANSSYMBOLS];
+	huffCode codeTable[ANSSYMBOLS];
+
+	for (int64_t i = 0; i < n; i++) {
+
+		freqTable[block[i]]++;
+	}
+	ansTable *table = ansTableBuild(freqTable, ansTableLogFor(freqTable));
+	canonicalCodeLengths(freqTable, ANSSYMBOLS, HUFFMAXCODELEN, lengths);
+
+	if (backend == ANSBACKENDAUTO) {
+
+		int64_t huffmanCost = canonicalLengthsCost(lengths, ANSSYMBOLS);
+		for (int s = 0; s < ANSSYMBOLS; s++) {
+
+			huffmanCost = huffmanCost + freqTable[s] * lengths[s];
+		}
+		backend = ansTableCost(table) + ansCodeCost(table, freqTable) <
+				  huffmanCost ? ANSBACKENDTANS : ANSBACKENDHUFFMAN;
+	}
+
+	canonicalWriteGamma(bs, n);
+	bitStringAddCode(bs, backend, 1);
+	if (backend == ANSBACKENDTANS) {
+
+		ansWriteTable(table, bs);
+		ansEncode(table, bs, block, n);
+	} else {
+
+		canonicalAssignCodes(lengths, ANSSYMBOLS, codeTable);
+		canonicalWriteLengths(bs, lengths, ANSSYMBOLS);
+		encodeBuffer(bs, block, n, codeTable);
+	}
+	ansTableKill(table);
+}
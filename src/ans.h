@@ -0,0 +1,235 @@
+/*
+* ans: Table based asymmetric numeral system (tANS) coder, and a block mode
+* where each block picks tANS or huffman, whichever is cheaper.
+*
+* A histogram of chars, the same counts freqAnalysis makes, is normalized to
+* 2^tableLog slots. Symbols are spread over the slots and each slot becomes a
+* decoder state telling the symbol, how many bits to read and the base of
+* the next state. Encoder runs backwards over the chars so decoder can read
+* states forwards.
+*
+* Payload after file header, one entry per block until all chars are coded:
+*   gamma(block length)
+*   1 bit backend, ANSBACKENDHUFFMAN or ANSBACKENDTANS
+*   huffman: code lengths of 256 chars, see canonicalWriteLengths, and codes
+*   tANS: 4 bits tableLog, gamma(number of used chars + 1), for each used char
+*         gamma(gap from previous) and gamma(normalized count), then tableLog
+*         bits start state and the bits read after each char but the last
+*/
+
+#ifndef ANS
+#define ANS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "huffTree.h"
+#include "bitString.h"
+#include "canonical.h"
+
+#define ANSSYMBOLS 256
+#define ANSMINTABLELOG 5
+#define ANSMAXTABLELOG 12
+#define ANSBLOCKSIZE (1 << 16)
+//Most chars decoded from a byte of payload. A tANS block takes atleast 16
+//bits, and a huffman block atleast a bit per char.
+#define ANSMAXPERBYTE (ANSBLOCKSIZE / 2)
+
+#define ANSBACKENDAUTO -1
+#define ANSBACKENDHUFFMAN 0
+#define ANSBACKENDTANS 1
+
+
+typedef struct ansDecodeEntry {
+
+	uint16_t newState;
+	uint8_t symbol;
+	uint8_t nrOfBits;
+} ansDecodeEntry;
+
+typedef struct ansTable {
+
+	int tableLog;
+	uint32_t norm[ANSSYMBOLS];
+	ansDecodeEntry *decode;
+	uint16_t *stateTable;
+	int32_t deltaNrOfBits[ANSSYMBOLS];
+	int32_t deltaFindState[ANSSYMBOLS];
+} ansTable;
+
+
+/*
+* description: Normalizes histogram to 2^tableLog and builds encode and
+* decode tables. Every used char gets atleast one slot.
+* param[in]: freqTable - Number of times each char is used, see freqAnalysis.
+* param[in]: tableLog - ANSMINTABLELOG to ANSMAXTABLELOG.
+* return: The table, NULL if no char is used.
+*/
+ansTable *ansTableBuild (const uint64_t *freqTable, int tableLog);
+
+
+/*
+* description: Frees memory of table.
+* param[in]: table - The table.
+*/
+void ansTableKill (ansTable *table);
+
+
+/*
+* description: Picks table size for a histogram, big enough to give each used
+* char a few slots and no bigger than the number of chars.
+* param[in]: freqTable - Number of times each char is used.
+* return: The tableLog.
+*/
+int ansTableLogFor (const uint64_t *freqTable);
+
+
+/*
+* description: Writes tableLog and normalized counts to bitString.
+* param[in]: table - The table.
+* param[in]: bs - The bitString.
+*/
+void ansWriteTable (ansTable *table, bitString *bs);
+
+
+/*
+* description: Reads tableLog and normalized counts from bitString and builds
+* the tables.
+* param[in]: bs - The bitString.
+* param[in]: bitPos - Position of next bit to read. Moved past the table.
+* return: The table, NULL if stored counts are invalid.
+*/
+ansTable *ansReadTable (bitString *bs, int64_t *bitPos);
+
+
+/*
+* description: Estimates bits needed to code chars of histogram with table,
+* table itself not included.
+* param[in]: table - The table.
+* param[in]: freqTable - Number of times each char is used.
+* return: Estimated number of bits.
+*/
+int64_t ansCodeCost (ansTable *table, const uint64_t *freqTable);
+
+
+/*
+* description: Estimates bits needed to write table.
+* param[in]: table - The table.
+* return: Number of bits.
+*/
+int64_t ansTableCost (ansTable *table);
+
+
+/*
+* description: Encodes chars and adds start state and bits to bitString.
+* param[in]: table - Table built from a histogram containing all the chars.
+* param[in]: bs - The bitString.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars, atleast 1.
+*/
+void ansEncode (ansTable *table, bitString *bs, const unsigned char *text,
+				int64_t length);
+
+
+/*
+* description: Decodes chars from bitString.
+* param[in]: table - The table.
+* param[in]: bs - The bitString.
+* param[in]: bitPos - Position of next bit to read. Moved past the chars.
+* param[out]: text - Array to store atleast length chars in.
+* param[in]: length - Number of chars to decode, atleast 1.
+*/
+void ansDecode (ansTable *table, bitString *bs, int64_t *bitPos,
+				unsigned char *text, int64_t length);
+
+
+/*
+* description: Encodes chars in memory block by block, each block with
+* backend of it's own.
+* param[in]: bs - The bitString.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[in]: blockSize - Largest number of chars in a block.
+* param[in]: backend - ANSBACKENDAUTO picks the cheaper backend per block,
+* else the backend to use for all blocks.
+*/
+void ansBlocksEncode (bitString *bs, const unsigned char *text,
+					  int64_t length, int64_t blockSize, int backend);
+
+
+/*
+* description: Decodes blocks from bitString. A tANS block holds atmost
+* ANSBLOCKSIZE chars.
+* param[in]: bs - The bitString.
+* param[in]: bitPos - Position of next bit to read. Moved past the blocks.
+* param[out]: text - Array to store atleast length chars in.
+* param[in]: length - Number of chars to decode.
+* return: 1 if all chars could be decoded, else 0.
+*/
+int ansBlocksDecode (bitString *bs, int64_t *bitPos, unsigned char *text,
+					 int64_t length);
+
+
+/*
+* description: Reads file, encodes it block by block and writes encoded file.
+* param[in]: file1 - Name of file to be read and encoded.
+* param[in]: file2 - Name of file to be written as encoded file.
+* return: 1 if file2 was written, else 0.
+*/
+int ansEncodeFile (char const *file1, char const *file2);
+
+
+/*
+* description: Decodes block payload and writes decoded file.
+* param[in]: file2 - Name of file to write decode.
+* param[in]: bs - The bitString with payload after file header.
+* param[in]: originalLength - Number of chars to decode.
+* return: 1 if payload could be decoded, else 0.
+*/
+int ansDecodeFile (char const *file2, bitString *bs, uint64_t originalLength);
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN ANS.C
+
+
+/* support function for ansTableBuild!
+* description: Normalizes histogram so counts sum to 2^tableLog.
+* param[in]: freqTable - Number of times each char is used.
+* param[in]: tableLog - Table size.
+* param[out]: norm - Normalized counts.
+* return: 1 if any char is used, else 0.
+*/
+int ansNormalize (const uint64_t *freqTable, int tableLog, uint32_t *norm);
+
+
+/* support function for ansTableBuild and ansReadTable!
+* description: Spreads symbols over slots and builds encode and decode tables
+* from normalized counts.
+* param[in]: tableLog - Table size.
+* param[in]: norm - Normalized counts summing to 2^tableLog.
+* return: The table.
+*/
+ansTable *ansTableFromNorm (int tableLog, const uint32_t *norm);
+
+
+/* support function for ansCodeCost!
+* description: Computes base 2 logarithm in fixed point.
+* param[in]: value - Atleast 1.
+* return: log2(value) * 256, rounded down.
+*/
+uint32_t ansLog2 (uint32_t value);
+
+
+/* support function for ansBlocksEncode!
+* description: Encodes one block with huffman or tANS.
+* param[in]: bs - The bitString.
+* param[in]: block - The chars of the block.
+* param[in]: n - Number of chars in block.
+* param[in]: backend - Backend to use, or ANSBACKENDAUTO.
+*/
+void ansEncodeBlock (bitString *bs, const unsigned char *block, int64_t n,
+					 int backend);
+
+
+#endif //ANS
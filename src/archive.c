@@ -0,0 +1,737 @@
+/*
+* archive: Indexed container of many coded members. See archive.h for the
+* layout.
+*/
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "archive.h"
+#include "batch.h"
+#include "encode.h"
+#include "format.h"
+#include "level.h"
+
+
+/*
+* description: Codes every file of source as a member and writes archive.
+* Members are coded at once by the workers.
+* param[in]: source - Directory, or file listing one file name per line.
+* Members are named by base name of each file.
+* param[in]: file2 - Name of archive to write.
+* param[in]: freqTable - Char counts of file0, for shared table.
+* param[in]: level - LEVELMIN to LEVELMAX to also try own tables of level,
+* below LEVELMIN for shared table only.
+* param[in]: workers - Pool coding members, NULL for calling thread.
+* param[in]: log - File to print totals to.
+* return: 1 if archive was written, else 0.
+*/
+int archiveCreate (char const *source, char const *file2,
+				   const uint64_t *freqTable, int level, pool *workers,
+				   FILE *log) {
+
+	int64_t count = 0;
+	char **paths = batchNames(source, &count);
+
+	if (paths == NULL) {
+
+		fprintf(stderr, "Could not read %s\n", source);
+		return 0;
+	}
+
+	//Every char gets a code, so any member can use the shared table.
+	uint64_t weights[ARCHIVESYMBOLS];
+	uint8_t lengths[ARCHIVESYMBOLS];
+	huffCode codes[ARCHIVESYMBOLS];
+	for (int i = 0; i < ARCHIVESYMBOLS; i++) {
+
+		weights[i] = freqTable[i] + 1;
+	}
+	canonicalCodeLengths(weights, ARCHIVESYMBOLS, HUFFMAXCODELEN, lengths);
+	canonicalAssignCodes(lengths, ARCHIVESYMBOLS, codes);
+
+	archiveMember *members = malloc(sizeof(archiveMember) * (count + 1));
+	for (int64_t i = 0; i < count; i++) {
+
+		char const *base = strrchr(paths[i], '/');
+		members[i].path = paths[i];
+		members[i].name = base != NULL ? base + 1 : paths[i];
+		members[i].codes = codes;
+		members[i].level = level;
+		members[i].payload = NULL;
+		members[i].valid = 0;
+	}
+	free(paths);
+	qsort(members, count, sizeof(archiveMember), archiveCompareName);
+
+	int valid = 1;
+	for (int64_t i = 0; i < count; i++) {
+
+		if (strlen(members[i].name) > ARCHIVEMAXNAME ||
+			(i > 0 && strcmp(members[i].name, members[i - 1].name) == 0)) {
+
+			fprintf(stderr, "Member name %s is too long or used twice\n",
+					members[i].name);
+			valid = 0;
+		}
+	}
+
+	//Members are coded at once, but written in name order after.
+	if (valid) {
+
+		poolGroup group;
+		poolGroupInit(&group);
+		for (int64_t i = 0; i < count; i++) {
+
+			if (workers != NULL) {
+
+				poolSubmit(workers, &group, archiveEncodeTask, &members[i]);
+			} else {
+
+				archiveEncodeTask(&members[i]);
+			}
+		}
+		if (workers != NULL) {
+
+			poolWait(workers, &group);
+		}
+	}
+
+	stream *out = valid ? streamOpenWrite(file2) : NULL;
+	if (out != NULL) {
+
+		unsigned char header[ARCHIVEHEADERSIZE];
+		unsigned char trailer[ARCHIVETRAILERSIZE];
+		unsigned char record[ARCHIVERECORDSIZE];
+		int64_t position = 0;
+		int64_t nrOfMembers = 0;
+		int64_t shared = 0;
+		uint64_t chars = 0;
+		uint32_t namesSize = 0;
+		bitString *table = bitStringEmpty();
+
+		memset(header, 0, ARCHIVEHEADERSIZE);
+		memcpy(header, ARCHIVEMAGIC, 4);
+		header[4] = ARCHIVEVERSION;
+		canonicalWriteLengths(table, lengths, ARCHIVESYMBOLS);
+		unsigned char *tableBytes = bitStringGetEncode(table);
+		int64_t tableSize = bitStringGetSize(table);
+
+		valid = streamWrite(out, header, ARCHIVEHEADERSIZE) &&
+				streamWrite(out, tableBytes, tableSize);
+		position = ARCHIVEHEADERSIZE + tableSize;
+
+		//Offset of each payload is kept in size of name, not needed after.
+		for (int64_t i = 0; i < count && valid; i++) {
+
+			if (!members[i].valid) {
+
+				fprintf(stderr, "Could not read %s\n", members[i].path);
+				continue;
+			}
+			valid = archivePad(out, &position) &&
+					streamWrite(out, members[i].payload, members[i].size);
+			members[i].valid = position + 1;
+			position = position + members[i].size;
+		}
+
+		int64_t indexOffset = position;
+		for (int64_t i = 0; i < count && valid; i++) {
+
+			if (!members[i].valid) {
+
+				continue;
+			}
+			memset(record, 0, ARCHIVERECORDSIZE);
+			formatPutU64(record, members[i].valid - 1);
+			formatPutU64(&record[8], members[i].size);
+			formatPutU64(&record[16], members[i].length);
+			formatPutU32(&record[24], namesSize);
+			record[28] = (unsigned char)(strlen(members[i].name) & 0xFF);
+			record[29] = (unsigned char)(strlen(members[i].name) >> 8);
+			record[30] = (unsigned char)members[i].mode;
+			record[31] = (unsigned char)members[i].table;
+			valid = streamWrite(out, record, ARCHIVERECORDSIZE);
+
+			namesSize = namesSize + strlen(members[i].name);
+			nrOfMembers++;
+			shared = shared + (members[i].table == ARCHIVESHAREDTABLE);
+			chars = chars + members[i].length;
+		}
+		for (int64_t i = 0; i < count && valid; i++) {
+
+			if (members[i].valid) {
+
+				valid = streamWrite(out, members[i].name,
+									strlen(members[i].name));
+			}
+		}
+
+		formatPutU64(trailer, ARCHIVEHEADERSIZE);
+		formatPutU64(&trailer[8], tableSize);
+		formatPutU64(&trailer[16], indexOffset);
+		formatPutU64(&trailer[24], nrOfMembers);
+		formatPutU32(&trailer[32], namesSize);
+		memcpy(&trailer[36], ARCHIVEINDEXMAGIC, 4);
+		valid = valid && streamWrite(out, trailer, ARCHIVETRAILERSIZE);
+		valid = streamClose(out) && valid && nrOfMembers == count;
+
+		fprintf(log, "%lld members, %lld with shared table, %llu chars, "
+				"%lld bytes\n", (long long)nrOfMembers, (long long)shared,
+				(unsigned long long)chars,
+				(long long)(indexOffset + nrOfMembers * ARCHIVERECORDSIZE +
+							namesSize + ARCHIVETRAILERSIZE));
+		bitStringKill(table);
+	} else if (valid) {
+
+		fprintf(stderr, "Could not write %s\n", file2);
+		valid = 0;
+	}
+
+	for (int64_t i = 0; i < count; i++) {
+
+		free(members[i].path);
+		free(members[i].payload);
+	}
+	free(members);
+	return valid;
+}
+
+
+/*
+* description: Maps archive and checks its trailer and index.
+* param[in]: file1 - Name of archive.
+* return: The archive, NULL if it can not be read or is not an archive.
+*/
+archive *archiveOpen (char const *file1) {
+
+	struct stat info;
+	int fd = open(file1, O_RDONLY);
+
+	if (fd < 0) {
+
+		return NULL;
+	}
+	if (fstat(fd, &info) != 0 ||
+		info.st_size < ARCHIVEHEADERSIZE + ARCHIVETRAILERSIZE) {
+
+		close(fd);
+		return NULL;
+	}
+
+	const unsigned char *base = mmap(NULL, info.st_size, PROT_READ,
+									 MAP_PRIVATE, fd, 0);
+	if (base == MAP_FAILED) {
+
+		close(fd);
+		return NULL;
+	}
+
+	//Sizes are checked by subtraction, so corrupt values can not overflow.
+	const unsigned char *trailer = &base[info.st_size - ARCHIVETRAILERSIZE];
+	uint64_t end = info.st_size - ARCHIVETRAILERSIZE;
+	uint64_t tableOffset = formatGetU64(trailer);
+	uint64_t tableSize = formatGetU64(&trailer[8]);
+	uint64_t indexOffset = formatGetU64(&trailer[16]);
+	uint64_t nrOfMembers = formatGetU64(&trailer[24]);
+	uint32_t namesSize = formatGetU32(&trailer[32]);
+
+	if (memcmp(base, ARCHIVEMAGIC, 4) != 0 || base[4] != ARCHIVEVERSION ||
+		memcmp(&trailer[36], ARCHIVEINDEXMAGIC, 4) != 0 ||
+		tableOffset < ARCHIVEHEADERSIZE || indexOffset > end ||
+		tableOffset > indexOffset || tableSize > indexOffset - tableOffset ||
+		nrOfMembers > (end - indexOffset) / ARCHIVERECORDSIZE ||
+		end - indexOffset - nrOfMembers * ARCHIVERECORDSIZE != namesSize) {
+
+		munmap((void *)base, info.st_size);
+		close(fd);
+		return NULL;
+	}
+
+	uint8_t lengths[ARCHIVESYMBOLS];
+	bitString *table = bitStringEmpty();
+	int64_t bitPos = 0;
+	bitStringAddBytes(table, &base[tableOffset], tableSize);
+	int validTable = canonicalReadLengths(table, &bitPos, lengths, ARCHIVESYMBOLS);
+	bitStringKill(table);
+	if (!validTable) {
+
+		munmap((void *)base, info.st_size);
+		close(fd);
+		return NULL;
+	}
+
+	archive *a = malloc(sizeof(archive));
+	a -> fd = fd;
+	a -> base = base;
+	a -> fileSize = info.st_size;
+	a -> records = &base[indexOffset];
+	a -> names = (const char *)&base[indexOffset +
+									 nrOfMembers * ARCHIVERECORDSIZE];
+	a -> nrOfMembers = nrOfMembers;
+	a -> indexOffset = indexOffset;
+	a -> namesSize = namesSize;
+	a -> dec = canonicalDecoderBuild(lengths, ARCHIVESYMBOLS);
+	return a;
+}
+
+
+/*
+* description: Unmaps archive and frees its memory.
+* param[in]: a - The archive.
+*/
+void archiveClose (archive *a) {
+
+	canonicalDecoderKill(a -> dec);
+	munmap((void *)a -> base, a -> fileSize);
+	close(a -> fd);
+	free(a);
+}
+
+
+/*
+* description: Finds member by name, by binary search of index.
+* param[in]: a - The archive.
+* param[in]: name - Name of member.
+* return: Index of member, -1 if there is none.
+*/
+int64_t archiveFind (archive *a, char const *name) {
+
+	size_t length = strlen(name);
+	int64_t low = 0;
+	int64_t high = a -> nrOfMembers - 1;
+	archiveEntry entry;
+
+	while (low <= high) {
+
+		int64_t middle = low + (high - low) / 2;
+		if (!archiveGetEntry(a, middle, &entry)) {
+
+			return -1;
+		}
+
+		size_t shortest = length < (size_t)entry.nameLength ? length :
+						  (size_t)entry.nameLength;
+		int order = memcmp(name, entry.name, shortest);
+		if (order == 0) {
+
+			order = (length > (size_t)entry.nameLength) -
+					(length < (size_t)entry.nameLength);
+		}
+		if (order == 0) {
+
+			return middle;
+		} else if (order < 0) {
+
+			high = middle - 1;
+		} else {
+
+			low = middle + 1;
+		}
+	}
+	return -1;
+}
+
+
+/*
+* description: Reads index record of member and checks it.
+* param[in]: a - The archive.
+* param[in]: i - Index of member.
+* param[out]: entry - The record. Name points into the map.
+* return: 1 if record is valid, else 0.
+*/
+int archiveGetEntry (archive *a, int64_t i, archiveEntry *entry) {
+
+	const unsigned char *record = &a -> records[i * ARCHIVERECORDSIZE];
+	uint32_t nameOffset = formatGetU32(&record[24]);
+
+	entry -> offset = formatGetU64(record);
+	entry -> size = formatGetU64(&record[8]);
+	entry -> length = formatGetU64(&record[16]);
+	entry -> nameLength = record[28] | (record[29] << 8);
+	entry -> name = &a -> names[nameOffset];
+	entry -> mode = record[30];
+	entry -> table = record[31];
+
+	//Shared table only codes static mode, own tables any mode of a level.
+	return entry -> offset >= ARCHIVEHEADERSIZE &&
+		   entry -> offset <= a -> indexOffset &&
+		   entry -> size <= a -> indexOffset - entry -> offset &&
+		   nameOffset <= a -> namesSize &&
+		   (uint32_t)entry -> nameLength <= a -> namesSize - nameOffset &&
+		   ((entry -> table == ARCHIVESHAREDTABLE &&
+			 entry -> mode == FORMATMODESTATIC) ||
+			(entry -> table == ARCHIVEOWNTABLE &&
+			 entry -> mode != FORMATMODESTATIC &&
+			 entry -> mode < FORMATMODEFRAMED));
+}
+
+
+/*
+* description: Decodes member. Allocates memory for the chars.
+* param[in]: a - The archive.
+* param[in]: i - Index of member.
+* param[out]: length - Number of chars.
+* return: The chars, NULL if member is corrupt.
+*/
+unsigned char *archiveExtract (archive *a, int64_t i, int64_t *length) {
+
+	archiveEntry entry;
+
+	*length = 0;
+	if (i < 0 || i >= a -> nrOfMembers || !archiveGetEntry(a, i, &entry)) {
+
+		return NULL;
+	}
+	//Every code of the shared table is atleast one bit.
+	if (entry.table == ARCHIVESHAREDTABLE && entry.length > entry.size * 8) {
+
+		return NULL;
+	}
+
+	unsigned char *text = malloc(entry.length + 1);
+	if (text == NULL) {
+
+		return NULL;
+	}
+
+	bitString *bs = bitStringEmpty();
+	int64_t bitPos = 0;
+	int valid = 1;
+	bitStringAddBytes(bs, &a -> base[entry.offset], entry.size);
+
+	if (entry.table == ARCHIVESHAREDTABLE) {
+
+		for (uint64_t j = 0; j < entry.length && valid; j++) {
+
+			int key = canonicalDecodeKey(a -> dec, bs, &bitPos);
+			text[j] = (unsigned char)key;
+			valid = key >= 0;
+		}
+	} else {
+
+		valid = levelDecode(bs, &bitPos, entry.mode, text, entry.length);
+	}
+
+	bitStringKill(bs);
+	if (!valid) {
+
+		free(text);
+		return NULL;
+	}
+	*length = entry.length;
+	return text;
+}
+
+
+/*
+* description: Decodes one member of archive to file.
+* param[in]: file1 - Name of archive.
+* param[in]: member - Name of member.
+* param[in]: file2 - Name of file to write, "-" for stdout.
+* return: 1 if member was found and written, else 0.
+*/
+int archiveExtractFile (char const *file1, char const *member,
+						char const *file2) {
+
+	archive *a = archiveOpen(file1);
+	int64_t length = 0;
+
+	if (a == NULL) {
+
+		fprintf(stderr, "%s is not an archive\n", file1);
+		return 0;
+	}
+
+	int64_t i = archiveFind(a, member);
+	unsigned char *text = archiveExtract(a, i, &length);
+	int valid = text != NULL;
+
+	if (i < 0) {
+
+		fprintf(stderr, "%s has no member %s\n", file1, member);
+	} else if (!valid) {
+
+		fprintf(stderr, "Member %s of %s is corrupt\n", member, file1);
+	} else {
+
+		valid = writePlainFile(file2, text, length);
+	}
+
+	free(text);
+	archiveClose(a);
+	return valid;
+}
+
+
+/*
+* description: Decodes every member of archive into directory, by workers.
+* param[in]: file1 - Name of archive.
+* param[in]: outDir - Directory to write to, made if it does not exist.
+* param[in]: workers - Pool decoding members, NULL for calling thread.
+* param[in]: log - File to print totals to.
+* return: 1 if every member was written, else 0.
+*/
+int archiveExtractAll (char const *file1, char const *outDir, pool *workers,
+					   FILE *log) {
+
+	archive *a = archiveOpen(file1);
+
+	if (a == NULL) {
+
+		fprintf(stderr, "%s is not an archive\n", file1);
+		return 0;
+	}
+	if (mkdir(outDir, 0777) != 0 && errno != EEXIST) {
+
+		fprintf(stderr, "Could not make directory %s\n", outDir);
+		archiveClose(a);
+		return 0;
+	}
+
+	archiveOutput *outputs = malloc(sizeof(archiveOutput) *
+									(a -> nrOfMembers + 1));
+	poolGroup group;
+	poolGroupInit(&group);
+	for (int64_t i = 0; i < a -> nrOfMembers; i++) {
+
+		outputs[i].a = a;
+		outputs[i].index = i;
+		outputs[i].outDir = outDir;
+		if (workers != NULL) {
+
+			poolSubmit(workers, &group, archiveExtractTask, &outputs[i]);
+		} else {
+
+			archiveExtractTask(&outputs[i]);
+		}
+	}
+	if (workers != NULL) {
+
+		poolWait(workers, &group);
+	}
+
+	int64_t failed = 0;
+	int64_t chars = 0;
+	for (int64_t i = 0; i < a -> nrOfMembers; i++) {
+
+		failed = failed + !outputs[i].valid;
+		chars = chars + outputs[i].length;
+	}
+	fprintf(log, "%lld members, %lld failed, %lld chars\n",
+			(long long)a -> nrOfMembers, (long long)failed, (long long)chars);
+
+	free(outputs);
+	archiveClose(a);
+	return failed == 0;
+}
+
+
+/*
+* description: Writes a tab separated line per member: chars, payload bytes,
+* mode, table and name.
+* param[in]: file1 - Name of archive.
+* param[in]: file2 - Name of file to write, "-" for stdout.
+* return: 1 if list was written, else 0.
+*/
+int archiveList (char const *file1, char const *file2) {
+
+	archive *a = archiveOpen(file1);
+	archiveEntry entry;
+	char line[128];
+
+	if (a == NULL) {
+
+		fprintf(stderr, "%s is not an archive\n", file1);
+		return 0;
+	}
+	stream *out = streamOpenWrite(file2);
+	if (out == NULL) {
+
+		fprintf(stderr, "Could not open %s\n", file2);
+		archiveClose(a);
+		return 0;
+	}
+
+	int valid = 1;
+	for (int64_t i = 0; i < a -> nrOfMembers && valid; i++) {
+
+		valid = archiveGetEntry(a, i, &entry);
+		if (valid) {
+
+			int n = snprintf(line, sizeof(line), "%llu\t%llu\t%d\t%s\t",
+							 (unsigned long long)entry.length,
+							 (unsigned long long)entry.size, entry.mode,
+							 entry.table == ARCHIVESHAREDTABLE ? "shared" :
+							 "own");
+			valid = streamWrite(out, line, n) &&
+					streamWrite(out, entry.name, entry.nameLength) &&
+					streamPutc(out, '\n');
+		}
+	}
+	if (!valid) {
+
+		fprintf(stderr, "%s is corrupt\n", file1);
+	}
+
+	valid = streamClose(out) && valid;
+	archiveClose(a);
+	return valid;
+}
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN ARCHIVE.C
+
+
+/* support function for archiveCreate!
+* description: Task coding one member, with shared table and own tables of
+* level, keeping the smallest.
+* param[in]: arg - The archiveMember, payload and sizes are set.
+*/
+void archiveEncodeTask (void *arg) {
+
+	archiveMember *member = arg;
+	int64_t length = 0;
+	unsigned char *text = readPlainFile(member -> path, &length);
+
+	if (text == NULL) {
+
+		return;
+	}
+
+	bitString *bs = bitStringEmpty();
+	encodeBuffer(bs, text, length, member -> codes);
+	unsigned char *encode = bitStringGetEncode(bs);
+	member -> size = bitStringGetSize(bs);
+	member -> length = length;
+	member -> mode = FORMATMODESTATIC;
+	member -> table = ARCHIVESHAREDTABLE;
+	member -> payload = malloc(member -> size + 1);
+	memcpy(member -> payload, encode, member -> size);
+	bitStringKill(bs);
+
+	if (member -> level >= LEVELMIN) {
+
+		bitString *own = bitStringEmpty();
+		int mode = levelEncode(own, text, length, member -> level);
+		unsigned char *ownEncode = bitStringGetEncode(own);
+		int64_t size = bitStringGetSize(own);
+
+		if (size < member -> size) {
+
+			member -> size = size;
+			member -> mode = mode;
+			member -> table = ARCHIVEOWNTABLE;
+			memcpy(member -> payload, ownEncode, size);
+		}
+		bitStringKill(own);
+	}
+
+	//Stored chars are a payload of levelDecode too.
+	if (member -> size > length) {
+
+		member -> size = length;
+		member -> mode = FORMATMODESTORED;
+		member -> table = ARCHIVEOWNTABLE;
+		memcpy(member -> payload, text, length);
+	}
+
+	free(text);
+	member -> valid = 1;
+}
+
+
+/* support function for archiveCreate!
+* description: Writes zero bytes until position is a multiple of
+* ARCHIVEALIGN.
+* param[in]: out - Stream of archive.
+* param[in,out]: position - Position in archive.
+* return: 1 if bytes were written, else 0.
+*/
+int archivePad (stream *out, int64_t *position) {
+
+	unsigned char zeros[ARCHIVEALIGN];
+	int64_t pad = (ARCHIVEALIGN - *position % ARCHIVEALIGN) % ARCHIVEALIGN;
+
+	memset(zeros, 0, ARCHIVEALIGN);
+	*position = *position + pad;
+	return streamWrite(out, zeros, pad);
+}
+
+
+/* support function for archiveExtractAll!
+* description: Task decoding one member to its file.
+* param[in]: arg - The archiveOutput, length and valid are set.
+*/
+void archiveExtractTask (void *arg) {
+
+	archiveOutput *output = arg;
+	archiveEntry entry;
+
+	output -> length = 0;
+	output -> valid = 0;
+	if (!archiveGetEntry(output -> a, output -> index, &entry) ||
+		!archiveSafeName(&entry)) {
+
+		fprintf(stderr, "Member %lld has a corrupt index record\n",
+				(long long)output -> index);
+		return;
+	}
+
+	char *name = malloc(strlen(output -> outDir) + entry.nameLength + 2);
+	sprintf(name, "%s/%.*s", output -> outDir, entry.nameLength, entry.name);
+	unsigned char *text = archiveExtract(output -> a, output -> index,
+										 &output -> length);
+
+	if (text == NULL) {
+
+		fprintf(stderr, "Member %s is corrupt\n", name);
+	} else {
+
+		output -> valid = writePlainFile(name, text, output -> length);
+	}
+	free(text);
+	free(name);
+}
+
+
+/* support function for archiveExtractAll!
+* description: Checks that name of member can only make a file in the
+* output directory.
+* param[in]: entry - The member.
+* return: 1 if name is safe, else 0.
+*/
+int archiveSafeName (const archiveEntry *entry) {
+
+	if (entry -> nameLength == 0 ||
+		(entry -> nameLength == 1 && entry -> name[0] == '.') ||
+		(entry -> nameLength == 2 && memcmp(entry -> name, "..", 2) == 0)) {
+
+		return 0;
+	}
+	for (int i = 0; i < entry -> nameLength; i++) {
+
+		if (entry -> name[i] == '/' || entry -> name[i] == '\0') {
+
+			return 0;
+		}
+	}
+	return 1;
+}
+
+
+/* support function for archiveCreate!
+* description: Compares members by name, for qsort.
+* param[in]: a - First archiveMember.
+* param[in]: b - Second archiveMember.
+* return: Negative, 0 or positive as a is before, same as or after b.
+*/
+int archiveCompareName (const void *a, const void *b) {
+
+	return strcmp(((const archiveMember *)a) -> name,
+				  ((const archiveMember *)b) -> name);
+}
@@ -0,0 +1,253 @@
+/*
+* archive: One file holding many coded members, with an index at the end so
+* one member can be listed or extracted without reading the others.
+*
+* Members are coded with a table shared by the whole archive, built from
+* file0, or with their own tables by the engine of a level, whichever is
+* smaller. The index is sorted by name. An archive is opened by mapping it
+* with mmap and reading its fixed size trailer, so opening, finding a member
+* and extracting it cost the same however big the archive is. Payloads start
+* at multiples of ARCHIVEALIGN, so they can be used in place from the map.
+*
+* Layout, integers little endian:
+*   16 bytes  header: ARCHIVEMAGIC, version, 11 reserved bytes
+*   shared table, code lengths written by canonicalWriteLengths
+*   payload of each member
+*   index, a record of ARCHIVERECORDSIZE bytes per member:
+*     8 bytes  offset of payload
+*     8 bytes  number of payload bytes
+*     8 bytes  number of chars in member
+*     4 bytes  offset of name in name area
+*     2 bytes  number of chars in name
+*     1 byte   mode of payload, see format.h
+*     1 byte   ARCHIVESHAREDTABLE or ARCHIVEOWNTABLE
+*   name area, the names without terminators
+*   trailer of ARCHIVETRAILERSIZE bytes:
+*     8 bytes  offset of shared table
+*     8 bytes  number of bytes of shared table
+*     8 bytes  offset of index
+*     8 bytes  number of members
+*     4 bytes  number of bytes of name area
+*     4 bytes  ARCHIVEINDEXMAGIC
+* Members with the shared table have mode FORMATMODESTATIC, with their own
+* tables a mode of levelEncode, or FORMATMODESTORED.
+*/
+
+#ifndef ARCHIVE
+#define ARCHIVE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "huffTree.h"
+#include "canonical.h"
+#include "stream.h"
+#include "pool.h"
+
+#define ARCHIVEMAGIC "HUFA"
+#define ARCHIVEINDEXMAGIC "HUFI"
+#define ARCHIVEVERSION 1
+#define ARCHIVEHEADERSIZE 16
+#define ARCHIVERECORDSIZE 32
+#define ARCHIVETRAILERSIZE 40
+#define ARCHIVEALIGN 8
+#define ARCHIVESHAREDTABLE 0
+#define ARCHIVEOWNTABLE 1
+#define ARCHIVEMAXNAME 65535
+#define ARCHIVESYMBOLS 256
+
+
+typedef struct archiveEntry {
+
+	const char *name;
+	int nameLength;
+	uint64_t offset;
+	uint64_t size;
+	uint64_t length;
+	int mode;
+	int table;
+} archiveEntry;
+
+
+typedef struct archive {
+
+	int fd;
+	const unsigned char *base;
+	int64_t fileSize;
+	const unsigned char *records;
+	const char *names;
+	int64_t nrOfMembers;
+	uint64_t indexOffset;
+	uint32_t namesSize;
+	canonicalDecoder *dec;
+} archive;
+
+
+/*
+* description: Codes every file of source as a member and writes archive.
+* Members are coded at once by the workers.
+* param[in]: source - Directory, or file listing one file name per line.
+* Members are named by base name of each file.
+* param[in]: file2 - Name of archive to write.
+* param[in]: freqTable - Char counts of file0, for shared table.
+* param[in]: level - LEVELMIN to LEVELMAX to also try own tables of level,
+* below LEVELMIN for shared table only.
+* param[in]: workers - Pool coding members, NULL for calling thread.
+* param[in]: log - File to print totals to.
+* return: 1 if archive was written, else 0.
+*/
+int archiveCreate (char const *source, char const *file2,
+				   const uint64_t *freqTable, int level, pool *workers,
+				   FILE *log);
+
+
+/*
+* description: Maps archive and checks its trailer and index.
+* param[in]: file1 - Name of archive.
+* return: The archive, NULL if it can not be read or is not an archive.
+*/
+archive *archiveOpen (char const *file1);
+
+
+/*
+* description: Unmaps archive and frees its memory.
+* param[in]: a - The archive.
+*/
+void archiveClose (archive *a);
+
+
+/*
+* description: Finds member by name, by binary search of index.
+* param[in]: a - The archive.
+* param[in]: name - Name of member.
+* return: Index of member, -1 if there is none.
+*/
+int64_t archiveFind (archive *a, char const *name);
+
+
+/*
+* description: Reads index record of member and checks it.
+* param[in]: a - The archive.
+* param[in]: i - Index of member.
+* param[out]: entry - The record. Name points into the map.
+* return: 1 if record is valid, else 0.
+*/
+int archiveGetEntry (archive *a, int64_t i, archiveEntry *entry);
+
+
+/*
+* description: Decodes member. Allocates memory for the chars.
+* param[in]: a - The archive.
+* param[in]: i - Index of member.
+* param[out]: length - Number of chars.
+* return: The chars, NULL if member is corrupt.
+*/
+unsigned char *archiveExtract (archive *a, int64_t i, int64_t *length);
+
+
+/*
+* description: Decodes one member of archive to file.
+* param[in]: file1 - Name of archive.
+* param[in]: member - Name of member.
+* param[in]: file2 - Name of file to write, "-" for stdout.
+* return: 1 if member was found and written, else 0.
+*/
+int archiveExtractFile (char const *file1, char const *member,
+						char const *file2);
+
+
+/*
+* description: Decodes every member of archive into directory, by workers.
+* param[in]: file1 - Name of archive.
+* param[in]: outDir - Directory to write to, made if it does not exist.
+* param[in]: workers - Pool decoding members, NULL for calling thread.
+* param[in]: log - File to print totals to.
+* return: 1 if every member was written, else 0.
+*/
+int archiveExtractAll (char const *file1, char const *outDir, pool *workers,
+					   FILE *log);
+
+
+/*
+* description: Writes a tab separated line per member: chars, payload bytes,
+* mode, table and name.
+* param[in]: file1 - Name of archive.
+* param[in]: file2 - Name of file to write, "-" for stdout.
+* return: 1 if list was written, else 0.
+*/
+int archiveList (char const *file1, char const *file2);
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN ARCHIVE.C
+
+
+typedef struct archiveMember {
+
+	char *path;
+	const char *name;
+	const huffCode *codes;
+	int level;
+	unsigned char *payload;
+	int64_t size;
+	int64_t length;
+	int mode;
+	int table;
+	int valid;
+} archiveMember;
+
+
+typedef struct archiveOutput {
+
+	archive *a;
+	int64_t index;
+	const char *outDir;
+	int64_t length;
+	int valid;
+} archiveOutput;
+
+
+/* support function for archiveCreate!
+* description: Task coding one member, with shared table and own tables of
+* level, keeping the smallest.
+* param[in]: arg - The archiveMember, payload and sizes are set.
+*/
+void archiveEncodeTask (void *arg);
+
+
+/* support function for archiveCreate!
+* description: Writes zero bytes until position is a multiple of
+* ARCHIVEALIGN.
+* param[in]: out - Stream of archive.
+* param[in,out]: position - Position in archive.
+* return: 1 if bytes were written, else 0.
+*/
+int archivePad (stream *out, int64_t *position);
+
+
+/* support function for archiveExtractAll!
+* description: Task decoding one member to its file.
+* param[in]: arg - The archiveOutput, length and valid are set.
+*/
+void archiveExtractTask (void *arg);
+
+
+/* support function for archiveExtractAll!
+* description: Checks that name of member can only make a file in the
+* output directory.
+* param[in]: entry - The member.
+* return: 1 if name is safe, else 0.
+*/
+int archiveSafeName (const archiveEntry *entry);
+
+
+/* support function for archiveCreate!
+* description: Compares members by name, for qsort.
+* param[in]: a - First archiveMember.
+* param[in]: b - Second archiveMember.
+* return: Negative, 0 or positive as a is before, same as or after b.
+*/
+int archiveCompareName (const void *a, const void *b);
+
+
+#endif //ARCHIVE
@@ -0,0 +1,454 @@
+/*
+* batch: Coding of many files with one shared table. See batch.h.
+*/
+
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "batch.h"
+#include "encode.h"
+#include "decode.h"
+#include "format.h"
+
+
+/*
+* description: Encodes or decodes every file of source into outDir, using
+* the workers of config, and writes manifest and total throughput.
+* param[in]: encode - 1 to encode, 0 to decode.
+* param[in]: source - Directory, or file listing one file name per line.
+* param[in]: outDir - Directory to write to, made if it does not exist.
+* param[in]: tree - Shared huffman tree coding every file.
+* param[in]: config - Pipeline options, its pool runs the files.
+* param[in]: log - File to print totals to.
+* return: 1 if every file was coded, else 0.
+*/
+int batchRun (int encode, char const *source, char const *outDir,
+			  huffTree *tree, const pipelineConfig *config, FILE *log) {
+
+	batchJob job;
+
+	job.encode = encode;
+	job.tree = tree;
+	job.config = *config;
+	//Pool is busy with whole files, so frames of a file are coded in its
+	//own pipeline. A worker waiting on the pool from inside a task could
+	//leave no worker to run the frames.
+	job.config.workers = NULL;
+
+	if (mkdir(outDir, 0777) != 0 && errno != EEXIST) {
+
+		fprintf(stderr, "Could not make directory %s\n", outDir);
+		return 0;
+	}
+	if (!batchList(&job, source, outDir)) {
+
+		fprintf(stderr, "Could not read %s\n", source);
+		return 0;
+	}
+
+	batchItem **order = malloc(sizeof(batchItem *) * (job.nrOfItems + 1));
+	for (int64_t i = 0; i < job.nrOfItems; i++) {
+
+		order[i] = &job.items[i];
+	}
+
+	//Outputs are named by base name, so two inputs can get one output. Only
+	//the first of them in name order is coded, the others fail.
+	qsort(order, job.nrOfItems, sizeof(batchItem *), batchCompareOutput);
+	for (int64_t i = 1; i < job.nrOfItems; i++) {
+
+		if (strcmp(order[i] -> output, order[i - 1] -> output) == 0) {
+
+			fprintf(stderr, "Output name %s is used twice, %s is not coded\n",
+					order[i] -> output, order[i] -> input);
+			order[i] -> twice = 1;
+		}
+	}
+	qsort(order, job.nrOfItems, sizeof(batchItem *), batchCompareSize);
+
+	double start = batchNow();
+	poolGroup group;
+	poolGroupInit(&group);
+	for (int64_t i = 0; i < job.nrOfItems; i++) {
+
+		if (order[i] -> twice) {
+
+			continue;
+		} else if (config -> workers != NULL) {
+
+			poolSubmit(config -> workers, &group, batchTask, order[i]);
+		} else {
+
+			batchTask(order[i]);
+		}
+	}
+	if (config -> workers != NULL) {
+
+		poolWait(config -> workers, &group);
+	}
+	double seconds = batchNow() - start;
+
+	int64_t failed = 0;
+	int64_t inTotal = 0;
+	int64_t outTotal = 0;
+	for (int64_t i = 0; i < job.nrOfItems; i++) {
+
+		failed = failed + !job.items[i].valid;
+		inTotal = inTotal + job.items[i].inSize;
+		outTotal = outTotal + job.items[i].outSize;
+	}
+	int valid = batchWriteManifest(&job, outDir) && failed == 0;
+
+	//Throughput is counted in plain chars, read when encoding and written
+	//when decoding.
+	int64_t plain = encode ? inTotal : outTotal;
+	fprintf(log, "%lld files, %lld failed, %lld bytes in, %lld bytes out\n",
+			(long long)job.nrOfItems, (long long)failed, (long long)inTotal,
+			(long long)outTotal);
+	fprintf(log, "%.3f s, %.1f MB/s, %.0f files/s on %d threads\n", seconds,
+			seconds > 0 ? plain / seconds / 1e6 : 0.0,
+			seconds > 0 ? job.nrOfItems / seconds : 0.0,
+			poolSize(config -> workers));
+
+	for (int64_t i = 0; i < job.nrOfItems; i++) {
+
+		free(job.items[i].input);
+		free(job.items[i].output);
+	}
+	free(job.items);
+	free(order);
+	return valid;
+}
+
+
+/*
+* description: Gets names of every file in source, sorted by name.
+* param[in]: source - Directory, or file listing one file name per line.
+* param[out]: count - Number of names.
+* return: Allocated array of allocated names, NULL if source could not be
+* read.
+*/
+char **batchNames (char const *source, int64_t *count) {
+
+	struct stat info;
+	int64_t capacity = 64;
+	char **names = NULL;
+
+	*count = 0;
+	if (stat(source, &info) != 0) {
+
+		return NULL;
+	}
+
+	if (S_ISDIR(info.st_mode)) {
+
+		DIR *dir = opendir(source);
+		struct dirent *entry = NULL;
+
+		if (dir == NULL) {
+
+			return NULL;
+		}
+		names = malloc(sizeof(char *) * capacity);
+		while ((entry = readdir(dir)) != NULL) {
+
+			char *name = malloc(strlen(source) + strlen(entry -> d_name) + 2);
+			sprintf(name, "%s/%s", source, entry -> d_name);
+
+			//Manifest of an earlier run is not one of the files.
+			if (stat(name, &info) != 0 || !S_ISREG(info.st_mode) ||
+				strcmp(entry -> d_name, BATCHMANIFEST) == 0) {
+
+				free(name);
+				continue;
+			}
+			if (*count == capacity) {
+
+				capacity = capacity * 2;
+				names = realloc(names, sizeof(char *) * capacity);
+			}
+			names[*count] = name;
+			(*count)++;
+		}
+		closedir(dir);
+	} else {
+
+		int64_t length = 0;
+		unsigned char *text = readPlainFile(source, &length);
+		int64_t begin = 0;
+
+		if (text == NULL) {
+
+			return NULL;
+		}
+		names = malloc(sizeof(char *) * capacity);
+		for (int64_t i = 0; i <= length; i++) {
+
+			if (i < length && text[i] != '\n') {
+
+				continue;
+			}
+			int64_t end = i;
+			if (end > begin && text[end - 1] == '\r') {
+
+				end--;
+			}
+			if (end > begin) {
+
+				if (*count == capacity) {
+
+					capacity = capacity * 2;
+					names = realloc(names, sizeof(char *) * capacity);
+				}
+				names[*count] = malloc(end - begin + 1);
+				memcpy(names[*count], &text[begin], end - begin);
+				names[*count][end - begin] = '\0';
+				(*count)++;
+			}
+			begin = i + 1;
+		}
+		free(text);
+	}
+
+	qsort(names, *count, sizeof(char *), batchCompareName);
+	return names;
+}
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN BATCH.C
+
+
+/* support function for batchRun!
+* description: Makes items of every file in source, sorted by name.
+* param[in]: job - The batchJob, items are set.
+* param[in]: source - Directory or list file.
+* param[in]: outDir - Directory outputs are written to.
+* return: 1 if source could be read, else 0.
+*/
+int batchList (batchJob *job, char const *source, char const *outDir) {
+
+	int64_t count = 0;
+	char **names = batchNames(source, &count);
+
+	if (names == NULL) {
+
+		return 0;
+	}
+
+	job -> items = malloc(sizeof(batchItem) * (count + 1));
+	job -> nrOfItems = 0;
+	for (int64_t i = 0; i < count; i++) {
+
+		batchAdd(job, names[i], outDir);
+		job -> items[i].job = job;
+		free(names[i]);
+	}
+	free(names);
+	return 1;
+}
+
+
+/* support function for batchList!
+* description: Adds item of input name, with output name in outDir. Items
+* must have room for it.
+* param[in]: job - The batchJob.
+* param[in]: input - Name of input file.
+* param[in]: outDir - Directory outputs are written to.
+*/
+void batchAdd (batchJob *job, char const *input, char const *outDir) {
+
+	struct stat info;
+	char const *base = strrchr(input, '/');
+	base = base != NULL ? base + 1 : input;
+	size_t baseLength = strlen(base);
+	size_t suffixLength = strlen(BATCHSUFFIX);
+
+	batchItem *item = &job -> items[job -> nrOfItems];
+	job -> nrOfItems++;
+
+	item -> input = malloc(strlen(input) + 1);
+	strcpy(item -> input, input);
+	item -> output = malloc(strlen(outDir) + baseLength + suffixLength +
+							strlen(BATCHPLAINSUFFIX) + 2);
+	sprintf(item -> output, "%s/%s", outDir, base);
+
+	//Decoded name drops suffix, or gets one so it never is the input.
+	if (job -> encode) {
+
+		strcat(item -> output, BATCHSUFFIX);
+	} else if (baseLength > suffixLength &&
+			   strcmp(&base[baseLength - suffixLength], BATCHSUFFIX) == 0) {
+
+		item -> output[strlen(item -> output) - suffixLength] = '\0';
+	} else {
+
+		strcat(item -> output, BATCHPLAINSUFFIX);
+	}
+
+	item -> inSize = stat(input, &info) == 0 ? info.st_size : 0;
+	item -> outSize = 0;
+	item -> valid = 0;
+	item -> twice = 0;
+}
+
+
+/* support function for batchRun!
+* description: Task coding one file.
+* param[in]: arg - The batchItem, sizes and valid are set.
+*/
+void batchTask (void *arg) {
+
+	batchItem *item = arg;
+	batchJob *job = item -> job;
+	struct stat info;
+
+	if (job -> encode) {
+
+		item -> valid = batchEncode(item);
+		return;
+	}
+
+	item -> valid = decodeFile(item -> input, item -> output, job -> tree,
+							   &job -> config);
+	if (!item -> valid) {
+
+		fprintf(stderr, "\n");
+	}
+	item -> outSize = stat(item -> output, &info) == 0 ? info.st_size : 0;
+}
+
+
+/* support function for batchTask!
+* description: Encodes file of item with shared tree into static mode file.
+* param[in]: item - The batchItem, sizes are set.
+* return: 1 if file was read and written, else 0.
+*/
+int batchEncode (batchItem *item) {
+
+	int64_t length = 0;
+	unsigned char *text = readPlainFile(item -> input, &length);
+
+	if (text == NULL) {
+
+		fprintf(stderr, "Could not read %s\n", item -> input);
+		return 0;
+	}
+
+	bitString *bs = bitStringEmpty();
+	encodeBuffer(bs, text, length, item -> job -> tree -> codeTable);
+	//Last partial byte is padded by getting the encode, before the size.
+	unsigned char *encode = bitStringGetEncode(bs);
+	int64_t size = bitStringGetSize(bs);
+	stream *out = streamOpenWrite(item -> output);
+	int valid = out != NULL;
+
+	if (valid) {
+
+		valid = formatWriteHeader(out, FORMATMODESTATIC, length) &&
+				streamWrite(out, encode, size);
+		valid = streamClose(out) && valid;
+	}
+	if (!valid) {
+
+		fprintf(stderr, "Could not write %s\n", item -> output);
+	}
+
+	item -> inSize = length;
+	item -> outSize = FORMATHEADERSIZE + size;
+	bitStringKill(bs);
+	free(text);
+	return valid;
+}
+
+
+/* support function for batchRun!
+* description: Writes one line per item to BATCHMANIFEST of outDir.
+* param[in]: job - The batchJob.
+* param[in]: outDir - Directory outputs are written to.
+* return: 1 if manifest was written, else 0.
+*/
+int batchWriteManifest (batchJob *job, char const *outDir) {
+
+	char *name = malloc(strlen(outDir) + strlen(BATCHMANIFEST) + 2);
+	sprintf(name, "%s/%s", outDir, BATCHMANIFEST);
+	FILE *fp = fopen(name, "w");
+
+	if (fp == NULL) {
+
+		fprintf(stderr, "Could not write %s\n", name);
+		free(name);
+		return 0;
+	}
+
+	for (int64_t i = 0; i < job -> nrOfItems; i++) {
+
+		batchItem *item = &job -> items[i];
+		fprintf(fp, "%s\t%lld\t%lld\t%s\t%s\n",
+				item -> valid ? "ok" : "failed", (long long)item -> inSize,
+				(long long)item -> outSize, item -> input, item -> output);
+	}
+
+	int valid = fclose(fp) == 0;
+	free(name);
+	return valid;
+}
+
+
+/* support function for batchNames!
+* description: Compares name pointers, for qsort.
+* param[in]: a - First name pointer.
+* param[in]: b - Second name pointer.
+* return: Negative, 0 or positive as a is before, same as or after b.
+*/
+int batchCompareName (const void *a, const void *b) {
+
+	return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+
+/* support function for batchRun!
+* description: Compares item pointers by input size, largest first, for
+* qsort.
+* param[in]: a - First batchItem pointer.
+* param[in]: b - Second batchItem pointer.
+* return: Negative, 0 or positive as a is before, same as or after b.
+*/
+int batchCompareSize (const void *a, const void *b) {
+
+	int64_t sizeA = (*(batchItem * const *)a) -> inSize;
+	int64_t sizeB = (*(batchItem * const *)b) -> inSize;
+
+	return (sizeA < sizeB) - (sizeA > sizeB);
+}
+
+
+/* support function for batchRun!
+* description: Compares item pointers by output name, and items with the
+* same output name by their place in name order, for qsort.
+* param[in]: a - First batchItem pointer.
+* param[in]: b - Second batchItem pointer.
+* return: Negative, 0 or positive as a is before, same as or after b.
+*/
+int batchCompareOutput (const void *a, const void *b) {
+
+	const batchItem *itemA = *(batchItem * const *)a;
+	const batchItem *itemB = *(batchItem * const *)b;
+	int order = strcmp(itemA -> output, itemB -> output);
+
+	return order != 0 ? order : (itemA > itemB) - (itemA < itemB);
+}
+
+
+/* support function for batchRun!
+* description: Gets time from a monotonic clock.
+* return: Time in seconds.
+*/
+double batchNow (void) {
+
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
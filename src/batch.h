@@ -0,0 +1,166 @@
+/*
+* batch: Encodes or decodes many files in one run, with one shared huffman
+* table built from file0, so the table and the process are only set up once.
+*
+* Files are given as a directory, whose regular files are all used, or as a
+* list file with one name per line. Each file is coded by its own pool task.
+* Tasks are queued largest file first, so that one big file queued last does
+* not keep the run going after the other workers are done. Outputs are
+* written to an output directory under the base name of each input. Encoded
+* names get BATCHSUFFIX, and decoded names lose it, or get BATCHPLAINSUFFIX
+* if they have none. Inputs sharing a base name would share an output, so
+* only the first of them in name order is coded and the others fail.
+*
+* BATCHMANIFEST in the output directory gets one tab separated line per
+* file, in name order:
+*   ok or failed, input size, output size, input name, output name
+*/
+
+#ifndef BATCH
+#define BATCH
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "huffTree.h"
+#include "pipeline.h"
+#include "pool.h"
+
+#define BATCHSUFFIX ".huf"
+#define BATCHPLAINSUFFIX ".out"
+#define BATCHMANIFEST "MANIFEST"
+
+
+typedef struct batchItem {
+
+	char *input;
+	char *output;
+	int64_t inSize;
+	int64_t outSize;
+	int valid;
+	//1 if an input before it in name order has the same output.
+	int twice;
+	struct batchJob *job;
+} batchItem;
+
+
+typedef struct batchJob {
+
+	int encode;
+	huffTree *tree;
+	pipelineConfig config;
+	batchItem *items;
+	int64_t nrOfItems;
+} batchJob;
+
+
+/*
+* description: Encodes or decodes every file of source into outDir, using
+* the workers of config, and writes manifest and total throughput.
+* param[in]: encode - 1 to encode, 0 to decode.
+* param[in]: source - Directory, or file listing one file name per line.
+* param[in]: outDir - Directory to write to, made if it does not exist.
+* param[in]: tree - Shared huffman tree coding every file.
+* param[in]: config - Pipeline options, its pool runs the files.
+* param[in]: log - File to print totals to.
+* return: 1 if every file was coded, else 0.
+*/
+int batchRun (int encode, char const *source, char const *outDir,
+			  huffTree *tree, const pipelineConfig *config, FILE *log);
+
+
+/*
+* description: Gets names of every file in source, sorted by name.
+* param[in]: source - Directory, or file listing one file name per line.
+* param[out]: count - Number of names.
+* return: Allocated array of allocated names, NULL if source could not be
+* read.
+*/
+char **batchNames (char const *source, int64_t *count);
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN BATCH.C
+
+
+/* support function for batchRun!
+* description: Makes items of every file in source, sorted by name.
+* param[in]: job - The batchJob, items are set.
+* param[in]: source - Directory or list file.
+* param[in]: outDir - Directory outputs are written to.
+* return: 1 if source could be read, else 0.
+*/
+int batchList (batchJob *job, char const *source, char const *outDir);
+
+
+/* support function for batchList!
+* description: Adds item of input name, with output name in outDir. Items
+* must have room for it.
+* param[in]: job - The batchJob.
+* param[in]: input - Name of input file.
+* param[in]: outDir - Directory outputs are written to.
+*/
+void batchAdd (batchJob *job, char const *input, char const *outDir);
+
+
+/* support function for batchRun!
+* description: Task coding one file.
+* param[in]: arg - The batchItem, sizes and valid are set.
+*/
+void batchTask (void *arg);
+
+
+/* support function for batchTask!
+* description: Encodes file of item with shared tree into static mode file.
+* param[in]: item - The batchItem, sizes are set.
+* return: 1 if file was read and written, else 0.
+*/
+int batchEncode (batchItem *item);
+
+
+/* support function for batchRun!
+* description: Writes one line per item to BATCHMANIFEST of outDir.
+* param[in]: job - The batchJob.
+* param[in]: outDir - Directory outputs are written to.
+* return: 1 if manifest was written, else 0.
+*/
+int batchWriteManifest (batchJob *job, char const *outDir);
+
+
+/* support function for batchNames!
+* description: Compares name pointers, for qsort.
+* param[in]: a - First name pointer.
+* param[in]: b - Second name pointer.
+* return: Negative, 0 or positive as a is before, same as or after b.
+*/
+int batchCompareName (const void *a, const void *b);
+
+
+/* support function for batchRun!
+* description: Compares item pointers by input size, largest first, for
+* qsort.
+* param[in]: a - First batchItem pointer.
+* param[in]: b - Second batchItem pointer.
+* return: Negative, 0 or positive as a is before, same as or after b.
+*/
+int batchCompareSize (const void *a, const void *b);
+
+
+/* support function for batchRun!
+* description: Compares item pointers by output name, and items with the
+* same output name by their place in name order, for qsort.
+* param[in]: a - First batchItem pointer.
+* param[in]: b - Second batchItem pointer.
+* return: Negative, 0 or positive as a is before, same as or after b.
+*/
+int batchCompareOutput (const void *a, const void *b);
+
+
+/* support function for batchRun!
+* description: Gets time from a monotonic clock.
+* return: Time in seconds.
+*/
+double batchNow (void);
+
+
+#endif //BATCH
@@ -0,0 +1,1432 @@
+/*
+* Benchmark program for the coding engines.
+*
+* Reads a file into memory and encodes and decodes it with each engine,
+* reporting compressed size and speed. Decoded text is compared with the
+* original so a broken engine can not report a good result. The file is also
+* cut into small messages, coded one at a time with reused contexts, with
+* trained tables and with a new order-0 code per message, reporting messages
+* per second, and in batches by a multiEncoder, with and without AVX2,
+* against a loop of single message calls. Short decode sessions on several
+* threads are timed with tables rebuilt per session and shared in a
+* tableCache. A server is started on a socket in /tmp and loaded by client
+* threads with small encode and decode requests, reporting requests per
+* second and latency percentiles, and the whole file is coded by it sent on
+* the socket and passed in a memfd. The file is also coded by push encoder
+* and decoder fed chunks of several sizes.
+*
+* PROGRAM INPUTS / OUTPUT:
+* param[in]: file - name of file to benchmark with.
+* param[in]: rounds - optional number of rounds per engine, default 3.
+* return: 0 if all engines round trip, else 1.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "encode.h"
+#include "canonical.h"
+#include "order1.h"
+#include "symbol.h"
+#include "blocksort.h"
+#include "lz77.h"
+#include "ans.h"
+#include "filter.h"
+#include "adaptive.h"
+#include "context.h"
+#include "multi.h"
+#include "dict.h"
+#include "tableCache.h"
+#include "format.h"
+#include "server.h"
+#include "client.h"
+#include "push.h"
+
+//Most tables trained from the messages.
+#define BENCHTABLES 4
+//Messages coded at once by a multiEncoder.
+#define BENCHBATCH 1024
+//Decode sessions run by BENCHTHREADS threads, each decoding
+//BENCHSESSIONMESSAGES messages of BENCHSESSIONSIZE chars.
+#define BENCHTHREADS 4
+#define BENCHSESSIONS 4000
+#define BENCHSESSIONMESSAGES 16
+#define BENCHSESSIONSIZE 200
+//Server is loaded by BENCHCLIENTS threads, each sending BENCHREQUESTS
+//requests of BENCHSESSIONSIZE chars.
+#define BENCHCLIENTS 4
+#define BENCHREQUESTS 2000
+//Output array of push encoder and decoder, fed chunks of several sizes.
+#define BENCHPUSHOUTSIZE 4096
+
+
+typedef struct benchEngine {
+
+	char const *name;
+	bitString *(*encode) (const unsigned char *text, int64_t length);
+	int (*decode) (bitString *bs, unsigned char *text, int64_t length);
+} benchEngine;
+
+
+//Decode sessions of one thread, with tables rebuilt or from a cache.
+typedef struct benchSession {
+
+	int cached;
+	tableCache *cache;
+	contextTable *const *tables;
+	int nrOfTables;
+	const unsigned char *store;
+	const int64_t *offsets;
+	const unsigned char *text;
+	int64_t sessions;
+	int valid;
+} benchSession;
+
+
+//Requests of one client thread, with the latency of each.
+typedef struct benchClient {
+
+	char const *path;
+	const unsigned char *text;
+	int64_t nrOfMessages;
+	int64_t first;
+	double *latency;
+	int valid;
+} benchClient;
+
+
+/*
+* description: Gets time from a monotonic clock.
+* return: Time in seconds.
+*/
+double benchNow (void) {
+
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+/*
+* description: Order-0 canonical code built from the text itself, used as
+* baseline for the other engines. Code lengths are stored in front.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* return: bitString with lengths and codes.
+*/
+bitString *benchOrder0Encode (const unsigned char *text, int64_t length) {
+
+	uint64_t freqTable[256] = {0};
+	uint8_t lengths[256];
+	huffCode codeTable[256];
+	bitString *bs = bitStringEmpty();
+
+	for (int64_t i = 0; i < length; i++) {
+
+		freqTable[text[i]]++;
+	}
+	canonicalCodeLengths(freqTable, 256, HUFFMAXCODELEN, lengths);
+	canonicalAssignCodes(lengths, 256, codeTable);
+	canonicalWriteLengths(bs, lengths, 256);
+	encodeBuffer(bs, text, length, codeTable);
+	bitStringGetEncode(bs);
+	return bs;
+}
+
+
+/*
+* description: Decodes bitString written by benchOrder0Encode.
+* param[in]: bs - The bitString.
+* param[out]: text - Array to store atleast length chars in.
+* param[in]: length - Number of chars to decode.
+* return: 1 if chars could be decoded, else 0.
+*/
+int benchOrder0Decode (bitString *bs, unsigned char *text, int64_t length) {
+
+	uint8_t lengths[256];
+	int64_t bitPos = 0;
+
+	if (!canonicalReadLengths(bs, &bitPos, lengths, 256)) {
+
+		return 0;
+	}
+	canonicalDecoder *dec = canonicalDecoderBuild(lengths, 256);
+	for (int64_t i = 0; i < length; i++) {
+
+		text[i] = (unsigned char)canonicalDecodeKey(dec, bs, &bitPos);
+	}
+	canonicalDecoderKill(dec);
+	return 1;
+}
+
+
+/*
+* description: Order-1 context mode, see order1.h.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* return: bitString with tables and codes.
+*/
+bitString *benchOrder1Encode (const unsigned char *text, int64_t length) {
+
+	order1Model *model = order1Build(text, length);
+	bitString *bs = bitStringEmpty();
+
+	order1WriteTables(model, bs);
+	order1Encode(model, bs, text, length);
+	bitStringGetEncode(bs);
+	order1Kill(model);
+	return bs;
+}
+
+
+/*
+* description: Decodes bitString written by benchOrder1Encode.
+* param[in]: bs - The bitString.
+* param[out]: text - Array to store atleast length chars in.
+* param[in]: length - Number of chars to decode.
+* return: 1 if chars could be decoded, else 0.
+*/
+int benchOrder1Decode (bitString *bs, unsigned char *text, int64_t length) {
+
+	int64_t bitPos = 0;
+	order1Model *model = order1ReadTables(bs, &bitPos);
+
+	if (model == NULL) {
+
+		return 0;
+	}
+	int valid = order1Decode(model, bs, &bitPos, text, length);
+	order1Kill(model);
+	return valid;
+}
+
+
+/*
+* description: UTF-8 code point symbols, see symbol.h.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* return: bitString with used symbols, lengths and codes.
+*/
+bitString *benchUtf8Encode (const unsigned char *text, int64_t length) {
+
+	bitString *bs = bitStringEmpty();
+
+	symbolEncode(SYMBOLUTF8, bs, text, length);
+	bitStringGetEncode(bs);
+	return bs;
+}
+
+
+/*
+* description: Decodes bitString written by benchUtf8Encode.
+* param[in]: bs - The bitString.
+* param[out]: text - Array to store atleast length chars in.
+* param[in]: length - Number of chars to decode.
+* return: 1 if chars could be decoded, else 0.
+*/
+int benchUtf8Decode (bitString *bs, unsigned char *text, int64_t length) {
+
+	int64_t bitPos = 0;
+	return symbolDecode(SYMBOLUTF8, bs, &bitPos, text, length);
+}
+
+
+/*
+* description: 16 bit word symbols, see symbol.h.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* return: bitString with used symbols, lengths and codes.
+*/
+bitString *benchWord16Encode (const unsigned char *text, int64_t length) {
+
+	bitString *bs = bitStringEmpty();
+
+	symbolEncode(SYMBOLWORD16, bs, text, length);
+	bitStringGetEncode(bs);
+	return bs;
+}
+
+
+/*
+* description: Decodes bitString written by benchWord16Encode.
+* param[in]: bs - The bitString.
+* param[out]: text - Array to store atleast length chars in.
+* param[in]: length - Number of chars to decode.
+* return: 1 if chars could be decoded, else 0.
+*/
+int benchWord16Decode (bitString *bs, unsigned char *text, int64_t length) {
+
+	int64_t bitPos = 0;
+	return symbolDecode(SYMBOLWORD16, bs, &bitPos, text, length);
+}
+
+
+/*
+* description: Block sorting mode, see blocksort.h.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* return: bitString with coded blocks.
+*/
+bitString *benchBlockSortEncode (const unsigned char *text, int64_t length) {
+
+	bitString *bs = bitStringEmpty();
+
+	blockSortEncode(bs, text, length, BLOCKSORTSIZE);
+	bitStringGetEncode(bs);
+	return bs;
+}
+
+
+/*
+* description: Decodes bitString written by benchBlockSortEncode.
+* param[in]: bs - The bitString.
+* param[out]: text - Array to store atleast length chars in.
+* param[in]: length - Number of chars to decode.
+* return: 1 if chars could be decoded, else 0.
+*/
+int benchBlockSortDecode (bitString *bs, unsigned char *text, int64_t length) {
+
+	int64_t bitPos = 0;
+	return blockSortDecode(bs, &bitPos, text, length);
+}
+
+
+/*
+* description: Lz77 with default window and effort, see lz77.h.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* return: bitString with coded token blocks.
+*/
+bitString *benchLz77Encode (const unsigned char *text, int64_t length) {
+
+	lz77Params params;
+	bitString *bs = bitStringEmpty();
+
+	lz77ParamsSet(&params, LZ77DEFAULTWINDOW, LZ77DEFAULTEFFORT);
+	lz77Encode(bs, text, length, &params);
+	bitStringGetEncode(bs);
+	return bs;
+}
+
+
+/*
+* description: Decodes bitString written by benchLz77Encode.
+* param[in]: bs - The bitString.
+* param[out]: text - Array to store atleast length chars in.
+* param[in]: length - Number of chars to decode.
+* return: 1 if chars could be decoded, else 0.
+*/
+int benchLz77Decode (bitString *bs, unsigned char *text, int64_t length) {
+
+	int64_t bitPos = 0;
+	return lz77Decode(bs, &bitPos, text, length);
+}
+
+
+/*
+* description: Blocks coded with huffman only, baseline for the tANS engines
+* on the same blocks, see ans.h.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* return: bitString with coded blocks.
+*/
+bitString *benchHuffBlocksEncode (const unsigned char *text, int64_t length) {
+
+	bitString *bs = bitStringEmpty();
+
+	ansBlocksEncode(bs, text, length, ANSBLOCKSIZE, ANSBACKENDHUFFMAN);
+	bitStringGetEncode(bs);
+	return bs;
+}
+
+
+/*
+* description: Blocks coded with tANS only, see ans.h.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* return: bitString with coded blocks.
+*/
+bitString *benchTansBlocksEncode (const unsigned char *text, int64_t length) {
+
+	bitString *bs = bitStringEmpty();
+
+	ansBlocksEncode(bs, text, length, ANSBLOCKSIZE, ANSBACKENDTANS);
+	bitStringGetEncode(bs);
+	return bs;
+}
+
+
+/*
+* description: Blocks coded with the cheaper of tANS and huffman, see ans.h.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* return: bitString with coded blocks.
+*/
+bitString *benchAutoBlocksEncode (const unsigned char *text, int64_t length) {
+
+	bitString *bs = bitStringEmpty();
+
+	ansBlocksEncode(bs, text, length, ANSBLOCKSIZE, ANSBACKENDAUTO);
+	bitStringGetEncode(bs);
+	return bs;
+}
+
+
+/*
+* description: Decodes bitString written by any of the block engines above.
+* param[in]: bs - The bitString.
+* param[out]: text - Array to store atleast length chars in.
+* param[in]: length - Number of chars to decode.
+* return: 1 if chars could be decoded, else 0.
+*/
+int benchAnsBlocksDecode (bitString *bs, unsigned char *text, int64_t length) {
+
+	int64_t bitPos = 0;
+	return ansBlocksDecode(bs, &bitPos, text, length);
+}
+
+
+/*
+* description: Filters picked per block, see filter.h.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* return: bitString with filtered and coded blocks.
+*/
+bitString *benchFilterEncode (const unsigned char *text, int64_t length) {
+
+	filterSpec spec;
+	bitString *bs = bitStringEmpty();
+
+	filterParse("auto", &spec);
+	filterEncode(bs, text, length, FILTERBLOCKSIZE, &spec);
+	bitStringGetEncode(bs);
+	return bs;
+}
+
+
+/*
+* description: Decodes bitString written by benchFilterEncode.
+* param[in]: bs - The bitString.
+* param[out]: text - Array to store atleast length chars in.
+* param[in]: length - Number of chars to decode.
+* return: 1 if chars could be decoded, else 0.
+*/
+int benchFilterDecode (bitString *bs, unsigned char *text, int64_t length) {
+
+	int64_t bitPos = 0;
+	return filterDecode(bs, &bitPos, text, length);
+}
+
+
+/*
+* description: One pass adaptive model, see adaptive.h.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* return: bitString with codes.
+*/
+bitString *benchAdaptiveEncode (const unsigned char *text, int64_t length) {
+
+	adaptiveModel *model = adaptiveEmpty(ADAPTIVEDEFAULTPERIOD);
+	bitString *bs = bitStringEmpty();
+
+	adaptiveEncode(model, bs, text, length);
+	bitStringGetEncode(bs);
+	adaptiveKill(model);
+	return bs;
+}
+
+
+/*
+* description: Decodes bitString written by benchAdaptiveEncode.
+* param[in]: bs - The bitString.
+* param[out]: text - Array to store atleast length chars in.
+* param[in]: length - Number of chars to decode.
+* return: 1 if chars could be decoded, else 0.
+*/
+int benchAdaptiveDecode (bitString *bs, unsigned char *text, int64_t length) {
+
+	adaptiveModel *model = adaptiveEmpty(ADAPTIVEDEFAULTPERIOD);
+	int64_t bitPos = 0;
+	int valid = adaptiveDecode(model, bs, &bitPos, text, length);
+
+	adaptiveKill(model);
+	return valid;
+}
+
+
+/*
+* description: Times each stage of block sorting on it's own, forward and
+* inverse, on the first block of text.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[in]: rounds - Number of rounds per stage.
+* return: 1 if all stages round trip, else 0.
+*/
+int benchBlockSortStages (const unsigned char *text, int64_t length,
+						  int rounds) {
+
+	int64_t n = length < BLOCKSORTSIZE ? length : BLOCKSORTSIZE;
+	unsigned char *bwt = malloc(n + 1);
+	unsigned char *mtf = malloc(n + 1);
+	unsigned char *back = malloc(n + 1);
+	uint16_t *symbols = malloc(sizeof(uint16_t) * (n + 1));
+	double megabytes = n / 1e6 * rounds;
+	double times[6] = {0};
+	int64_t primary = 0;
+	int64_t count = 0;
+	int valid = 1;
+
+	for (int r = 0; r < rounds; r++) {
+
+		double start = benchNow();
+		primary = bwtForward(text, bwt, n);
+		times[0] = times[0] + benchNow() - start;
+
+		start = benchNow();
+		valid = bwtInverse(bwt, back, n, primary) && valid;
+		times[1] = times[1] + benchNow() - start;
+		valid = valid && memcmp(text, back, n) == 0;
+
+		start = benchNow();
+		mtfForward(bwt, mtf, n);
+		times[2] = times[2] + benchNow() - start;
+
+		start = benchNow();
+		mtfInverse(mtf, back, n);
+		times[3] = times[3] + benchNow() - start;
+		valid = valid && memcmp(bwt, back, n) == 0;
+
+		start = benchNow();
+		count = rleZeroEncode(mtf, n, symbols);
+		times[4] = times[4] + benchNow() - start;
+
+		start = benchNow();
+		valid = valid && rleZeroDecode(symbols, count, back, n) == n;
+		times[5] = times[5] + benchNow() - start;
+		valid = valid && memcmp(mtf, back, n) == 0;
+	}
+
+	printf("\n%-10s %10s %10s  (first %lld chars)\n", "stage", "fwd MB/s",
+		   "inv MB/s", (long long)n);
+	printf("%-10s %10.1f %10.1f\n", "bwt", megabytes / times[0],
+		   megabytes / times[1]);
+	printf("%-10s %10.1f %10.1f\n", "mtf", megabytes / times[2],
+		   megabytes / times[3]);
+	printf("%-10s %10.1f %10.1f  (%lld symbols)\n", "rle",
+		   megabytes / times[4], megabytes / times[5], (long long)count);
+
+	free(symbols);
+	free(back);
+	free(mtf);
+	free(bwt);
+	return valid;
+}
+
+
+/*
+* description: Times reading file and writing a copy of it with each stream
+* backend, with and without O_DIRECT. The copy is written to a temporary file
+* next to file, so both are on the same file system.
+* param[in]: file - Name of file to read.
+* param[in]: text - The chars of file.
+* param[in]: length - Number of chars.
+* param[in]: rounds - Number of rounds per backend.
+* return: 1 if all backends read and wrote the chars, else 0.
+*/
+int benchIo (char const *file, const unsigned char *text, int64_t length,
+			 int rounds) {
+
+	char copy[4096];
+	unsigned char *back = malloc(length > 0 ? length : 1);
+	double megabytes = length / 1e6 * rounds;
+	int valid = 1;
+
+	snprintf(copy, sizeof(copy), "%s.iobench", file);
+	printf("\n%-10s %6s %10s %10s\n", "io", "direct", "read MB/s",
+		   "write MB/s");
+
+	for (int direct = 0; direct <= 1; direct++) {
+
+		for (int backend = STREAMBACKENDPLAIN; backend <= STREAMBACKENDURING;
+			 backend++) {
+
+			streamConfig config = {backend, direct};
+			double readTime = 0;
+			double writeTime = 0;
+			char const *name = "";
+			int used = 0;
+
+			for (int r = 0; r < rounds; r++) {
+
+				double start = benchNow();
+				stream *out = streamOpen(copy, 1, &config);
+				if (out == NULL) {
+
+					free(back);
+					return 0;
+				}
+				name = streamBackendName(out);
+				used = out -> direct;
+				valid = streamWrite(out, text, length) && valid;
+				valid = streamClose(out) && valid;
+				writeTime = writeTime + benchNow() - start;
+
+				start = benchNow();
+				stream *in = streamOpen(copy, 0, &config);
+				valid = streamRead(in, back, length) == length && valid;
+				valid = streamClose(in) && valid;
+				readTime = readTime + benchNow() - start;
+				valid = valid && memcmp(text, back, length) == 0;
+			}
+
+			//Backend and O_DIRECT may have fallen back on this system.
+			printf("%-10s %6s %10.1f %10.1f\n", name, used ? "yes" : "no",
+				   megabytes / readTime, megabytes / writeTime);
+		}
+	}
+
+	remove(copy);
+	free(back);
+	return valid;
+}
+
+
+/*
+* description: Codes text as messages of size chars with contexts, then
+* decodes them and compares with text.
+* param[in]: enc - The contextEncoder.
+* param[in]: dec - The contextDecoder.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[in]: size - Number of chars per message.
+* param[out]: store - Array to store the messages in.
+* param[out]: back - Array to store the decoded chars in.
+* param[out]: offsets - Array to store offset of each message in.
+* param[in,out]: times - Seconds of encode and decode, added to.
+* param[out]: packed - Number of bytes of all messages.
+* return: 1 if all messages round trip, else 0.
+*/
+int benchContexts (contextEncoder *enc, contextDecoder *dec,
+				   const unsigned char *text, int64_t length, int64_t size,
+				   unsigned char *store, unsigned char *back,
+				   int64_t *offsets, double *times, int64_t *packed) {
+
+	int64_t n = (length + size - 1) / size;
+	int valid = 1;
+
+	double start = benchNow();
+	*packed = 0;
+	for (int64_t m = 0; m < n; m++) {
+
+		const unsigned char *out = NULL;
+		int64_t begin = m * size;
+		int64_t chars = begin + size < length ? size : length - begin;
+		int64_t bytes = contextEncode(enc, &text[begin], chars, &out);
+		offsets[m] = *packed;
+		memcpy(&store[*packed], out, bytes);
+		*packed = *packed + bytes;
+	}
+	offsets[n] = *packed;
+	times[0] = times[0] + benchNow() - start;
+
+	start = benchNow();
+	for (int64_t m = 0; m < n; m++) {
+
+		int64_t begin = m * size;
+		int64_t chars = begin + size < length ? size : length - begin;
+		valid = contextDecode(dec, &store[offsets[m]],
+							  offsets[m + 1] - offsets[m], &back[begin],
+							  chars) && valid;
+	}
+	times[1] = times[1] + benchNow() - start;
+	return valid && memcmp(text, back, length) == 0;
+}
+
+
+/*
+* description: Times coding file as messages of a few sizes, one call per
+* message. Contexts are reused for every message, with one table of counts
+* of the whole file, and with BENCHTABLES tables trained from the messages.
+* They are compared with benchOrder0Encode, which builds everything anew per
+* message.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[in]: rounds - Number of rounds per size.
+* return: 1 if all messages round trip, else 0.
+*/
+int benchMessages (const unsigned char *text, int64_t length, int rounds) {
+
+	static const int64_t sizes[] = {100, 1024, 4096};
+	uint64_t freqTable[CONTEXTSYMBOLS] = {0};
+	//Messages are atmost one byte bigger than their chars.
+	unsigned char *store = malloc(length + length / 100 + 2);
+	unsigned char *back = malloc(length + 1);
+	contextEncoder *enc = contextEncoderEmpty();
+	contextDecoder *dec = contextDecoderEmpty();
+	int valid = 1;
+
+	for (int64_t i = 0; i < length; i++) {
+
+		freqTable[text[i]]++;
+	}
+	contextTable *table = contextTableBuild(freqTable, 1);
+
+	printf("\n%-10s %8s %12s %12s %8s\n", "messages", "size", "enc msg/s",
+		   "dec msg/s", "ratio");
+
+	for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+
+		int64_t n = (length + sizes[s] - 1) / sizes[s];
+		int64_t *offsets = malloc(sizeof(int64_t) * (n + 1));
+		double times[4] = {0};
+		double trainedTimes[2] = {0};
+		int64_t packed = 0;
+		int64_t trainedPacked = 0;
+
+		//Tables are trained on the messages themselves, as a best case.
+		unsigned char **samples = malloc(sizeof(unsigned char *) * n);
+		int64_t *lengths = malloc(sizeof(int64_t) * n);
+		for (int64_t m = 0; m < n; m++) {
+
+			samples[m] = (unsigned char *)&text[m * sizes[s]];
+			lengths[m] = m * sizes[s] + sizes[s] < length ? sizes[s] :
+						 length - m * sizes[s];
+		}
+		int count = 0;
+		double start = benchNow();
+		contextTable **trained = dictTrain(samples, lengths, n, BENCHTABLES,
+										   1, &count);
+		double trainTime = benchNow() - start;
+
+		for (int r = 0; r < rounds; r++) {
+
+			contextEncoderSetTables(enc, &table, 1);
+			contextDecoderSetTables(dec, &table, 1);
+			valid = benchContexts(enc, dec, text, length, sizes[s], store,
+								  back, offsets, times, &packed) && valid;
+
+			contextEncoderSetTables(enc, trained, count);
+			contextDecoderSetTables(dec, trained, count);
+			valid = benchContexts(enc, dec, text, length, sizes[s], store,
+								  back, offsets, trainedTimes,
+								  &trainedPacked) && valid;
+
+			start = benchNow();
+			for (int64_t m = 0; m < n; m++) {
+
+				bitString *bs = benchOrder0Encode(samples[m], lengths[m]);
+				times[2] = times[2] + benchNow() - start;
+				start = benchNow();
+				valid = benchOrder0Decode(bs, &back[m * sizes[s]],
+										  lengths[m]) && valid;
+				times[3] = times[3] + benchNow() - start;
+				bitStringKill(bs);
+				start = benchNow();
+			}
+			valid = valid && memcmp(text, back, length) == 0;
+		}
+
+		printf("%-10s %8lld %12.0f %12.0f %8.3f\n", "context",
+			   (long long)sizes[s], n * rounds / times[0],
+			   n * rounds / times[1], packed > 0 ? (double)length / packed : 0);
+		printf("%-10s %8lld %12.0f %12.0f %8.3f  %d tables in %.3f s\n",
+			   "trained", (long long)sizes[s], n * rounds / trainedTimes[0],
+			   n * rounds / trainedTimes[1], trainedPacked > 0 ?
+			   (double)length / trainedPacked : 0, count, trainTime);
+		printf("%-10s %8lld %12.0f %12.0f\n", "per-call", (long long)sizes[s],
+			   n * rounds / times[2], n * rounds / times[3]);
+		dictKill(trained, count);
+		free(lengths);
+		free(samples);
+		free(offsets);
+	}
+
+	contextEncoderKill(enc);
+	contextDecoderKill(dec);
+	contextTableKill(table);
+	free(back);
+	free(store);
+	return valid;
+}
+
+
+/*
+* description: Times coding file as small messages in batches of
+* BENCHBATCH, by a loop of contextEncode calls and by a multiEncoder with
+* and without AVX2, all with one table of counts of the whole file. Batches
+* must come out as the same bytes as the loop.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[in]: rounds - Number of rounds per size.
+* return: 1 if every batch matches the loop, else 0.
+*/
+int benchMulti (const unsigned char *text, int64_t length, int rounds) {
+
+	static const int64_t sizes[] = {32, 100, 1024};
+	uint64_t freqTable[CONTEXTSYMBOLS] = {0};
+	//Messages are atmost one byte bigger than their chars.
+	unsigned char *store = malloc(length + length / 32 + 2);
+	const unsigned char *texts[BENCHBATCH];
+	int64_t lengths[BENCHBATCH];
+	int64_t bytes[BENCHBATCH];
+	contextEncoder *enc = contextEncoderEmpty();
+	multiEncoder *m = multiEncoderEmpty();
+	int simd = m -> simd;
+	int valid = 1;
+
+	for (int64_t i = 0; i < length; i++) {
+
+		freqTable[text[i]]++;
+	}
+	contextTable *table = contextTableBuild(freqTable, 1);
+	contextEncoderSetTables(enc, &table, 1);
+	multiEncoderSetTables(m, &table, 1);
+
+	printf("\n%-10s %8s %12s %12s %12s\n", "multi", "size", "loop msg/s",
+		   "scalar msg/s", "avx2 msg/s");
+
+	for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+
+		int64_t n = (length + sizes[s] - 1) / sizes[s];
+		double times[3] = {0};
+
+		for (int r = 0; r < rounds; r++) {
+
+			int64_t packed = 0;
+			double start = benchNow();
+			for (int64_t i = 0; i < n; i++) {
+
+				const unsigned char *out = NULL;
+				int64_t begin = i * sizes[s];
+				int64_t chars = begin + sizes[s] < length ? sizes[s] :
+								length - begin;
+				int64_t size = contextEncode(enc, &text[begin], chars, &out);
+				memcpy(&store[packed], out, size);
+				packed = packed + size;
+			}
+			times[0] = times[0] + benchNow() - start;
+
+			//Scalar lanes are timed, then AVX2 lanes where the CPU has it.
+			for (int way = 0; way < 2 && (way == 0 || simd); way++) {
+
+				m -> simd = way;
+				int64_t at = 0;
+				start = benchNow();
+				for (int64_t i = 0; i < n; i = i + BENCHBATCH) {
+
+					int count = n - i < BENCHBATCH ? n - i : BENCHBATCH;
+					for (int b = 0; b < count; b++) {
+
+						int64_t begin = (i + b) * sizes[s];
+						texts[b] = &text[begin];
+						lengths[b] = begin + sizes[s] < length ? sizes[s] :
+									 length - begin;
+					}
+					const unsigned char *out = NULL;
+					int64_t size = multiEncode(m, texts, lengths, count,
+											   bytes, &out);
+					valid = valid && at + size <= packed &&
+							memcmp(&store[at], out, size) == 0;
+					at = at + size;
+				}
+				times[1 + way] = times[1 + way] + benchNow() - start;
+				valid = valid && at == packed;
+			}
+		}
+
+		printf("%-10s %8lld %12.0f %12.0f %12.0f%s\n", "encode",
+			   (long long)sizes[s], n * rounds / times[0],
+			   n * rounds / times[1], simd ? n * rounds / times[2] : 0.0,
+			   valid ? "" : "  FAILED");
+	}
+
+	multiEncoderKill(m);
+	contextEncoderKill(enc);
+	contextTableKill(table);
+	free(store);
+	return valid;
+}
+
+
+/*
+* description: Thread running decode sessions. Each session sets up a new
+* decoder and its tables, as a service does per request, and decodes the
+* messages. Tables are rebuilt from their code lengths per session, or found
+* in a cache shared by all threads and built only by the first session.
+* param[in]: arg - The benchSession, valid is set.
+* return: NULL.
+*/
+void *benchSessionRun (void *arg) {
+
+	benchSession *job = arg;
+	unsigned char back[BENCHSESSIONSIZE];
+
+	job -> valid = 1;
+	for (int64_t s = 0; s < job -> sessions; s++) {
+
+		contextDecoder *dec = contextDecoderEmpty();
+		contextTable *built[CONTEXTMAXTABLES];
+		for (int t = 0; t < job -> nrOfTables; t++) {
+
+			uint32_t id = job -> tables[t] -> id;
+			if (!job -> cached) {
+
+				built[t] = contextTableFromLengths(job -> tables[t] -> lengths,
+												   id);
+			} else if (tableCacheGet(job -> cache, id) == NULL) {
+
+				tableCacheIntern(job -> cache, job -> tables[t] -> lengths, id);
+			}
+		}
+		if (job -> cached) {
+
+			contextDecoderSetCache(dec, job -> cache);
+		} else {
+
+			contextDecoderSetTables(dec, built, job -> nrOfTables);
+			for (int t = 0; t < job -> nrOfTables; t++) {
+
+				contextTableKill(built[t]);
+			}
+		}
+
+		for (int m = 0; m < BENCHSESSIONMESSAGES; m++) {
+
+			job -> valid = contextDecode(dec, &job -> store[job -> offsets[m]],
+										 job -> offsets[m + 1] -
+										 job -> offsets[m], back,
+										 BENCHSESSIONSIZE) &&
+						   memcmp(back, &job -> text[m * BENCHSESSIONSIZE],
+								  BENCHSESSIONSIZE) == 0 && job -> valid;
+		}
+		contextDecoderKill(dec);
+	}
+	return NULL;
+}
+
+
+/*
+* description: Times short decode sessions on BENCHTHREADS threads, with
+* tables trained from the file rebuilt per session and shared in a cache.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[in]: rounds - Number of rounds.
+* return: 1 if all sessions decoded their messages, else 0.
+*/
+int benchSessions (const unsigned char *text, int64_t length, int rounds) {
+
+	int64_t n = length / BENCHSESSIONSIZE;
+	if (n < BENCHSESSIONMESSAGES) {
+
+		return 1;
+	}
+
+	unsigned char **samples = malloc(sizeof(unsigned char *) * n);
+	int64_t *lengths = malloc(sizeof(int64_t) * n);
+	for (int64_t m = 0; m < n; m++) {
+
+		samples[m] = (unsigned char *)&text[m * BENCHSESSIONSIZE];
+		lengths[m] = BENCHSESSIONSIZE;
+	}
+	int count = 0;
+	contextTable **tables = dictTrain(samples, lengths, n, BENCHTABLES, 1,
+									  &count);
+
+	//Messages are atmost one byte bigger than their chars.
+	unsigned char *store = malloc((BENCHSESSIONSIZE + 1) *
+								  BENCHSESSIONMESSAGES);
+	int64_t offsets[BENCHSESSIONMESSAGES + 1];
+	contextEncoder *enc = contextEncoderEmpty();
+	contextEncoderSetTables(enc, tables, count);
+	offsets[0] = 0;
+	for (int m = 0; m < BENCHSESSIONMESSAGES; m++) {
+
+		const unsigned char *out = NULL;
+		int64_t size = contextEncode(enc, samples[m], BENCHSESSIONSIZE, &out);
+		memcpy(&store[offsets[m]], out, size);
+		offsets[m + 1] = offsets[m] + size;
+	}
+	contextEncoderKill(enc);
+
+	printf("\n%-10s %8s %8s %14s %14s\n", "sessions", "messages",
+		   "threads", "rebuild sess/s", "cached sess/s");
+
+	int valid = 1;
+	double times[2] = {0};
+	for (int r = 0; r < rounds; r++) {
+
+		for (int cached = 0; cached < 2; cached++) {
+
+			tableCache *cache = tableCacheEmpty();
+			benchSession jobs[BENCHTHREADS];
+			pthread_t threads[BENCHTHREADS];
+			double start = benchNow();
+			for (int i = 0; i < BENCHTHREADS; i++) {
+
+				jobs[i].cached = cached;
+				jobs[i].cache = cache;
+				jobs[i].tables = tables;
+				jobs[i].nrOfTables = count;
+				jobs[i].store = store;
+				jobs[i].offsets = offsets;
+				jobs[i].text = text;
+				jobs[i].sessions = BENCHSESSIONS / BENCHTHREADS;
+				pthread_create(&threads[i], NULL, benchSessionRun, &jobs[i]);
+			}
+			for (int i = 0; i < BENCHTHREADS; i++) {
+
+				pthread_join(threads[i], NULL);
+				valid = valid && jobs[i].valid;
+			}
+			times[cached] = times[cached] + benchNow() - start;
+			tableCacheKill(cache);
+		}
+	}
+
+	printf("%-10s %8d %8d %14.0f %14.0f\n", "decode", BENCHSESSIONMESSAGES,
+		   BENCHTHREADS, BENCHSESSIONS * rounds / times[0],
+		   BENCHSESSIONS * rounds / times[1]);
+
+	dictKill(tables, count);
+	free(store);
+	free(lengths);
+	free(samples);
+	return valid;
+}
+
+
+/*
+* description: Thread of one client of the server. Encodes a message and
+* decodes the reply, every second request, on one connection.
+* param[in]: arg - The benchClient, valid and latency are set.
+* return: NULL.
+*/
+void *benchClientRun (void *arg) {
+
+	benchClient *job = arg;
+	unsigned char coded[BENCHSESSIONSIZE * 2 + FORMATHEADERSIZE];
+	int sock = clientConnect(job -> path);
+	clientReply *reply = clientReplyEmpty();
+
+	job -> valid = sock >= 0;
+	for (int64_t r = 0; r + 1 < BENCHREQUESTS && job -> valid; r = r + 2) {
+
+		int64_t m = (job -> first + r / 2) % job -> nrOfMessages;
+		const unsigned char *message = &job -> text[m * BENCHSESSIONSIZE];
+		double start = benchNow();
+		job -> valid = clientRequest(sock, SERVEROPENCODE, message,
+									 BENCHSESSIONSIZE, -1, reply) &&
+					   reply -> status == SERVEROK &&
+					   reply -> length <= (int64_t)sizeof(coded);
+		job -> latency[r] = benchNow() - start;
+		if (!job -> valid) {
+
+			break;
+		}
+
+		int64_t size = reply -> length;
+		memcpy(coded, reply -> data, size);
+		start = benchNow();
+		job -> valid = clientRequest(sock, SERVEROPDECODE, coded, size, -1,
+									 reply) &&
+					   reply -> status == SERVEROK &&
+					   reply -> length == BENCHSESSIONSIZE &&
+					   memcmp(reply -> data, message, BENCHSESSIONSIZE) == 0;
+		job -> latency[r + 1] = benchNow() - start;
+	}
+
+	clientReplyKill(reply);
+	if (sock >= 0) {
+
+		close(sock);
+	}
+	return NULL;
+}
+
+
+/*
+* description: Thread serving the server until it is stopped.
+* param[in]: arg - The server.
+* return: NULL.
+*/
+void *benchServe (void *arg) {
+
+	serverServe(arg);
+	return NULL;
+}
+
+
+/*
+* description: Compares two latencies, for qsort.
+* param[in]: a - First latency.
+* param[in]: b - Second latency.
+* return: Below, equal to or above 0 as a is below, equal to or above b.
+*/
+int benchCompareTimes (const void *a, const void *b) {
+
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+
+/*
+* description: Loads a server with tables trained from the messages of text
+* by BENCHCLIENTS client threads, and codes all of text with it, sent on
+* the socket and passed in a memfd.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[in]: rounds - Number of rounds.
+* return: 1 if every reply was right, else 0.
+*/
+int benchServer (const unsigned char *text, int64_t length, int rounds) {
+
+	int64_t n = length / BENCHSESSIONSIZE;
+	if (n < BENCHCLIENTS) {
+
+		return 1;
+	}
+
+	unsigned char **samples = malloc(sizeof(unsigned char *) * n);
+	int64_t *lengths = malloc(sizeof(int64_t) * n);
+	for (int64_t m = 0; m < n; m++) {
+
+		samples[m] = (unsigned char *)&text[m * BENCHSESSIONSIZE];
+		lengths[m] = BENCHSESSIONSIZE;
+	}
+	int count = 0;
+	contextTable **tables = dictTrain(samples, lengths, n, BENCHTABLES, 1,
+									  &count);
+
+	char path[64];
+	snprintf(path, sizeof(path), "/tmp/huffman-bench-%ld.sock",
+			 (long)getpid());
+	server *s = serverEmpty(path, tables, count, 0);
+	dictKill(tables, count);
+	free(lengths);
+	free(samples);
+	if (s == NULL) {
+
+		fprintf(stderr, "Could not listen on %s\n", path);
+		return 0;
+	}
+	pthread_t serving;
+	pthread_create(&serving, NULL, benchServe, s);
+
+	int64_t total = (int64_t)BENCHCLIENTS * BENCHREQUESTS * rounds;
+	double *latency = malloc(sizeof(double) * total);
+	int valid = 1;
+	double elapsed = 0;
+	for (int r = 0; r < rounds; r++) {
+
+		benchClient jobs[BENCHCLIENTS];
+		pthread_t threads[BENCHCLIENTS];
+		double start = benchNow();
+		for (int i = 0; i < BENCHCLIENTS; i++) {
+
+			jobs[i].path = path;
+			jobs[i].text = text;
+			jobs[i].nrOfMessages = n;
+			jobs[i].first = (int64_t)i * BENCHREQUESTS / 2;
+			jobs[i].latency = &latency[((int64_t)r * BENCHCLIENTS + i) *
+									   BENCHREQUESTS];
+			pthread_create(&threads[i], NULL, benchClientRun, &jobs[i]);
+		}
+		for (int i = 0; i < BENCHCLIENTS; i++) {
+
+			pthread_join(threads[i], NULL);
+			valid = valid && jobs[i].valid;
+		}
+		elapsed = elapsed + benchNow() - start;
+	}
+
+	printf("\n%-10s %8s %8s %10s %10s %10s %10s\n", "server", "clients",
+		   "workers", "req/s", "p50 us", "p99 us", "max queue");
+	if (valid) {
+
+		qsort(latency, total, sizeof(double), benchCompareTimes);
+		printf("%-10s %8d %8d %10.0f %10.1f %10.1f %10lld\n", "requests",
+			   BENCHCLIENTS, poolSize(s -> workers), total / elapsed,
+			   latency[total / 2] * 1e6, latency[total * 99 / 100] * 1e6,
+			   (long long)__atomic_load_n(&s -> maxQueued, __ATOMIC_RELAXED));
+	}
+
+	//All of text is coded sent on the socket and passed in a memfd made
+	//once, as a client holding its data in a memfd would. Bigger texts can
+	//only be passed.
+	int sock = length <= SERVERINLINEMAX ? clientConnect(path) : -1;
+	int fd = serverMemfd(NULL, 0, text, length);
+	clientReply *reply = clientReplyEmpty();
+	double times[2] = {0};
+	int64_t sizes[2] = {0};
+	for (int r = 0; r < rounds && valid && sock >= 0 && fd >= 0; r++) {
+
+		for (int passed = 0; passed < 2 && valid; passed++) {
+
+			double start = benchNow();
+			valid = clientRequest(sock, SERVEROPENCODE, text, length,
+								  passed ? fd : -1, reply) &&
+					reply -> status == SERVEROK;
+			times[passed] = times[passed] + benchNow() - start;
+			sizes[passed] = reply -> length;
+		}
+	}
+	if (sock >= 0) {
+
+		valid = valid && sizes[0] == sizes[1];
+		printf("%-10s %12s %12s %12s\n", "payload", "size", "socket MB/s",
+			   "memfd MB/s");
+		printf("%-10s %12lld %12.1f %12.1f\n", "encode", (long long)length,
+			   length / 1e6 * rounds / times[0],
+			   length / 1e6 * rounds / times[1]);
+	}
+
+	clientReplyKill(reply);
+	if (fd >= 0) {
+
+		close(fd);
+	}
+	if (sock >= 0) {
+
+		close(sock);
+	}
+	serverStop(s);
+	pthread_join(serving, NULL);
+	serverKill(s);
+	free(latency);
+	return valid;
+}
+
+
+/*
+* description: Codes text with a push encoder and decoder fed chunks of
+* several sizes, as a service getting data from the network would, and
+* checks the round trip.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[in]: rounds - Number of rounds per chunk size.
+* return: 1 if text round trips with every chunk size, else 0.
+*/
+int benchPush (const unsigned char *text, int64_t length, int rounds) {
+
+	static const int64_t chunks[] = {16, 1500, 65536};
+	uint64_t freqTable[256] = {0};
+
+	for (int64_t i = 0; i < length; i++) {
+
+		freqTable[text[i]]++;
+	}
+	pqueue *pq = fillPqueue(freqTable, 256);
+	huffTree *tree = fillhuffTree(pq, 256);
+	pqueue_kill(pq);
+	if (huffTreeTraverse(tree) == 0) {
+
+		huffTreeKill(tree);
+		return 0;
+	}
+
+	//Codes are atmost HUFFMAXCODELEN bits per char, plus block headers.
+	int64_t capacity = length * (HUFFMAXCODELEN / 8) + 2 * PUSHBUFFERSIZE;
+	unsigned char *codes = malloc(capacity);
+	unsigned char *decoded = malloc(length + 1);
+	unsigned char out[BENCHPUSHOUTSIZE];
+	int valid = 1;
+
+	printf("\n%-10s %8s %12s %10s %10s\n", "push", "chunk", "size",
+		   "enc MB/s", "dec MB/s");
+	for (size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+
+		double times[2] = {0};
+		int64_t size = 0;
+		for (int r = 0; r < rounds && valid; r++) {
+
+			int64_t consumed = 0;
+			int64_t produced = 0;
+			double start = benchNow();
+			pushEncoder *enc = pushEncoderEmpty(tree);
+			size = 0;
+			for (int64_t pos = 0; pos < length; pos = pos + consumed) {
+
+				int64_t n = length - pos < chunks[c] ? length - pos : chunks[c];
+				pushEncodeFeed(enc, &text[pos], n, &consumed, out,
+							   BENCHPUSHOUTSIZE, &produced);
+				memcpy(&codes[size], out, produced);
+				size = size + produced;
+			}
+			int complete = 0;
+			while (!complete) {
+
+				complete = pushEncodeEnd(enc, out, BENCHPUSHOUTSIZE,
+										 &produced);
+				memcpy(&codes[size], out, produced);
+				size = size + produced;
+			}
+			pushEncoderKill(enc);
+			times[0] = times[0] + benchNow() - start;
+
+			int64_t put = 0;
+			start = benchNow();
+			pushDecoder *dec = pushDecoderEmpty(tree);
+			for (int64_t pos = 0; pos < size && valid;
+				 pos = pos + consumed) {
+
+				int64_t n = size - pos < chunks[c] ? size - pos : chunks[c];
+				valid = pushDecodeFeed(dec, &codes[pos], n, &consumed, out,
+									   BENCHPUSHOUTSIZE, &produced) ||
+						pushDecodeEnd(dec);
+				valid = valid && put + produced <= length &&
+						(consumed > 0 || produced > 0);
+				if (valid) {
+
+					memcpy(&decoded[put], out, produced);
+					put = put + produced;
+				}
+			}
+			valid = valid && pushDecodeEnd(dec) && put == length &&
+					memcmp(text, decoded, length) == 0;
+			pushDecoderKill(dec);
+			times[1] = times[1] + benchNow() - start;
+		}
+		printf("%-10s %8lld %12lld %10.1f %10.1f%s\n", "stream",
+			   (long long)chunks[c], (long long)size,
+			   length / 1e6 * rounds / times[0],
+			   length / 1e6 * rounds / times[1], valid ? "" : "  FAILED");
+	}
+
+	huffTreeKill(tree);
+	free(decoded);
+	free(codes);
+	return valid;
+}
+
+
+//Engines to benchmark, in order of output.
+static benchEngine engines[] = {
+
+	{"order0", benchOrder0Encode, benchOrder0Decode},
+	{"order1", benchOrder1Encode, benchOrder1Decode},
+	{"utf8", benchUtf8Encode, benchUtf8Decode},
+	{"word16", benchWord16Encode, benchWord16Decode},
+	{"blocksort", benchBlockSortEncode, benchBlockSortDecode},
+	{"lz77", benchLz77Encode, benchLz77Decode},
+	{"blk-huff", benchHuffBlocksEncode, benchAnsBlocksDecode},
+	{"blk-tans", benchTansBlocksEncode, benchAnsBlocksDecode},
+	{"blk-auto", benchAutoBlocksEncode, benchAnsBlocksDecode},
+	{"filter", benchFilterEncode, benchFilterDecode},
+	{"adaptive", benchAdaptiveEncode, benchAdaptiveDecode},
+};
+
+
+/*
+* description: Control flow of benchmark.
+* param[in]: file - name of file to benchmark with.
+* param[in]: rounds - optional number of rounds per engine.
+* return: 0 if all engines round trip, else 1.
+*/
+int main (int argc, char const *argv[]) {
+
+	if (argc < 2) {
+
+		fprintf(stderr, "usage: %s file [rounds]\n", argv[0]);
+		return 1;
+	}
+
+	int rounds = argc > 2 ? atoi(argv[2]) : 3;
+	int64_t length = 0;
+	unsigned char *text = readPlainFile(argv[1], &length);
+
+	if (text == NULL) {
+
+		fprintf(stderr, "Could not open %s\n", argv[1]);
+		return 1;
+	}
+
+	unsigned char *decoded = malloc(length > 0 ? length : 1);
+	double megabytes = length / 1e6;
+	int failed = 0;
+
+	printf("%-10s %12s %8s %10s %10s\n", "engine", "size", "ratio",
+		   "enc MB/s", "dec MB/s");
+
+	for (size_t e = 0; e < sizeof(engines) / sizeof(engines[0]); e++) {
+
+		double encodeTime = 0;
+		double decodeTime = 0;
+		int64_t size = 0;
+		int valid = 1;
+
+		for (int r = 0; r < rounds; r++) {
+
+			double start = benchNow();
+			bitString *bs = engines[e].encode(text, length);
+			encodeTime = encodeTime + benchNow() - start;
+			size = bitStringGetSize(bs);
+
+			start = benchNow();
+			valid = engines[e].decode(bs, decoded, length) &&
+					memcmp(text, decoded, length) == 0;
+			decodeTime = decodeTime + benchNow() - start;
+			bitStringKill(bs);
+		}
+
+		if (!valid) {
+
+			failed = 1;
+		}
+		printf("%-10s %12lld %8.3f %10.1f %10.1f%s\n", engines[e].name,
+			   (long long)size, size > 0 ? (double)length / size : 0.0,
+			   megabytes * rounds / encodeTime,
+			   megabytes * rounds / decodeTime, valid ? "" : "  FAILED");
+	}
+
+	if (length > 0 && !benchBlockSortStages(text, length, rounds)) {
+
+		printf("block sorting stages FAILED\n");
+		failed = 1;
+	}
+
+	if (length > 0 && !benchMessages(text, length, rounds)) {
+
+		printf("messages FAILED\n");
+		failed = 1;
+	}
+
+	if (length > 0 && !benchMulti(text, length, rounds)) {
+
+		printf("multi FAILED\n");
+		failed = 1;
+	}
+
+	if (length > 0 && !benchSessions(text, length, rounds)) {
+
+		printf("sessions FAILED\n");
+		failed = 1;
+	}
+
+	if (length > 0 && !benchServer(text, length, rounds)) {
+
+		printf("server FAILED\n");
+		failed = 1;
+	}
+
+	if (length > 0 && !benchPush(text, length, rounds)) {
+
+		printf("push FAILED\n");
+		failed = 1;
+	}
+
+	if (!benchIo(argv[1], text, length, rounds)) {
+
+		printf("io FAILED\n");
+		failed = 1;
+	}
+
+	free(decoded);
+	free(text);
+	return failed;
+}
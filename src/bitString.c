@@ -1,6 +1,7 @@
 /*
-* bitString: Dynamiclly stores bits. bitString takes 0 and 1's represented as
-* chars and convert these, when a full byte is collected, into an unsigned char
+* bitString: Dynamiclly stores bits. bitString takes packed codes of up to 32
+* bits, collects them in a bit buffer and converts these, when a full byte is
+* collected, into an unsigned char
 *
 * bitString can also read unsigned chars and convert them into a byte.
 *
@@ -19,10 +20,11 @@
 bitString *bitStringEmpty () {
 
 	bitString *bs = malloc(sizeof(bitString));
-	bs -> bits = NULL;
 	bs -> encode = NULL;
 	bs -> length = 0;
+	bs -> capacity = 0;
 	bs -> nrOfBits = 0;
+	bs -> bitBuffer = 0;
 
 	return bs;
 }
@@ -35,32 +37,41 @@ bitString *bitStringEmpty () {
 */
 void bitStringKill (bitString *bs) {
 
-	free(bs -> bits);
 	free(bs -> encode);
 	free(bs);
 }
 
 
 /*
-* description: Add bits to bitString. If bitString reaches 8 bits (1 byte) or
-* more, bitString will encode these.
+* description: Empties bitString but keeps its memory, so it can be filled
+* again without reallocating.
 * param[in]: bs - The bitString.
-* param[in]: bits - Pointer to char array where the bits are stored as either
-* '1' or '0'.
-* param[in]: nrOfBits - Number of bits added to bitString.
 */
-void bitStringAddBits (bitString *bs, char *bits, int newBits) {
+void bitStringClear (bitString *bs) {
 
-	newBits = newBits + bs -> nrOfBits;
-	bs -> bits = realloc(bs -> bits, sizeof(char) * newBits);
+	bs -> length = 0;
+	bs -> nrOfBits = 0;
+	bs -> bitBuffer = 0;
+}
 
-	for (int i = 0; i < newBits - bs -> nrOfBits; i++) {
 
-		bs -> bits[bs -> nrOfBits + i] = bits[i];
-	}
-	bs -> nrOfBits = newBits;
+/*
+* description: Add packed code to bitString. If bitString reaches 32 bits or
+* more, bitString will encode all full bytes.
+* param[in]: bs - The bitString.
+* param[in]: code - The bits, MSB first. Bits above nrOfBits must be 0.
+* param[in]: nrOfBits - Number of bits added to bitString. At most 32.
+*/
+void bitStringAddCode (bitString *bs, uint32_t code, int nrOfBits) {
 
-	encodeBytes(bs);
+	bs -> bitBuffer = (bs -> bitBuffer << nrOfBits) | code;
+	bs -> nrOfBits = bs -> nrOfBits + nrOfBits;
+
+	//Buffer holds 64 bits, so flush before next code can overflow it.
+	if (bs -> nrOfBits >= 32) {
+
+		encodeBytes(bs);
+	}
 }
 
 
@@ -71,10 +82,27 @@ void bitStringAddBits (bitString *bs, char *bits, int newBits) {
 */
 void bitStringAddByte (bitString *bs, unsigned char byte) {
 
-
+	bitStringReserve(bs, 1);
+	bs -> encode[bs -> length] = byte;
 	bs -> length++;
-	bs -> encode = realloc(bs -> encode, sizeof(char) * bs -> length);
-	bs -> encode[bs -> length - 1] = byte;
+}
+
+
+/*
+* description: Adds a number of encoded bytes to bitString.
+* param[in]: bs - The bitString.
+* param[in]: bytes - The encoded bytes.
+* param[in]: nrOfBytes - Number of bytes to add.
+*/
+void bitStringAddBytes (bitString *bs, const unsigned char *bytes,
+						int64_t nrOfBytes) {
+
+	if (nrOfBytes > 0) {
+
+		bitStringReserve(bs, nrOfBytes);
+		memcpy(&bs -> encode[bs -> length], bytes, nrOfBytes);
+		bs -> length = bs -> length + nrOfBytes;
+	}
 }
 
 
@@ -83,15 +111,60 @@ void bitStringAddByte (bitString *bs, unsigned char byte) {
 * param[in]: bs - The bitString.
 * param[in]: byte - Pointer to char array of atleast size 8. Array will be
 * changed to which byte was read.
-* param[in]: byteNr - Index of stored encoded byte in bitString.
+* param[in]: byteNr - Index of stored encoded byte in bitString. Bytes past
+* the last stored byte are read as 0.
 */
-void bitStringReadByte (bitString *bs, char *byte, int byteNr) {
+void bitStringReadByte (bitString *bs, char *byte, int64_t byteNr) {
 
-	int encodedByte = bs -> encode[byteNr];
+	int encodedByte = byteNr < bs -> length ? bs -> encode[byteNr] : 0;
 	intToByte(byte, encodedByte);
 }
 
 
+/*
+* description: Reads a single bit of the encoded bytes in bitString. Bits are
+* read MSB first within each byte.
+* param[in]: bs - The bitString.
+* param[in]: bitNr - Index of the bit, counted from start of first byte.
+* return: The bit, 0 or 1. Bits past the last byte are read as 0.
+*/
+int bitStringGetBit (bitString *bs, int64_t bitNr) {
+
+	if (bitNr / 8 >= bs -> length) {
+
+		return 0;
+	}
+	return (bs -> encode[bitNr / 8] >> (7 - bitNr % 8)) & 1;
+}
+
+
+/*
+* description: Reads up to 32 bits of the encoded bytes in bitString as an
+* integer, MSB first.
+* param[in]: bs - The bitString.
+* param[in]: bitNr - Index of the first bit, counted from start of first byte.
+* param[in]: nrOfBits - Number of bits to read, 0 to 32.
+* return: The integer. Bits past the last byte are read as 0.
+*/
+uint32_t bitStringGetBits (bitString *bs, int64_t bitNr, int nrOfBits) {
+
+	int64_t byteNr = bitNr / 8;
+	uint64_t window = 0;
+
+	//Five bytes always hold the wanted bits, whatever bit they start at.
+	for (int i = 0; i < 5; i++) {
+
+		window = window << 8;
+		if (byteNr + i < bs -> length) {
+
+			window = window | bs -> encode[byteNr + i];
+		}
+	}
+	window = window >> (40 - bitNr % 8 - nrOfBits);
+	return (uint32_t)(window & (((uint64_t)1 << nrOfBits) - 1));
+}
+
+
 /*
 * description: Gets all bits put to bitString encoded as unsigned char array.
 * If there are not enough bits to create full bytes, padding (0's) will be
@@ -114,12 +187,31 @@ unsigned char *bitStringGetEncode (bitString *bs) {
 * param[in]: bs - The bitString.
 * return: Size of the bitString.
 */
-int bitStringGetSize (bitString *bs) {
+int64_t bitStringGetSize (bitString *bs) {
 
 	return bs -> length;
 }
 
 
+/*
+* description: Writes all full bytes of bitString to stream and removes them
+* from bitString, so long streams can be coded in constant memory. Bits not
+* yet filling a byte are kept.
+* param[in]: bs - The bitString.
+* param[in]: out - Stream to write to.
+* return: Number of bytes written, -1 if writing failed.
+*/
+int64_t bitStringWriteBytes (bitString *bs, stream *out) {
+
+	encodeBytes(bs);
+
+	int64_t written = streamWrite(out, bs -> encode, bs -> length) ?
+					  bs -> length : -1;
+	bs -> length = 0;
+	return written;
+}
+
+
 /* SUPPORT FUNCTION FOR BITSTRING
 * description: Encodes all possible bytes in bitString. If number of bits < 7;
 * nothing will happen. Else, all bites that fill a byte will be encoded.
@@ -127,42 +219,38 @@ int bitStringGetSize (bitString *bs) {
 */
 void encodeBytes (bitString *bs) {
 
-	int rest = bs -> nrOfBits % 8;
-	int bytes = bs -> nrOfBits - rest;
-
-	if (bytes >= 8) {
+	bitStringReserve(bs, bs -> nrOfBits / 8);
 
-		int i = 0;
-		int j = 0;
-		unsigned char tempEncode[bytes];
+	while (bs -> nrOfBits >= 8) {
 
-		while (i < bytes) {
-
-			tempEncode[j] = byteToInt(&bs -> bits[i]);
+		bs -> nrOfBits = bs -> nrOfBits - 8;
+		bs -> encode[bs -> length] =
+			(unsigned char)(bs -> bitBuffer >> bs -> nrOfBits);
+		bs -> length++;
+	}
+	//Only keep bits that are not yet encoded.
+	bs -> bitBuffer = bs -> bitBuffer & ((1ULL << bs -> nrOfBits) - 1);
+}
 
-			i = i + 8;
-			j++;
-		}
 
-		//     Reallocating memory for newly encoded text
-		bs -> encode = realloc(bs -> encode, bs -> length + j);
+/* SUPPORT FUNCTION FOR BITSTRING
+* description: Makes sure encoded char array has room for atleast extra more
+* chars. Capacity is doubled to keep number of reallocations low.
+* param[in]: bs - The bitString.
+* param[in]: extra - Number of chars that will be added.
+*/
+void bitStringReserve (bitString *bs, int64_t extra) {
 
-		//     Adding tempEncode to encoded text
-		//Using k since i and j already used
-		for (int k = 0; k < j; k++) {
+	if (bs -> length + extra > bs -> capacity) {
 
-			bs -> encode[bs -> length + k] = tempEncode[k];
-		}
-		bs -> length = bs -> length + j;
+		int64_t capacity = bs -> capacity > 0 ? bs -> capacity * 2 : 1024;
 
-		//     Deleting already encoded bits
-		//Using l since i, j and k already used
-		for (int l = 0; l < rest; l++) {
+		while (capacity < bs -> length + extra) {
 
-			bs -> bits[l] = bs -> bits [bytes + l];
+			capacity = capacity * 2;
 		}
-		bs -> bits = realloc(bs -> bits, rest);
-		bs -> nrOfBits = rest;
+		bs -> encode = realloc(bs -> encode, capacity);
+		bs -> capacity = capacity;
 	}
 }
 
@@ -181,14 +269,7 @@ void addPadding (bitString *bs) {
 		bitsToGo = 8 - bitsToGo;
 	}
 
-	if (bitsToGo > 0) {
-
-		bs -> bits = realloc(bs -> bits, sizeof(char) * (bs -> nrOfBits + bitsToGo));
-		for (int i = 0; i < bitsToGo; i++) {
-
-			bs -> bits[bs -> nrOfBits + i] = '0';
-		}
-	}
+	bs -> bitBuffer = bs -> bitBuffer << bitsToGo;
 	bs -> nrOfBits = bs -> nrOfBits + bitsToGo;
 }
 
@@ -1,6 +1,7 @@
 /*
-* bitString: Dynamiclly stores bits. bitString takes 0 and 1's represented as
-* chars and convert these, when a full byte is collected, into an unsigned char
+* bitString: Dynamiclly stores bits. bitString takes packed codes of up to 32
+* bits, collects them in a bit buffer and converts these, when a full byte is
+* collected, into an unsigned char
 *
 * bitString can also read unsigned chars and convert them into a byte.
 *
@@ -14,13 +15,18 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "stream.h"
 
 
 typedef struct {
 
-	int length;
+	int64_t length;
+	int64_t capacity;
 	int nrOfBits;
-	char *bits;
+	uint64_t bitBuffer;
 	unsigned char *encode;
 } bitString;
 
@@ -41,14 +47,21 @@ void bitStringKill (bitString *bs);
 
 
 /*
-* description: Add bits to bitString. If bitString reaches 8 bits (1 byte) or
-* more, bitString will encode these.
+* description: Empties bitString but keeps its memory, so it can be filled
+* again without reallocating.
+* param[in]: bs - The bitString.
+*/
+void bitStringClear (bitString *bs);
+
+
+/*
+* description: Add packed code to bitString. If bitString reaches 32 bits or
+* more, bitString will encode all full bytes.
 * param[in]: bs - The bitString.
-* param[in]: bits - Pointer to char array where the bits are stored as either
-* '1' or '0'.
-* param[in]: nrOfBits - Number of bits added to bitString.
+* param[in]: code - The bits, MSB first. Bits above nrOfBits must be 0.
+* param[in]: nrOfBits - Number of bits added to bitString. At most 32.
 */
-void bitStringAddBits (bitString *bs, char *bits, int nrOfBits);
+void bitStringAddCode (bitString *bs, uint32_t code, int nrOfBits);
 
 
 
@@ -60,14 +73,46 @@ void bitStringAddBits (bitString *bs, char *bits, int nrOfBits);
 void bitStringAddByte (bitString *bs, unsigned char byte);
 
 
+/*
+* description: Adds a number of encoded bytes to bitString.
+* param[in]: bs - The bitString.
+* param[in]: bytes - The encoded bytes.
+* param[in]: nrOfBytes - Number of bytes to add.
+*/
+void bitStringAddBytes (bitString *bs, const unsigned char *bytes,
+						int64_t nrOfBytes);
+
+
 /*
 * description: Reads encoded byte in bitString and points it back.
 * param[in]: bs - The bitString.
 * param[in]: byte - Pointer to char array of atleast size 8. Array will be
 * changed to which byte was read.
-* param[in]: byteNr - Index of stored encoded byte in bitString.
+* param[in]: byteNr - Index of stored encoded byte in bitString. Bytes past
+* the last stored byte are read as 0.
+*/
+void bitStringReadByte (bitString *bs, char *byte, int64_t byteNr);
+
+
+/*
+* description: Reads a single bit of the encoded bytes in bitString. Bits are
+* read MSB first within each byte.
+* param[in]: bs - The bitString.
+* param[in]: bitNr - Index of the bit, counted from start of first byte.
+* return: The bit, 0 or 1. Bits past the last byte are read as 0.
 */
-void bitStringReadByte (bitString *bs, char *byte, int byteNr) ;
+int bitStringGetBit (bitString *bs, int64_t bitNr);
+
+
+/*
+* description: Reads up to 32 bits of the encoded bytes in bitString as an
+* integer, MSB first.
+* param[in]: bs - The bitString.
+* param[in]: bitNr - Index of the first bit, counted from start of first byte.
+* param[in]: nrOfBits - Number of bits to read, 0 to 32.
+* return: The integer. Bits past the last byte are read as 0.
+*/
+uint32_t bitStringGetBits (bitString *bs, int64_t bitNr, int nrOfBits);
 
 
 /*
@@ -87,7 +132,18 @@ unsigned char *bitStringGetEncode (bitString *bs);
 * param[in]: bs - The bitString.
 * return: Size of the bitString.
 */
-int bitStringGetSize (bitString *bs);
+int64_t bitStringGetSize (bitString *bs);
+
+
+/*
+* description: Writes all full bytes of bitString to stream and removes them
+* from bitString, so long streams can be coded in constant memory. Bits not
+* yet filling a byte are kept.
+* param[in]: bs - The bitString.
+* param[in]: out - Stream to write to.
+* return: Number of bytes written, -1 if writing failed.
+*/
+int64_t bitStringWriteBytes (bitString *bs, stream *out);
 
 
 
@@ -99,6 +155,15 @@ int bitStringGetSize (bitString *bs);
 void encodeBytes (bitString *bs);
 
 
+/* SUPPORT FUNCTION FOR BITSTRING
+* description: Makes sure encoded char array has room for atleast extra more
+* chars. Capacity is doubled to keep number of reallocations low.
+* param[in]: bs - The bitString.
+* param[in]: extra - Number of chars that will be added.
+*/
+void bitStringReserve (bitString *bs, int64_t extra);
+
+
 /* SUPPORT FUNCTION FOR BITSTRING
 * description: If number of bits in bitString does not fill a full byte,
 * padding (0's) will be added to end such that a byte can be filled.
@@ -0,0 +1,203 @@
+/*
+* blocksort: Block sorting mode. Text is split into blocks and each block is
+* run through bwt, mtf and rle before it is coded with a canonical huffman
+* code of it's own. See blocksort.h for the layout of the payload.
+*/
+
+#include "blocksort.h"
+#include "encode.h"
+
+
+/*
+* description: Encodes chars in memory block by block and adds the blocks to
+* bitString.
+* param[in]: bs - The bitString.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[in]: blockSize - Largest number of chars in a block.
+*/
+void blockSortEncode (bitString *bs, const unsigned char *text,
+					  int64_t length, int64_t blockSize) {
+
+	int64_t workSize = length < blockSize ? length : blockSize;
+	unsigned char *work = malloc(workSize > 0 ? workSize : 1);
+	uint16_t *symbols = malloc(sizeof(uint16_t) * (workSize > 0 ? workSize : 1));
+
+	for (int64_t pos = 0; pos < length; pos = pos + blockSize) {
+
+		int64_t n = length - pos < blockSize ? length - pos : blockSize;
+		blockSortEncodeBlock(bs, &text[pos], n, work, symbols);
+	}
+
+	free(symbols);
+	free(work);
+}
+
+
+/*
+* description: Decodes blocks from bitString. A block holds atmost
+* BLOCKSORTSIZE chars.
+* param[in]: bs - The bitString.
+* param[in]: bitPos - Position of next bit to read. Moved past the blocks.
+* param[out]: text - Array to store atleast length chars in.
+* param[in]: length - Number of chars to decode.
+* return: 1 if all chars could be decoded, else 0.
+*/
+int blockSortDecode (bitString *bs, int64_t *bitPos, unsigned char *text,
+					 int64_t length) {
+
+	unsigned char *work = NULL;
+	uint16_t *symbols = NULL;
+	int64_t workSize = 0;
+	int64_t pos = 0;
+	int valid = 1;
+
+	while (valid && pos < length) {
+
+		int64_t n = canonicalReadGamma(bs, bitPos);
+		int64_t primary = (int64_t)canonicalReadGamma(bs, bitPos) - 1;
+		int64_t count = (int64_t)canonicalReadGamma(bs, bitPos) - 1;
+		uint8_t lengths[RLESYMBOLS];
+
+		valid = n > 0 && n <= length - pos && n <= BLOCKSORTSIZE &&
+				count >= 0 && count <= n &&
+				canonicalReadLengths(bs, bitPos, lengths, RLESYMBOLS);
+		if (!valid) {
+
+			break;
+		}
+
+		if (n > workSize) {
+
+			workSize = n;
+			work = realloc(work, workSize);
+			symbols = realloc(symbols, sizeof(uint16_t) * workSize);
+		}
+
+		canonicalDecoder *dec = canonicalDecoderBuild(lengths, RLESYMBOLS);
+		for (int64_t i = 0; valid && i < count; i++) {
+
+			int key = canonicalDecodeKey(dec, bs, bitPos);
+
+			valid = key >= 0;
+			symbols[i] = (uint16_t)key;
+		}
+		canonicalDecoderKill(dec);
+
+		valid = valid && rleZeroDecode(symbols, count, work, n) == n;
+		if (valid) {
+
+			//mtf output is reused as bwt input, text holds the bwt output.
+			mtfInverse(work, &text[pos], n);
+			memcpy(work, &text[pos], n);
+			valid = bwtInverse(work, &text[pos], n, primary);
+		}
+		pos = pos + n;
+	}
+
+	free(symbols);
+	free(work);
+	return valid;
+}
+
+
+/*
+* description: Reads file, encodes it block by block and writes encoded file.
+* param[in]: file1 - Name of file to be read and encoded.
+* param[in]: file2 - Name of file to be written as encoded file.
+* return: 1 if file2 was written, else 0.
+*/
+int blockSortEncodeFile (char const *file1, char const *file2) {
+
+	int64_t length = 0;
+	unsigned char *text = readPlainFile(file1, &length);
+	bitString *bs = bitStringEmpty();
+
+	blockSortEncode(bs, text, length, BLOCKSORTSIZE);
+
+	unsigned char *encode = bitStringGetEncode(bs);
+	int valid = writeEncode(file2, FORMATMODEBLOCKSORT, length, encode,
+							bitStringGetSize(bs));
+
+	bitStringKill(bs);
+	free(text);
+	return valid;
+}
+
+
+/*
+* description: Decodes block sorting payload and writes decoded file.
+* param[in]: file2 - Name of file to write decode.
+* param[in]: bs - The bitString with payload after file header.
+* param[in]: originalLength - Number of chars to decode.
+* return: 1 if payload could be decoded, else 0.
+*/
+int blockSortDecodeFile (char const *file2, bitString *bs,
+						 uint64_t originalLength) {
+
+	int64_t bitPos = 0;
+	unsigned char *text = NULL;
+
+	//A block takes atleast 4 bits, one per gamma and one for its lengths.
+	if (formatLengthFits(originalLength, bitStringGetSize(bs),
+						 2 * BLOCKSORTSIZE)) {
+
+		text = malloc(originalLength > 0 ? originalLength : 1);
+	}
+	if (text == NULL) {
+
+		return 0;
+	}
+	int valid = blockSortDecode(bs, &bitPos, text, originalLength);
+
+	if (valid) {
+
+		valid = writePlainFile(file2, text, originalLength);
+	}
+
+	free(text);
+	return valid;
+}
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN BLOCKSORT.C
+
+
+/* support function for blockSortEncode!
+* description: Encodes one block.
+* param[in]: bs - The bitString.
+* param[in]: block - The chars of the block.
+* param[in]: n - Number of chars in block.
+* param[in]: work - Array of atleast n chars used between stages.
+* param[in]: symbols - Array of atleast n symbols used between stages.
+*/
+void blockSortEncodeBlock (bitString *bs, const unsigned char *block,
+						   int64_t n, unsigned char *work, uint16_t *symbols) {
+
+	uint64_t freqTable[RLESYMBOLS] = {0};
+	uint8_t lengths[RLESYMBOLS];
+	huffCode codeTable[RLESYMBOLS];
+
+	//bwt output goes to work and mtf is done in place on it.
+	int64_t primary = bwtForward(block, work, n);
+	mtfForward(work, work, n);
+	int64_t count = rleZeroEncode(work, n, symbols);
+
+	for (int64_t i = 0; i < count; i++) {
+
+		freqTable[symbols[i]]++;
+	}
+	canonicalCodeLengths(freqTable, RLESYMBOLS, HUFFMAXCODELEN, lengths);
+	canonicalAssignCodes(lengths, RLESYMBOLS, codeTable);
+
+	canonicalWriteGamma(bs, n);
+	canonicalWriteGamma(bs, primary + 1);
+	canonicalWriteGamma(bs, count + 1);
+	canonicalWriteLengths(bs, lengths, RLESYMBOLS);
+
+	for (int64_t i = 0; i < count; i++) {
+
+		huffCode hc = codeTable[symbols[i]];
+		bitStringAddCode(bs, hc.code, hc.len);
+	}
+}
@@ -0,0 +1,91 @@
+/*
+* blocksort: Block sorting mode. Text is split into blocks and each block is
+* run through bwt, mtf and rle before it is coded with a canonical huffman
+* code of it's own. Decoding runs the same chain backwards.
+*
+* Payload after file header, one entry per block until all chars are coded:
+*   gamma(block length)
+*   gamma(primary index + 1)
+*   gamma(number of rle symbols + 1)
+*   code lengths of the RLESYMBOLS symbols, see canonicalWriteLengths
+*   codes of the rle symbols
+*/
+
+#ifndef BLOCKSORT
+#define BLOCKSORT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "huffTree.h"
+#include "bitString.h"
+#include "canonical.h"
+#include "bwt.h"
+#include "mtf.h"
+#include "rle.h"
+
+#define BLOCKSORTSIZE (1 << 20)
+
+
+/*
+* description: Encodes chars in memory block by block and adds the blocks to
+* bitString.
+* param[in]: bs - The bitString.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[in]: blockSize - Largest number of chars in a block.
+*/
+void blockSortEncode (bitString *bs, const unsigned char *text,
+					  int64_t length, int64_t blockSize);
+
+
+/*
+* description: Decodes blocks from bitString. A block holds atmost
+* BLOCKSORTSIZE chars.
+* param[in]: bs - The bitString.
+* param[in]: bitPos - Position of next bit to read. Moved past the blocks.
+* param[out]: text - Array to store atleast length chars in.
+* param[in]: length - Number of chars to decode.
+* return: 1 if all chars could be decoded, else 0.
+*/
+int blockSortDecode (bitString *bs, int64_t *bitPos, unsigned char *text,
+					 int64_t length);
+
+
+/*
+* description: Reads file, encodes it block by block and writes encoded file.
+* param[in]: file1 - Name of file to be read and encoded.
+* param[in]: file2 - Name of file to be written as encoded file.
+* return: 1 if file2 was written, else 0.
+*/
+int blockSortEncodeFile (char const *file1, char const *file2);
+
+
+/*
+* description: Decodes block sorting payload and writes decoded file.
+* param[in]: file2 - Name of file to write decode.
+* param[in]: bs - The bitString with payload after file header.
+* param[in]: originalLength - Number of chars to decode.
+* return: 1 if payload could be decoded, else 0.
+*/
+int blockSortDecodeFile (char const *file2, bitString *bs,
+						 uint64_t originalLength);
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN BLOCKSORT.C
+
+
+/* support function for blockSortEncode!
+* description: Encodes one block.
+* param[in]: bs - The bitString.
+* param[in]: block - The chars of the block.
+* param[in]: n - Number of chars in block.
+* param[in]: work - Array of atleast n chars used between stages.
+* param[in]: symbols - Array of atleast n symbols used between stages.
+*/
+void blockSortEncodeBlock (bitString *bs, const unsigned char *block,
+						   int64_t n, unsigned char *work, uint16_t *symbols);
+
+
+#endif //BLOCKSORT
@@ -0,0 +1,199 @@
+/*
+* bwt: Burrows-Wheeler transform of a block of chars.
+*
+* All rotations of the block are sorted with prefix doubling over a suffix
+* array of rotations, O(n log n), and the last char of each sorted rotation
+* is output.
+*/
+
+#include <string.h>
+
+#include "bwt.h"
+
+
+/*
+* description: Transforms block of chars.
+* param[in]: in - The chars.
+* param[out]: out - Array to store n transformed chars in.
+* param[in]: n - Number of chars, at most INT32_MAX.
+* return: Primary index, the row of the sorted rotations that holds in. 0 if
+* n is 0.
+*/
+int64_t bwtForward (const unsigned char *in, unsigned char *out, int64_t n) {
+
+	int64_t primary = 0;
+
+	if (n == 0) {
+
+		return primary;
+	}
+
+	int32_t *order = malloc(sizeof(int32_t) * n);
+	bwtSortRotations(in, (int32_t)n, order);
+
+	for (int64_t i = 0; i < n; i++) {
+
+		if (order[i] == 0) {
+
+			primary = i;
+			out[i] = in[n - 1];
+		} else {
+
+			out[i] = in[order[i] - 1];
+		}
+	}
+
+	free(order);
+	return primary;
+}
+
+
+/*
+* description: Transforms block back to original chars.
+* param[in]: in - The transformed chars.
+* param[out]: out - Array to store n original chars in.
+* param[in]: n - Number of chars.
+* param[in]: primary - Primary index from bwtForward.
+* return: 1 if primary index is valid, else 0.
+*/
+int bwtInverse (const unsigned char *in, unsigned char *out, int64_t n,
+				int64_t primary) {
+
+	if (n == 0) {
+
+		return 1;
+	}
+	if (primary < 0 || primary >= n) {
+
+		return 0;
+	}
+
+	int64_t count[256] = {0};
+	int64_t start[256];
+	int32_t *lf = malloc(sizeof(int32_t) * n);
+
+	for (int64_t i = 0; i < n; i++) {
+
+		count[in[i]]++;
+	}
+	start[0] = 0;
+	for (int c = 1; c < 256; c++) {
+
+		start[c] = start[c - 1] + count[c - 1];
+	}
+
+	//Row i ends with in[i], lf[i] is the row that starts with that char.
+	for (int64_t i = 0; i < n; i++) {
+
+		lf[i] = (int32_t)start[in[i]];
+		start[in[i]]++;
+	}
+
+	int64_t row = primary;
+	for (int64_t k = n - 1; k >= 0; k--) {
+
+		out[k] = in[row];
+		row = lf[row];
+	}
+
+	free(lf);
+	return 1;
+}
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN BWT.C
+
+
+/* support function for bwtForward!
+* description: Sorts all rotations of block.
+* param[in]: in - The chars.
+* param[in]: n - Number of chars.
+* param[out]: order - Array to store start of each sorted rotation in.
+*/
+void bwtSortRotations (const unsigned char *in, int32_t n, int32_t *order) {
+
+	int32_t *rank = malloc(sizeof(int32_t) * n);
+	int32_t *nextOrder = malloc(sizeof(int32_t) * n);
+	int32_t *nextRank = malloc(sizeof(int32_t) * n);
+	int32_t *count = malloc(sizeof(int32_t) * (n > 256 ? n : 256));
+	int32_t classes = 0;
+
+	//Rotations sorted by first char.
+	memset(count, 0, sizeof(int32_t) * 256);
+	for (int32_t i = 0; i < n; i++) {
+
+		count[in[i]]++;
+	}
+	for (int c = 1; c < 256; c++) {
+
+		count[c] = count[c] + count[c - 1];
+	}
+	for (int32_t i = n - 1; i >= 0; i--) {
+
+		count[in[i]]--;
+		order[count[in[i]]] = i;
+	}
+	rank[order[0]] = 0;
+	classes = 1;
+	for (int32_t i = 1; i < n; i++) {
+
+		if (in[order[i]] != in[order[i - 1]]) {
+
+			classes++;
+		}
+		rank[order[i]] = classes - 1;
+	}
+
+	//Each round sorts by first 2h chars using ranks of first h chars.
+	for (int64_t h = 1; h < n && classes < n; h = h * 2) {
+
+		//Sorted by second half already, so a stable sort by first half rank
+		//gives order by both.
+		for (int32_t i = 0; i < n; i++) {
+
+			int64_t start = order[i] - h;
+			nextOrder[i] = (int32_t)(start < 0 ? start + n : start);
+		}
+
+		memset(count, 0, sizeof(int32_t) * classes);
+		for (int32_t i = 0; i < n; i++) {
+
+			count[rank[nextOrder[i]]]++;
+		}
+		for (int32_t c = 1; c < classes; c++) {
+
+			count[c] = count[c] + count[c - 1];
+		}
+		for (int32_t i = n - 1; i >= 0; i--) {
+
+			count[rank[nextOrder[i]]]--;
+			order[count[rank[nextOrder[i]]]] = nextOrder[i];
+		}
+
+		nextRank[order[0]] = 0;
+		classes = 1;
+		for (int32_t i = 1; i < n; i++) {
+
+			int32_t current = order[i];
+			int32_t previous = order[i - 1];
+			int32_t currentHalf = rank[(current + h) % n];
+			int32_t previousHalf = rank[(previous + h) % n];
+
+			if (rank[current] != rank[previous] ||
+				currentHalf != previousHalf) {
+
+				classes++;
+			}
+			nextRank[current] = classes - 1;
+		}
+
+		int32_t *swap = rank;
+		rank = nextRank;
+		nextRank = swap;
+	}
+
+	free(count);
+	free(nextRank);
+	free(nextOrder);
+	free(rank);
+}
@@ -0,0 +1,53 @@
+/*
+* bwt: Burrows-Wheeler transform of a block of chars.
+*
+* All rotations of the block are sorted with prefix doubling over a suffix
+* array of rotations, O(n log n), and the last char of each sorted rotation
+* is output. Chars that come before similar contexts end up next to each
+* other, which move-to-front and run length coding can then exploit.
+*/
+
+#ifndef BWT
+#define BWT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+
+/*
+* description: Transforms block of chars.
+* param[in]: in - The chars.
+* param[out]: out - Array to store n transformed chars in.
+* param[in]: n - Number of chars, at most INT32_MAX.
+* return: Primary index, the row of the sorted rotations that holds in. 0 if
+* n is 0.
+*/
+int64_t bwtForward (const unsigned char *in, unsigned char *out, int64_t n);
+
+
+/*
+* description: Transforms block back to original chars.
+* param[in]: in - The transformed chars.
+* param[out]: out - Array to store n original chars in.
+* param[in]: n - Number of chars.
+* param[in]: primary - Primary index from bwtForward.
+* return: 1 if primary index is valid, else 0.
+*/
+int bwtInverse (const unsigned char *in, unsigned char *out, int64_t n,
+				int64_t primary);
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN BWT.C
+
+
+/* support function for bwtForward!
+* description: Sorts all rotations of block.
+* param[in]: in - The chars.
+* param[in]: n - Number of chars.
+* param[out]: order - Array to store start of each sorted rotation in.
+*/
+void bwtSortRotations (const unsigned char *in, int32_t n, int32_t *order);
+
+
+#endif //BWT
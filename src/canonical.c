@@ -0,0 +1,648 @@
+/*
+* canonical: Builds canonical huffman codes without building a huffTree.
+*
+* Nonzero weights are sorted once, code lengths are computed in place in a
+* single array with the method of Moffat and Katajainen, lengths are limited
+* to a maximum and codes are assigned canonically from the lengths. Only the
+* lengths are needed to rebuild the same codes, which makes them cheap to
+* store and to rebuild per block.
+*/
+
+#include "canonical.h"
+
+
+/* support function for canonicalCodeLengths!
+* description: qsort compare function for canonicalEntry. Lesser weight comes
+* first, equal weights are ordered by key.
+*/
+static int canonicalEntryCompare (const void *in1, const void *in2) {
+
+	const canonicalEntry *e1 = in1;
+	const canonicalEntry *e2 = in2;
+
+	if (e1 -> weight != e2 -> weight) {
+
+		return e1 -> weight < e2 -> weight ? -1 : 1;
+	}
+	return e1 -> key - e2 -> key;
+}
+
+
+/*
+* description: Computes code lengths for all keys from their weights. Keys
+* with weight 0 get length 0 and no code. If only one key has weight, it gets
+* length 1.
+* param[in]: freqTable - Weight of each key.
+* param[in]: size - Number of keys.
+* param[in]: maxLen - Longest allowed code length. At most HUFFMAXCODELEN.
+* param[out]: lengths - Array of size keys to store code lengths in.
+* return: Number of keys with a code.
+*/
+int canonicalCodeLengths (const uint64_t *freqTable, int size, int maxLen,
+						  uint8_t *lengths) {
+
+	canonicalEntry *entries = malloc(sizeof(canonicalEntry) * size);
+	uint64_t *work = malloc(sizeof(uint64_t) * size);
+	int n = canonicalCodeLengthsInto(freqTable, size, maxLen, lengths, entries,
+									 work);
+
+	free(work);
+	free(entries);
+	return n;
+}
+
+
+/*
+* description: Computes code lengths like canonicalCodeLengths, in work
+* arrays of the caller, so no memory is allocated.
+* param[in]: freqTable - Weight of each key.
+* param[in]: size - Number of keys.
+* param[in]: maxLen - Longest allowed code length. At most HUFFMAXCODELEN.
+* param[out]: lengths - Array of size keys to store code lengths in.
+* param[in]: entries - Work array of atleast size entries.
+* param[in]: work - Work array of atleast size integers.
+* return: Number of keys with a code.
+*/
+int canonicalCodeLengthsInto (const uint64_t *freqTable, int size,
+							  int maxLen, uint8_t *lengths,
+							  canonicalEntry *entries, uint64_t *work) {
+
+	int n = 0;
+
+	for (int i = 0; i < size; i++) {
+
+		lengths[i] = 0;
+		if (freqTable[i] > 0) {
+
+			entries[n].weight = freqTable[i];
+			entries[n].key = i;
+			n++;
+		}
+	}
+
+	if (n == 1) {
+
+		lengths[entries[0].key] = 1;
+	} else if (n > 1) {
+
+		canonicalSortEntries(entries, n);
+		for (int i = 0; i < n; i++) {
+
+			work[i] = entries[i].weight;
+		}
+
+		canonicalMinimumRedundancy(work, n);
+		if (work[0] > (uint64_t)maxLen) {
+
+			canonicalLimitLengths(work, n, maxLen);
+		}
+
+		for (int i = 0; i < n; i++) {
+
+			lengths[entries[i].key] = (uint8_t)work[i];
+		}
+	}
+
+	return n;
+}
+
+
+/*
+* description: Assigns canonical codes from code lengths. Shorter codes come
+* first and codes of same length are ordered by key.
+* param[in]: lengths - Code length of each key, 0 for keys without code.
+* param[in]: size - Number of keys.
+* param[out]: codeTable - Array of size huffCodes to store the codes in.
+*/
+void canonicalAssignCodes (const uint8_t *lengths, int size,
+						   huffCode *codeTable) {
+
+	int count[HUFFMAXCODELEN + 1] = {0};
+	uint32_t nextCode[HUFFMAXCODELEN + 1];
+	uint32_t code = 0;
+
+	for (int i = 0; i < size; i++) {
+
+		count[lengths[i]]++;
+	}
+	count[0] = 0;
+
+	for (int len = 1; len <= HUFFMAXCODELEN; len++) {
+
+		code = (code + count[len - 1]) << 1;
+		nextCode[len] = code;
+	}
+
+	for (int i = 0; i < size; i++) {
+
+		codeTable[i].len = lengths[i];
+		codeTable[i].code = 0;
+		if (lengths[i] > 0) {
+
+			codeTable[i].code = nextCode[lengths[i]];
+			nextCode[lengths[i]]++;
+		}
+	}
+}
+
+
+/*
+* description: Builds decoder for canonical codes from code lengths. Allocates
+* memory for canonicalDecoder.
+* param[in]: lengths - Code length of each key, 0 for keys without code.
+* param[in]: size - Number of keys.
+* return: The canonicalDecoder.
+*/
+canonicalDecoder *canonicalDecoderBuild (const uint8_t *lengths, int size) {
+
+	canonicalDecoder *dec = malloc(sizeof(canonicalDecoder));
+
+	canonicalDecoderInit(dec, lengths, size, malloc(sizeof(int) * size));
+	return dec;
+}
+
+
+/*
+* description: Builds decoder for canonical codes from code lengths into
+* memory of the caller, so no memory is allocated.
+* param[out]: dec - The canonicalDecoder.
+* param[in]: lengths - Code length of each key, 0 for keys without code.
+* param[in]: size - Number of keys.
+* param[in]: symbols - Array of atleast size integers, used by dec.
+*/
+void canonicalDecoderInit (canonicalDecoder *dec, const uint8_t *lengths,
+						   int size, int *symbols) {
+
+	int index[HUFFMAXCODELEN + 1];
+	uint32_t code = 0;
+	int first = 0;
+
+	dec -> size = size;
+	dec -> maxLen = 0;
+	dec -> symbols = symbols;
+
+	for (int len = 0; len <= HUFFMAXCODELEN; len++) {
+
+		dec -> count[len] = 0;
+	}
+	for (int i = 0; i < size; i++) {
+
+		dec -> count[lengths[i]]++;
+		if (lengths[i] > dec -> maxLen) {
+
+			dec -> maxLen = lengths[i];
+		}
+	}
+	dec -> count[0] = 0;
+
+	//Same walk as canonicalAssignCodes, but remembering first code and
+	//where keys of each length start in symbols.
+	for (int len = 1; len <= HUFFMAXCODELEN; len++) {
+
+		code = (code + dec -> count[len - 1]) << 1;
+		dec -> firstCode[len] = code;
+		dec -> firstIndex[len] = first;
+		index[len] = first;
+		first = first + dec -> count[len];
+	}
+
+	for (int i = 0; i < size; i++) {
+
+		if (lengths[i] > 0) {
+
+			dec -> symbols[index[lengths[i]]] = i;
+			index[lengths[i]]++;
+		}
+	}
+}
+
+
+/*
+* description: Deallocates all memory allocated by canonicalDecoder.
+* param[in]: dec - The canonicalDecoder.
+*/
+void canonicalDecoderKill (canonicalDecoder *dec) {
+
+	free(dec -> symbols);
+	free(dec);
+}
+
+
+/*
+* description: Decodes one key from bitString.
+* param[in]: dec - The canonicalDecoder.
+* param[in]: bs - The bitString to read bits from.
+* param[in]: bitPos - Position of next bit to read. Moved past the code.
+* return: The decoded key, -1 if bits do not form a valid code.
+*/
+int canonicalDecodeKey (canonicalDecoder *dec, bitString *bs,
+						int64_t *bitPos) {
+
+	uint32_t code = 0;
+
+	for (int len = 1; len <= dec -> maxLen; len++) {
+
+		code = (code << 1) | bitStringGetBit(bs, *bitPos);
+		(*bitPos)++;
+
+		if (code - dec -> firstCode[len] < (uint32_t)dec -> count[len]) {
+
+			return dec -> symbols[dec -> firstIndex[len] +
+								  (code - dec -> firstCode[len])];
+		}
+	}
+	return -1;
+}
+
+
+/*
+* description: Writes code lengths compactly to bitString. Number of keys with
+* a code is written first, then for each such key the gap from previous key
+* and it's length. Gaps and count are Elias gamma coded.
+* param[in]: bs - The bitString to write to.
+* param[in]: lengths - Code length of each key, 0 for keys without code.
+* param[in]: size - Number of keys.
+*/
+void canonicalWriteLengths (bitString *bs, const uint8_t *lengths, int size) {
+
+	int n = 0;
+	int maxLen = 0;
+
+	for (int i = 0; i < size; i++) {
+
+		if (lengths[i] > 0) {
+
+			n++;
+			if (lengths[i] > maxLen) {
+
+				maxLen = lengths[i];
+			}
+		}
+	}
+
+	canonicalWriteGamma(bs, n + 1);
+	if (n == 0) {
+
+		return;
+	}
+
+	//Lengths are stored as len - 1 in just enough bits for longest code.
+	int lengthBits = canonicalBitWidth(maxLen - 1);
+	bitStringAddCode(bs, lengthBits, 5);
+
+	int previous = -1;
+	for (int i = 0; i < size; i++) {
+
+		if (lengths[i] > 0) {
+
+			canonicalWriteGamma(bs, i - previous);
+			bitStringAddCode(bs, lengths[i] - 1, lengthBits);
+			previous = i;
+		}
+	}
+}
+
+
+/*
+* description: Reads code lengths written by canonicalWriteLengths.
+* param[in]: bs - The bitString to read from.
+* param[in]: bitPos - Position of next bit to read. Moved past the lengths.
+* param[out]: lengths - Array of size keys to store code lengths in.
+* param[in]: size - Number of keys.
+* return: 1 if lengths are valid, else 0.
+*/
+int canonicalReadLengths (bitString *bs, int64_t *bitPos, uint8_t *lengths,
+						  int size) {
+
+	for (int i = 0; i < size; i++) {
+
+		lengths[i] = 0;
+	}
+
+	uint32_t n = canonicalReadGamma(bs, bitPos);
+	if (n == 0 || n - 1 > (uint32_t)size) {
+
+		return 0;
+	}
+	n--;
+	if (n == 0) {
+
+		return 1;
+	}
+
+	int lengthBits = (int)canonicalReadBits(bs, bitPos, 5);
+	int64_t key = -1;
+	uint64_t kraft = 0;
+
+	for (uint32_t j = 0; j < n; j++) {
+
+		uint32_t gap = canonicalReadGamma(bs, bitPos);
+		int len = (int)canonicalReadBits(bs, bitPos, lengthBits) + 1;
+
+		key = key + gap;
+		if (gap == 0 || key >= size || len > HUFFMAXCODELEN) {
+
+			return 0;
+		}
+		lengths[key] = (uint8_t)len;
+		kraft = kraft + (1ULL << (HUFFMAXCODELEN - len));
+	}
+
+	//Codes must not overlap, else decoding is ambiguous.
+	return kraft <= (1ULL << HUFFMAXCODELEN);
+}
+
+
+/*
+* description: Computes number of bits canonicalWriteLengths would write.
+* param[in]: lengths - Code length of each key, 0 for keys without code.
+* param[in]: size - Number of keys.
+* return: Number of bits.
+*/
+int64_t canonicalLengthsCost (const uint8_t *lengths, int size) {
+
+	int n = 0;
+	int maxLen = 0;
+	int64_t gapBits = 0;
+	int previous = -1;
+
+	for (int i = 0; i < size; i++) {
+
+		if (lengths[i] > 0) {
+
+			n++;
+			if (lengths[i] > maxLen) {
+
+				maxLen = lengths[i];
+			}
+			gapBits = gapBits + 2 * canonicalBitWidth(i - previous) - 1;
+			previous = i;
+		}
+	}
+
+	int64_t cost = 2 * canonicalBitWidth(n + 1) - 1;
+	if (n > 0) {
+
+		cost = cost + 5 + gapBits + (int64_t)n * canonicalBitWidth(maxLen - 1);
+	}
+	return cost;
+}
+
+
+/*
+* description: Writes a positive integer Elias gamma coded to bitString.
+* param[in]: bs - The bitString.
+* param[in]: value - The integer, atleast 1.
+*/
+void canonicalWriteGamma (bitString *bs, uint32_t value) {
+
+	int width = canonicalBitWidth(value);
+
+	//width - 1 zeros, then value itself which starts with a 1.
+	bitStringAddCode(bs, 0, width - 1);
+	bitStringAddCode(bs, value, width);
+}
+
+
+/*
+* description: Reads an Elias gamma coded integer from bitString.
+* param[in]: bs - The bitString.
+* param[in]: bitPos - Position of next bit to read. Moved past the integer.
+* return: The integer, 0 if bits are not a valid gamma code.
+*/
+uint32_t canonicalReadGamma (bitString *bs, int64_t *bitPos) {
+
+	int zeros = 0;
+
+	while (bitStringGetBit(bs, *bitPos) == 0) {
+
+		zeros++;
+		(*bitPos)++;
+		if (zeros > 31) {
+
+			return 0;
+		}
+	}
+	return canonicalReadBits(bs, bitPos, zeros + 1);
+}
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN CANONICAL.C
+
+
+/* support function for canonicalCodeLengthsInto!
+* description: Sorts entries by weight and then key, with heapsort. Unlike
+* qsort, which may allocate a buffer, it makes no allocation.
+* param[in]: entries - The entries.
+* param[in]: n - Number of entries.
+*/
+void canonicalSortEntries (canonicalEntry *entries, int n) {
+
+	//Greatest entry is kept at root of heap, and swapped to the end of the
+	//unsorted part.
+	for (int i = n / 2 - 1; i >= 0; i--) {
+
+		canonicalSiftDown(entries, i, n);
+	}
+	for (int end = n - 1; end > 0; end--) {
+
+		canonicalEntry swap = entries[0];
+		entries[0] = entries[end];
+		entries[end] = swap;
+		canonicalSiftDown(entries, 0, end);
+	}
+}
+
+
+/* support function for canonicalSortEntries!
+* description: Moves entry down the heap until it is not less than its
+* children.
+* param[in]: entries - The heap.
+* param[in]: parent - Index of entry.
+* param[in]: n - Number of entries in heap.
+*/
+void canonicalSiftDown (canonicalEntry *entries, int parent, int n) {
+
+	int child = 2 * parent + 1;
+
+	while (child < n) {
+
+		if (child + 1 < n &&
+			canonicalEntryCompare(&entries[child], &entries[child + 1]) < 0) {
+
+			child++;
+		}
+		if (canonicalEntryCompare(&entries[parent], &entries[child]) >= 0) {
+
+			return;
+		}
+		canonicalEntry swap = entries[parent];
+		entries[parent] = entries[child];
+		entries[child] = swap;
+		parent = child;
+		child = 2 * parent + 1;
+	}
+}
+
+
+/* support function for canonicalCodeLengths!
+* description: Computes code lengths in place on weights sorted in ascending
+* order. Each weight is replaced by the code length of it's key.
+* param[in]: weights - Sorted weights, becomes code lengths.
+* param[in]: n - Number of weights, atleast 2.
+*/
+void canonicalMinimumRedundancy (uint64_t *weights, int n) {
+
+	uint64_t *a = weights;
+	int root = 0;
+	int leaf = 2;
+
+	//First pass, left to right. Internal nodes are formed in a[0..n-2] and
+	//a[root] becomes pointer to parent once it has been used.
+	a[0] = a[0] + a[1];
+	for (int next = 1; next < n - 1; next++) {
+
+		if (leaf >= n || a[root] < a[leaf]) {
+
+			a[next] = a[root];
+			a[root] = next;
+			root++;
+		} else {
+
+			a[next] = a[leaf];
+			leaf++;
+		}
+
+		if (leaf >= n || (root < next && a[root] < a[leaf])) {
+
+			a[next] = a[next] + a[root];
+			a[root] = next;
+			root++;
+		} else {
+
+			a[next] = a[next] + a[leaf];
+			leaf++;
+		}
+	}
+
+	//Second pass, right to left. Parent pointers become internal depths.
+	a[n - 2] = 0;
+	for (int next = n - 3; next >= 0; next--) {
+
+		a[next] = a[a[next]] + 1;
+	}
+
+	//Third pass, right to left. Internal depths become leaf depths.
+	int available = 1;
+	int used = 0;
+	uint64_t depth = 0;
+	root = n - 2;
+	int next = n - 1;
+
+	while (available > 0) {
+
+		while (root >= 0 && a[root] == depth) {
+
+			used++;
+			root--;
+		}
+		while (available > used) {
+
+			a[next] = depth;
+			next--;
+			available--;
+		}
+		available = 2 * used;
+		depth++;
+		used = 0;
+	}
+}
+
+
+/* support function for canonicalCodeLengths!
+* description: Limits code lengths to maxLen while keeping a complete code.
+* Works on number of codes per length, lengths are then handed out again with
+* shortest lengths to highest weights.
+* param[in]: lengths - Code lengths of sorted weights, in descending order.
+* param[in]: n - Number of lengths.
+* param[in]: maxLen - Longest allowed code length.
+*/
+void canonicalLimitLengths (uint64_t *lengths, int n, int maxLen) {
+
+	int count[HUFFMAXCODELEN + 1] = {0};
+	uint64_t kraft = 0;
+
+	for (int i = 0; i < n; i++) {
+
+		count[lengths[i] > (uint64_t)maxLen ? (uint64_t)maxLen : lengths[i]]++;
+	}
+
+	for (int len = maxLen; len > 0; len--) {
+
+		kraft = kraft + ((uint64_t)count[len] << (maxLen - len));
+	}
+
+	//Each step removes one code at maxLen and splits a shorter code in two,
+	//which lowers the kraft sum by one unit.
+	while (kraft > (1ULL << maxLen)) {
+
+		count[maxLen]--;
+		for (int len = maxLen - 1; len > 0; len--) {
+
+			if (count[len] > 0) {
+
+				count[len]--;
+				count[len + 1] = count[len + 1] + 2;
+				break;
+			}
+		}
+		kraft--;
+	}
+
+	int i = n - 1;
+	for (int len = 1; len <= maxLen; len++) {
+
+		for (int j = 0; j < count[len]; j++) {
+
+			lengths[i] = len;
+			i--;
+		}
+	}
+}
+
+
+/* support function for canonicalWriteLengths!
+* description: Computes number of bits needed to write an integer.
+* param[in]: value - The integer.
+* return: Number of bits, 1 for value 0.
+*/
+int canonicalBitWidth (uint32_t value) {
+
+	int width = 1;
+
+	while (width < 32 && (value >> width) != 0) {
+
+		width++;
+	}
+	return width;
+}
+
+
+/* support function for canonicalReadLengths!
+* description: Reads integer of nrOfBits bits from bitString, MSB first.
+* param[in]: bs - The bitString.
+* param[in]: bitPos - Position of next bit to read. Moved past the integer.
+* param[in]: nrOfBits - Number of bits to read, at most 32.
+* return: The integer.
+*/
+uint32_t canonicalReadBits (bitString *bs, int64_t *bitPos, int nrOfBits) {
+
+	uint32_t value = 0;
+
+	for (int i = 0; i < nrOfBits; i++) {
+
+		value = (value << 1) | bitStringGetBit(bs, *bitPos);
+		(*bitPos)++;
+	}
+	return value;
+}
@@ -0,0 +1,231 @@
+/*
+* canonical: Builds canonical huffman codes without building a huffTree.
+*
+* Nonzero weights are sorted once, code lengths are computed in place in a
+* single array with the method of Moffat and Katajainen, lengths are limited
+* to a maximum and codes are assigned canonically from the lengths. Only the
+* lengths are needed to rebuild the same codes, which makes them cheap to
+* store and to rebuild per block.
+*/
+
+#ifndef CANONICAL
+#define CANONICAL
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "huffTree.h"
+#include "bitString.h"
+
+
+typedef struct canonicalDecoder {
+
+	int size;
+	int maxLen;
+	uint32_t firstCode[HUFFMAXCODELEN + 1];
+	int firstIndex[HUFFMAXCODELEN + 1];
+	int count[HUFFMAXCODELEN + 1];
+	int *symbols;
+} canonicalDecoder;
+
+
+//A key with nonzero weight, sorted by weight and then key.
+typedef struct canonicalEntry {
+
+	uint64_t weight;
+	int key;
+} canonicalEntry;
+
+
+/*
+* description: Computes code lengths for all keys from their weights. Keys
+* with weight 0 get length 0 and no code. If only one key has weight, it gets
+* length 1.
+* param[in]: freqTable - Weight of each key.
+* param[in]: size - Number of keys.
+* param[in]: maxLen - Longest allowed code length. At most HUFFMAXCODELEN.
+* param[out]: lengths - Array of size keys to store code lengths in.
+* return: Number of keys with a code.
+*/
+int canonicalCodeLengths (const uint64_t *freqTable, int size, int maxLen,
+						  uint8_t *lengths);
+
+
+/*
+* description: Computes code lengths like canonicalCodeLengths, in work
+* arrays of the caller, so no memory is allocated.
+* param[in]: freqTable - Weight of each key.
+* param[in]: size - Number of keys.
+* param[in]: maxLen - Longest allowed code length. At most HUFFMAXCODELEN.
+* param[out]: lengths - Array of size keys to store code lengths in.
+* param[in]: entries - Work array of atleast size entries.
+* param[in]: work - Work array of atleast size integers.
+* return: Number of keys with a code.
+*/
+int canonicalCodeLengthsInto (const uint64_t *freqTable, int size,
+							  int maxLen, uint8_t *lengths,
+							  canonicalEntry *entries, uint64_t *work);
+
+
+/*
+* description: Assigns canonical codes from code lengths. Shorter codes come
+* first and codes of same length are ordered by key.
+* param[in]: lengths - Code length of each key, 0 for keys without code.
+* param[in]: size - Number of keys.
+* param[out]: codeTable - Array of size huffCodes to store the codes in.
+*/
+void canonicalAssignCodes (const uint8_t *lengths, int size,
+						   huffCode *codeTable);
+
+
+/*
+* description: Builds decoder for canonical codes from code lengths. Allocates
+* memory for canonicalDecoder.
+* param[in]: lengths - Code length of each key, 0 for keys without code.
+* param[in]: size - Number of keys.
+* return: The canonicalDecoder.
+*/
+canonicalDecoder *canonicalDecoderBuild (const uint8_t *lengths, int size);
+
+
+/*
+* description: Builds decoder for canonical codes from code lengths into
+* memory of the caller, so no memory is allocated.
+* param[out]: dec - The canonicalDecoder.
+* param[in]: lengths - Code length of each key, 0 for keys without code.
+* param[in]: size - Number of keys.
+* param[in]: symbols - Array of atleast size integers, used by dec.
+*/
+void canonicalDecoderInit (canonicalDecoder *dec, const uint8_t *lengths,
+						   int size, int *symbols);
+
+
+/*
+* description: Deallocates all memory allocated by canonicalDecoder.
+* param[in]: dec - The canonicalDecoder.
+*/
+void canonicalDecoderKill (canonicalDecoder *dec);
+
+
+/*
+* description: Decodes one key from bitString.
+* param[in]: dec - The canonicalDecoder.
+* param[in]: bs - The bitString to read bits from.
+* param[in]: bitPos - Position of next bit to read. Moved past the code.
+* return: The decoded key, -1 if bits do not form a valid code.
+*/
+int canonicalDecodeKey (canonicalDecoder *dec, bitString *bs,
+						int64_t *bitPos);
+
+
+/*
+* description: Writes code lengths compactly to bitString. Number of keys with
+* a code is written first, then for each such key the gap from previous key
+* and it's length. Gaps and count are Elias gamma coded.
+* param[in]: bs - The bitString to write to.
+* param[in]: lengths - Code length of each key, 0 for keys without code.
+* param[in]: size - Number of keys.
+*/
+void canonicalWriteLengths (bitString *bs, const uint8_t *lengths, int size);
+
+
+/*
+* description: Reads code lengths written by canonicalWriteLengths.
+* param[in]: bs - The bitString to read from.
+* param[in]: bitPos - Position of next bit to read. Moved past the lengths.
+* param[out]: lengths - Array of size keys to store code lengths in.
+* param[in]: size - Number of keys.
+* return: 1 if lengths are valid, else 0.
+*/
+int canonicalReadLengths (bitString *bs, int64_t *bitPos, uint8_t *lengths,
+						  int size);
+
+
+/*
+* description: Computes number of bits canonicalWriteLengths would write.
+* param[in]: lengths - Code length of each key, 0 for keys without code.
+* param[in]: size - Number of keys.
+* return: Number of bits.
+*/
+int64_t canonicalLengthsCost (const uint8_t *lengths, int size);
+
+
+/*
+* description: Writes a positive integer Elias gamma coded to bitString.
+* param[in]: bs - The bitString.
+* param[in]: value - The integer, atleast 1.
+*/
+void canonicalWriteGamma (bitString *bs, uint32_t value);
+
+
+/*
+* description: Reads an Elias gamma coded integer from bitString.
+* param[in]: bs - The bitString.
+* param[in]: bitPos - Position of next bit to read. Moved past the integer.
+* return: The integer, 0 if bits are not a valid gamma code.
+*/
+uint32_t canonicalReadGamma (bitString *bs, int64_t *bitPos);
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN CANONICAL.C
+
+
+/* support function for canonicalCodeLengthsInto!
+* description: Sorts entries by weight and then key, with heapsort. Unlike
+* qsort, which may allocate a buffer, it makes no allocation.
+* param[in]: entries - The entries.
+* param[in]: n - Number of entries.
+*/
+void canonicalSortEntries (canonicalEntry *entries, int n);
+
+
+/* support function for canonicalSortEntries!
+* description: Moves entry down the heap until it is not less than its
+* children.
+* param[in]: entries - The heap.
+* param[in]: parent - Index of entry.
+* param[in]: n - Number of entries in heap.
+*/
+void canonicalSiftDown (canonicalEntry *entries, int parent, int n);
+
+
+/* support function for canonicalCodeLengths!
+* description: Computes code lengths in place on weights sorted in ascending
+* order. Each weight is replaced by the code length of it's key.
+* param[in]: weights - Sorted weights, becomes code lengths.
+* param[in]: n - Number of weights, atleast 2.
+*/
+void canonicalMinimumRedundancy (uint64_t *weights, int n);
+
+
+/* support function for canonicalCodeLengths!
+* description: Limits code lengths to maxLen while keeping a complete code.
+* Works on number of codes per length, lengths are then handed out again with
+* shortest lengths to highest weights.
+* param[in]: lengths - Code lengths of sorted weights, in descending order.
+* param[in]: n - Number of lengths.
+* param[in]: maxLen - Longest allowed code length.
+*/
+void canonicalLimitLengths (uint64_t *lengths, int n, int maxLen);
+
+
+/* support function for canonicalWriteLengths!
+* description: Computes number of bits needed to write an integer.
+* param[in]: value - The integer.
+* return: Number of bits, 1 for value 0.
+*/
+int canonicalBitWidth (uint32_t value);
+
+
+/* support function for canonicalReadLengths!
+* description: Reads integer of nrOfBits bits from bitString, MSB first.
+* param[in]: bs - The bitString.
+* param[in]: bitPos - Position of next bit to read. Moved past the integer.
+* param[in]: nrOfBits - Number of bits to read, at most 32.
+* return: The integer.
+*/
+uint32_t canonicalReadBits (bitString *bs, int64_t *bitPos, int nrOfBits);
+
+
+#endif //CANONICAL
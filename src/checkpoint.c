@@ -0,0 +1,362 @@
+/*
+* checkpoint: Static mode coding with checkpoints. See checkpoint.h.
+*/
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "checkpoint.h"
+#include "encode.h"
+#include "format.h"
+#include "stream.h"
+
+
+/*
+* description: Encodes file1 with codes of tree and a checkpoint every
+* intervalKiB KiB of chars.
+* param[in]: file1 - Name of file to be read, "-" for stdin.
+* param[in]: file2 - Name of file to be written, "-" for stdout.
+* param[in]: tree - Tree that contains huffman table.
+* param[in]: intervalKiB - KiB of chars between checkpoints.
+* return: 1 if file2 was written, else 0.
+*/
+int checkpointEncodeFile (char const *file1, char const *file2,
+						  huffTree *tree, int64_t intervalKiB) {
+
+	int64_t length = 0;
+	unsigned char *text = readPlainFile(file1, &length);
+
+	if (text == NULL) {
+
+		fprintf(stderr, "Could not read %s\n", file1);
+		return 0;
+	}
+
+	uint64_t interval = (uint64_t)intervalKiB * 1024;
+	uint64_t nrOfCheckpoints = length == 0 ? 0 : (length - 1) / interval + 1;
+	unsigned char *checkpoints = malloc(nrOfCheckpoints * 8 + 1);
+	bitString *bs = bitStringEmpty();
+
+	//Bits not yet made into bytes are still in the bit buffer.
+	for (uint64_t i = 0; i < nrOfCheckpoints; i++) {
+
+		uint64_t begin = i * interval;
+		uint64_t end = begin + interval < (uint64_t)length ?
+					   begin + interval : (uint64_t)length;
+		formatPutU64(&checkpoints[i * 8], bs -> length * 8 + bs -> nrOfBits);
+		encodeBuffer(bs, &text[begin], end - begin, tree -> codeTable);
+	}
+
+	unsigned char *encode = bitStringGetEncode(bs);
+	int64_t size = bitStringGetSize(bs);
+	unsigned char trailer[CHECKPOINTTRAILERSIZE];
+	formatPutU64(trailer, interval);
+	formatPutU64(&trailer[8], nrOfCheckpoints);
+	formatPutU64(&trailer[16], size);
+
+	stream *out = streamOpenWrite(file2);
+	int valid = out != NULL;
+	if (valid) {
+
+		valid = formatWriteHeader(out, FORMATMODECHECKPOINT, length) &&
+				streamWrite(out, encode, size) &&
+				streamWrite(out, checkpoints, nrOfCheckpoints * 8) &&
+				streamWrite(out, trailer, CHECKPOINTTRAILERSIZE);
+		valid = streamClose(out) && valid;
+	}
+	if (!valid) {
+
+		fprintf(stderr, "Could not write %s\n", file2);
+	}
+
+	bitStringKill(bs);
+	free(checkpoints);
+	free(text);
+	return valid;
+}
+
+
+/*
+* description: Decodes chars start to start + length of an encoded file.
+* Range is cut at end of file. Allocates memory for the chars.
+* param[in]: file1 - Name of file encoded in static or checkpoint mode.
+* param[in]: tree - Tree that contains huffman table.
+* param[in]: start - Index of first char.
+* param[in]: length - Number of chars.
+* param[out]: got - Number of chars decoded.
+* return: The chars, NULL if file1 can not be read or is corrupt.
+*/
+unsigned char *checkpointDecodeRange (char const *file1, huffTree *tree,
+									  uint64_t start, uint64_t length,
+									  int64_t *got) {
+
+	checkpointIndex index;
+
+	*got = 0;
+	if (!checkpointOpen(file1, &index)) {
+
+		return NULL;
+	}
+
+	start = start < index.originalLength ? start : index.originalLength;
+	length = length < index.originalLength - start ? length :
+			 index.originalLength - start;
+
+	//Codes are read from checkpoint at or before start, up to checkpoint
+	//after end of range, or end of codes.
+	uint64_t first = index.interval > 0 ? start / index.interval : 0;
+	uint64_t last = index.interval > 0 ?
+					(start + length + index.interval - 1) / index.interval :
+					index.nrOfCheckpoints;
+	uint64_t beginBit = 0;
+	uint64_t endBit = 0;
+	if (length == 0) {
+
+		close(index.fd);
+		return malloc(1);
+	}
+	if (last > index.nrOfCheckpoints) {
+
+		last = index.nrOfCheckpoints;
+	}
+	if (!checkpointGet(&index, first, &beginBit) ||
+		!checkpointGet(&index, last, &endBit) || endBit < beginBit) {
+
+		close(index.fd);
+		return NULL;
+	}
+
+	int64_t offset = beginBit / 8;
+	int64_t size = (endBit + 7) / 8 - offset;
+	unsigned char *codes = malloc(size + 1);
+	int64_t read = streamPreadFd(index.fd, codes, size,
+								 FORMATHEADERSIZE + offset);
+	close(index.fd);
+	if (read != size) {
+
+		free(codes);
+		return NULL;
+	}
+
+	bitString *bs = bitStringEmpty();
+	bitStringAddBytes(bs, codes, size);
+	free(codes);
+
+	unsigned char *text = malloc(length + 1);
+	int64_t bitPos = beginBit % 8;
+	int64_t nrOfBits = endBit - offset * 8;
+	uint64_t skip = start - first * index.interval;
+	int valid = 1;
+
+	for (uint64_t i = 0; i < skip + length && valid; i++) {
+
+		int key = huffTreeDecodeKey(tree, bs, &bitPos, nrOfBits);
+		if (i >= skip) {
+
+			text[i - skip] = (unsigned char)key;
+		}
+		valid = key >= 0;
+	}
+
+	bitStringKill(bs);
+	if (!valid) {
+
+		free(text);
+		return NULL;
+	}
+	*got = length;
+	return text;
+}
+
+
+/*
+* description: Decodes chars start to start + length of file1 to file2.
+* param[in]: file1 - Name of file encoded in static or checkpoint mode.
+* param[in]: file2 - Name of file to be written, "-" for stdout.
+* param[in]: tree - Tree that contains huffman table.
+* param[in]: start - Index of first char.
+* param[in]: length - Number of chars.
+* return: 1 if range was decoded and written, else 0.
+*/
+int checkpointDecodeFile (char const *file1, char const *file2,
+						  huffTree *tree, uint64_t start, uint64_t length) {
+
+	int64_t got = 0;
+	unsigned char *text = checkpointDecodeRange(file1, tree, start, length,
+												&got);
+
+	if (text == NULL) {
+
+		fprintf(stderr, "%s is not a static or checkpoint mode file, or is "
+				"corrupt", file1);
+		return 0;
+	}
+
+	int valid = writePlainFile(file2, text, got);
+	free(text);
+	return valid;
+}
+
+
+/*
+* description: Parses a range written as start:length.
+* param[in]: text - The range.
+* param[out]: start - Index of first char.
+* param[out]: length - Number of chars.
+* return: 1 if text is a valid range, else 0.
+*/
+int checkpointParseRange (char const *text, uint64_t *start,
+						  uint64_t *length) {
+
+	char *end = NULL;
+
+	if (text[0] < '0' || text[0] > '9') {
+
+		return 0;
+	}
+	*start = strtoull(text, &end, 10);
+	if (end[0] != ':' || end[1] < '0' || end[1] > '9') {
+
+		return 0;
+	}
+	*length = strtoull(&end[1], &end, 10);
+	return end[0] == '\0';
+}
+
+
+/*
+* description: Finds where the codes of a checkpoint mode payload end, by
+* its trailer.
+* param[in]: bs - The bitString with payload after file header.
+* param[in]: originalLength - Length in file header.
+* return: Number of bytes of codes, -1 if trailer does not fit payload.
+*/
+int64_t checkpointCodeBytes (bitString *bs, uint64_t originalLength) {
+
+	checkpointIndex index;
+	int64_t size = bitStringGetSize(bs);
+
+	index.originalLength = originalLength;
+	if (size < CHECKPOINTTRAILERSIZE ||
+		!checkpointReadTrailer(&index, &bitStringGetEncode(bs)[size -
+							   CHECKPOINTTRAILERSIZE],
+							   size - CHECKPOINTTRAILERSIZE)) {
+
+		return -1;
+	}
+	return (int64_t)index.codeBytes;
+}
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN CHECKPOINT.C
+
+
+/* support function for checkpointDecodeRange!
+* description: Opens encoded file and reads its header and trailer.
+* param[in]: file1 - Name of encoded file.
+* param[out]: index - The checkpointIndex, fd is open if 1 is returned.
+* return: 1 if file1 is a valid static or checkpoint mode file, else 0.
+*/
+int checkpointOpen (char const *file1, checkpointIndex *index) {
+
+	unsigned char header[FORMATHEADERSIZE];
+	unsigned char trailer[CHECKPOINTTRAILERSIZE];
+	struct stat info;
+
+	index -> fd = open(file1, O_RDONLY);
+	if (index -> fd < 0) {
+
+		return 0;
+	}
+	if (fstat(index -> fd, &info) != 0 || info.st_size < FORMATHEADERSIZE ||
+		streamPreadFd(index -> fd, header, FORMATHEADERSIZE, 0) !=
+		FORMATHEADERSIZE || memcmp(header, FORMATMAGIC, 4) != 0 ||
+		header[4] != FORMATVERSION) {
+
+		close(index -> fd);
+		return 0;
+	}
+
+	uint64_t payload = info.st_size - FORMATHEADERSIZE;
+	index -> mode = header[5];
+	index -> originalLength = formatGetU64(&header[8]);
+
+	//Static mode is decoded from bit 0, as if it had one checkpoint.
+	if (index -> mode == FORMATMODESTATIC) {
+
+		index -> interval = 0;
+		index -> nrOfCheckpoints = 1;
+		index -> codeBytes = payload;
+		return 1;
+	}
+
+	if (index -> mode != FORMATMODECHECKPOINT ||
+		payload < CHECKPOINTTRAILERSIZE ||
+		streamPreadFd(index -> fd, trailer, CHECKPOINTTRAILERSIZE,
+					  info.st_size - CHECKPOINTTRAILERSIZE) !=
+		CHECKPOINTTRAILERSIZE ||
+		!checkpointReadTrailer(index, trailer,
+							   payload - CHECKPOINTTRAILERSIZE)) {
+
+		close(index -> fd);
+		return 0;
+	}
+	return 1;
+}
+
+
+/* support function for checkpointDecodeRange!
+* description: Reads bit position of checkpoint.
+* param[in]: index - The checkpointIndex.
+* param[in]: i - Number of checkpoint, number of checkpoints for end of
+* codes.
+* param[out]: bitPos - Bit position in codes.
+* return: 1 if position was read and is inside codes, else 0.
+*/
+int checkpointGet (checkpointIndex *index, uint64_t i, uint64_t *bitPos) {
+
+	unsigned char buf[8];
+
+	if (i >= index -> nrOfCheckpoints) {
+
+		*bitPos = index -> codeBytes * 8;
+		return 1;
+	}
+	if (index -> mode == FORMATMODESTATIC) {
+
+		*bitPos = 0;
+		return 1;
+	}
+	if (streamPreadFd(index -> fd, buf, 8, FORMATHEADERSIZE +
+					  index -> codeBytes + i * 8) != 8) {
+
+		return 0;
+	}
+	*bitPos = formatGetU64(buf);
+	return *bitPos <= index -> codeBytes * 8;
+}
+
+
+/* support function for checkpointOpen and checkpointCodeBytes!
+* description: Reads trailer into index and checks it against the payload.
+* Sizes are checked by division, so corrupt values can not overflow.
+* param[in]: index - The checkpointIndex, with originalLength set.
+* param[in]: trailer - CHECKPOINTTRAILERSIZE bytes.
+* param[in]: payload - Number of bytes of payload before the trailer.
+* return: 1 if trailer fits payload, else 0.
+*/
+int checkpointReadTrailer (checkpointIndex *index,
+						   const unsigned char *trailer, uint64_t payload) {
+
+	index -> interval = formatGetU64(trailer);
+	index -> nrOfCheckpoints = formatGetU64(&trailer[8]);
+	index -> codeBytes = formatGetU64(&trailer[16]);
+
+	return index -> interval > 0 && index -> nrOfCheckpoints <= payload / 8 &&
+		   index -> codeBytes == payload - index -> nrOfCheckpoints * 8 &&
+		   index -> nrOfCheckpoints ==
+		   (index -> originalLength + index -> interval - 1) /
+		   index -> interval;
+}
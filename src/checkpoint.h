@@ -0,0 +1,143 @@
+/*
+* checkpoint: Static mode coding with checkpoints, so a range of the
+* original file can be decoded without decoding everything before it.
+*
+* Codes are the same as in static mode, with the tree built from file0.
+* Every interval chars, the bit position of the next code is stored as a
+* checkpoint. A range is decoded by reading the trailer and the checkpoint
+* at or before its start, and then only the code bytes up to the checkpoint
+* after its end. So a small range costs about the same wherever it is in the
+* file. Static mode files have no checkpoints and are decoded from bit 0.
+*
+* Payload, after the file header, integers little endian:
+*   codes, padded to a whole byte
+*   index, 8 bytes per checkpoint: bit position of char i * interval
+*   trailer of CHECKPOINTTRAILERSIZE bytes:
+*     8 bytes  interval in chars
+*     8 bytes  number of checkpoints
+*     8 bytes  number of code bytes
+*/
+
+#ifndef CHECKPOINT
+#define CHECKPOINT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "huffTree.h"
+#include "bitString.h"
+
+#define CHECKPOINTTRAILERSIZE 24
+#define CHECKPOINTMAXKIB (1 << 20)
+
+
+typedef struct checkpointIndex {
+
+	int fd;
+	int mode;
+	uint64_t originalLength;
+	uint64_t interval;
+	uint64_t nrOfCheckpoints;
+	uint64_t codeBytes;
+} checkpointIndex;
+
+
+/*
+* description: Encodes file1 with codes of tree and a checkpoint every
+* intervalKiB KiB of chars.
+* param[in]: file1 - Name of file to be read, "-" for stdin.
+* param[in]: file2 - Name of file to be written, "-" for stdout.
+* param[in]: tree - Tree that contains huffman table.
+* param[in]: intervalKiB - KiB of chars between checkpoints.
+* return: 1 if file2 was written, else 0.
+*/
+int checkpointEncodeFile (char const *file1, char const *file2,
+						  huffTree *tree, int64_t intervalKiB);
+
+
+/*
+* description: Decodes chars start to start + length of an encoded file.
+* Range is cut at end of file. Allocates memory for the chars.
+* param[in]: file1 - Name of file encoded in static or checkpoint mode.
+* param[in]: tree - Tree that contains huffman table.
+* param[in]: start - Index of first char.
+* param[in]: length - Number of chars.
+* param[out]: got - Number of chars decoded.
+* return: The chars, NULL if file1 can not be read or is corrupt.
+*/
+unsigned char *checkpointDecodeRange (char const *file1, huffTree *tree,
+									  uint64_t start, uint64_t length,
+									  int64_t *got);
+
+
+/*
+* description: Decodes chars start to start + length of file1 to file2.
+* param[in]: file1 - Name of file encoded in static or checkpoint mode.
+* param[in]: file2 - Name of file to be written, "-" for stdout.
+* param[in]: tree - Tree that contains huffman table.
+* param[in]: start - Index of first char.
+* param[in]: length - Number of chars.
+* return: 1 if range was decoded and written, else 0.
+*/
+int checkpointDecodeFile (char const *file1, char const *file2,
+						  huffTree *tree, uint64_t start, uint64_t length);
+
+
+/*
+* description: Parses a range written as start:length.
+* param[in]: text - The range.
+* param[out]: start - Index of first char.
+* param[out]: length - Number of chars.
+* return: 1 if text is a valid range, else 0.
+*/
+int checkpointParseRange (char const *text, uint64_t *start,
+						  uint64_t *length);
+
+
+/*
+* description: Finds where the codes of a checkpoint mode payload end, by
+* its trailer.
+* param[in]: bs - The bitString with payload after file header.
+* param[in]: originalLength - Length in file header.
+* return: Number of bytes of codes, -1 if trailer does not fit payload.
+*/
+int64_t checkpointCodeBytes (bitString *bs, uint64_t originalLength);
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN CHECKPOINT.C
+
+
+/* support function for checkpointDecodeRange!
+* description: Opens encoded file and reads its header and trailer.
+* param[in]: file1 - Name of encoded file.
+* param[out]: index - The checkpointIndex, fd is open if 1 is returned.
+* return: 1 if file1 is a valid static or checkpoint mode file, else 0.
+*/
+int checkpointOpen (char const *file1, checkpointIndex *index);
+
+
+/* support function for checkpointDecodeRange!
+* description: Reads bit position of checkpoint.
+* param[in]: index - The checkpointIndex.
+* param[in]: i - Number of checkpoint, number of checkpoints for end of
+* codes.
+* param[out]: bitPos - Bit position in codes.
+* return: 1 if position was read and is inside codes, else 0.
+*/
+int checkpointGet (checkpointIndex *index, uint64_t i, uint64_t *bitPos);
+
+
+/* support function for checkpointOpen and checkpointCodeBytes!
+* description: Reads trailer into index and checks it against the payload.
+* Sizes are checked by division, so corrupt values can not overflow.
+* param[in]: index - The checkpointIndex, with originalLength set.
+* param[in]: trailer - CHECKPOINTTRAILERSIZE bytes.
+* param[in]: payload - Number of bytes of payload before the trailer.
+* return: 1 if trailer fits payload, else 0.
+*/
+int checkpointReadTrailer (checkpointIndex *index,
+						   const unsigned char *trailer, uint64_t payload);
+
+
+#endif //CHECKPOINT
@@ -0,0 +1,276 @@
+/*
+* client: Requests to a coding server. See client.h.
+*/
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "client.h"
+#include "encode.h"
+#include "format.h"
+#include "stream.h"
+
+
+/*
+* description: Connects to server.
+* param[in]: path - Name of the socket of the server.
+* return: The socket, -1 if server could not be reached.
+*/
+int clientConnect (char const *path) {
+
+	struct sockaddr_un addr;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+
+		return -1;
+	}
+	strcpy(addr.sun_path, path);
+
+	int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sock < 0) {
+
+		return -1;
+	}
+	if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+
+		close(sock);
+		return -1;
+	}
+	return sock;
+}
+
+
+/*
+* description: Creates empty reply. Allocates memory for clientReply.
+* return: The clientReply.
+*/
+clientReply *clientReplyEmpty (void) {
+
+	return calloc(1, sizeof(clientReply));
+}
+
+
+/*
+* description: Unmaps or deallocates data of reply, and deallocates all
+* memory of clientReply.
+* param[in]: reply - The clientReply.
+*/
+void clientReplyKill (clientReply *reply) {
+
+	clientRelease(reply);
+	free(reply -> buffer);
+	free(reply);
+}
+
+
+/*
+* description: Sends request and waits for its reply. Data of the last reply
+* of reply is dropped.
+* param[in]: sock - Socket of clientConnect.
+* param[in]: op - SERVEROPENCODE, SERVEROPDECODE or SERVEROPSTATS.
+* param[in]: payload - Payload, not used if payloadFd is given.
+* param[in]: length - Length of payload.
+* param[in]: payloadFd - Descriptor of a file whose first length bytes are
+* the payload, -1 to send payload on the socket.
+* param[out]: reply - The clientReply.
+* return: 1 if a reply was read, else 0, and the connection can not be used
+* again.
+*/
+int clientRequest (int sock, int op, const unsigned char *payload,
+				   int64_t length, int payloadFd, clientReply *reply) {
+
+	unsigned char header[SERVERHEADERSIZE];
+	int passFd = -1;
+
+	clientRelease(reply);
+	serverHeaderBytes(header, op, payloadFd >= 0 ? SERVERFD : 0, length);
+	if (!serverSendHeader(sock, header, payloadFd) ||
+		(payloadFd < 0 && !serverSendAll(sock, payload, length)) ||
+		!serverRecvHeader(sock, header, &passFd)) {
+
+		return 0;
+	}
+
+	uint64_t size = formatGetU64(&header[8]);
+	int valid = size <= INT64_MAX;
+	reply -> status = header[0];
+	reply -> length = valid ? (int64_t)size : 0;
+
+	//Reply in a memfd is mapped, else read into the buffer.
+	if ((header[1] & SERVERFD) && size > 0) {
+
+		void *bytes = MAP_FAILED;
+		if (valid && passFd >= 0) {
+
+			bytes = mmap(NULL, size, PROT_READ, MAP_PRIVATE, passFd, 0);
+		}
+		valid = bytes != MAP_FAILED;
+		reply -> data = valid ? bytes : NULL;
+		reply -> mapped = valid;
+	} else if (valid && !(header[1] & SERVERFD)) {
+
+		if (reply -> buffer == NULL || reply -> capacity < reply -> length) {
+
+			free(reply -> buffer);
+			reply -> capacity = reply -> length;
+			reply -> buffer = malloc(reply -> capacity + 1);
+		}
+		valid = streamReadFd(sock, reply -> buffer, reply -> length) ==
+				reply -> length;
+		reply -> data = reply -> buffer;
+	}
+	if (passFd >= 0) {
+
+		close(passFd);
+	}
+	if (!valid) {
+
+		reply -> length = 0;
+	}
+	return valid;
+}
+
+
+/*
+* description: Codes file1 with server and writes the reply to file2.
+* param[in]: path - Name of the socket of the server.
+* param[in]: op - SERVEROPENCODE, SERVEROPDECODE or SERVEROPSTATS.
+* param[in]: file1 - Name of file to be read, "-" for stdin. Not used with
+* SERVEROPSTATS.
+* param[in]: file2 - Name of file to be written, "-" for stdout.
+* param[in]: passFd - 1 to pass file1 as a descriptor, a memfd if it is not
+* a regular file. Payloads above SERVERINLINEMAX are always passed so.
+* return: 1 if file2 was written, else 0.
+*/
+int clientFile (char const *path, int op, char const *file1,
+				char const *file2, int passFd) {
+
+	unsigned char *text = NULL;
+	int64_t length = 0;
+	int fd = -1;
+
+	if (op != SERVEROPSTATS) {
+
+		fd = clientOpen(file1, passFd, &text, &length);
+		if (fd < 0 && text == NULL) {
+
+			fprintf(stderr, "Could not read %s\n", file1);
+			return 0;
+		}
+	}
+
+	int sock = clientConnect(path);
+	if (sock < 0) {
+
+		fprintf(stderr, "Could not connect to %s", path);
+		free(text);
+		if (fd >= 0) {
+
+			close(fd);
+		}
+		return 0;
+	}
+
+	clientReply *reply = clientReplyEmpty();
+	int valid = clientRequest(sock, op, text, length, fd, reply);
+	if (!valid) {
+
+		fprintf(stderr, "Could not get a reply from %s", path);
+	} else if (reply -> status == SERVERCORRUPT) {
+
+		fprintf(stderr, "%s is not a file coded with the table set of the "
+				"server, or is corrupt", file1);
+		valid = 0;
+	} else if (reply -> status != SERVEROK) {
+
+		fprintf(stderr, "Server at %s refused the request", path);
+		valid = 0;
+	} else {
+
+		valid = writePlainFile(file2, reply -> data, reply -> length);
+	}
+
+	clientReplyKill(reply);
+	close(sock);
+	free(text);
+	if (fd >= 0) {
+
+		close(fd);
+	}
+	return valid;
+}
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN CLIENT.C
+
+
+/* support function for clientRequest and clientReplyKill!
+* description: Unmaps data of reply if it is mapped.
+* param[in]: reply - The clientReply.
+*/
+void clientRelease (clientReply *reply) {
+
+	if (reply -> mapped) {
+
+		munmap((void *)reply -> data, reply -> length);
+	}
+	reply -> mapped = 0;
+	reply -> data = NULL;
+	reply -> length = 0;
+}
+
+
+/* support function for clientFile!
+* description: Opens file1 as a descriptor to pass to the server.
+* param[in]: file1 - Name of file to be read, "-" for stdin.
+* param[in]: passFd - 1 to pass file1 as a descriptor.
+* param[out]: text - Chars of file1 if they are sent on the socket, else
+* NULL.
+* param[out]: length - Number of chars of file1.
+* return: The descriptor, -1 if chars are sent on the socket or file1 could
+* not be read.
+*/
+int clientOpen (char const *file1, int passFd, unsigned char **text,
+				int64_t *length) {
+
+	struct stat info;
+
+	*text = NULL;
+	*length = 0;
+
+	//A regular file is passed as it is, so its chars are not copied.
+	if (passFd && strcmp(file1, "-") != 0) {
+
+		int fd = open(file1, O_RDONLY);
+		if (fd >= 0 && fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+
+			*length = info.st_size;
+			return fd;
+		}
+		if (fd >= 0) {
+
+			close(fd);
+		}
+	}
+
+	*text = readPlainFile(file1, length);
+	if (*text == NULL || (!passFd && *length <= SERVERINLINEMAX)) {
+
+		return -1;
+	}
+
+	int fd = serverMemfd(NULL, 0, *text, *length);
+	if (fd >= 0 || *length > SERVERINLINEMAX) {
+
+		free(*text);
+		*text = NULL;
+	}
+	return fd;
+}
@@ -0,0 +1,111 @@
+/*
+* client: Requests to a coding server, see server.h, used by huffmanc and
+* the benchmark.
+*
+* A connection serves any number of requests, one at a time. A reply passed
+* in a memfd is mapped and not copied, and is kept until the next request
+* with the same clientReply.
+*/
+
+#ifndef CLIENT
+#define CLIENT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "server.h"
+
+
+typedef struct clientReply {
+
+	int status;
+	const unsigned char *data;
+	int64_t length;
+	//data is mapped from a memfd, else it is in buffer.
+	int mapped;
+	unsigned char *buffer;
+	int64_t capacity;
+} clientReply;
+
+
+/*
+* description: Connects to server.
+* param[in]: path - Name of the socket of the server.
+* return: The socket, -1 if server could not be reached.
+*/
+int clientConnect (char const *path);
+
+
+/*
+* description: Creates empty reply. Allocates memory for clientReply.
+* return: The clientReply.
+*/
+clientReply *clientReplyEmpty (void);
+
+
+/*
+* description: Unmaps or deallocates data of reply, and deallocates all
+* memory of clientReply.
+* param[in]: reply - The clientReply.
+*/
+void clientReplyKill (clientReply *reply);
+
+
+/*
+* description: Sends request and waits for its reply. Data of the last reply
+* of reply is dropped.
+* param[in]: sock - Socket of clientConnect.
+* param[in]: op - SERVEROPENCODE, SERVEROPDECODE or SERVEROPSTATS.
+* param[in]: payload - Payload, not used if payloadFd is given.
+* param[in]: length - Length of payload.
+* param[in]: payloadFd - Descriptor of a file whose first length bytes are
+* the payload, -1 to send payload on the socket.
+* param[out]: reply - The clientReply.
+* return: 1 if a reply was read, else 0, and the connection can not be used
+* again.
+*/
+int clientRequest (int sock, int op, const unsigned char *payload,
+				   int64_t length, int payloadFd, clientReply *reply);
+
+
+/*
+* description: Codes file1 with server and writes the reply to file2.
+* param[in]: path - Name of the socket of the server.
+* param[in]: op - SERVEROPENCODE, SERVEROPDECODE or SERVEROPSTATS.
+* param[in]: file1 - Name of file to be read, "-" for stdin. Not used with
+* SERVEROPSTATS.
+* param[in]: file2 - Name of file to be written, "-" for stdout.
+* param[in]: passFd - 1 to pass file1 as a descriptor, a memfd if it is not
+* a regular file. Payloads above SERVERINLINEMAX are always passed so.
+* return: 1 if file2 was written, else 0.
+*/
+int clientFile (char const *path, int op, char const *file1,
+				char const *file2, int passFd);
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN CLIENT.C
+
+
+/* support function for clientRequest and clientReplyKill!
+* description: Unmaps data of reply if it is mapped.
+* param[in]: reply - The clientReply.
+*/
+void clientRelease (clientReply *reply);
+
+
+/* support function for clientFile!
+* description: Opens file1 as a descriptor to pass to the server.
+* param[in]: file1 - Name of file to be read, "-" for stdin.
+* param[in]: passFd - 1 to pass file1 as a descriptor.
+* param[out]: text - Chars of file1 if they are sent on the socket, else
+* NULL.
+* param[out]: length - Number of chars of file1.
+* return: The descriptor, -1 if chars are sent on the socket or file1 could
+* not be read.
+*/
+int clientOpen (char const *file1, int passFd, unsigned char **text,
+				int64_t *length);
+
+
+#endif //CLIENT
@@ -0,0 +1,593 @@
+/*
+* context: Reusable contexts for small messages. See context.h.
+*/
+
+#include <string.h>
+
+#include "context.h"
+#include "tableCache.h"
+#include "encode.h"
+
+
+/*
+* description: Builds shared table from counts, so every char has a code.
+* Allocates memory for contextTable, held once by the caller.
+* param[in]: freqTable - CONTEXTSYMBOLS char counts.
+* param[in]: id - Id of the table, below 1 << CONTEXTIDBITS.
+* return: The contextTable.
+*/
+contextTable *contextTableBuild (const uint64_t *freqTable, uint32_t id) {
+
+	uint64_t weights[CONTEXTSYMBOLS];
+	uint8_t lengths[CONTEXTSYMBOLS];
+
+	for (int i = 0; i < CONTEXTSYMBOLS; i++) {
+
+		weights[i] = freqTable[i] + 1;
+	}
+	canonicalCodeLengths(weights, CONTEXTSYMBOLS, HUFFMAXCODELEN, lengths);
+	return contextTableFromLengths(lengths, id);
+}
+
+
+/*
+* description: Builds shared table from code lengths. Allocates memory for
+* contextTable, held once by the caller.
+* param[in]: lengths - CONTEXTSYMBOLS code lengths, 0 for chars without code.
+* param[in]: id - Id of the table, below 1 << CONTEXTIDBITS.
+* return: The contextTable, NULL if lengths are not a valid prefix code or id
+* is too big.
+*/
+contextTable *contextTableFromLengths (const uint8_t *lengths, uint32_t id) {
+
+	uint64_t kraft = 0;
+
+	if (id >= (1U << CONTEXTIDBITS)) {
+
+		return NULL;
+	}
+	for (int i = 0; i < CONTEXTSYMBOLS; i++) {
+
+		if (lengths[i] > HUFFMAXCODELEN) {
+
+			return NULL;
+		}
+		if (lengths[i] > 0) {
+
+			kraft = kraft + (1ULL << (HUFFMAXCODELEN - lengths[i]));
+		}
+	}
+	if (kraft == 0 || kraft > (1ULL << HUFFMAXCODELEN)) {
+
+		return NULL;
+	}
+
+	contextTable *table = NULL;
+	if (posix_memalign((void **)&table, CONTEXTALIGN,
+					   sizeof(contextTable)) != 0) {
+
+		return NULL;
+	}
+	table -> refs = 1;
+	table -> id = id;
+	table -> hash = contextHash(lengths);
+	memcpy(table -> lengths, lengths, CONTEXTSYMBOLS);
+	canonicalAssignCodes(lengths, CONTEXTSYMBOLS, table -> codes);
+	canonicalDecoderInit(&table -> dec, lengths, CONTEXTSYMBOLS,
+						 table -> symbols);
+	contextFillLookup(lengths, table -> codes, table -> lookup);
+	return table;
+}
+
+
+/*
+* description: Holds contextTable once more. Safe from any thread that holds
+* it already.
+* param[in]: table - The contextTable.
+* return: The contextTable.
+*/
+contextTable *contextTableHold (contextTable *table) {
+
+	__atomic_add_fetch(&table -> refs, 1, __ATOMIC_RELAXED);
+	return table;
+}
+
+
+/*
+* description: Drops one hold of contextTable, and deallocates all its memory
+* if it was the last.
+* param[in]: table - The contextTable.
+*/
+void contextTableKill (contextTable *table) {
+
+	//Release and acquire order every use of the table before it is freed.
+	if (__atomic_sub_fetch(&table -> refs, 1, __ATOMIC_ACQ_REL) == 0) {
+
+		free(table);
+	}
+}
+
+
+/*
+* description: Counts bits of chars coded with shared table, without the
+* message kind and table id.
+* param[in]: table - The contextTable.
+* param[in]: counts - CONTEXTSYMBOLS char counts.
+* return: Number of bits, UINT64_MAX if a counted char has no code.
+*/
+uint64_t contextTableCost (const contextTable *table, const uint64_t *counts) {
+
+	for (int i = 0; i < CONTEXTSYMBOLS; i++) {
+
+		if (counts[i] > 0 && table -> lengths[i] == 0) {
+
+			return UINT64_MAX;
+		}
+	}
+	return contextCost(counts, table -> lengths);
+}
+
+
+/*
+* description: Creates encoder without shared table. Allocates memory for
+* contextEncoder.
+* return: The contextEncoder.
+*/
+contextEncoder *contextEncoderEmpty (void) {
+
+	contextEncoder *enc = malloc(sizeof(contextEncoder));
+
+	enc -> nrOfTables = 0;
+	enc -> bs = bitStringEmpty();
+	return enc;
+}
+
+
+/*
+* description: Deallocates all memory of contextEncoder, and drops its holds
+* of its tables.
+* param[in]: enc - The contextEncoder.
+*/
+void contextEncoderKill (contextEncoder *enc) {
+
+	for (int i = 0; i < enc -> nrOfTables; i++) {
+
+		contextTableKill(enc -> tables[i]);
+	}
+	bitStringKill(enc -> bs);
+	free(enc);
+}
+
+
+/*
+* description: Sets shared tables of encoder. Tables are not copied, the
+* encoder holds them until they are replaced or it is killed.
+* param[in]: enc - The contextEncoder.
+* param[in]: tables - The tables.
+* param[in]: count - Number of tables, 0 to reset encoder to having no
+* shared table.
+* return: 1 if tables were set, 0 if count is above CONTEXTMAXTABLES.
+*/
+int contextEncoderSetTables (contextEncoder *enc, contextTable *const *tables,
+							 int count) {
+
+	if (count < 0 || count > CONTEXTMAXTABLES) {
+
+		return 0;
+	}
+	contextSwapTables(enc -> tables, &enc -> nrOfTables, tables, count);
+	return 1;
+}
+
+
+/*
+* description: Encodes message. Makes no allocation once encoder has coded a
+* message atleast as big.
+* param[in]: enc - The contextEncoder.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[out]: out - Encoded message, owned by encoder and valid until its
+* next call.
+* return: Number of bytes in encoded message.
+*/
+int64_t contextEncode (contextEncoder *enc, const unsigned char *text,
+					   int64_t length, const unsigned char **out) {
+
+	int table = -1;
+	uint64_t bits = 0;
+	int kind = contextEncodeHead(enc, text, length, &table, &bits);
+
+	if (kind == CONTEXTSHARED) {
+
+		encodeBuffer(enc -> bs, text, length, enc -> tables[table] -> codes);
+	} else if (kind == CONTEXTOWN) {
+
+		encodeBuffer(enc -> bs, text, length, enc -> ownCodes);
+	} else {
+
+		for (int64_t i = 0; i < length; i++) {
+
+			bitStringAddCode(enc -> bs, text[i], 8);
+		}
+	}
+
+	*out = bitStringGetEncode(enc -> bs);
+	return bitStringGetSize(enc -> bs);
+}
+
+
+/*
+* description: Picks kind of message as contextEncode does, and writes the
+* kind and table id or own table to the bitString of encoder, emptied first.
+* The codes of the chars are left to the caller. Own codes are in ownCodes of
+* encoder.
+* param[in]: enc - The contextEncoder.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[out]: table - Index of the shared table picked, -1 if none.
+* param[out]: bits - Number of bits of the whole message, without padding.
+* return: CONTEXTSHARED, CONTEXTOWN or CONTEXTSTORED.
+*/
+int contextEncodeHead (contextEncoder *enc, const unsigned char *text,
+					   int64_t length, int *table, uint64_t *bits) {
+
+	memset(enc -> counts, 0, sizeof(enc -> counts));
+	for (int64_t i = 0; i < length; i++) {
+
+		enc -> counts[text[i]]++;
+	}
+
+	//Costs are counted exactly, so the smallest kind is always picked.
+	canonicalCodeLengthsInto(enc -> counts, CONTEXTSYMBOLS, HUFFMAXCODELEN,
+							 enc -> ownLengths, enc -> entries, enc -> work);
+	uint64_t stored = (uint64_t)length * 8;
+	uint64_t own = contextCost(enc -> counts, enc -> ownLengths) +
+				   canonicalLengthsCost(enc -> ownLengths, CONTEXTSYMBOLS);
+	uint64_t shared = UINT64_MAX;
+	*table = -1;
+	for (int i = 0; i < enc -> nrOfTables; i++) {
+
+		uint64_t cost = contextTableCost(enc -> tables[i], enc -> counts);
+		if (cost < UINT64_MAX - CONTEXTIDBITS &&
+			cost + CONTEXTIDBITS < shared) {
+
+			shared = cost + CONTEXTIDBITS;
+			*table = i;
+		}
+	}
+
+	bitStringClear(enc -> bs);
+	if (*table >= 0 && shared <= own && shared <= stored) {
+
+		bitStringAddCode(enc -> bs, CONTEXTSHARED, CONTEXTKINDBITS);
+		bitStringAddCode(enc -> bs, enc -> tables[*table] -> id,
+						 CONTEXTIDBITS);
+		*bits = CONTEXTKINDBITS + shared;
+		return CONTEXTSHARED;
+	}
+	*table = -1;
+	if (own < stored) {
+
+		canonicalAssignCodes(enc -> ownLengths, CONTEXTSYMBOLS,
+							 enc -> ownCodes);
+		bitStringAddCode(enc -> bs, CONTEXTOWN, CONTEXTKINDBITS);
+		canonicalWriteLengths(enc -> bs, enc -> ownLengths, CONTEXTSYMBOLS);
+		*bits = CONTEXTKINDBITS + own;
+		return CONTEXTOWN;
+	}
+	bitStringAddCode(enc -> bs, CONTEXTSTORED, CONTEXTKINDBITS);
+	*bits = CONTEXTKINDBITS + stored;
+	return CONTEXTSTORED;
+}
+
+
+/*
+* description: Creates decoder without shared table. Allocates memory for
+* contextDecoder.
+* return: The contextDecoder.
+*/
+contextDecoder *contextDecoderEmpty (void) {
+
+	contextDecoder *dec = malloc(sizeof(contextDecoder));
+
+	dec -> nrOfTables = 0;
+	dec -> cache = NULL;
+	dec -> bs = bitStringEmpty();
+	return dec;
+}
+
+
+/*
+* description: Deallocates all memory of contextDecoder, and drops its holds
+* of its tables.
+* param[in]: dec - The contextDecoder.
+*/
+void contextDecoderKill (contextDecoder *dec) {
+
+	for (int i = 0; i < dec -> nrOfTables; i++) {
+
+		contextTableKill(dec -> tables[i]);
+	}
+	bitStringKill(dec -> bs);
+	free(dec);
+}
+
+
+/*
+* description: Sets shared tables of decoder, found by their id when a
+* message is decoded. Tables are not copied, the decoder holds them until
+* they are replaced or it is killed.
+* param[in]: dec - The contextDecoder.
+* param[in]: tables - The tables.
+* param[in]: count - Number of tables, 0 to reset decoder to having no
+* shared table.
+* return: 1 if tables were set, 0 if count is above CONTEXTMAXTABLES.
+*/
+int contextDecoderSetTables (contextDecoder *dec, contextTable *const *tables,
+							 int count) {
+
+	if (count < 0 || count > CONTEXTMAXTABLES) {
+
+		return 0;
+	}
+	contextSwapTables(dec -> tables, &dec -> nrOfTables, tables, count);
+	return 1;
+}
+
+
+/*
+* description: Sets cache of decoder, searched for ids not among its tables.
+* The cache is not held and must outlive its use by the decoder.
+* param[in]: dec - The contextDecoder.
+* param[in]: cache - The tableCache, NULL for none.
+*/
+void contextDecoderSetCache (contextDecoder *dec, struct tableCache *cache) {
+
+	dec -> cache = cache;
+}
+
+
+/*
+* description: Decodes message. Makes no allocation once decoder has read a
+* message atleast as big.
+* param[in]: dec - The contextDecoder.
+* param[in]: in - Encoded message.
+* param[in]: size - Number of bytes in encoded message.
+* param[out]: text - Array to store atleast length chars in.
+* param[in]: length - Number of chars in message.
+* return: 1 if message could be decoded, else 0.
+*/
+int contextDecode (contextDecoder *dec, const unsigned char *in, int64_t size,
+				   unsigned char *text, int64_t length) {
+
+	int64_t bitPos = CONTEXTKINDBITS;
+	canonicalDecoder *codes = NULL;
+	const uint16_t *lookup = NULL;
+
+	//Every code is atleast one bit, so length is bounded by size.
+	if (size < 1 || length > size * 8) {
+
+		return 0;
+	}
+	bitStringClear(dec -> bs);
+	bitStringAddBytes(dec -> bs, in, size);
+
+	int kind = (int)bitStringGetBits(dec -> bs, 0, CONTEXTKINDBITS);
+	if (kind == CONTEXTSTORED) {
+
+		for (int64_t i = 0; i < length; i++) {
+
+			text[i] = (unsigned char)bitStringGetBits(dec -> bs, bitPos, 8);
+			bitPos = bitPos + 8;
+		}
+		return bitPos <= size * 8;
+	}
+
+	if (kind == CONTEXTOWN) {
+
+		if (!canonicalReadLengths(dec -> bs, &bitPos, dec -> lengths,
+								  CONTEXTSYMBOLS)) {
+
+			return 0;
+		}
+		canonicalDecoderInit(&dec -> own, dec -> lengths, CONTEXTSYMBOLS,
+							 dec -> ownSymbols);
+		codes = &dec -> own;
+		if (length >= CONTEXTLOOKUPMIN) {
+
+			canonicalAssignCodes(dec -> lengths, CONTEXTSYMBOLS, dec -> codes);
+			contextFillLookup(dec -> lengths, dec -> codes, dec -> ownLookup);
+			lookup = dec -> ownLookup;
+		}
+	} else if (kind == CONTEXTSHARED) {
+
+		uint32_t id = (uint32_t)bitStringGetBits(dec -> bs, bitPos,
+												 CONTEXTIDBITS);
+		bitPos = bitPos + CONTEXTIDBITS;
+		contextTable *table = NULL;
+		for (int i = 0; i < dec -> nrOfTables && table == NULL; i++) {
+
+			if (dec -> tables[i] -> id == id) {
+
+				table = dec -> tables[i];
+			}
+		}
+		if (table == NULL && dec -> cache != NULL) {
+
+			table = tableCacheGet(dec -> cache, id);
+		}
+		if (table != NULL) {
+
+			codes = &table -> dec;
+			lookup = table -> lookup;
+		}
+	}
+	if (codes == NULL) {
+
+		return 0;
+	}
+
+	//Codes read past the message as zero bits, caught by the final check.
+	return contextDecodeKeys(dec -> bs, codes, lookup, &bitPos, text,
+							 length) && bitPos <= size * 8;
+}
+
+
+/*
+* description: Gets id of shared table a message is coded with.
+* param[in]: in - Encoded message.
+* param[in]: size - Number of bytes in encoded message.
+* return: The id, -1 if message is not coded with a shared table.
+*/
+int64_t contextMessageTable (const unsigned char *in, int64_t size) {
+
+	uint32_t bits = 0;
+
+	if (size * 8 < CONTEXTKINDBITS + CONTEXTIDBITS ||
+		in[0] >> (8 - CONTEXTKINDBITS) != CONTEXTSHARED) {
+
+		return -1;
+	}
+	//Kind and id are in the first 3 bytes, MSB first.
+	for (int i = 0; i < 3; i++) {
+
+		bits = bits << 8 | (i < size ? in[i] : 0);
+	}
+	return (bits >> (24 - CONTEXTKINDBITS - CONTEXTIDBITS)) &
+		   ((1U << CONTEXTIDBITS) - 1);
+}
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN CONTEXT.C
+
+
+/* support function for contextEncoderSetTables and contextDecoderSetTables!
+* description: Holds new tables and drops holds of old ones. New tables are
+* held first, as they may be among the old ones.
+* param[in,out]: held - Array of tables held.
+* param[in,out]: nrHeld - Number of tables held.
+* param[in]: tables - New tables.
+* param[in]: count - Number of new tables.
+*/
+void contextSwapTables (contextTable **held, int *nrHeld,
+						contextTable *const *tables, int count) {
+
+	for (int i = 0; i < count; i++) {
+
+		contextTableHold(tables[i]);
+	}
+	for (int i = 0; i < *nrHeld; i++) {
+
+		contextTableKill(held[i]);
+	}
+	for (int i = 0; i < count; i++) {
+
+		held[i] = tables[i];
+	}
+	*nrHeld = count;
+}
+
+
+/* support function for contextTableFromLengths!
+* description: Hashes code lengths with 64 bit FNV-1a.
+* param[in]: lengths - CONTEXTSYMBOLS code lengths.
+* return: The hash.
+*/
+uint64_t contextHash (const uint8_t *lengths) {
+
+	uint64_t hash = 14695981039346656037ULL;
+
+	for (int i = 0; i < CONTEXTSYMBOLS; i++) {
+
+		hash = (hash ^ lengths[i]) * 1099511628211ULL;
+	}
+	return hash;
+}
+
+
+/* support function for contextTableFromLengths and contextDecode!
+* description: Fills lookup table of codes of atmost CONTEXTLOOKUPBITS bits.
+* Entry of each bit pattern starting with a code is code length << 8 | char,
+* other entries are 0.
+* param[in]: lengths - CONTEXTSYMBOLS code lengths.
+* param[in]: codes - CONTEXTSYMBOLS codes assigned from lengths.
+* param[out]: lookup - Table of 1 << CONTEXTLOOKUPBITS entries.
+*/
+void contextFillLookup (const uint8_t *lengths, const huffCode *codes,
+						uint16_t *lookup) {
+
+	memset(lookup, 0, sizeof(uint16_t) << CONTEXTLOOKUPBITS);
+
+	for (int c = 0; c < CONTEXTSYMBOLS; c++) {
+
+		int len = lengths[c];
+		if (len == 0 || len > CONTEXTLOOKUPBITS) {
+
+			continue;
+		}
+		uint32_t first = codes[c].code << (CONTEXTLOOKUPBITS - len);
+		uint32_t count = 1U << (CONTEXTLOOKUPBITS - len);
+		for (uint32_t j = 0; j < count; j++) {
+
+			lookup[first + j] = (uint16_t)(len << 8 | c);
+		}
+	}
+}
+
+
+/* support function for contextDecode!
+* description: Decodes chars with lookup table, and bit by bit for longer
+* codes.
+* param[in]: bs - The bitString holding the message.
+* param[in]: codes - Decoder of the table.
+* param[in]: lookup - Lookup table of the table, NULL to decode bit by bit.
+* param[in,out]: bitPos - Position of next bit, moved past the codes.
+* param[out]: text - Array to store atleast length chars in.
+* param[in]: length - Number of chars.
+* return: 1 if all codes were valid, else 0.
+*/
+int contextDecodeKeys (bitString *bs, canonicalDecoder *codes,
+					   const uint16_t *lookup, int64_t *bitPos,
+					   unsigned char *text, int64_t length) {
+
+	for (int64_t i = 0; i < length; i++) {
+
+		uint16_t entry = 0;
+		if (lookup != NULL) {
+
+			entry = lookup[bitStringGetBits(bs, *bitPos, CONTEXTLOOKUPBITS)];
+		}
+		if (entry != 0) {
+
+			text[i] = (unsigned char)(entry & 0xFF);
+			*bitPos = *bitPos + (entry >> 8);
+			continue;
+		}
+
+		int key = canonicalDecodeKey(codes, bs, bitPos);
+		if (key < 0) {
+
+			return 0;
+		}
+		text[i] = (unsigned char)key;
+	}
+	return 1;
+}
+
+
+/* support function for contextEncode and contextTableCost!
+* description: Counts bits of chars coded with code lengths.
+* param[in]: counts - CONTEXTSYMBOLS char counts.
+* param[in]: lengths - CONTEXTSYMBOLS code lengths.
+* return: Number of bits.
+*/
+uint64_t contextCost (const uint64_t *counts, const uint8_t *lengths) {
+
+	uint64_t bits = 0;
+
+	for (int i = 0; i < CONTEXTSYMBOLS; i++) {
+
+		bits = bits + counts[i] * lengths[i];
+	}
+	return bits;
+}
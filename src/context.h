@@ -0,0 +1,325 @@
+/*
+* context: Encoder and decoder contexts for many small messages. A context
+* owns every table and buffer it codes with, so once it has coded a message
+* as big as the next one it makes no heap allocations. Codes are canonical,
+* so no huffTree, pqueue or code strings are built per message.
+*
+* A context can be given up to CONTEXTMAXTABLES shared tables, built from
+* counts of typical messages or trained, see dict.h. A contextTable is not
+* changed once built, so one table can be used by many contexts and threads
+* without locks. It is counted, and freed when the last holder drops it. It
+* starts on a cache line, and its count has a line of its own, so threads
+* taking and dropping it do not slow threads decoding with it. A decoder can
+* also find tables by id in a tableCache, see tableCache.h. Each message is coded with the shared table coding it best, with its own
+* table written in front, or stored, whichever is smallest. Message length is
+* not stored, the caller keeps it, as it keeps its records apart.
+*
+* Message, bits MSB first:
+*   2 bits   CONTEXTSHARED, CONTEXTOWN or CONTEXTSTORED
+*   CONTEXTIDBITS bits id of the shared table, if CONTEXTSHARED
+*   own table, code lengths written by canonicalWriteLengths, if CONTEXTOWN
+*   codes of the chars, or the chars themselves if CONTEXTSTORED
+*   padding to a whole byte
+*/
+
+#ifndef CONTEXT
+#define CONTEXT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "bitString.h"
+#include "canonical.h"
+
+#define CONTEXTSYMBOLS 256
+#define CONTEXTKINDBITS 2
+#define CONTEXTSHARED 0
+#define CONTEXTOWN 1
+#define CONTEXTSTORED 2
+#define CONTEXTIDBITS 8
+#define CONTEXTMAXTABLES 16
+//Codes of atmost CONTEXTLOOKUPBITS bits are decoded by one table lookup.
+//Own tables of messages shorter than CONTEXTLOOKUPMIN chars are decoded bit
+//by bit, as filling the table would cost more than it saves.
+#define CONTEXTLOOKUPBITS 11
+#define CONTEXTLOOKUPMIN 512
+#define CONTEXTALIGN 64
+
+
+typedef struct contextTable {
+
+	uint32_t refs;
+	unsigned char pad[CONTEXTALIGN - sizeof(uint32_t)];
+	uint32_t id;
+	//FNV-1a hash of lengths, the key of a table by content.
+	uint64_t hash;
+	uint8_t lengths[CONTEXTSYMBOLS];
+	huffCode codes[CONTEXTSYMBOLS];
+	canonicalDecoder dec;
+	int symbols[CONTEXTSYMBOLS];
+	uint16_t lookup[1 << CONTEXTLOOKUPBITS];
+} contextTable;
+
+
+typedef struct contextEncoder {
+
+	contextTable *tables[CONTEXTMAXTABLES];
+	int nrOfTables;
+	uint64_t counts[CONTEXTSYMBOLS];
+	uint8_t ownLengths[CONTEXTSYMBOLS];
+	huffCode ownCodes[CONTEXTSYMBOLS];
+	canonicalEntry entries[CONTEXTSYMBOLS];
+	uint64_t work[CONTEXTSYMBOLS];
+	bitString *bs;
+} contextEncoder;
+
+
+//Decoders can search a tableCache, which holds contextTables itself.
+struct tableCache;
+
+
+typedef struct contextDecoder {
+
+	contextTable *tables[CONTEXTMAXTABLES];
+	int nrOfTables;
+	canonicalDecoder own;
+	int ownSymbols[CONTEXTSYMBOLS];
+	uint16_t ownLookup[1 << CONTEXTLOOKUPBITS];
+	uint8_t lengths[CONTEXTSYMBOLS];
+	huffCode codes[CONTEXTSYMBOLS];
+	struct tableCache *cache;
+	bitString *bs;
+} contextDecoder;
+
+
+/*
+* description: Builds shared table from counts, so every char has a code.
+* Allocates memory for contextTable, held once by the caller.
+* param[in]: freqTable - CONTEXTSYMBOLS char counts.
+* param[in]: id - Id of the table, below 1 << CONTEXTIDBITS.
+* return: The contextTable.
+*/
+contextTable *contextTableBuild (const uint64_t *freqTable, uint32_t id);
+
+
+/*
+* description: Builds shared table from code lengths. Allocates memory for
+* contextTable, held once by the caller.
+* param[in]: lengths - CONTEXTSYMBOLS code lengths, 0 for chars without code.
+* param[in]: id - Id of the table, below 1 << CONTEXTIDBITS.
+* return: The contextTable, NULL if lengths are not a valid prefix code or id
+* is too big.
+*/
+contextTable *contextTableFromLengths (const uint8_t *lengths, uint32_t id);
+
+
+/*
+* description: Holds contextTable once more. Safe from any thread that holds
+* it already.
+* param[in]: table - The contextTable.
+* return: The contextTable.
+*/
+contextTable *contextTableHold (contextTable *table);
+
+
+/*
+* description: Drops one hold of contextTable, and deallocates all its memory
+* if it was the last.
+* param[in]: table - The contextTable.
+*/
+void contextTableKill (contextTable *table);
+
+
+/*
+* description: Counts bits of chars coded with shared table, without the
+* message kind and table id.
+* param[in]: table - The contextTable.
+* param[in]: counts - CONTEXTSYMBOLS char counts.
+* return: Number of bits, UINT64_MAX if a counted char has no code.
+*/
+uint64_t contextTableCost (const contextTable *table, const uint64_t *counts);
+
+
+/*
+* description: Creates encoder without shared table. Allocates memory for
+* contextEncoder.
+* return: The contextEncoder.
+*/
+contextEncoder *contextEncoderEmpty (void);
+
+
+/*
+* description: Deallocates all memory of contextEncoder, and drops its holds
+* of its tables.
+* param[in]: enc - The contextEncoder.
+*/
+void contextEncoderKill (contextEncoder *enc);
+
+
+/*
+* description: Sets shared tables of encoder. Tables are not copied, the
+* encoder holds them until they are replaced or it is killed.
+* param[in]: enc - The contextEncoder.
+* param[in]: tables - The tables.
+* param[in]: count - Number of tables, 0 to reset encoder to having no
+* shared table.
+* return: 1 if tables were set, 0 if count is above CONTEXTMAXTABLES.
+*/
+int contextEncoderSetTables (contextEncoder *enc, contextTable *const *tables,
+							 int count);
+
+
+/*
+* description: Encodes message. Makes no allocation once encoder has coded a
+* message atleast as big.
+* param[in]: enc - The contextEncoder.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[out]: out - Encoded message, owned by encoder and valid until its
+* next call.
+* return: Number of bytes in encoded message.
+*/
+int64_t contextEncode (contextEncoder *enc, const unsigned char *text,
+					   int64_t length, const unsigned char **out);
+
+
+/*
+* description: Picks kind of message as contextEncode does, and writes the
+* kind and table id or own table to the bitString of encoder, emptied first.
+* The codes of the chars are left to the caller. Own codes are in ownCodes of
+* encoder.
+* param[in]: enc - The contextEncoder.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[out]: table - Index of the shared table picked, -1 if none.
+* param[out]: bits - Number of bits of the whole message, without padding.
+* return: CONTEXTSHARED, CONTEXTOWN or CONTEXTSTORED.
+*/
+int contextEncodeHead (contextEncoder *enc, const unsigned char *text,
+					   int64_t length, int *table, uint64_t *bits);
+
+
+/*
+* description: Creates decoder without shared table. Allocates memory for
+* contextDecoder.
+* return: The contextDecoder.
+*/
+contextDecoder *contextDecoderEmpty (void);
+
+
+/*
+* description: Deallocates all memory of contextDecoder, and drops its holds
+* of its tables.
+* param[in]: dec - The contextDecoder.
+*/
+void contextDecoderKill (contextDecoder *dec);
+
+
+/*
+* description: Sets shared tables of decoder, found by their id when a
+* message is decoded. Tables are not copied, the decoder holds them until
+* they are replaced or it is killed.
+* param[in]: dec - The contextDecoder.
+* param[in]: tables - The tables.
+* param[in]: count - Number of tables, 0 to reset decoder to having no
+* shared table.
+* return: 1 if tables were set, 0 if count is above CONTEXTMAXTABLES.
+*/
+int contextDecoderSetTables (contextDecoder *dec, contextTable *const *tables,
+							 int count);
+
+
+/*
+* description: Sets cache of decoder, searched for ids not among its tables.
+* The cache is not held and must outlive its use by the decoder.
+* param[in]: dec - The contextDecoder.
+* param[in]: cache - The tableCache, NULL for none.
+*/
+void contextDecoderSetCache (contextDecoder *dec, struct tableCache *cache);
+
+
+/*
+* description: Decodes message. Makes no allocation once decoder has read a
+* message atleast as big.
+* param[in]: dec - The contextDecoder.
+* param[in]: in - Encoded message.
+* param[in]: size - Number of bytes in encoded message.
+* param[out]: text - Array to store atleast length chars in.
+* param[in]: length - Number of chars in message.
+* return: 1 if message could be decoded, else 0.
+*/
+int contextDecode (contextDecoder *dec, const unsigned char *in, int64_t size,
+				   unsigned char *text, int64_t length);
+
+
+/*
+* description: Gets id of shared table a message is coded with.
+* param[in]: in - Encoded message.
+* param[in]: size - Number of bytes in encoded message.
+* return: The id, -1 if message is not coded with a shared table.
+*/
+int64_t contextMessageTable (const unsigned char *in, int64_t size);
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN CONTEXT.C
+
+
+/* support function for contextEncoderSetTables and contextDecoderSetTables!
+* description: Holds new tables and drops holds of old ones. New tables are
+* held first, as they may be among the old ones.
+* param[in,out]: held - Array of tables held.
+* param[in,out]: nrHeld - Number of tables held.
+* param[in]: tables - New tables.
+* param[in]: count - Number of new tables.
+*/
+void contextSwapTables (contextTable **held, int *nrHeld,
+						contextTable *const *tables, int count);
+
+
+/* support function for contextTableFromLengths!
+* description: Hashes code lengths with 64 bit FNV-1a.
+* param[in]: lengths - CONTEXTSYMBOLS code lengths.
+* return: The hash.
+*/
+uint64_t contextHash (const uint8_t *lengths);
+
+
+/* support function for contextTableFromLengths and contextDecode!
+* description: Fills lookup table of codes of atmost CONTEXTLOOKUPBITS bits.
+* Entry of each bit pattern starting with a code is code length << 8 | char,
+* other entries are 0.
+* param[in]: lengths - CONTEXTSYMBOLS code lengths.
+* param[in]: codes - CONTEXTSYMBOLS codes assigned from lengths.
+* param[out]: lookup - Table of 1 << CONTEXTLOOKUPBITS entries.
+*/
+void contextFillLookup (const uint8_t *lengths, const huffCode *codes,
+						uint16_t *lookup);
+
+
+/* support function for contextDecode!
+* description: Decodes chars with lookup table, and bit by bit for longer
+* codes.
+* param[in]: bs - The bitString holding the message.
+* param[in]: codes - Decoder of the table.
+* param[in]: lookup - Lookup table of the table, NULL to decode bit by bit.
+* param[in,out]: bitPos - Position of next bit, moved past the codes.
+* param[out]: text - Array to store atleast length chars in.
+* param[in]: length - Number of chars.
+* return: 1 if all codes were valid, else 0.
+*/
+int contextDecodeKeys (bitString *bs, canonicalDecoder *codes,
+					   const uint16_t *lookup, int64_t *bitPos,
+					   unsigned char *text, int64_t length);
+
+
+/* support function for contextEncode and contextTableCost!
+* description: Counts bits of chars coded with code lengths.
+* param[in]: counts - CONTEXTSYMBOLS char counts.
+* param[in]: lengths - CONTEXTSYMBOLS code lengths.
+* return: Number of bits.
+*/
+uint64_t contextCost (const uint64_t *counts, const uint8_t *lengths);
+
+
+#endif //CONTEXT
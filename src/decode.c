@@ -9,64 +9,139 @@
 
 
 #include "decode.h"
+#include "encode.h"
 
 
 /*
 * description: Control flow for program. Does function calls and Deallocates
 * memory.
-* param[in]: file1 - Name of encoded file to be read and decoded.
-* param[in]: file2 - Name of file to be written as decode.
-* param[in]: tree - Huffman tree that can decode the encode.
+* param[in]: file1 - Name of encoded file to be read, "-" for stdin.
+* param[in]: file2 - Name of file to be written as decode, "-" for stdout.
+* param[in]: tree - Huffman tree that can decode the encode, NULL if there is
+* no table of file0.
+* param[in]: config - Pipeline options, used by framed files.
+* return: 1 if file1 could be decoded, else 0.
 */
-void decodeFile (char const *file1, char const *file2, huffTree *tree) {
+int decodeFile (char const *file1, char const *file2, huffTree *tree,
+				const pipelineConfig *config) {
 
-	int textLength = getFileLength(file1);
-	bitString *bs = readEncode(file1, textLength);
+	stream *in = streamOpen(file1, 0, &config -> io);
+	int mode = 0;
+	uint64_t originalLength = 0;
 
-	decodeBits(file2, tree, bs);
+	if (in == NULL || formatReadHeader(in, &mode, &originalLength) == 0 ||
+		((mode < FORMATMODESTATIC || mode > FORMATMODECHECKPOINT) &&
+		 mode != FORMATMODEPUSH)) {
 
-	bitStringKill(bs);
-}
+		fprintf(stderr, "%s is not a supported encoded file%s", file1,
+				mode == FORMATMODEDICT ? ", decode it with -dict" : "");
+		if (in != NULL) {
 
+			streamClose(in);
+		}
+		return 0;
+	}
 
-/*
-* description: Gets length of file (nr of chars);
-* param[in]: file - Name of file.
-* return: length of file.
-*/
-int getFileLength (char const *file) {
+	//Frames code with the table only when it was given, other modes using
+	//the table can not be decoded without it.
+	if (tree == NULL &&
+		(mode == FORMATMODESTATIC || mode == FORMATMODECHECKPOINT ||
+		 mode == FORMATMODEPUSH)) {
+
+		fprintf(stderr, "%s is coded with the table of file0, which could "
+				"not be opened", file1);
+		streamClose(in);
+		return 0;
+	}
+
+	//Frames, push blocks and adaptive blocks are decoded as they are read,
+	//other modes need whole payload.
+	if (mode == FORMATMODEFRAMED || mode == FORMATMODEPUSH ||
+		mode == FORMATMODEADAPTIVE) {
+
+		int valid = 0;
+		if (mode == FORMATMODEPUSH) {
+
+			valid = pushDecodeStream(in, file2, tree);
+		} else if (mode == FORMATMODEADAPTIVE) {
+
+			valid = adaptiveDecodeStream(in, file2);
+		} else {
+
+			valid = frameDecodeStream(in, file2, tree, config);
+		}
+		streamClose(in);
+		if (!valid) {
+
+			fprintf(stderr, "%s is corrupt", file1);
+		}
+		return valid;
+	}
+
+	bitString *bs = readEncode(in);
+	streamClose(in);
+
+	int valid = 1;
+	//Checkpoints follow the codes, and are not read by a full decode.
+	if (mode == FORMATMODESTATIC || mode == FORMATMODECHECKPOINT) {
+
+		int64_t codeBytes = mode == FORMATMODESTATIC ? bitStringGetSize(bs) :
+							checkpointCodeBytes(bs, originalLength);
+		valid = codeBytes >= 0 &&
+				decodeBits(file2, tree, bs, originalLength, codeBytes);
+	} else if (mode == FORMATMODEORDER1) {
+
+		valid = order1DecodeFile(file2, bs, originalLength);
+	} else if (mode == FORMATMODEUTF8) {
+
+		valid = symbolDecodeFile(SYMBOLUTF8, file2, bs, originalLength);
+	} else if (mode == FORMATMODEWORD16) {
 
-	FILE *fp = fopen(file, "rb");
-	int length = 0;
+		valid = symbolDecodeFile(SYMBOLWORD16, file2, bs, originalLength);
+	} else if (mode == FORMATMODEBLOCKSORT) {
 
-	while (fgetc(fp) >= 0) {
+		valid = blockSortDecodeFile(file2, bs, originalLength);
+	} else if (mode == FORMATMODELZ77) {
 
-		length++;
+		valid = lz77DecodeFile(file2, bs, originalLength);
+	} else if (mode == FORMATMODEANS) {
+
+		valid = ansDecodeFile(file2, bs, originalLength);
+	} else if (mode == FORMATMODEFILTER) {
+
+		valid = filterDecodeFile(file2, bs, originalLength);
+	} else {
+
+		valid = decodeStored(file2, bs, originalLength);
+	}
+
+	if (!valid) {
+
+		fprintf(stderr, "%s is corrupt", file1);
 	}
 
-	fclose(fp);
-	return length;
+	bitStringKill(bs);
+	return valid;
 }
 
 
 /*
-* description: Reads encoded file and puts all text into char array allocated
-* in heap.
-* param[in]: file1 - Name of encoded file.
-* param[in]: textLength - Length of encoded file.
-* return: Pointer to allocated char array.
+* description: Reads rest of encoded file and puts all text into bitString.
+* param[in]: in - Encoded stream, positioned after header.
+* return: bitString containing the encoded text.
 */
-bitString *readEncode (char const *file1, int textLength) {
+bitString *readEncode (stream *in) {
 
-	FILE *fp = fopen(file1, "rb");
 	bitString *bs = bitStringEmpty();
+	unsigned char *buffer = malloc(STREAMBUFFERSIZE);
+	int64_t got = 0;
 
-	for (int i = 0; i < textLength; i++) {
+	while ((got = streamRead(in, buffer, STREAMBUFFERSIZE)) > 0) {
 
-		int currentChar = fgetc(fp);
-		bitStringAddByte(bs, currentChar);
+		bitStringAddBytes(bs, buffer, got);
 	}
-	fclose(fp);
+
+	free(buffer);
 	return bs;
 }
 
@@ -77,19 +152,36 @@ bitString *readEncode (char const *file1, int textLength) {
 * param[in]: fil2 - Name of file to write decode.
 * param[in]: tree - The huffTree to read huffman table from.
 * param[in]: bs - The bitString.
+* param[in]: originalLength - Number of chars to decode.
+* param[in]: codeBytes - Number of bytes of codes at start of bitString.
+* return: 1 if all chars were decoded within the codes and written, else 0.
 */
-void decodeBits (char const *file2, huffTree *tree, bitString *bs) {
+int decodeBits (char const *file2, huffTree *tree, bitString *bs,
+				uint64_t originalLength, int64_t codeBytes) {
+
+	//Every code is atleast one bit, unless the tree is a single leaf.
+	int64_t end = codeBytes * 8;
+	if (!nodeIsLeaf(huffTreeGetRoot(tree)) &&
+		!formatLengthFits(originalLength, codeBytes, 8)) {
 
-	FILE *fp = fopen(file2, "w");
+		return 0;
+	}
+
+	stream *out = streamOpenWrite(file2);
+	if (out == NULL) {
 
-	int currentByte = 0; //Position of which encoded byte is read.
+		return 0;
+	}
+
+	int64_t currentByte = 0; //Position of which encoded byte is read.
 	int currentBit = 8; //Position in buffer of 8 bits. Set to 8 for reset in
 						// while loop.
 	unsigned char decodedByte = 0; // What key is found from huffTree.
+	char byte[8]; //Buffer of 8 bits
+	int valid = 1;
 
-	while (decodedByte != 4) {
+	for (uint64_t decoded = 0; valid && decoded < originalLength; decoded++) {
 
-		char byte[8]; //Buffer of 8 bits
 		treeNode *subRoot = huffTreeGetRoot(tree);
 
 		//If buffer has been worked through, load 8 new bits.
@@ -101,12 +193,31 @@ void decodeBits (char const *file2, huffTree *tree, bitString *bs) {
 		}
 
 		decodedByte = findKey(subRoot, bs, byte, &currentByte, &currentBit);
-		if (decodedByte != 4) {
 
-			fputc(decodedByte, fp);
-		}
+		//Bits past the last byte are read as 0, a code using them means the
+		//payload was cut.
+		valid = (currentByte - 1) * 8 + currentBit <= end &&
+				streamPutc(out, decodedByte);
 	}
-	fclose(fp);
+	return streamClose(out) && valid;
+}
+
+
+/*
+* description: Writes stored payload, the original chars, to file.
+* param[in]: file2 - Name of file to write decode.
+* param[in]: bs - The bitString with payload after file header.
+* param[in]: originalLength - Number of chars in payload.
+* return: 1 if payload holds originalLength chars, else 0.
+*/
+int decodeStored (char const *file2, bitString *bs, uint64_t originalLength) {
+
+	if ((uint64_t)bitStringGetSize(bs) != originalLength) {
+
+		return 0;
+	}
+
+	return writePlainFile(file2, bitStringGetEncode(bs), originalLength);
 }
 
 
@@ -121,7 +232,7 @@ void decodeBits (char const *file2, huffTree *tree, bitString *bs) {
 * return: Key of the leaf that is found.
 */
 unsigned char findKey (treeNode *subRoot, bitString *bs, char *byte,
-						int *currentByte, int *currentBit) {
+						int64_t *currentByte, int *currentBit) {
 
 	while (!nodeIsLeaf(subRoot)) {
 
@@ -141,5 +252,5 @@ unsigned char findKey (treeNode *subRoot, bitString *bs, char *byte,
 		}
 		(*currentBit)++;
 	}
-	return nodeGetKey(subRoot);
+	return (unsigned char)nodeGetKey(subRoot);
 }
@@ -14,34 +14,40 @@
 
 #include "huffTree.h"
 #include "bitString.h"
+#include "format.h"
+#include "order1.h"
+#include "symbol.h"
+#include "blocksort.h"
+#include "lz77.h"
+#include "ans.h"
+#include "filter.h"
+#include "adaptive.h"
+#include "frame.h"
+#include "push.h"
+#include "checkpoint.h"
+#include "stream.h"
 
 
 /*
 * description: Control flow for program. Does function calls and Deallocates
 * memory.
-* param[in]: file1 - Name of encoded file to be read and decoded.
-* param[in]: file2 - Name of file to be written as decode.
-* param[in]: tree - Huffman tree that can decode the encode.
+* param[in]: file1 - Name of encoded file to be read, "-" for stdin.
+* param[in]: file2 - Name of file to be written as decode, "-" for stdout.
+* param[in]: tree - Huffman tree that can decode the encode, NULL if there is
+* no table of file0.
+* param[in]: config - Pipeline options, used by framed files.
+* return: 1 if file1 could be decoded, else 0.
 */
-void decodeFile (char const *file1, char const *file2, huffTree *tree);
+int decodeFile (char const *file1, char const *file2, huffTree *tree,
+				const pipelineConfig *config);
 
 
 /*
-* description: Gets length of file (nr of chars);
-* param[in]: file - Name of file.
-* return: length of file.
+* description: Reads rest of encoded file and puts all text into bitString.
+* param[in]: in - Encoded stream, positioned after header.
+* return: bitString containing the encoded text.
 */
-int getFileLength (char const *file);
-
-
-/*
-* description: Reads encoded file and puts all text into char array allocated
-* in heap.
-* param[in]: file1 - Name of encoded file.
-* param[in]: textLength - Length of encoded file.
-* return: Pointer to allocated char array.
-*/
-bitString *readEncode (char const *file1, int textLength);
+bitString *readEncode (stream *in);
 
 
 /*
@@ -50,8 +56,22 @@ bitString *readEncode (char const *file1, int textLength);
 * param[in]: fil2 - Name of file to write decode.
 * param[in]: tree - The huffTree to read huffman table from.
 * param[in]: bs - The bitString.
+* param[in]: originalLength - Number of chars to decode.
+* param[in]: codeBytes - Number of bytes of codes at start of bitString.
+* return: 1 if all chars were decoded within the codes and written, else 0.
+*/
+int decodeBits (char const *file2, huffTree *tree, bitString *bs,
+				uint64_t originalLength, int64_t codeBytes);
+
+
+/*
+* description: Writes stored payload, the original chars, to file.
+* param[in]: file2 - Name of file to write decode.
+* param[in]: bs - The bitString with payload after file header.
+* param[in]: originalLength - Number of chars in payload.
+* return: 1 if payload holds originalLength chars, else 0.
 */
-void decodeBits (char const *file2, huffTree *tree, bitString *bs);
+int decodeStored (char const *file2, bitString *bs, uint64_t originalLength);
 
 
 /*
@@ -65,4 +85,4 @@ void decodeBits (char const *file2, huffTree *tree, bitString *bs);
 * return: Key of the leaf that is found.
 */
 unsigned char findKey (treeNode *subRoot, bitString *bs, char *byte,
-						int *currentByte, int *currentBit);
+						int64_t *currentByte, int *currentBit);
@@ -0,0 +1,582 @@
+/*
+* dict: Shared tables trained from sample records. See dict.h.
+*/
+
+#include <string.h>
+
+#include "dict.h"
+#include "batch.h"
+#include "encode.h"
+#include "format.h"
+#include "stream.h"
+
+
+/*
+* description: Trains shared tables from samples. Allocates memory for the
+* tables and the array of them.
+* param[in]: samples - The samples.
+* param[in]: lengths - Number of chars of each sample.
+* param[in]: nrOfSamples - Number of samples.
+* param[in]: nrOfTables - Most tables to train, 1 to CONTEXTMAXTABLES.
+* param[in]: firstId - Id of the first table, the others follow it.
+* param[out]: count - Number of tables trained. Fewer than nrOfTables if
+* samples do not fill them.
+* return: The tables, NULL if there are no samples or ids do not fit in
+* CONTEXTIDBITS bits.
+*/
+contextTable **dictTrain (unsigned char *const *samples,
+						  const int64_t *lengths, int64_t nrOfSamples,
+						  int nrOfTables, uint32_t firstId, int *count) {
+
+	*count = 0;
+	if (nrOfSamples < 1 || nrOfTables < 1 ||
+		nrOfTables > CONTEXTMAXTABLES ||
+		(uint64_t)firstId + nrOfTables > (1U << CONTEXTIDBITS)) {
+
+		return NULL;
+	}
+
+	//Counts are kept per distinct char, so a round costs the distinct chars
+	//of the samples rather than all their chars.
+	int64_t maxKeys = 0;
+	for (int64_t s = 0; s < nrOfSamples; s++) {
+
+		maxKeys = maxKeys + (lengths[s] < CONTEXTSYMBOLS ? lengths[s] :
+							 CONTEXTSYMBOLS);
+	}
+	dictSample *info = malloc(sizeof(dictSample) * nrOfSamples);
+	unsigned char *keys = malloc(maxKeys + 1);
+	uint64_t *counts = malloc(sizeof(uint64_t) * (maxKeys + 1));
+	uint64_t (*sums)[CONTEXTSYMBOLS] = calloc(CONTEXTMAXTABLES,
+											  sizeof(*sums));
+	int64_t nrOfKeys = 0;
+
+	for (int64_t s = 0; s < nrOfSamples; s++) {
+
+		uint64_t freqTable[CONTEXTSYMBOLS] = {0};
+		for (int64_t i = 0; i < lengths[s]; i++) {
+
+			freqTable[samples[s][i]]++;
+		}
+		info[s].first = nrOfKeys;
+		info[s].nrOfKeys = 0;
+		info[s].length = lengths[s];
+		for (int c = 0; c < CONTEXTSYMBOLS; c++) {
+
+			if (freqTable[c] > 0) {
+
+				keys[nrOfKeys] = (unsigned char)c;
+				counts[nrOfKeys] = freqTable[c];
+				nrOfKeys++;
+				info[s].nrOfKeys++;
+				sums[0][c] = sums[0][c] + freqTable[c];
+			}
+		}
+	}
+
+	int *cluster = calloc(nrOfSamples, sizeof(int));
+	uint64_t *bits = malloc(sizeof(uint64_t) * nrOfSamples);
+	contextTable **tables = malloc(sizeof(contextTable *) * nrOfTables);
+	int k = 1;
+	tables[0] = contextTableBuild(sums[0], firstId);
+	dictAssign(info, nrOfSamples, keys, counts, tables, k, cluster, bits);
+
+	//Each further table is seeded by the sample the tables so far code in
+	//the most bits per char.
+	while (k < nrOfTables) {
+
+		int64_t worst = -1;
+		double worstRate = 0;
+		for (int64_t s = 0; s < nrOfSamples; s++) {
+
+			double rate = info[s].length > 0 ?
+						  (double)bits[s] / info[s].length : 0;
+			if (rate > worstRate) {
+
+				worst = s;
+				worstRate = rate;
+			}
+		}
+		if (worst < 0) {
+
+			break;
+		}
+
+		uint64_t seed[CONTEXTSYMBOLS] = {0};
+		for (int j = 0; j < info[worst].nrOfKeys; j++) {
+
+			int64_t at = info[worst].first + j;
+			seed[keys[at]] = counts[at] * DICTSEEDSCALE;
+		}
+		tables[k] = contextTableBuild(seed, firstId + k);
+		k++;
+		dictAssign(info, nrOfSamples, keys, counts, tables, k, cluster, bits);
+	}
+
+	//Each table is rebuilt from its samples until no sample moves.
+	for (int round = 0; round < DICTROUNDS && k > 1; round++) {
+
+		memset(sums, 0, sizeof(*sums) * CONTEXTMAXTABLES);
+		for (int64_t s = 0; s < nrOfSamples; s++) {
+
+			for (int j = 0; j < info[s].nrOfKeys; j++) {
+
+				int64_t at = info[s].first + j;
+				sums[cluster[s]][keys[at]] = sums[cluster[s]][keys[at]] +
+											 counts[at];
+			}
+		}
+		for (int t = 0; t < k; t++) {
+
+			contextTableKill(tables[t]);
+			tables[t] = contextTableBuild(sums[t], firstId + t);
+		}
+		if (dictAssign(info, nrOfSamples, keys, counts, tables, k, cluster,
+					   NULL) == 0) {
+
+			break;
+		}
+	}
+
+	//Tables no sample is coded with are dropped, and the others built again
+	//with ids closed up, as a built table is not changed.
+	int used[CONTEXTMAXTABLES] = {0};
+	for (int64_t s = 0; s < nrOfSamples; s++) {
+
+		used[cluster[s]] = 1;
+	}
+	for (int t = 0; t < k; t++) {
+
+		contextTable *table = tables[t];
+		if (used[t]) {
+
+			tables[*count] = contextTableFromLengths(table -> lengths,
+													 firstId + *count);
+			*count = *count + 1;
+		}
+		contextTableKill(table);
+	}
+
+	free(bits);
+	free(cluster);
+	free(sums);
+	free(counts);
+	free(keys);
+	free(info);
+	return tables;
+}
+
+
+/*
+* description: Trains tables from every file of source and writes them to
+* file2.
+* param[in]: source - Directory, or file listing one sample file per line.
+* param[in]: file2 - Name of table set file to be written.
+* param[in]: nrOfTables - Most tables to train, 1 to CONTEXTMAXTABLES.
+* param[in]: firstId - Id of the first table.
+* param[in]: log - File to print the tables to.
+* return: 1 if file2 was written, else 0.
+*/
+int dictTrainFile (char const *source, char const *file2, int nrOfTables,
+				   uint32_t firstId, FILE *log) {
+
+	int64_t nrOfSamples = 0;
+	char **paths = batchNames(source, &nrOfSamples);
+
+	if (paths == NULL) {
+
+		fprintf(stderr, "Could not read %s\n", source);
+		return 0;
+	}
+
+	unsigned char **samples = malloc(sizeof(unsigned char *) *
+									 (nrOfSamples + 1));
+	int64_t *lengths = malloc(sizeof(int64_t) * (nrOfSamples + 1));
+	int valid = 1;
+	for (int64_t s = 0; s < nrOfSamples; s++) {
+
+		samples[s] = readPlainFile(paths[s], &lengths[s]);
+		if (samples[s] == NULL) {
+
+			fprintf(stderr, "Could not read %s\n", paths[s]);
+			lengths[s] = 0;
+			valid = 0;
+		}
+	}
+
+	int count = 0;
+	contextTable **tables = NULL;
+	if (valid) {
+
+		tables = dictTrain(samples, lengths, nrOfSamples, nrOfTables,
+						   firstId, &count);
+		if (tables == NULL) {
+
+			fprintf(stderr, "Could not train tables from %s, it has no "
+					"samples or ids are above %d\n", source,
+					(1 << CONTEXTIDBITS) - 1);
+			valid = 0;
+		}
+	}
+	if (valid) {
+
+		valid = dictWrite(file2, tables, count);
+	}
+
+	//Each sample is counted with the table coding it best, as it would be
+	//coded, with kind and id in front and padding to a byte.
+	if (valid) {
+
+		int64_t members[CONTEXTMAXTABLES] = {0};
+		uint64_t chars[CONTEXTMAXTABLES] = {0};
+		uint64_t packed[CONTEXTMAXTABLES] = {0};
+		for (int64_t s = 0; s < nrOfSamples; s++) {
+
+			uint64_t freqTable[CONTEXTSYMBOLS] = {0};
+			for (int64_t i = 0; i < lengths[s]; i++) {
+
+				freqTable[samples[s][i]]++;
+			}
+			int best = 0;
+			uint64_t bestBits = UINT64_MAX;
+			for (int t = 0; t < count; t++) {
+
+				uint64_t cost = contextTableCost(tables[t], freqTable);
+				if (cost < bestBits) {
+
+					best = t;
+					bestBits = cost;
+				}
+			}
+			members[best]++;
+			chars[best] = chars[best] + lengths[s];
+			packed[best] = packed[best] + (bestBits + CONTEXTKINDBITS +
+										   CONTEXTIDBITS + 7) / 8;
+		}
+
+		fprintf(log, "Trained %d tables from %lld samples\n", count,
+				(long long)nrOfSamples);
+		for (int t = 0; t < count; t++) {
+
+			fprintf(log, "table %u: %lld samples, %llu chars, ratio %.3f\n",
+					(unsigned)tables[t] -> id, (long long)members[t],
+					(unsigned long long)chars[t], packed[t] > 0 ?
+					(double)chars[t] / packed[t] : 0);
+		}
+	} else if (tables != NULL) {
+
+		fprintf(stderr, "Could not write %s\n", file2);
+	}
+
+	if (tables != NULL) {
+
+		dictKill(tables, count);
+	}
+	for (int64_t s = 0; s < nrOfSamples; s++) {
+
+		free(samples[s]);
+		free(paths[s]);
+	}
+	free(lengths);
+	free(samples);
+	free(paths);
+	return valid;
+}
+
+
+/*
+* description: Writes tables to a table set file.
+* param[in]: file - Name of file to be written.
+* param[in]: tables - The tables.
+* param[in]: count - Number of tables.
+* return: 1 if file was written, else 0.
+*/
+int dictWrite (char const *file, contextTable *const *tables, int count) {
+
+	unsigned char header[DICTHEADERSIZE] = {0};
+	unsigned char record[DICTTABLESIZE];
+	stream *out = streamOpenWrite(file);
+
+	if (out == NULL) {
+
+		return 0;
+	}
+
+	memcpy(header, DICTMAGIC, 4);
+	header[4] = DICTVERSION;
+	header[5] = (unsigned char)count;
+	int valid = streamWrite(out, header, DICTHEADERSIZE);
+	for (int t = 0; t < count && valid; t++) {
+
+		formatPutU32(record, tables[t] -> id);
+		memcpy(&record[4], tables[t] -> lengths, CONTEXTSYMBOLS);
+		valid = streamWrite(out, record, DICTTABLESIZE);
+	}
+	return streamClose(out) && valid;
+}
+
+
+/*
+* description: Reads tables from a table set file. Allocates memory for the
+* tables and the array of them.
+* param[in]: file - Name of table set file.
+* param[out]: count - Number of tables.
+* return: The tables, NULL if file can not be read or is not a valid table
+* set.
+*/
+contextTable **dictRead (char const *file, int *count) {
+
+	int64_t length = 0;
+	unsigned char *data = readPlainFile(file, &length);
+
+	*count = 0;
+	if (data == NULL) {
+
+		return NULL;
+	}
+	int n = length >= DICTHEADERSIZE ? data[5] : 0;
+	if (length < DICTHEADERSIZE || memcmp(data, DICTMAGIC, 4) != 0 ||
+		data[4] != DICTVERSION || n < 1 || n > CONTEXTMAXTABLES ||
+		length != DICTHEADERSIZE + (int64_t)n * DICTTABLESIZE) {
+
+		free(data);
+		return NULL;
+	}
+
+	//Ids must differ, else a message could be decoded with the wrong table.
+	contextTable **tables = malloc(sizeof(contextTable *) * n);
+	int valid = 1;
+	for (int t = 0; t < n && valid; t++) {
+
+		unsigned char *record = &data[DICTHEADERSIZE + t * DICTTABLESIZE];
+		tables[t] = contextTableFromLengths(&record[4],
+											formatGetU32(record));
+		valid = tables[t] != NULL;
+		for (int u = 0; u < t && valid; u++) {
+
+			valid = tables[u] -> id != tables[t] -> id;
+		}
+		*count = tables[t] != NULL ? t + 1 : t;
+	}
+	free(data);
+	if (!valid) {
+
+		dictKill(tables, *count);
+		*count = 0;
+		return NULL;
+	}
+	return tables;
+}
+
+
+/*
+* description: Deallocates tables and the array of them.
+* param[in]: tables - The tables.
+* param[in]: count - Number of tables.
+*/
+void dictKill (contextTable **tables, int count) {
+
+	for (int t = 0; t < count; t++) {
+
+		contextTableKill(tables[t]);
+	}
+	free(tables);
+}
+
+
+/*
+* description: Encodes file1 as one message with the table of dictFile
+* coding it best.
+* param[in]: file1 - Name of file to be read, "-" for stdin.
+* param[in]: file2 - Name of file to be written, "-" for stdout.
+* param[in]: dictFile - Name of table set file.
+* return: 1 if file2 was written, else 0.
+*/
+int dictEncodeFile (char const *file1, char const *file2,
+					char const *dictFile) {
+
+	int count = 0;
+	contextTable **tables = dictRead(dictFile, &count);
+
+	if (tables == NULL) {
+
+		fprintf(stderr, "%s is not a valid table set", dictFile);
+		return 0;
+	}
+
+	int64_t length = 0;
+	unsigned char *text = readPlainFile(file1, &length);
+	if (text == NULL) {
+
+		fprintf(stderr, "Could not read %s\n", file1);
+		dictKill(tables, count);
+		return 0;
+	}
+
+	const unsigned char *message = NULL;
+	contextEncoder *enc = contextEncoderEmpty();
+	contextEncoderSetTables(enc, tables, count);
+	int64_t size = contextEncode(enc, text, length, &message);
+
+	stream *out = streamOpenWrite(file2);
+	int valid = out != NULL;
+	if (valid) {
+
+		valid = formatWriteHeader(out, FORMATMODEDICT, length) &&
+				streamWrite(out, message, size);
+		valid = streamClose(out) && valid;
+	}
+	if (!valid) {
+
+		fprintf(stderr, "Could not write %s\n", file2);
+	}
+
+	contextEncoderKill(enc);
+	dictKill(tables, count);
+	free(text);
+	return valid;
+}
+
+
+/*
+* description: Decodes file1 coded with a table of dictFile.
+* param[in]: file1 - Name of file to be read, "-" for stdin.
+* param[in]: file2 - Name of file to be written, "-" for stdout.
+* param[in]: dictFile - Name of table set file.
+* return: 1 if file2 was written, else 0.
+*/
+int dictDecodeFile (char const *file1, char const *file2,
+					char const *dictFile) {
+
+	int count = 0;
+	contextTable **tables = dictRead(dictFile, &count);
+
+	if (tables == NULL) {
+
+		fprintf(stderr, "%s is not a valid table set", dictFile);
+		return 0;
+	}
+
+	int mode = -1;
+	uint64_t length = 0;
+	int64_t size = 0;
+	unsigned char *message = NULL;
+	stream *in = streamOpenRead(file1);
+	if (in != NULL && formatReadHeader(in, &mode, &length) &&
+		mode == FORMATMODEDICT) {
+
+		message = streamReadAll(in, &size);
+	}
+	if (in != NULL) {
+
+		streamClose(in);
+	}
+
+	//Every char is atleast one bit, so a corrupt length is caught before
+	//memory is allocated for it.
+	if (message == NULL || length > (uint64_t)size * 8) {
+
+		fprintf(stderr, "%s is not a file coded with -dict, or is corrupt",
+				file1);
+		free(message);
+		dictKill(tables, count);
+		return 0;
+	}
+
+	unsigned char *text = malloc(length + 1);
+	contextDecoder *dec = contextDecoderEmpty();
+	contextDecoderSetTables(dec, tables, count);
+	int valid = contextDecode(dec, message, size, text, length);
+	if (valid) {
+
+		valid = writePlainFile(file2, text, length);
+	} else if (contextMessageTable(message, size) >= 0) {
+
+		fprintf(stderr, "%s is coded with table %lld, which is not in %s, "
+				"or is corrupt", file1,
+				(long long)contextMessageTable(message, size), dictFile);
+	} else {
+
+		fprintf(stderr, "%s is corrupt", file1);
+	}
+
+	contextDecoderKill(dec);
+	dictKill(tables, count);
+	free(text);
+	free(message);
+	return valid;
+}
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN DICT.C
+
+
+/* support function for dictTrain!
+* description: Counts bits of sample coded with table.
+* param[in]: sample - The dictSample.
+* param[in]: keys - Distinct chars of all samples.
+* param[in]: counts - Counts of distinct chars of all samples.
+* param[in]: table - The contextTable.
+* return: Number of bits.
+*/
+uint64_t dictSampleCost (const dictSample *sample, const unsigned char *keys,
+						 const uint64_t *counts, const contextTable *table) {
+
+	uint64_t bits = 0;
+
+	for (int j = 0; j < sample -> nrOfKeys; j++) {
+
+		int64_t at = sample -> first + j;
+		bits = bits + counts[at] * table -> lengths[keys[at]];
+	}
+	return bits;
+}
+
+
+/* support function for dictTrain!
+* description: Moves every sample to the table coding it in fewest bits.
+* param[in]: samples - The dictSamples.
+* param[in]: nrOfSamples - Number of samples.
+* param[in]: keys - Distinct chars of all samples.
+* param[in]: counts - Counts of distinct chars of all samples.
+* param[in]: tables - The tables.
+* param[in]: nrOfTables - Number of tables.
+* param[in,out]: cluster - Table of each sample.
+* param[out]: bits - Bits of each sample with its table, may be NULL.
+* return: Number of samples that moved.
+*/
+int64_t dictAssign (const dictSample *samples, int64_t nrOfSamples,
+					const unsigned char *keys, const uint64_t *counts,
+					contextTable *const *tables, int nrOfTables,
+					int *cluster, uint64_t *bits) {
+
+	int64_t moved = 0;
+
+	//Tables trained from counts code every char, so no cost is infinite.
+	for (int64_t s = 0; s < nrOfSamples; s++) {
+
+		int best = cluster[s];
+		uint64_t bestBits = dictSampleCost(&samples[s], keys, counts,
+										   tables[best]);
+		for (int t = 0; t < nrOfTables; t++) {
+
+			uint64_t cost = dictSampleCost(&samples[s], keys, counts,
+										   tables[t]);
+			if (cost < bestBits) {
+
+				best = t;
+				bestBits = cost;
+			}
+		}
+		if (best != cluster[s]) {
+
+			cluster[s] = best;
+			moved++;
+		}
+		if (bits != NULL) {
+
+			bits[s] = bestBits;
+		}
+	}
+	return moved;
+}
@@ -0,0 +1,172 @@
+/*
+* dict: Shared tables trained from sample records, so small records can be
+* coded without a table or a histogram of their own.
+*
+* A record of a few hundred chars is too short to build a good tree from,
+* and its own table would cost more than its codes save. Training counts the
+* chars of every sample and clusters samples by which table codes them in
+* the fewest bits. Each table is rebuilt from the counts of its samples until
+* no sample moves, or after DICTROUNDS rounds. Tables get ids from a first
+* id up, and each coded record names the table it was coded with, see
+* context.h. Ids name tables only within a table set, so sets used by the
+* same decoder must be trained with ids that do not overlap.
+*
+* Table set file, integers little endian:
+*   DICTHEADERSIZE bytes header: DICTMAGIC, version, number of tables,
+*   2 reserved bytes
+*   per table DICTTABLESIZE bytes:
+*     4 bytes    id
+*     256 bytes  code length of each char, 0 for chars without code
+*
+* A file coded with a table set has mode FORMATMODEDICT, and its payload is
+* one message of contextEncode.
+*/
+
+#ifndef DICT
+#define DICT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "context.h"
+
+#define DICTMAGIC "HUFD"
+#define DICTVERSION 1
+#define DICTHEADERSIZE 8
+#define DICTTABLESIZE (4 + CONTEXTSYMBOLS)
+#define DICTROUNDS 16
+#define DICTDEFAULTID 1
+//Counts of the sample seeding a table are scaled, so the one count added to
+//every char does not hide them.
+#define DICTSEEDSCALE 64
+
+
+/*
+* description: Trains shared tables from samples. Allocates memory for the
+* tables and the array of them.
+* param[in]: samples - The samples.
+* param[in]: lengths - Number of chars of each sample.
+* param[in]: nrOfSamples - Number of samples.
+* param[in]: nrOfTables - Most tables to train, 1 to CONTEXTMAXTABLES.
+* param[in]: firstId - Id of the first table, the others follow it.
+* param[out]: count - Number of tables trained. Fewer than nrOfTables if
+* samples do not fill them.
+* return: The tables, NULL if there are no samples or ids do not fit in
+* CONTEXTIDBITS bits.
+*/
+contextTable **dictTrain (unsigned char *const *samples,
+						  const int64_t *lengths, int64_t nrOfSamples,
+						  int nrOfTables, uint32_t firstId, int *count);
+
+
+/*
+* description: Trains tables from every file of source and writes them to
+* file2.
+* param[in]: source - Directory, or file listing one sample file per line.
+* param[in]: file2 - Name of table set file to be written.
+* param[in]: nrOfTables - Most tables to train, 1 to CONTEXTMAXTABLES.
+* param[in]: firstId - Id of the first table.
+* param[in]: log - File to print the tables to.
+* return: 1 if file2 was written, else 0.
+*/
+int dictTrainFile (char const *source, char const *file2, int nrOfTables,
+				   uint32_t firstId, FILE *log);
+
+
+/*
+* description: Writes tables to a table set file.
+* param[in]: file - Name of file to be written.
+* param[in]: tables - The tables.
+* param[in]: count - Number of tables.
+* return: 1 if file was written, else 0.
+*/
+int dictWrite (char const *file, contextTable *const *tables, int count);
+
+
+/*
+* description: Reads tables from a table set file. Allocates memory for the
+* tables and the array of them.
+* param[in]: file - Name of table set file.
+* param[out]: count - Number of tables.
+* return: The tables, NULL if file can not be read or is not a valid table
+* set.
+*/
+contextTable **dictRead (char const *file, int *count);
+
+
+/*
+* description: Deallocates tables and the array of them.
+* param[in]: tables - The tables.
+* param[in]: count - Number of tables.
+*/
+void dictKill (contextTable **tables, int count);
+
+
+/*
+* description: Encodes file1 as one message with the table of dictFile
+* coding it best.
+* param[in]: file1 - Name of file to be read, "-" for stdin.
+* param[in]: file2 - Name of file to be written, "-" for stdout.
+* param[in]: dictFile - Name of table set file.
+* return: 1 if file2 was written, else 0.
+*/
+int dictEncodeFile (char const *file1, char const *file2,
+					char const *dictFile);
+
+
+/*
+* description: Decodes file1 coded with a table of dictFile.
+* param[in]: file1 - Name of file to be read, "-" for stdin.
+* param[in]: file2 - Name of file to be written, "-" for stdout.
+* param[in]: dictFile - Name of table set file.
+* return: 1 if file2 was written, else 0.
+*/
+int dictDecodeFile (char const *file1, char const *file2,
+					char const *dictFile);
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN DICT.C
+
+
+//Where the distinct chars of one sample and their counts are kept.
+//Distinct chars of one sample and their counts.
+typedef struct dictSample {
+
+	int64_t first;
+	int nrOfKeys;
+	int64_t length;
+} dictSample;
+
+
+/* support function for dictTrain!
+* description: Counts bits of sample coded with table.
+* param[in]: sample - The dictSample.
+* param[in]: keys - Distinct chars of all samples.
+* param[in]: counts - Counts of distinct chars of all samples.
+* param[in]: table - The contextTable.
+* return: Number of bits.
+*/
+uint64_t dictSampleCost (const dictSample *sample, const unsigned char *keys,
+						 const uint64_t *counts, const contextTable *table);
+
+
+/* support function for dictTrain!
+* description: Moves every sample to the table coding it in fewest bits.
+* param[in]: samples - The dictSamples.
+* param[in]: nrOfSamples - Number of samples.
+* param[in]: keys - Distinct chars of all samples.
+* param[in]: counts - Counts of distinct chars of all samples.
+* param[in]: tables - The tables.
+* param[in]: nrOfTables - Number of tables.
+* param[in,out]: cluster - Table of each sample.
+* param[out]: bits - Bits of each sample with its table, may be NULL.
+* return: Number of samples that moved.
+*/
+int64_t dictAssign (const dictSample *samples, int64_t nrOfSamples,
+					const unsigned char *keys, const uint64_t *counts,
+					contextTable *const *tables, int nrOfTables,
+					int *cluster, uint64_t *bits);
+
+
+#endif //DICT
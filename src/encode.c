@@ -16,15 +16,19 @@
 * param[in]: file1 - Name of file to be read and encoded.
 * param[in]: file2 - Name of file to be written as encoded file.
 * param[in]: tree - Tree that contains huffman table.
+* return: 1 if file2 was written, else 0.
 */
-void encodeFile (char const *file1, char const *file2, huffTree *tree) {
+int encodeFile (char const *file1, char const *file2, huffTree *tree) {
 
-	bitString *bs = encodeFileToBitString(file1, tree);
+	uint64_t originalLength = 0;
+	bitString *bs = encodeFileToBitString(file1, tree, &originalLength);
 	unsigned char *text = bitStringGetEncode(bs);
-	int size = bitStringGetSize(bs);
-	writeEncode(file2, text, size);
+	int64_t size = bitStringGetSize(bs);
+	int valid = writeEncode(file2, FORMATMODESTATIC, originalLength, text,
+							size);
 
 	bitStringKill(bs);
+	return valid;
 }
 
 
@@ -32,56 +36,128 @@ void encodeFile (char const *file1, char const *file2, huffTree *tree) {
 * description: Reads file and turns it into encoded bitString.
 * param[in]: file1 - Name of file to be read.
 * param[in]: tree - Tree that contains huffman table.
+* param[out]: originalLength - Number of chars read from file1.
 * return: bitString containing encoded file1 as bits.
 */
-bitString *encodeFileToBitString (char const *file1, huffTree *tree) {
+bitString *encodeFileToBitString (char const *file1, huffTree *tree,
+								  uint64_t *originalLength) {
 
-	FILE *fp = fopen(file1, "r");
+	stream *in = streamOpenRead(file1);
 
-	int currentChar = 0;
+	unsigned char *buffer = malloc(STREAMBUFFERSIZE);
+	int64_t got = 0;
+	uint64_t length = 0;
 	bitString *bs = bitStringEmpty();
 
-	while ((currentChar = fgetc(fp)) >= 0) {
+	//Length is stored in header, so no end of file code is needed.
+	while ((got = streamRead(in, buffer, STREAMBUFFERSIZE)) > 0) {
 
-		char *newBits = huffTreeGetKeyPath(tree, currentChar);
-		int nrOfBits = getBitLength(newBits);
-		bitStringAddBits(bs, newBits, nrOfBits);
+		encodeBuffer(bs, buffer, got, tree -> codeTable);
+		length = length + got;
 	}
-	char *eof = huffTreeGetKeyPath(tree, 4);
-	int eofLength = getBitLength(eof);
-	bitStringAddBits(bs, eof, eofLength);
+	*originalLength = length;
 
-	fclose(fp);
+	streamClose(in);
+	free(buffer);
 	return bs;
 }
 
 
 /*
-* description: Counts how many bits there are in a string of bits. String must
-* contain NULLBYTE.
-* param[in]: bits - Pointer to array of bits.
-* return: Number of bits in string.
+* description: Encodes chars in memory and adds the codes to bitString.
+* param[in]: bs - The bitString to add codes to.
+* param[in]: text - The chars to encode.
+* param[in]: length - Number of chars.
+* param[in]: codeTable - Code of each char.
 */
-int getBitLength (char *bits) {
-	int length = 0;
-	while (bits[length] != '\0') {
+void encodeBuffer (bitString *bs, const unsigned char *text, int64_t length,
+				   const huffCode *codeTable) {
 
-		length++;
+	for (int64_t i = 0; i < length; i++) {
+
+		huffCode hc = codeTable[text[i]];
+		bitStringAddCode(bs, hc.code, hc.len);
+	}
+}
+
+
+/*
+* description: Reads whole file into memory. Allocates memory for the chars.
+* param[in]: file1 - Name of file to be read, "-" for stdin.
+* param[out]: length - Number of chars read.
+* return: Pointer to allocated chars, NULL if file could not be read.
+*/
+unsigned char *readPlainFile (char const *file1, int64_t *length) {
+
+	stream *in = streamOpenRead(file1);
+
+	*length = 0;
+	if (in == NULL) {
+
+		return NULL;
 	}
-	return length;
+
+	unsigned char *text = streamReadAll(in, length);
+	streamClose(in);
+	return text;
 }
 
 
 /*
-* description: Writes the encoded file.
-* param[in]: file2 - Name of file to be written.
+* description: Writes the encoded file, header first and then the text.
+* param[in]: file2 - Name of file to be written, "-" for stdout.
+* param[in]: mode - Mode of the encoded text, stored in header.
+* param[in]: originalLength - Length of original file, stored in header.
+* param[in]: text - The encoded text.
 * param[in]: size - size in number of charachters to be written.
+* return: 1 if header and text were written, else 0.
+*/
+int writeEncode (char const *file2, int mode, uint64_t originalLength,
+				 unsigned char *text, int64_t size) {
+
+	stream *out = streamOpenWrite(file2);
+
+	if (out == NULL) {
+
+		fprintf(stderr, "Could not open %s\n", file2);
+		return 0;
+	}
+
+	int valid = formatWriteHeader(out, mode, originalLength) &&
+				streamWrite(out, text, size);
+
+	valid = streamClose(out) && valid;
+	if (!valid) {
+
+		fprintf(stderr, "Could not write %s\n", file2);
+	}
+	return valid;
+}
+
+
+/*
+* description: Writes decoded chars to file.
+* param[in]: file2 - Name of file to be written, "-" for stdout.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* return: 1 if all chars were written, else 0.
 */
-void writeEncode (char const *file2, unsigned char *text, int size) {
+int writePlainFile (char const *file2, const unsigned char *text,
+					int64_t length) {
 
-	FILE *fp = fopen(file2, "w");
+	stream *out = streamOpenWrite(file2);
 
-	fwrite(text, sizeof(char), size, fp);
+	if (out == NULL) {
 
-	fclose(fp);
+		fprintf(stderr, "Could not open %s\n", file2);
+		return 0;
+	}
+
+	streamWrite(out, text, length);
+	if (!streamClose(out)) {
+
+		fprintf(stderr, "Could not write %s\n", file2);
+		return 0;
+	}
+	return 1;
 }
@@ -13,6 +13,8 @@
 
 #include "huffTree.h"
 #include "bitString.h"
+#include "format.h"
+#include "stream.h"
 
 
 /*
@@ -21,31 +23,61 @@
 * param[in]: file1 - Name of file to be read and encoded.
 * param[in]: file2 - Name of file to be written as encoded file.
 * param[in]: tree - Tree that contains huffman table.
+* return: 1 if file2 was written, else 0.
 */
-void encodeFile (char const *file1, char const *file2, huffTree *tree);
+int encodeFile (char const *file1, char const *file2, huffTree *tree);
 
 
 /*
 * description: Reads file and turns it into encoded bitString.
 * param[in]: file1 - Name of file to be read.
 * param[in]: tree - Tree that contains huffman table.
+* param[out]: originalLength - Number of chars read from file1.
 * return: bitString containing encoded file1 as bits.
 */
-bitString *encodeFileToBitString (char const *file1, huffTree *tree);
+bitString *encodeFileToBitString (char const *file1, huffTree *tree,
+								  uint64_t *originalLength);
 
 
 /*
-* description: Counts how many bits there are in a string of bits. String must
-* contain NULLBYTE.
-* param[in]: bits - Pointer to array of bits.
-* return: Number of bits in string.
+* description: Encodes chars in memory and adds the codes to bitString.
+* param[in]: bs - The bitString to add codes to.
+* param[in]: text - The chars to encode.
+* param[in]: length - Number of chars.
+* param[in]: codeTable - Code of each char.
 */
-int getBitLength (char *bits);
+void encodeBuffer (bitString *bs, const unsigned char *text, int64_t length,
+				   const huffCode *codeTable);
 
 
 /*
-* description: Writes the encoded file.
-* param[in]: file2 - Name of file to be written.
+* description: Reads whole file into memory. Allocates memory for the chars.
+* param[in]: file1 - Name of file to be read, "-" for stdin.
+* param[out]: length - Number of chars read.
+* return: Pointer to allocated chars, NULL if file could not be read.
+*/
+unsigned char *readPlainFile (char const *file1, int64_t *length);
+
+
+/*
+* description: Writes the encoded file, header first and then the text.
+* param[in]: file2 - Name of file to be written, "-" for stdout.
+* param[in]: mode - Mode of the encoded text, stored in header.
+* param[in]: originalLength - Length of original file, stored in header.
+* param[in]: text - The encoded text.
 * param[in]: size - size in number of charachters to be written.
+* return: 1 if header and text were written, else 0.
+*/
+int writeEncode (char const *file2, int mode, uint64_t originalLength,
+				 unsigned char *text, int64_t size);
+
+
+/*
+* description: Writes decoded chars to file.
+* param[in]: file2 - Name of file to be written, "-" for stdout.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* return: 1 if all chars were written, else 0.
 */
-void writeEncode (char const *file2, unsigned char *text, int size);
+int writePlainFile (char const *file2, const unsigned char *text,
+					int64_t length);
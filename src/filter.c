@@ -0,0 +1,615 @@
+/*
+* filter: Stride, delta and xor filters for binary numeric data. See filter.h
+* for the layout of the payload.
+*/
+
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "filter.h"
+#include "encode.h"
+
+//Filters tried per block when filter is picked automatically.
+static const filterSpec filterCandidates[] = {
+
+	{FILTERNONE, 1, 0}, {FILTERNONE, 2, 1}, {FILTERNONE, 4, 1},
+	{FILTERNONE, 8, 1}, {FILTERDELTA, 1, 0}, {FILTERDELTA, 2, 0},
+	{FILTERDELTA, 2, 1}, {FILTERDELTA, 4, 0}, {FILTERDELTA, 4, 1},
+	{FILTERDELTA, 8, 0}, {FILTERDELTA, 8, 1}, {FILTERXOR, 1, 0},
+	{FILTERXOR, 2, 0}, {FILTERXOR, 2, 1}, {FILTERXOR, 4, 0},
+	{FILTERXOR, 4, 1}, {FILTERXOR, 8, 0}, {FILTERXOR, 8, 1}
+};
+
+
+/*
+* description: Parses filter name, one of auto, none, shuffleN, deltaN or
+* xorN where N is stride 1, 2, 4 or 8. Delta and xor with stride above 1 are
+* followed by shuffle.
+* param[in]: name - The name.
+* param[out]: spec - The filter.
+* return: 1 if name is a filter, else 0.
+*/
+int filterParse (char const *name, filterSpec *spec) {
+
+	char const *number = name;
+
+	spec -> stride = 1;
+	spec -> shuffle = 0;
+	if (strcmp(name, "auto") == 0) {
+
+		spec -> transform = FILTERAUTO;
+		return 1;
+	} else if (strcmp(name, "none") == 0) {
+
+		spec -> transform = FILTERNONE;
+		return 1;
+	} else if (strncmp(name, "shuffle", 7) == 0) {
+
+		spec -> transform = FILTERNONE;
+		number = &name[7];
+	} else if (strncmp(name, "delta", 5) == 0) {
+
+		spec -> transform = FILTERDELTA;
+		number = &name[5];
+	} else if (strncmp(name, "xor", 3) == 0) {
+
+		spec -> transform = FILTERXOR;
+		number = &name[3];
+	} else {
+
+		return 0;
+	}
+
+	if (strcmp(number, "1") != 0 && strcmp(number, "2") != 0 &&
+		strcmp(number, "4") != 0 && strcmp(number, "8") != 0) {
+
+		return 0;
+	}
+	spec -> stride = atoi(number);
+	spec -> shuffle = spec -> stride > 1;
+	return spec -> transform != FILTERNONE || spec -> shuffle;
+}
+
+
+/*
+* description: Applies transform and then shuffle of filter.
+* param[in]: spec - The filter.
+* param[in]: in - The chars.
+* param[out]: out - Array of atleast n chars, not in.
+* param[in]: n - Number of chars. Chars after the last full element are
+* copied as they are.
+*/
+void filterForward (const filterSpec *spec, const unsigned char *in,
+					unsigned char *out, int64_t n) {
+
+	int64_t count = n / spec -> stride;
+	int64_t bytes = count * spec -> stride;
+
+	if (spec -> transform != FILTERNONE && spec -> shuffle) {
+
+		unsigned char *work = malloc(bytes > 0 ? bytes : 1);
+		filterDeltaForward(spec -> transform, in, work, count, spec -> stride);
+		filterShuffle(work, out, count, spec -> stride);
+		free(work);
+	} else if (spec -> transform != FILTERNONE) {
+
+		filterDeltaForward(spec -> transform, in, out, count, spec -> stride);
+	} else if (spec -> shuffle) {
+
+		filterShuffle(in, out, count, spec -> stride);
+	} else {
+
+		memcpy(out, in, bytes);
+	}
+	memcpy(&out[bytes], &in[bytes], n - bytes);
+}
+
+
+/*
+* description: Undoes shuffle and then transform of filter.
+* param[in]: spec - The filter.
+* param[in]: in - The filtered chars.
+* param[out]: out - Array of atleast n chars, not in.
+* param[in]: n - Number of chars.
+*/
+void filterInverse (const filterSpec *spec, const unsigned char *in,
+					unsigned char *out, int64_t n) {
+
+	int64_t count = n / spec -> stride;
+	int64_t bytes = count * spec -> stride;
+
+	if (spec -> shuffle) {
+
+		filterUnshuffle(in, out, count, spec -> stride);
+	} else {
+
+		memcpy(out, in, bytes);
+	}
+	if (spec -> transform != FILTERNONE) {
+
+		filterDeltaInverse(spec -> transform, out, count, spec -> stride);
+	}
+	memcpy(&out[bytes], &in[bytes], n - bytes);
+}
+
+
+/*
+* description: Encodes chars in memory block by block, each block filtered
+* before it is coded.
+* param[in]: bs - The bitString.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[in]: blockSize - Largest number of chars in a block.
+* param[in]: spec - Filter for all blocks, or transform FILTERAUTO to pick
+* the filter giving the smallest huffman code per block.
+*/
+void filterEncode (bitString *bs, const unsigned char *text, int64_t length,
+				   int64_t blockSize, const filterSpec *spec) {
+
+	int64_t workSize = length < blockSize ? length : blockSize;
+	unsigned char *work = malloc(workSize > 0 ? workSize : 1);
+	int nrOfCandidates = sizeof(filterCandidates) / sizeof(filterCandidates[0]);
+
+	for (int64_t pos = 0; pos < length; pos = pos + blockSize) {
+
+		int64_t n = length - pos < blockSize ? length - pos : blockSize;
+		filterSpec use = *spec;
+
+		if (spec -> transform == FILTERAUTO) {
+
+			int64_t bestCost = -1;
+			for (int c = 0; c < nrOfCandidates; c++) {
+
+				filterForward(&filterCandidates[c], &text[pos], work, n);
+				int64_t cost = filterCodeCost(work, n);
+				if (bestCost < 0 || cost < bestCost) {
+
+					bestCost = cost;
+					use = filterCandidates[c];
+				}
+			}
+		}
+		filterForward(&use, &text[pos], work, n);
+
+		canonicalWriteGamma(bs, n);
+		bitStringAddCode(bs, use.transform, 2);
+		bitStringAddCode(bs, canonicalBitWidth(use.stride) - 1, 2);
+		bitStringAddCode(bs, use.shuffle, 1);
+		ansBlocksEncode(bs, work, n, n, ANSBACKENDAUTO);
+	}
+
+	free(work);
+}
+
+
+/*
+* description: Decodes blocks from bitString.
+* param[in]: bs - The bitString.
+* param[in]: bitPos - Position of next bit to read. Moved past the blocks.
+* param[out]: text - Array to store atleast length chars in.
+* param[in]: length - Number of chars to decode.
+* return: 1 if all chars could be decoded, else 0.
+*/
+int filterDecode (bitString *bs, int64_t *bitPos, unsigned char *text,
+				  int64_t length) {
+
+	unsigned char *work = NULL;
+	int64_t workSize = 0;
+	int64_t pos = 0;
+	int valid = 1;
+
+	while (valid && pos < length) {
+
+		int64_t n = canonicalReadGamma(bs, bitPos);
+		filterSpec spec;
+
+		spec.transform = (int)canonicalReadBits(bs, bitPos, 2);
+		spec.stride = 1 << canonicalReadBits(bs, bitPos, 2);
+		spec.shuffle = (int)canonicalReadBits(bs, bitPos, 1);
+
+		valid = n > 0 && n <= length - pos && spec.transform <= FILTERXOR;
+		if (!valid) {
+
+			break;
+		}
+
+		if (n > workSize) {
+
+			workSize = n;
+			work = realloc(work, workSize);
+		}
+		valid = ansBlocksDecode(bs, bitPos, work, n);
+		if (valid) {
+
+			filterInverse(&spec, work, &text[pos], n);
+		}
+		pos = pos + n;
+	}
+
+	free(work);
+	return valid;
+}
+
+
+/*
+* description: Reads file, encodes it block by block and writes encoded file.
+* param[in]: file1 - Name of file to be read and encoded.
+* param[in]: file2 - Name of file to be written as encoded file.
+* param[in]: spec - Filter for all blocks, or transform FILTERAUTO.
+* return: 1 if file2 was written, else 0.
+*/
+int filterEncodeFile (char const *file1, char const *file2,
+					  const filterSpec *spec) {
+
+	int64_t length = 0;
+	unsigned char *text = readPlainFile(file1, &length);
+	bitString *bs = bitStringEmpty();
+
+	filterEncode(bs, text, length, FILTERBLOCKSIZE, spec);
+
+	unsigned char *encode = bitStringGetEncode(bs);
+	int valid = writeEncode(file2, FORMATMODEFILTER, length, encode,
+							bitStringGetSize(bs));
+
+	bitStringKill(bs);
+	free(text);
+	return valid;
+}
+
+
+/*
+* description: Decodes filter payload and writes decoded file.
+* param[in]: file2 - Name of file to write decode.
+* param[in]: bs - The bitString with payload after file header.
+* param[in]: originalLength - Number of chars to decode.
+* return: 1 if payload could be decoded, else 0.
+*/
+int filterDecodeFile (char const *file2, bitString *bs,
+					  uint64_t originalLength) {
+
+	int64_t bitPos = 0;
+	unsigned char *text = NULL;
+
+	//Filtered chars are coded as ans blocks, and filters keep the length.
+	if (formatLengthFits(originalLength, bitStringGetSize(bs),
+						 ANSMAXPERBYTE)) {
+
+		text = malloc(originalLength > 0 ? originalLength : 1);
+	}
+	if (text == NULL) {
+
+		return 0;
+	}
+	int valid = filterDecode(bs, &bitPos, text, originalLength);
+
+	if (valid) {
+
+		valid = writePlainFile(file2, text, originalLength);
+	}
+
+	free(text);
+	return valid;
+}
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN FILTER.C
+
+
+/* support function for filterForward!
+* description: Replaces each element with difference from, or xor with, the
+* element before it. First element is kept.
+* param[in]: transform - FILTERDELTA or FILTERXOR.
+* param[in]: in - The elements.
+* param[out]: out - Array of atleast count * stride chars, not in.
+* param[in]: count - Number of elements.
+* param[in]: stride - Bytes per element, 1, 2, 4 or 8.
+*/
+void filterDeltaForward (int transform, const unsigned char *in,
+						 unsigned char *out, int64_t count, int stride) {
+
+	int64_t bytes = count * stride;
+	int64_t i = stride;
+
+	if (count == 0) {
+
+		return;
+	}
+	memcpy(out, in, stride);
+
+#ifdef __SSE2__
+	//Each element only depends on input, so 16 bytes are done at once.
+	for (; i + 16 <= bytes; i = i + 16) {
+
+		__m128i cur = _mm_loadu_si128((const __m128i *)&in[i]);
+		__m128i prev = _mm_loadu_si128((const __m128i *)&in[i - stride]);
+		__m128i res;
+
+		if (transform == FILTERXOR) {
+
+			res = _mm_xor_si128(cur, prev);
+		} else if (stride == 1) {
+
+			res = _mm_sub_epi8(cur, prev);
+		} else if (stride == 2) {
+
+			res = _mm_sub_epi16(cur, prev);
+		} else if (stride == 4) {
+
+			res = _mm_sub_epi32(cur, prev);
+		} else {
+
+			res = _mm_sub_epi64(cur, prev);
+		}
+		_mm_storeu_si128((__m128i *)&out[i], res);
+	}
+#endif
+
+	//Bytes of an element are subtracted lowest first, with borrow.
+	for (; i < bytes; i = i + stride) {
+
+		int borrow = 0;
+		for (int b = 0; b < stride; b++) {
+
+			if (transform == FILTERXOR) {
+
+				out[i + b] = in[i + b] ^ in[i - stride + b];
+			} else {
+
+				int d = in[i + b] - in[i - stride + b] - borrow;
+				out[i + b] = (unsigned char)d;
+				borrow = d < 0;
+			}
+		}
+	}
+}
+
+
+/* support function for filterInverse!
+* description: Undoes filterDeltaForward in place, a running sum or xor.
+* param[in]: transform - FILTERDELTA or FILTERXOR.
+* param[in]: data - The elements.
+* param[in]: count - Number of elements.
+* param[in]: stride - Bytes per element, 1, 2, 4 or 8.
+*/
+void filterDeltaInverse (int transform, unsigned char *data, int64_t count,
+						 int stride) {
+
+	int64_t bytes = count * stride;
+	int64_t i = stride;
+
+#ifdef __SSE2__
+	//Prefix sum inside a vector by adding it shifted by 1, 2, 4 and 8
+	//elements, then adding last element of the vector before.
+	for (; i + 16 <= bytes; i = i + 16) {
+
+		__m128i x = _mm_loadu_si128((const __m128i *)&data[i]);
+		__m128i carry;
+
+		if (transform == FILTERXOR) {
+
+			if (stride == 1) {
+
+				x = _mm_xor_si128(x, _mm_slli_si128(x, 1));
+			}
+			if (stride <= 2) {
+
+				x = _mm_xor_si128(x, _mm_slli_si128(x, 2));
+			}
+			if (stride <= 4) {
+
+				x = _mm_xor_si128(x, _mm_slli_si128(x, 4));
+			}
+			x = _mm_xor_si128(x, _mm_slli_si128(x, 8));
+		} else if (stride == 1) {
+
+			x = _mm_add_epi8(x, _mm_slli_si128(x, 1));
+			x = _mm_add_epi8(x, _mm_slli_si128(x, 2));
+			x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+			x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+		} else if (stride == 2) {
+
+			x = _mm_add_epi16(x, _mm_slli_si128(x, 2));
+			x = _mm_add_epi16(x, _mm_slli_si128(x, 4));
+			x = _mm_add_epi16(x, _mm_slli_si128(x, 8));
+		} else if (stride == 4) {
+
+			x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+			x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+		} else {
+
+			x = _mm_add_epi64(x, _mm_slli_si128(x, 8));
+		}
+
+		if (stride == 1) {
+
+			carry = _mm_set1_epi8((char)data[i - 1]);
+		} else if (stride == 2) {
+
+			uint16_t last;
+			memcpy(&last, &data[i - 2], 2);
+			carry = _mm_set1_epi16((short)last);
+		} else if (stride == 4) {
+
+			uint32_t last;
+			memcpy(&last, &data[i - 4], 4);
+			carry = _mm_set1_epi32((int)last);
+		} else {
+
+			uint64_t last;
+			memcpy(&last, &data[i - 8], 8);
+			carry = _mm_set1_epi64x((long long)last);
+		}
+
+		if (transform == FILTERXOR) {
+
+			x = _mm_xor_si128(x, carry);
+		} else if (stride == 1) {
+
+			x = _mm_add_epi8(x, carry);
+		} else if (stride == 2) {
+
+			x = _mm_add_epi16(x, carry);
+		} else if (stride == 4) {
+
+			x = _mm_add_epi32(x, carry);
+		} else {
+
+			x = _mm_add_epi64(x, carry);
+		}
+		_mm_storeu_si128((__m128i *)&data[i], x);
+	}
+#endif
+
+	for (; i < bytes; i = i + stride) {
+
+		int carry = 0;
+		for (int b = 0; b < stride; b++) {
+
+			if (transform == FILTERXOR) {
+
+				data[i + b] = data[i + b] ^ data[i - stride + b];
+			} else {
+
+				int s = data[i + b] + data[i - stride + b] + carry;
+				data[i + b] = (unsigned char)s;
+				carry = s > 255;
+			}
+		}
+	}
+}
+
+
+/* support function for filterForward!
+* description: Splits elements into byte planes.
+* param[in]: in - The elements.
+* param[out]: out - Array of atleast count * stride chars, not in.
+* param[in]: count - Number of elements.
+* param[in]: stride - Bytes per element, 2, 4 or 8.
+*/
+void filterShuffle (const unsigned char *in, unsigned char *out,
+					int64_t count, int stride) {
+
+	int64_t i = 0;
+
+#ifdef __SSE2__
+	//16 elements are stride vectors. Splitting pairs of vectors into even
+	//and odd bytes log2(stride) times leaves vector k holding byte plane k.
+	__m128i mask = _mm_set1_epi16(0x00ff);
+	__m128i v[8];
+	__m128i t[8];
+	int half = stride / 2;
+
+	for (; stride > 1 && i + 16 <= count; i = i + 16) {
+
+		for (int k = 0; k < stride; k++) {
+
+			v[k] = _mm_loadu_si128((const __m128i *)&in[i * stride + 16 * k]);
+		}
+		for (int level = stride; level > 1; level = level / 2) {
+
+			for (int p = 0; p < half; p++) {
+
+				__m128i a = v[2 * p];
+				__m128i b = v[2 * p + 1];
+
+				t[p] = _mm_packus_epi16(_mm_and_si128(a, mask),
+										_mm_and_si128(b, mask));
+				t[p + half] = _mm_packus_epi16(_mm_srli_epi16(a, 8),
+											   _mm_srli_epi16(b, 8));
+			}
+			memcpy(v, t, sizeof(__m128i) * stride);
+		}
+		for (int k = 0; k < stride; k++) {
+
+			_mm_storeu_si128((__m128i *)&out[k * count + i], v[k]);
+		}
+	}
+#endif
+
+	for (; i < count; i++) {
+
+		for (int b = 0; b < stride; b++) {
+
+			out[b * count + i] = in[i * stride + b];
+		}
+	}
+}
+
+
+/* support function for filterInverse!
+* description: Joins byte planes into elements.
+* param[in]: in - The byte planes.
+* param[out]: out - Array of atleast count * stride chars, not in.
+* param[in]: count - Number of elements.
+* param[in]: stride - Bytes per element, 2, 4 or 8.
+*/
+void filterUnshuffle (const unsigned char *in, unsigned char *out,
+					  int64_t count, int stride) {
+
+	int64_t i = 0;
+
+#ifdef __SSE2__
+	//Interleaving is the inverse of the even and odd split in filterShuffle.
+	__m128i v[8];
+	__m128i t[8];
+	int half = stride / 2;
+
+	for (; stride > 1 && i + 16 <= count; i = i + 16) {
+
+		for (int k = 0; k < stride; k++) {
+
+			v[k] = _mm_loadu_si128((const __m128i *)&in[k * count + i]);
+		}
+		for (int level = stride; level > 1; level = level / 2) {
+
+			for (int p = 0; p < half; p++) {
+
+				t[2 * p] = _mm_unpacklo_epi8(v[p], v[p + half]);
+				t[2 * p + 1] = _mm_unpackhi_epi8(v[p], v[p + half]);
+			}
+			memcpy(v, t, sizeof(__m128i) * stride);
+		}
+		for (int k = 0; k < stride; k++) {
+
+			_mm_storeu_si128((__m128i *)&out[i * stride + 16 * k], v[k]);
+		}
+	}
+#endif
+
+	for (; i < count; i++) {
+
+		for (int b = 0; b < stride; b++) {
+
+			out[i * stride + b] = in[b * count + i];
+		}
+	}
+}
+
+
+/* support function for filterEncode!
+* description: Computes size of order-0 huffman code of chars.
+* param[in]: text - The chars.
+* param[in]: n - Number of chars.
+* return: Size in bits, code table included.
+*/
+int64_t filterCodeCost (const unsigned char *text, int64_t n) {
+
+	uint64_t freqTable[256] = {0};
+	uint8_t lengths[256];
+
+	for (int64_t i = 0; i < n; i++) {
+
+		freqTable[text[i]]++;
+	}
+	canonicalCodeLengths(freqTable, 256, HUFFMAXCODELEN, lengths);
+
+	int64_t cost = canonicalLengthsCost(lengths, 256);
+	for (int s = 0; s < 256; s++) {
+
+		cost = cost + freqTable[s] * lengths[s];
+	}
+	return cost;
+}
@@ -0,0 +1,183 @@
+/*
+* filter: Filters for binary numeric data, run before entropy coding. Data is
+* seen as little endian elements of stride bytes. Delta replaces each element
+* with the difference from the element before it and xor with the xor of
+* them, so slowly changing samples turn into small numbers. Shuffle then
+* splits elements into byte planes, all lowest bytes first and all highest
+* bytes last, so bytes with similar statistics end up next to each other.
+* Kernels use SSE2 where the compiler has it.
+*
+* Payload after file header, one entry per block until all chars are coded:
+*   gamma(block length)
+*   2 bits transform, 2 bits log2(stride), 1 bit shuffle
+*   the filtered block coded as one block of ans.h
+*/
+
+#ifndef FILTER
+#define FILTER
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "bitString.h"
+#include "canonical.h"
+#include "ans.h"
+
+#define FILTERBLOCKSIZE (1 << 16)
+
+#define FILTERAUTO -1
+#define FILTERNONE 0
+#define FILTERDELTA 1
+#define FILTERXOR 2
+
+
+typedef struct filterSpec {
+
+	int transform;
+	int stride;
+	int shuffle;
+} filterSpec;
+
+
+/*
+* description: Parses filter name, one of auto, none, shuffleN, deltaN or
+* xorN where N is stride 1, 2, 4 or 8. Delta and xor with stride above 1 are
+* followed by shuffle.
+* param[in]: name - The name.
+* param[out]: spec - The filter.
+* return: 1 if name is a filter, else 0.
+*/
+int filterParse (char const *name, filterSpec *spec);
+
+
+/*
+* description: Applies transform and then shuffle of filter.
+* param[in]: spec - The filter.
+* param[in]: in - The chars.
+* param[out]: out - Array of atleast n chars, not in.
+* param[in]: n - Number of chars. Chars after the last full element are
+* copied as they are.
+*/
+void filterForward (const filterSpec *spec, const unsigned char *in,
+					unsigned char *out, int64_t n);
+
+
+/*
+* description: Undoes shuffle and then transform of filter.
+* param[in]: spec - The filter.
+* param[in]: in - The filtered chars.
+* param[out]: out - Array of atleast n chars, not in.
+* param[in]: n - Number of chars.
+*/
+void filterInverse (const filterSpec *spec, const unsigned char *in,
+					unsigned char *out, int64_t n);
+
+
+/*
+* description: Encodes chars in memory block by block, each block filtered
+* before it is coded.
+* param[in]: bs - The bitString.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[in]: blockSize - Largest number of chars in a block.
+* param[in]: spec - Filter for all blocks, or transform FILTERAUTO to pick
+* the filter giving the smallest huffman code per block.
+*/
+void filterEncode (bitString *bs, const unsigned char *text, int64_t length,
+				   int64_t blockSize, const filterSpec *spec);
+
+
+/*
+* description: Decodes blocks from bitString.
+* param[in]: bs - The bitString.
+* param[in]: bitPos - Position of next bit to read. Moved past the blocks.
+* param[out]: text - Array to store atleast length chars in.
+* param[in]: length - Number of chars to decode.
+* return: 1 if all chars could be decoded, else 0.
+*/
+int filterDecode (bitString *bs, int64_t *bitPos, unsigned char *text,
+				  int64_t length);
+
+
+/*
+* description: Reads file, encodes it block by block and writes encoded file.
+* param[in]: file1 - Name of file to be read and encoded.
+* param[in]: file2 - Name of file to be written as encoded file.
+* param[in]: spec - Filter for all blocks, or transform FILTERAUTO.
+* return: 1 if file2 was written, else 0.
+*/
+int filterEncodeFile (char const *file1, char const *file2,
+					  const filterSpec *spec);
+
+
+/*
+* description: Decodes filter payload and writes decoded file.
+* param[in]: file2 - Name of file to write decode.
+* param[in]: bs - The bitString with payload after file header.
+* param[in]: originalLength - Number of chars to decode.
+* return: 1 if payload could be decoded, else 0.
+*/
+int filterDecodeFile (char const *file2, bitString *bs,
+					  uint64_t originalLength);
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN FILTER.C
+
+
+/* support function for filterForward!
+* description: Replaces each element with difference from, or xor with, the
+* element before it. First element is kept.
+* param[in]: transform - FILTERDELTA or FILTERXOR.
+* param[in]: in - The elements.
+* param[out]: out - Array of atleast count * stride chars, not in.
+* param[in]: count - Number of elements.
+* param[in]: stride - Bytes per element, 1, 2, 4 or 8.
+*/
+void filterDeltaForward (int transform, const unsigned char *in,
+						 unsigned char *out, int64_t count, int stride);
+
+
+/* support function for filterInverse!
+* description: Undoes filterDeltaForward in place, a running sum or xor.
+* param[in]: transform - FILTERDELTA or FILTERXOR.
+* param[in]: data - The elements.
+* param[in]: count - Number of elements.
+* param[in]: stride - Bytes per element, 1, 2, 4 or 8.
+*/
+void filterDeltaInverse (int transform, unsigned char *data, int64_t count,
+						 int stride);
+
+
+/* support function for filterForward!
+* description: Splits elements into byte planes.
+* param[in]: in - The elements.
+* param[out]: out - Array of atleast count * stride chars, not in.
+* param[in]: count - Number of elements.
+* param[in]: stride - Bytes per element, 2, 4 or 8.
+*/
+void filterShuffle (const unsigned char *in, unsigned char *out,
+					int64_t count, int stride);
+
+
+/* support function for filterInverse!
+* description: Joins byte planes into elements.
+* param[in]: in - The byte planes.
+* param[out]: out - Array of atleast count * stride chars, not in.
+* param[in]: count - Number of elements.
+* param[in]: stride - Bytes per element, 2, 4 or 8.
+*/
+void filterUnshuffle (const unsigned char *in, unsigned char *out,
+					  int64_t count, int stride);
+
+
+/* support function for filterEncode!
+* description: Computes size of order-0 huffman code of chars.
+* param[in]: text - The chars.
+* param[in]: n - Number of chars.
+* return: Size in bits, code table included.
+*/
+int64_t filterCodeCost (const unsigned char *text, int64_t n);
+
+
+#endif //FILTER
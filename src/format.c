@@ -0,0 +1,164 @@
+/*
+* format: Header of an encoded file.
+*
+* Every encoded file starts with a header of FORMATHEADERSIZE bytes, see
+* format.h for the layout.
+*/
+
+#include <string.h>
+
+#include "format.h"
+
+
+/*
+* description: Writes header to stream.
+* param[in]: out - Stream to write to.
+* param[in]: mode - Mode of the payload.
+* param[in]: originalLength - Length of original file in bytes.
+* return: 1 if header was written, else 0.
+*/
+int formatWriteHeader (stream *out, int mode, uint64_t originalLength) {
+
+	unsigned char header[FORMATHEADERSIZE];
+
+	formatHeaderBytes(header, mode, originalLength);
+	return streamWrite(out, header, FORMATHEADERSIZE);
+}
+
+
+/*
+* description: Stores header as FORMATHEADERSIZE bytes.
+* param[out]: header - Pointer to atleast FORMATHEADERSIZE bytes.
+* param[in]: mode - Mode of the payload.
+* param[in]: originalLength - Length of original file in bytes.
+*/
+void formatHeaderBytes (unsigned char *header, int mode,
+						uint64_t originalLength) {
+
+	memset(header, 0, FORMATHEADERSIZE);
+	memcpy(header, FORMATMAGIC, 4);
+	header[4] = FORMATVERSION;
+	header[5] = (unsigned char)mode;
+	formatPutU64(&header[8], originalLength);
+}
+
+
+/*
+* description: Reads and validates header from stream.
+* param[in]: in - Stream to read from.
+* param[out]: mode - Mode of the payload.
+* param[out]: originalLength - Length of original file in bytes.
+* return: 1 if a valid header was read, else 0.
+*/
+int formatReadHeader (stream *in, int *mode, uint64_t *originalLength) {
+
+	unsigned char header[FORMATHEADERSIZE];
+
+	if (streamRead(in, header, FORMATHEADERSIZE) != FORMATHEADERSIZE) {
+
+		return 0;
+	}
+	return formatParseHeader(header, mode, originalLength);
+}
+
+
+/*
+* description: Validates header stored as FORMATHEADERSIZE bytes.
+* param[in]: header - Pointer to atleast FORMATHEADERSIZE bytes.
+* param[out]: mode - Mode of the payload.
+* param[out]: originalLength - Length of original file in bytes.
+* return: 1 if header is valid, else 0.
+*/
+int formatParseHeader (const unsigned char *header, int *mode,
+					   uint64_t *originalLength) {
+
+	if (memcmp(header, FORMATMAGIC, 4) != 0 || header[4] != FORMATVERSION) {
+
+		return 0;
+	}
+
+	*mode = header[5];
+	*originalLength = formatGetU64(&header[8]);
+	return 1;
+}
+
+
+/*
+* description: Stores 64 bit integer as 8 bytes, little endian.
+* param[in]: buf - Pointer to atleast 8 bytes.
+* param[in]: value - The integer.
+*/
+void formatPutU64 (unsigned char *buf, uint64_t value) {
+
+	for (int i = 0; i < 8; i++) {
+
+		buf[i] = (unsigned char)(value >> (8 * i));
+	}
+}
+
+
+/*
+* description: Loads 64 bit integer stored as 8 bytes, little endian.
+* param[in]: buf - Pointer to atleast 8 bytes.
+* return: The integer.
+*/
+uint64_t formatGetU64 (const unsigned char *buf) {
+
+	uint64_t value = 0;
+
+	for (int i = 7; i >= 0; i--) {
+
+		value = (value << 8) | buf[i];
+	}
+	return value;
+}
+
+
+/*
+* description: Stores 32 bit integer as 4 bytes, little endian.
+* param[in]: buf - Pointer to atleast 4 bytes.
+* param[in]: value - The integer.
+*/
+void formatPutU32 (unsigned char *buf, uint32_t value) {
+
+	for (int i = 0; i < 4; i++) {
+
+		buf[i] = (unsigned char)(value >> (8 * i));
+	}
+}
+
+
+/*
+* description: Loads 32 bit integer stored as 4 bytes, little endian.
+* param[in]: buf - Pointer to atleast 4 bytes.
+* return: The integer.
+*/
+uint32_t formatGetU32 (const unsigned char *buf) {
+
+	uint32_t value = 0;
+
+	for (int i = 3; i >= 0; i--) {
+
+		value = (value << 8) | buf[i];
+	}
+	return value;
+}
+
+
+/*
+* description: Checks that a length read from a header can be decoded from
+* a payload, so a corrupt length is caught before memory is allocated for
+* it.
+* param[in]: originalLength - Length in header.
+* param[in]: payloadSize - Number of bytes of payload.
+* param[in]: perByte - Most chars the mode decodes from a byte of payload.
+* return: 1 if length fits payload, else 0.
+*/
+int formatLengthFits (uint64_t originalLength, int64_t payloadSize,
+					  uint64_t perByte) {
+
+	//Bytes needed rounded up, without the product overflowing.
+	uint64_t needed = originalLength / perByte +
+					  (originalLength % perByte != 0);
+	return payloadSize >= 0 && needed <= (uint64_t)payloadSize;
+}
@@ -0,0 +1,140 @@
+/*
+* format: Header of an encoded file.
+*
+* Every encoded file starts with a header of FORMATHEADERSIZE bytes:
+*   0-3   magic "HUFZ"
+*   4     format version
+*   5     mode, how the payload after the header is encoded
+*   6-7   reserved, 0
+*   8-15  length of original file in bytes, 64 bit little endian
+*/
+
+#ifndef FORMAT
+#define FORMAT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "stream.h"
+
+#define FORMATMAGIC "HUFZ"
+#define FORMATVERSION 1
+#define FORMATHEADERSIZE 16
+
+//Payload is one bitstream coded with tree built from analysis file.
+#define FORMATMODESTATIC 0
+//Payload is order-1 code tables followed by codes, see order1.h.
+#define FORMATMODEORDER1 1
+//Payload is UTF-8 code points or 16 bit words, see symbol.h.
+#define FORMATMODEUTF8 2
+#define FORMATMODEWORD16 3
+//Payload is blocks coded with bwt, mtf, rle and huffman, see blocksort.h.
+#define FORMATMODEBLOCKSORT 4
+//Payload is blocks of lz77 tokens coded with huffman, see lz77.h.
+#define FORMATMODELZ77 5
+//Payload is blocks coded with tANS or huffman, see ans.h.
+#define FORMATMODEANS 6
+//Payload is filtered blocks of binary data, see filter.h.
+#define FORMATMODEFILTER 7
+//Payload is the original chars, see level.h.
+#define FORMATMODESTORED 8
+//Payload is coded with a one pass adaptive model, see adaptive.h.
+#define FORMATMODEADAPTIVE 9
+//Payload is self-contained frames ending with a marker, see frame.h.
+#define FORMATMODEFRAMED 10
+//Payload is static mode codes with checkpoints, see checkpoint.h.
+#define FORMATMODECHECKPOINT 11
+//Payload is one message coded with a trained table set, see dict.h.
+#define FORMATMODEDICT 12
+//Payload is blocks of codes given by a push encoder, see push.h.
+#define FORMATMODEPUSH 13
+
+
+/*
+* description: Writes header to stream.
+* param[in]: out - Stream to write to.
+* param[in]: mode - Mode of the payload.
+* param[in]: originalLength - Length of original file in bytes.
+* return: 1 if header was written, else 0.
+*/
+int formatWriteHeader (stream *out, int mode, uint64_t originalLength);
+
+
+/*
+* description: Stores header as FORMATHEADERSIZE bytes.
+* param[out]: header - Pointer to atleast FORMATHEADERSIZE bytes.
+* param[in]: mode - Mode of the payload.
+* param[in]: originalLength - Length of original file in bytes.
+*/
+void formatHeaderBytes (unsigned char *header, int mode,
+						uint64_t originalLength);
+
+
+/*
+* description: Reads and validates header from stream.
+* param[in]: in - Stream to read from.
+* param[out]: mode - Mode of the payload.
+* param[out]: originalLength - Length of original file in bytes.
+* return: 1 if a valid header was read, else 0.
+*/
+int formatReadHeader (stream *in, int *mode, uint64_t *originalLength);
+
+
+/*
+* description: Validates header stored as FORMATHEADERSIZE bytes.
+* param[in]: header - Pointer to atleast FORMATHEADERSIZE bytes.
+* param[out]: mode - Mode of the payload.
+* param[out]: originalLength - Length of original file in bytes.
+* return: 1 if header is valid, else 0.
+*/
+int formatParseHeader (const unsigned char *header, int *mode,
+					   uint64_t *originalLength);
+
+
+/*
+* description: Stores 64 bit integer as 8 bytes, little endian.
+* param[in]: buf - Pointer to atleast 8 bytes.
+* param[in]: value - The integer.
+*/
+void formatPutU64 (unsigned char *buf, uint64_t value);
+
+
+/*
+* description: Loads 64 bit integer stored as 8 bytes, little endian.
+* param[in]: buf - Pointer to atleast 8 bytes.
+* return: The integer.
+*/
+uint64_t formatGetU64 (const unsigned char *buf);
+
+
+/*
+* description: Stores 32 bit integer as 4 bytes, little endian.
+* param[in]: buf - Pointer to atleast 4 bytes.
+* param[in]: value - The integer.
+*/
+void formatPutU32 (unsigned char *buf, uint32_t value);
+
+
+/*
+* description: Loads 32 bit integer stored as 4 bytes, little endian.
+* param[in]: buf - Pointer to atleast 4 bytes.
+* return: The integer.
+*/
+uint32_t formatGetU32 (const unsigned char *buf);
+
+
+/*
+* description: Checks that a length read from a header can be decoded from
+* a payload, so a corrupt length is caught before memory is allocated for
+* it.
+* param[in]: originalLength - Length in header.
+* param[in]: payloadSize - Number of bytes of payload.
+* param[in]: perByte - Most chars the mode decodes from a byte of payload.
+* return: 1 if length fits payload, else 0.
+*/
+int formatLengthFits (uint64_t originalLength, int64_t payloadSize,
+					  uint64_t perByte);
+
+
+#endif //FORMAT
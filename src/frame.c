@@ -0,0 +1,461 @@
+/*
+* frame: Framed stream format. See frame.h for the layout.
+*/
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "frame.h"
+#include "format.h"
+#include "encode.h"
+#include "canonical.h"
+
+
+/*
+* description: Reads file a frame at a time and writes framed stream.
+* Reading, coding and writing of frames overlap, see pipeline.h.
+* param[in]: file1 - Name of file to be read and encoded, "-" for stdin.
+* param[in]: file2 - Name of file to be written, "-" for stdout.
+* param[in]: level - LEVELMIN to LEVELMAX, or LEVELAUTO to pick by sampling
+* the first frame.
+* param[in]: target - Target used by LEVELAUTO, see levelPick.
+* param[in]: config - Pipeline options.
+* return: 1 if file2 was written, else 0.
+*/
+int frameEncodeFile (char const *file1, char const *file2, int level,
+					 const levelTarget *target, const pipelineConfig *config) {
+
+	frameState state;
+
+	state.in = streamOpen(file1, 0, &config -> io);
+	state.out = streamOpen(file2, 1, &config -> io);
+	state.level = level;
+	state.target = target;
+	state.tree = NULL;
+	state.log = strcmp(file2, "-") == 0 ? stderr : stdout;
+	state.originalLength = 0;
+
+	int valid = formatWriteHeader(state.out, FORMATMODEFRAMED, 0) &&
+				frameEncodeStream(&state, config);
+
+	valid = streamClose(state.out) && valid;
+	if (!valid) {
+
+		fprintf(stderr, "Could not write %s\n", file2);
+	}
+	if (!streamClose(state.in)) {
+
+		fprintf(stderr, "Could not read %s\n", file1);
+		valid = 0;
+	}
+	return valid;
+}
+
+
+/*
+* description: Reads file a frame at a time and appends the frames to a
+* framed file, or writes a new one if file2 does not exist or is empty.
+* param[in]: file1 - Name of file to be read and encoded, "-" for stdin.
+* param[in]: file2 - Name of framed file to append to.
+* param[in]: level - LEVELMIN to LEVELMAX, or LEVELAUTO to pick by sampling
+* the first frame.
+* param[in]: target - Target used by LEVELAUTO, see levelPick.
+* param[in]: tree - Tree of file0, reused by frames it codes well.
+* param[in]: config - Pipeline options.
+* return: 1 if frames were appended, else 0.
+*/
+int frameAppendFile (char const *file1, char const *file2, int level,
+					 const levelTarget *target, huffTree *tree,
+					 const pipelineConfig *config) {
+
+	frameState state;
+	int64_t offset = 0;
+
+	if (!frameFindMarker(file2, &offset, &state.originalLength)) {
+
+		fprintf(stderr, "%s is not a framed file\n", file2);
+		return 0;
+	}
+
+	state.in = streamOpen(file1, 0, &config -> io);
+	if (state.in == NULL) {
+
+		fprintf(stderr, "Could not read %s\n", file1);
+		return 0;
+	}
+	//Only the marker is written over, frames before it are not read.
+	state.out = streamOpenAt(file2, offset);
+	if (state.out == NULL) {
+
+		fprintf(stderr, "Could not write %s\n", file2);
+		streamClose(state.in);
+		return 0;
+	}
+	state.level = level;
+	state.target = target;
+	state.tree = tree;
+	state.log = stdout;
+
+	int valid = 1;
+	if (offset == 0) {
+
+		valid = formatWriteHeader(state.out, FORMATMODEFRAMED, 0);
+	}
+	valid = valid && frameEncodeStream(&state, config);
+
+	valid = streamClose(state.out) && valid;
+	if (!valid) {
+
+		fprintf(stderr, "Could not write %s\n", file2);
+	}
+	if (!streamClose(state.in)) {
+
+		fprintf(stderr, "Could not read %s\n", file1);
+		valid = 0;
+	}
+	return valid;
+}
+
+
+/*
+* description: Decodes frames and writes decoded file as each frame is done.
+* Reading, decoding and writing of frames overlap, see pipeline.h.
+* param[in]: in - Encoded stream, positioned after file header.
+* param[in]: file2 - Name of file to write decode, "-" for stdout.
+* param[in]: config - Pipeline options.
+* return: 1 if all frames and end of stream marker could be read, else 0.
+*/
+int frameDecodeStream (stream *in, char const *file2, huffTree *tree,
+					   const pipelineConfig *config) {
+
+	frameState state;
+
+	state.in = in;
+	state.tree = tree;
+	state.out = streamOpen(file2, 1, &config -> io);
+	state.originalLength = 0;
+
+	pipeline *p = pipelineEmpty(frameReadBlock, frameDecodeBlock,
+								frameWritePlain, &state, FRAMESIZE,
+								FRAMESIZE, config -> workers);
+	int valid = pipelineRun(p);
+
+	if (config -> stats) {
+
+		pipelinePrintStats(p, stderr);
+		fprintf(stderr, "io     %s in, %s out\n", streamBackendName(in),
+				streamBackendName(state.out));
+	}
+	valid = streamClose(state.out) && valid;
+	pipelineKill(p);
+	return valid;
+}
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN FRAME.C
+
+
+/* support function for frameEncodeFile and frameAppendFile!
+* description: Runs encoding pipeline and writes end of stream marker. The
+* marker is not written if a stage fails, so a cut stream is not mistaken
+* for a whole one.
+* param[in]: state - The frameState, streams are open and file header is
+* written.
+* param[in]: config - Pipeline options.
+* return: 1 if all frames and the marker were written, else 0.
+*/
+int frameEncodeStream (frameState *state, const pipelineConfig *config) {
+
+	unsigned char marker[FRAMEMARKERSIZE];
+
+	pipeline *p = pipelineEmpty(frameReadPlain, frameEncodeBlock,
+								frameWriteBlock, state, FRAMESIZE,
+								FRAMEHEADERSIZE + FRAMESIZE, config -> workers);
+
+	int valid = pipelineRun(p);
+	if (valid) {
+
+		formatPutU32(marker, 0);
+		formatPutU64(&marker[4], state -> originalLength);
+		valid = streamWrite(state -> out, marker, FRAMEMARKERSIZE);
+	}
+
+	if (config -> stats) {
+
+		pipelinePrintStats(p, stderr);
+		fprintf(stderr, "io     %s in, %s out\n",
+				streamBackendName(state -> in),
+				streamBackendName(state -> out));
+	}
+	pipelineKill(p);
+	return valid;
+}
+
+
+/* support function for frameAppendFile!
+* description: Finds end of stream marker of framed file.
+* param[in]: file2 - Name of framed file.
+* param[out]: offset - Offset of marker, 0 if file is empty or missing.
+* param[out]: total - Number of chars in all frames.
+* return: 1 if file2 is empty, missing or ends with a marker, else 0.
+*/
+int frameFindMarker (char const *file2, int64_t *offset, uint64_t *total) {
+
+	unsigned char header[FORMATHEADERSIZE];
+	unsigned char marker[FRAMEMARKERSIZE];
+	struct stat info;
+	int fd = open(file2, O_RDONLY);
+
+	*offset = 0;
+	*total = 0;
+	if (fd < 0) {
+
+		return 1;
+	}
+	if (fstat(fd, &info) != 0) {
+
+		close(fd);
+		return 0;
+	}
+	if (info.st_size == 0) {
+
+		close(fd);
+		return 1;
+	}
+
+	//Marker is the last chars of a framed file, so only they are read.
+	int valid = info.st_size >= FORMATHEADERSIZE + FRAMEMARKERSIZE &&
+				streamPreadFd(fd, header, FORMATHEADERSIZE, 0) ==
+				FORMATHEADERSIZE &&
+				streamPreadFd(fd, marker, FRAMEMARKERSIZE,
+							  info.st_size - FRAMEMARKERSIZE) ==
+				FRAMEMARKERSIZE &&
+				memcmp(header, FORMATMAGIC, 4) == 0 &&
+				header[4] == FORMATVERSION && header[5] == FORMATMODEFRAMED &&
+				formatGetU32(marker) == 0;
+	close(fd);
+
+	*offset = info.st_size - FRAMEMARKERSIZE;
+	*total = formatGetU64(&marker[4]);
+	return valid;
+}
+
+
+/* support function for frameEncodeBlock!
+* description: Estimates if table of tree codes chars about as well as an
+* own table, from their counts.
+* param[in]: tree - Tree of file0.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* return: 1 if table of tree costs atmost FRAMEREUSEPERCENT percent more,
+* else 0.
+*/
+int frameReuseTable (huffTree *tree, const unsigned char *text,
+					 int64_t length) {
+
+	uint64_t counts[256];
+	uint8_t lengths[256];
+	uint64_t shared = 0;
+	uint64_t own = 0;
+
+	memset(counts, 0, sizeof(counts));
+	for (int64_t i = 0; i < length; i++) {
+
+		counts[text[i]]++;
+	}
+	canonicalCodeLengths(counts, 256, HUFFMAXCODELEN, lengths);
+
+	//Chars without a code in tree can not be coded by it at all.
+	for (int c = 0; c < 256; c++) {
+
+		if (counts[c] > 0 && tree -> codeTable[c].len == 0) {
+
+			return 0;
+		}
+		shared = shared + counts[c] * tree -> codeTable[c].len;
+		own = own + counts[c] * lengths[c];
+	}
+	own = own + canonicalLengthsCost(lengths, 256);
+	return shared * 100 <= own * (100 + FRAMEREUSEPERCENT);
+}
+
+
+/* support function for frameEncodeFile!
+* description: Reading stage, reads chars of next frame. Picks level from
+* first frame if it is LEVELAUTO.
+* param[in]: state - The frameState.
+* param[in]: block - Block to fill.
+* return: 1 if chars or end of input were read, 0 on read error.
+*/
+int frameReadPlain (void *state, pipelineBlock *block) {
+
+	frameState *fs = state;
+
+	block -> inLength = streamRead(fs -> in, block -> in, FRAMESIZE);
+	block -> last = block -> inLength == 0;
+
+	//Picked before any frame is coded, as frames may be coded at once.
+	if (fs -> level == LEVELAUTO && !block -> last) {
+
+		fs -> level = levelPick(block -> in, block -> inLength, fs -> target);
+		fprintf(fs -> log, "Picked level %d\n", fs -> level);
+	}
+	return !fs -> in -> error;
+}
+
+
+/* support function for frameEncodeFile!
+* description: Coding stage, encodes chars of block into a whole frame with
+* frame header.
+* param[in]: state - The frameState.
+* param[in]: block - Block with chars.
+* return: 1.
+*/
+int frameEncodeBlock (void *state, pipelineBlock *block) {
+
+	frameState *fs = state;
+	int64_t length = block -> inLength;
+
+	bitString *bs = bitStringEmpty();
+	int mode = FORMATMODESTATIC;
+	if (fs -> tree != NULL && frameReuseTable(fs -> tree, block -> in, length)) {
+
+		encodeBuffer(bs, block -> in, length, fs -> tree -> codeTable);
+	} else {
+
+		mode = levelEncode(bs, block -> in, length, fs -> level);
+	}
+	const unsigned char *payload = bitStringGetEncode(bs);
+	int64_t size = bitStringGetSize(bs);
+
+	//Bounding payload by frame length lets decoder reject sizes up front.
+	if (size >= length) {
+
+		mode = FORMATMODESTORED;
+		payload = block -> in;
+		size = length;
+	}
+
+	formatPutU32(block -> out, (uint32_t)length);
+	formatPutU32(&block -> out[4], (uint32_t)size);
+	block -> out[8] = (unsigned char)mode;
+	memcpy(&block -> out[FRAMEHEADERSIZE], payload, size);
+	block -> outLength = FRAMEHEADERSIZE + size;
+
+	bitStringKill(bs);
+	return 1;
+}
+
+
+/* support function for frameEncodeFile!
+* description: Writing stage, writes frame of block.
+* param[in]: state - The frameState.
+* param[in]: block - Block with frame.
+* return: 1 if frame was written, else 0.
+*/
+int frameWriteBlock (void *state, pipelineBlock *block) {
+
+	frameState *fs = state;
+
+	fs -> originalLength = fs -> originalLength + block -> inLength;
+	return streamWrite(fs -> out, block -> out, block -> outLength);
+}
+
+
+/* support function for frameDecodeStream!
+* description: Reading stage, reads header and payload of next frame, or the
+* end of stream marker.
+* param[in]: state - The frameState.
+* param[in]: block - Block to fill.
+* return: 1 if a valid frame or marker was read, else 0.
+*/
+int frameReadBlock (void *state, pipelineBlock *block) {
+
+	frameState *fs = state;
+	unsigned char header[FRAMEHEADERSIZE];
+
+	//End of stream marker is a frame of 0 chars followed by the total.
+	if (streamRead(fs -> in, header, 4) != 4) {
+
+		return 0;
+	}
+	block -> length = formatGetU32(header);
+	if (block -> length == 0) {
+
+		unsigned char total[8];
+		block -> last = 1;
+		return streamRead(fs -> in, total, 8) == 8 &&
+			   formatGetU64(total) == fs -> originalLength;
+	}
+
+	if (streamRead(fs -> in, &header[4], FRAMEHEADERSIZE - 4) !=
+		FRAMEHEADERSIZE - 4) {
+
+		return 0;
+	}
+	block -> inLength = formatGetU32(&header[4]);
+	block -> mode = header[8];
+	fs -> originalLength = fs -> originalLength + block -> length;
+
+	return block -> length <= FRAMESIZE && block -> inLength <= block -> length &&
+		   streamRead(fs -> in, block -> in, block -> inLength) ==
+		   block -> inLength;
+}
+
+
+/* support function for frameDecodeStream!
+* description: Coding stage, decodes payload of block.
+* param[in]: state - The frameState.
+* param[in]: block - Block with payload.
+* return: 1 if payload could be decoded, else 0.
+*/
+int frameDecodeBlock (void *state, pipelineBlock *block) {
+
+	frameState *fs = state;
+
+	block -> outLength = block -> length;
+	if (block -> mode == FORMATMODESTORED) {
+
+		memcpy(block -> out, block -> in, block -> length);
+		return block -> inLength == block -> length;
+	}
+
+	bitString *bs = bitStringEmpty();
+	int64_t bitPos = 0;
+	int valid = 1;
+
+	bitStringAddBytes(bs, block -> in, block -> inLength);
+	if (block -> mode == FORMATMODESTATIC) {
+
+		for (int64_t i = 0; i < block -> length && valid; i++) {
+
+			int key = fs -> tree == NULL ? -1 :
+					  huffTreeDecodeKey(fs -> tree, bs, &bitPos,
+										block -> inLength * 8);
+			block -> out[i] = (unsigned char)key;
+			valid = key >= 0;
+		}
+	} else {
+
+		valid = levelDecode(bs, &bitPos, block -> mode, block -> out,
+							block -> length);
+	}
+	bitStringKill(bs);
+	return valid;
+}
+
+
+/* support function for frameDecodeStream!
+* description: Writing stage, writes decoded chars of block.
+* param[in]: state - The frameState.
+* param[in]: block - Block with chars.
+* return: 1 if chars were written, else 0.
+*/
+int frameWritePlain (void *state, pipelineBlock *block) {
+
+	frameState *fs = state;
+
+	return streamWrite(fs -> out, block -> out, block -> outLength);
+}
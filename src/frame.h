@@ -0,0 +1,198 @@
+/*
+* frame: Framed stream format, used when input or output is a pipe. Input is
+* read FRAMESIZE chars at a time and each frame is coded on its own by the
+* engine of a level, with its own tables, so a frame is written as soon as it
+* is coded and the decoder only holds the few frames in its pipeline. Length
+* in file header is 0, as it is not known when the header is written.
+*
+* Payload after file header, for each frame:
+*   4 bytes   number of chars in frame, 1 to FRAMESIZE
+*   4 bytes   number of payload bytes in frame, atmost number of chars
+*   1 byte    mode of frame payload, see format.h
+*   payload bytes, coded by levelEncode
+* and after the last frame:
+*   4 bytes   0, end of stream marker
+*   8 bytes   number of chars in all frames
+* Integers are little endian. A frame that does not get smaller is stored.
+*
+* Frames can be appended to a framed file without reading its frames. The
+* end of stream marker is written over by the new frames and a new marker.
+* Appended frames are coded with the table of file0, in mode
+* FORMATMODESTATIC, when that costs atmost FRAMEREUSEPERCENT percent more
+* than an own order-0 table of the frame, as estimated from its char counts.
+* Such frames need the same file0 to be decoded.
+*/
+
+#ifndef FRAME
+#define FRAME
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "bitString.h"
+#include "stream.h"
+#include "level.h"
+#include "pipeline.h"
+#include "huffTree.h"
+
+#define FRAMESIZE (1 << 20)
+#define FRAMEHEADERSIZE 9
+#define FRAMEDEFAULTLEVEL 4
+#define FRAMEMARKERSIZE 12
+#define FRAMEREUSEPERCENT 5
+
+
+typedef struct frameState {
+
+	stream *in;
+	stream *out;
+	int level;
+	const levelTarget *target;
+	huffTree *tree;
+	FILE *log;
+	uint64_t originalLength;
+} frameState;
+
+
+/*
+* description: Reads file a frame at a time and writes framed stream.
+* Reading, coding and writing of frames overlap, see pipeline.h.
+* param[in]: file1 - Name of file to be read and encoded, "-" for stdin.
+* param[in]: file2 - Name of file to be written, "-" for stdout.
+* param[in]: level - LEVELMIN to LEVELMAX, or LEVELAUTO to pick by sampling
+* the first frame.
+* param[in]: target - Target used by LEVELAUTO, see levelPick.
+* param[in]: config - Pipeline options.
+* return: 1 if file2 was written, else 0.
+*/
+int frameEncodeFile (char const *file1, char const *file2, int level,
+					 const levelTarget *target, const pipelineConfig *config);
+
+
+/*
+* description: Reads file a frame at a time and appends the frames to a
+* framed file, or writes a new one if file2 does not exist or is empty.
+* param[in]: file1 - Name of file to be read and encoded, "-" for stdin.
+* param[in]: file2 - Name of framed file to append to.
+* param[in]: level - LEVELMIN to LEVELMAX, or LEVELAUTO to pick by sampling
+* the first frame.
+* param[in]: target - Target used by LEVELAUTO, see levelPick.
+* param[in]: tree - Tree of file0, reused by frames it codes well.
+* param[in]: config - Pipeline options.
+* return: 1 if frames were appended, else 0.
+*/
+int frameAppendFile (char const *file1, char const *file2, int level,
+					 const levelTarget *target, huffTree *tree,
+					 const pipelineConfig *config);
+
+
+/*
+* description: Decodes frames and writes decoded file as each frame is done.
+* Reading, decoding and writing of frames overlap, see pipeline.h.
+* param[in]: in - Encoded stream, positioned after file header.
+* param[in]: file2 - Name of file to write decode, "-" for stdout.
+* param[in]: tree - Tree of file0, decoding frames in static mode.
+* param[in]: config - Pipeline options.
+* return: 1 if all frames and end of stream marker could be read, else 0.
+*/
+int frameDecodeStream (stream *in, char const *file2, huffTree *tree,
+					   const pipelineConfig *config);
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN FRAME.C
+
+
+/* support function for frameEncodeFile and frameAppendFile!
+* description: Runs encoding pipeline and writes end of stream marker. The
+* marker is not written if a stage fails, so a cut stream is not mistaken
+* for a whole one.
+* param[in]: state - The frameState, streams are open and file header is
+* written.
+* param[in]: config - Pipeline options.
+* return: 1 if all frames and the marker were written, else 0.
+*/
+int frameEncodeStream (frameState *state, const pipelineConfig *config);
+
+
+/* support function for frameAppendFile!
+* description: Finds end of stream marker of framed file.
+* param[in]: file2 - Name of framed file.
+* param[out]: offset - Offset of marker, 0 if file is empty or missing.
+* param[out]: total - Number of chars in all frames.
+* return: 1 if file2 is empty, missing or ends with a marker, else 0.
+*/
+int frameFindMarker (char const *file2, int64_t *offset, uint64_t *total);
+
+
+/* support function for frameEncodeBlock!
+* description: Estimates if table of tree codes chars about as well as an
+* own table, from their counts.
+* param[in]: tree - Tree of file0.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* return: 1 if table of tree costs atmost FRAMEREUSEPERCENT percent more,
+* else 0.
+*/
+int frameReuseTable (huffTree *tree, const unsigned char *text,
+					 int64_t length);
+
+
+/* support function for frameEncodeFile!
+* description: Reading stage, reads chars of next frame. Picks level from
+* first frame if it is LEVELAUTO.
+* param[in]: state - The frameState.
+* param[in]: block - Block to fill.
+* return: 1 if chars or end of input were read, 0 on read error.
+*/
+int frameReadPlain (void *state, pipelineBlock *block);
+
+
+/* support function for frameEncodeFile!
+* description: Coding stage, encodes chars of block into a whole frame with
+* frame header.
+* param[in]: state - The frameState.
+* param[in]: block - Block with chars.
+* return: 1.
+*/
+int frameEncodeBlock (void *state, pipelineBlock *block);
+
+
+/* support function for frameEncodeFile!
+* description: Writing stage, writes frame of block.
+* param[in]: state - The frameState.
+* param[in]: block - Block with frame.
+* return: 1 if frame was written, else 0.
+*/
+int frameWriteBlock (void *state, pipelineBlock *block);
+
+
+/* support function for frameDecodeStream!
+* description: Reading stage, reads header and payload of next frame, or the
+* end of stream marker.
+* param[in]: state - The frameState.
+* param[in]: block - Block to fill.
+* return: 1 if a valid frame or marker was read, else 0.
+*/
+int frameReadBlock (void *state, pipelineBlock *block);
+
+
+/* support function for frameDecodeStream!
+* description: Coding stage, decodes payload of block.
+* param[in]: state - The frameState.
+* param[in]: block - Block with payload.
+* return: 1 if payload could be decoded, else 0.
+*/
+int frameDecodeBlock (void *state, pipelineBlock *block);
+
+
+/* support function for frameDecodeStream!
+* description: Writing stage, writes decoded chars of block.
+* param[in]: state - The frameState.
+* param[in]: block - Block with chars.
+* return: 1 if chars were written, else 0.
+*/
+int frameWritePlain (void *state, pipelineBlock *block);
+
+
+#endif //FRAME
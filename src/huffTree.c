@@ -12,16 +12,28 @@
 #include "huffTree.h"
 
 
+/* support struct for huffTreeTraverse!
+* description: Stack entry used while traversing tree iterativly.
+*/
+typedef struct nodeTraverseEntry {
+
+	treeNode *node;
+	uint32_t code;
+	int len;
+} nodeTraverseEntry;
+
+
 /*
 * description: Creates empty huffTree. Allocates memory for huffTree.
 * param[in]: root - The treeNode that is the root of huffTree.
-* param[in]: size - amount of characthers huffman table should include.
+* param[in]: size - amount of keys huffman table should include. Keys are
+* 0 to size - 1, leafs with key -1 are padding and get no code.
 * return: empty huffTree.
 */
 huffTree *huffTreeEmpty (treeNode *root, int size) {
 
 	huffTree *tree = malloc(sizeof(huffTree));
-	tree -> huffTable = malloc(sizeof(char*) * size);
+	tree -> codeTable = calloc(size, sizeof(huffCode));
 	tree -> size = size;
 	tree -> root = root;
 
@@ -41,21 +53,13 @@ int huffTreeIsEmpty (huffTree *tree) {
 
 
 /*
-* description: Deallocates all memory that huffTable has allocated. This
-* includes all nodes, strings in huffTable, huffTable, huffTree.
+* description: Deallocates all memory that huffTree has allocated. This
+* includes all nodes, the code table and huffTree.
 * param[in]: tree - huffTree to be freed.
 */
 void huffTreeKill (huffTree *tree) {
 
-	for (int i = 0; i < tree -> size; i++) {
-
-		if (tree -> huffTable[i] != NULL) {
-
-			free(tree -> huffTable[i]);
-		}
-	}
-
-	free(tree -> huffTable);
+	free(tree -> codeTable);
 
 	if (tree -> root != NULL) {
 
@@ -77,41 +81,140 @@ treeNode *huffTreeGetRoot (huffTree *tree) {
 
 
 /*
-* description: Builds huffman table from huffTree by traversing tree and
-* collecting pathways. Traversion is dont postorder by depth.
+* description: Builds huffman code table from huffTree by traversing tree
+* iterativly and packing the pathway to each leaf into a huffCode.
 * param[in]: tree - the huffTree.
+* return: 1 if all codes fit in HUFFMAXCODELEN bits, else 0.
 */
-void huffTreeTraverse (huffTree *tree) {
+int huffTreeTraverse (huffTree *tree) {
 
-	int level = 0;
-	char path[tree -> size];
+	int fits = 1;
 
-	if (tree -> root != NULL) {
-		if (tree -> root -> left != NULL) {
+	if (tree -> root == NULL) {
 
-			path[level] = '\0';
-			nodeTraverse (tree, tree -> root -> left, level, path, '0');
-		}
+		return fits;
+	}
 
-		if (tree -> root -> right != NULL) {
+	//At most one pending sibling per level, depth is capped by the len check.
+	nodeTraverseEntry stack[HUFFMAXCODELEN + 2];
+	int top = 0;
 
-			path[level] = '\0';
-			nodeTraverse (tree, tree -> root -> right, level, path, '1');
+	stack[top].node = tree -> root;
+	stack[top].code = 0;
+	stack[top].len = 0;
+	top++;
+
+	while (top > 0) {
+
+		top--;
+		treeNode *node = stack[top].node;
+		uint32_t code = stack[top].code;
+		int len = stack[top].len;
+
+		if (nodeIsLeaf(node)) {
+
+			if (node -> key >= 0) {
+
+				tree -> codeTable[node -> key].code = code;
+				tree -> codeTable[node -> key].len = (uint8_t)len;
+			}
+		} else if (len >= HUFFMAXCODELEN) {
+
+			fits = 0;
+		} else {
+
+			//Right is pushed first so left is visited first.
+			if (node -> right != NULL) {
+
+				stack[top].node = node -> right;
+				stack[top].code = (code << 1) | 1;
+				stack[top].len = len + 1;
+				top++;
+			}
+
+			if (node -> left != NULL) {
+
+				stack[top].node = node -> left;
+				stack[top].code = code << 1;
+				stack[top].len = len + 1;
+				top++;
+			}
 		}
 	}
+
+	return fits;
 }
 
 
 /*
-* description: Gets pathway to node in huffTre containing specific key.
+* description: Gets packed code of key in huffTree.
 * param[in]: tree -The huffTree.
 * param[in]: key - The key.
-* return: Pointer to allocated pathway. Pathway is array of chars, each char
-* being 0 or 1. Last char is always '\0'
+* return: The huffCode of the key. len is 0 if key is not in tree.
+*/
+huffCode huffTreeGetCode (huffTree *tree, int key) {
+
+	return tree -> codeTable[key];
+}
+
+
+/*
+* description: Decodes one key by walking tree from root along bits of
+* bitString, without reading past the first nrOfBits bits.
+* param[in]: tree - The huffTree.
+* param[in]: bs - The bitString.
+* param[in,out]: bitPos - Position of next bit to read, moved past the code.
+* param[in]: nrOfBits - Number of bits in bitString that may be read.
+* return: The key, -1 if code runs past the bits.
+*/
+int huffTreeDecodeKey (huffTree *tree, bitString *bs, int64_t *bitPos,
+					   int64_t nrOfBits) {
+
+	treeNode *node = tree -> root;
+
+	while (!nodeIsLeaf(node)) {
+
+		if (*bitPos >= nrOfBits) {
+
+			return -1;
+		}
+		if (bitStringGetBit(bs, *bitPos) == 0) {
+
+			node = nodeGetLeftChild(node);
+		} else {
+
+			node = nodeGetRightChild(node);
+		}
+		(*bitPos)++;
+	}
+	return nodeGetKey(node);
+}
+
+
+/*
+* description: Debug dump of code table. Prints every key in tree along with
+* it's pathway as a string of 0 and 1's.
+* param[in]: tree - The huffTree.
+* param[in]: fp - Stream to print to.
 */
-char *huffTreeGetKeyPath (huffTree *tree, int key) {
+void huffTreePrintTable (huffTree *tree, FILE *fp) {
+
+	char path[HUFFMAXCODELEN + 1];
+
+	for (int key = 0; key < tree -> size; key++) {
+
+		huffCode hc = tree -> codeTable[key];
 
-	return tree -> huffTable[key];
+		if (hc.len > 0) {
+
+			for (int i = 0; i < hc.len; i++) {
+
+				path[i] = (hc.code >> (hc.len - 1 - i)) & 1 ? '1' : '0';
+			}
+			path[hc.len] = '\0';
+			fprintf(fp, "%3d: %2d %s\n", key, hc.len, path);
+		}
+	}
 }
 
 
@@ -121,7 +224,7 @@ char *huffTreeGetKeyPath (huffTree *tree, int key) {
 * param[in]: key - Key of the leaf.
 * return: - Pointer to allocated leaf.
 */
-treeNode *nodeNewLeaf (int weight, unsigned char key) {
+treeNode *nodeNewLeaf (uint64_t weight, int key) {
 
 
 	treeNode *leaf = malloc(sizeof(treeNode));
@@ -135,14 +238,14 @@ treeNode *nodeNewLeaf (int weight, unsigned char key) {
 
 /*
 * description: Adds to nodes into new node. Weight of node will be the
-* combined weight of both nodes. Key of node will be '\0' (ignored).
+* combined weight of both nodes. Key of node will be -1 (ignored).
 * param[in]: node1 - First node, will become left child.
 * param[in]: node2 - Second node, will become right child.
 * return: Pointer to allocated new node.
 */
 treeNode *nodeNewNode (treeNode *node1, treeNode *node2) {
 
-	treeNode *newNode = nodeNewLeaf(node1 -> weight + node2 -> weight, '\0');
+	treeNode *newNode = nodeNewLeaf(node1 -> weight + node2 -> weight, -1);
 	newNode -> left = node1;
 	newNode -> right = node2;
 
@@ -155,7 +258,7 @@ treeNode *nodeNewNode (treeNode *node1, treeNode *node2) {
 * param[in]: node - The node.
 * return: The key.
 */
-unsigned char nodeGetKey (treeNode *node) {
+int nodeGetKey (treeNode *node) {
 
 	return node -> key;
 }
@@ -168,11 +271,7 @@ unsigned char nodeGetKey (treeNode *node) {
 */
 int nodeIsLeaf (treeNode *node) {
 
-	if (node -> key != '\0') {
-
-		return 1;
-	}
-	return 0;
+	return node -> left == NULL && node -> right == NULL;
 }
 
 
@@ -220,72 +319,139 @@ treeNode *nodeGetRightChild (treeNode *node) {
 }
 
 
-//SUPPORT FUNCTIONS FOR USE ONLY IN HUFFTREE.C
+/*
+* description: Enqueues pqueue with results of freq. analysis. Allocates
+* memory for pqueue.
+* param[in]: *freqTable - Pointer to allocated array containing freq. results.
+* param[in]: size - Number of keys in freqTable (alphabet size).
+* return: pqueue filled with weighted nodes. Lesser weight is heigher prio.
+*/
+pqueue *fillPqueue (uint64_t *freqTable, int size) {
+
+	treeNode *tempNode;
+	pqueue *pq = pqueue_empty(key_compare);
+	for (int i = 0; i < size; i++) {
+
+		tempNode = nodeNewLeaf(freqTable[i], i);
+		pqueue_insert(pq, tempNode);
+	}
+
+	return pq;
+}
 
 
-/* support function for huffTreeTraverse!
-* description: Traverses through one roots nodes recursivly. Sends back path
-* for all leafs it visit to the huffTree function traverses through.
-* param[in]: tree - The huffTree being traversed.
-* param[in]: subRoot - Child of root to be traversed through. Child becomes
-* new root in next recursive function call.
-* param[in]: level - Current level of depth in huffTree that node is located
-* on.
-* param[in]: path - Current path in huffTree to reach node.
-* param[in]: newPath - The path it takes from subRoot to child. If child is
-* left, subRoot is 0, else 1.
+/*
+* description: Builds huffman tree with result of freq. analysis stored in
+* pqueue. Allocates memory for huffTree.
+* param[in]: *pq - pqueue filled with weighted nodes.
+* param[in]: size - Number of keys in huffman table (alphabet size).
+* return: Weighted huffTree.
 */
-void nodeTraverse (huffTree *tree, treeNode *subRoot, int level,
-				   char *path, char newPath) {
+huffTree *fillhuffTree (pqueue* pq, int size) {
 
-	path[level] = newPath;
-	level++;
+	huffTree *tree = NULL;
 
-	if (subRoot -> key != '\0') {
+	while (!pqueue_is_empty(pq)) {
 
-		path[level] = '\0';
-		huffTreeAddBitPath(tree, (int)subRoot -> key, path);
-	}
+		treeNode *tempNode1;
+		treeNode *tempNode2;
+		treeNode *newNode;
 
-	if (subRoot -> left != NULL) {
+		tempNode1 = pqueue_inspect_first(pq);
+		pqueue_delete_first(pq);
 
-		nodeTraverse(tree, subRoot -> left, level, path, '0');
-	}
+		if (!pqueue_is_empty(pq)) {
 
-	if (subRoot -> right != NULL) {
+			tempNode2 = pqueue_inspect_first(pq);
+			pqueue_delete_first(pq);
+		} else {
 
-		nodeTraverse(tree, subRoot -> right, level, path, '1');
+			tempNode2 = nodeNewLeaf(0, -1);
+		}
+		newNode = nodeNewNode(tempNode1, tempNode2);
+
+		if (!pqueue_is_empty(pq)) {
+
+			pqueue_insert(pq, newNode);
+		} else {
+
+			tree = huffTreeEmpty(newNode, size);
+		}
 	}
+	return tree;
 }
 
 
-/* support function for nodeTraverse!
-* description: Adds pathway huffman table (in huffTree) for a key.
-* param[in]: tree - The huffTree.
-* param[in]: key - The key.
-* param[in]: path - Pathway to the key. Note: pathway is allocated in stack
-* and not heap.
+/*
+* description: Help funtion for pqueue to compare to elements. Each element is
+* a node. Node with lesser weight has higher prio.
+* param[in]: nodeIn1 - Void pointer to first element in pqueue.
+* param[in]: nodeIn2 - Void pointer to second element in pqueue.
+* return: 0 if both nodes have same prio, 1 if nodeIn1 has higher prio, else -1
 */
-void huffTreeAddBitPath (huffTree *tree, int key, char *path) {
+int key_compare (void *nodeIn1, void *nodeIn2) {
+
+	treeNode *node1 = nodeIn1;
+	treeNode *node2 = nodeIn2;
+
+	int largest = 0;
+
+	if (node1 -> weight > node2 -> weight) {
 
-	int size = 0;
+		largest = 1;
 
-	while (size < 256 && path[size] != '\0') {
+	} else if (node2 -> weight > node1 -> weight) {
 
-		size++;
+		largest = -1;
 	}
-	size++;
 
-	char *pos = malloc(sizeof(char) * size);
+	return largest;
+}
+
+
+/*
+* description: Computes code lengths by building a huffTree of only the keys
+* that have weight. If only one key has weight it gets length 1.
+* param[in]: freqTable - Weight of each key.
+* param[in]: size - Number of keys.
+* param[out]: lengths - Array of size keys to store code lengths in.
+* return: 1 if all codes fit in HUFFMAXCODELEN bits, else 0.
+*/
+int huffTreeCodeLengths (const uint64_t *freqTable, int size,
+						 uint8_t *lengths) {
+
+	pqueue *pq = pqueue_empty(key_compare);
+	int fits = 1;
 
 	for (int i = 0; i < size; i++) {
 
-		pos[i] = path[i];
+		lengths[i] = 0;
+		if (freqTable[i] > 0) {
+
+			pqueue_insert(pq, nodeNewLeaf(freqTable[i], i));
+		}
+	}
+
+	if (!pqueue_is_empty(pq)) {
+
+		huffTree *tree = fillhuffTree(pq, size);
+
+		fits = huffTreeTraverse(tree);
+		for (int i = 0; i < size; i++) {
+
+			lengths[i] = tree -> codeTable[i].len;
+		}
+		huffTreeKill(tree);
 	}
-	tree -> huffTable[key] = pos;
+
+	pqueue_kill(pq);
+	return fits;
 }
 
 
+//SUPPORT FUNCTIONS FOR USE ONLY IN HUFFTREE.C
+
+
 /* support function for huffTreeKill!
 * description: Traverse recursivly through nodes to deallocate them.
 * param[in]: node - Root node of all nodes to be deallocated.
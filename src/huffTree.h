@@ -14,20 +14,37 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+
+#include "pqueue.h"
+#include "bitString.h"
+
+#define HUFFMAXCODELEN 32
 
 
 typedef struct treeNode {
 
-	int weight;
-	unsigned char key;
+	uint64_t weight;
+	int key;
 	struct treeNode* left;
 	struct treeNode* right;
 } treeNode;
 
+/*
+* Packed huffman code for one key. Bits are stored MSB first, so the first bit
+* of the pathway from root is bit (len - 1) of code. A len of 0 means the key
+* is not in the tree.
+*/
+typedef struct huffCode {
+
+	uint32_t code;
+	uint8_t len;
+} huffCode;
+
 typedef struct huffTree {
 
 	int size;
-	char **huffTable;
+	huffCode *codeTable;
 	struct treeNode* root;
 } huffTree;
 
@@ -35,7 +52,8 @@ typedef struct huffTree {
 /*
 * description: Creates empty huffTree. Allocates memory for huffTree.
 * param[in]: root - The treeNode that is the root of huffTree.
-* param[in]: size - amount of characthers huffman table should include.
+* param[in]: size - amount of keys huffman table should include. Keys are
+* 0 to size - 1, leafs with key -1 are padding and get no code.
 * return: empty huffTree.
 */
 huffTree *huffTreeEmpty (treeNode *root, int size);
@@ -50,8 +68,8 @@ int huffTreeIsEmpty (huffTree *tree);
 
 
 /*
-* description: Deallocates all memory that huffTable has allocated. This
-* includes all nodes, strings in huffTable, huffTable, huffTree.
+* description: Deallocates all memory that huffTree has allocated. This
+* includes all nodes, the code table and huffTree.
 * param[in]: tree - huffTree to be freed.
 */
 void huffTreeKill (huffTree *tree);
@@ -66,21 +84,43 @@ treeNode *huffTreeGetRoot (huffTree *tree);
 
 
 /*
-* description: Builds huffman table from huffTree by traversing tree and
-* collecting pathways. Traversion is dont postorder by depth.
+* description: Builds huffman code table from huffTree by traversing tree
+* iterativly and packing the pathway to each leaf into a huffCode.
 * param[in]: tree - the huffTree.
+* return: 1 if all codes fit in HUFFMAXCODELEN bits, else 0.
 */
-void huffTreeTraverse (huffTree *tree);
+int huffTreeTraverse (huffTree *tree);
 
 
 /*
-* description: Gets pathway to node in huffTre containing specific key.
+* description: Gets packed code of key in huffTree.
 * param[in]: tree -The huffTree.
 * param[in]: key - The key.
-* return: Pointer to allocated pathway. Pathway is array of chars, each char
-* being 0 or 1. Last char is always '\0'
+* return: The huffCode of the key. len is 0 if key is not in tree.
 */
-char *huffTreeGetKeyPath (huffTree *tree, int key);
+huffCode huffTreeGetCode (huffTree *tree, int key);
+
+
+/*
+* description: Decodes one key by walking tree from root along bits of
+* bitString, without reading past the first nrOfBits bits.
+* param[in]: tree - The huffTree.
+* param[in]: bs - The bitString.
+* param[in,out]: bitPos - Position of next bit to read, moved past the code.
+* param[in]: nrOfBits - Number of bits in bitString that may be read.
+* return: The key, -1 if code runs past the bits.
+*/
+int huffTreeDecodeKey (huffTree *tree, bitString *bs, int64_t *bitPos,
+					   int64_t nrOfBits);
+
+
+/*
+* description: Debug dump of code table. Prints every key in tree along with
+* it's pathway as a string of 0 and 1's.
+* param[in]: tree - The huffTree.
+* param[in]: fp - Stream to print to.
+*/
+void huffTreePrintTable (huffTree *tree, FILE *fp);
 
 
 /*
@@ -89,12 +129,12 @@ char *huffTreeGetKeyPath (huffTree *tree, int key);
 * param[in]: key - Key of the leaf.
 * return: - Pointer to allocated leaf.
 */
-treeNode *nodeNewLeaf (int weight, unsigned char key);
+treeNode *nodeNewLeaf (uint64_t weight, int key);
 
 
 /*
 * description: Adds to nodes into new node. Weight of node will be the
-* combined weight of both nodes. Key of node will be '\0' (ignored).
+* combined weight of both nodes. Key of node will be -1 (ignored).
 * param[in]: node1 - First node, will become left child.
 * param[in]: node2 - Second node, will become right child.
 * return: Pointer to allocated new node.
@@ -107,7 +147,7 @@ treeNode *nodeNewNode (treeNode *node1, treeNode *node2);
 * param[in]: node - The node.
 * return: The key.
 */
-unsigned char nodeGetKey (treeNode *node);
+int nodeGetKey (treeNode *node);
 
 
 /*
@@ -150,34 +190,49 @@ treeNode *nodeGetLeftChild (treeNode *node);
 treeNode *nodeGetRightChild (treeNode *node);
 
 
-//SUPPORT FUNCTIONS FOR USE ONLY IN HUFFTREE.C
+/*
+* description: Enqueues pqueue with results of freq. analysis. Allocates
+* memory for pqueue.
+* param[in]: *freqTable - Pointer to allocated array containing freq. results.
+* param[in]: size - Number of keys in freqTable (alphabet size).
+* return: pqueue filled with weighted nodes. Lesser weight is heigher prio.
+*/
+pqueue *fillPqueue (uint64_t *freqTable, int size);
 
 
-/*support function for huffTreeTraverse!
-* description: Traverses through one roots nodes recursivly. Sends back path
-* for all leafs it visit to the huffTree function traverses through.
-* param[in]: tree - The huffTree being traversed.
-* param[in]: subRoot - Child of root to be traversed through. Child becomes
-* new root in next recursive function call.
-* param[in]: level - Current level of depth in huffTree that node is located
-* on.
-* param[in]: path - Current path in huffTree to reach node.
-* param[in]: newPath - The path it takes from subRoot to child. If child is
-* left, subRoot is 0, else 1.
+/*
+* description: Builds huffman tree with result of freq. analysis stored in
+* pqueue. Allocates memory for huffTree.
+* param[in]: *pq - pqueue filled with weighted nodes.
+* param[in]: size - Number of keys in huffman table (alphabet size).
+* return: Weighted huffTree.
 */
+huffTree *fillhuffTree (pqueue* pq, int size);
+
 
-void nodeTraverse (huffTree *tree, treeNode *subRoot, int level,
-	 					  char *path, char newPath);
+/*
+* description: Help funtion for pqueue to compare to elements. Each element is
+* a node. Node with lesser weight has higher prio.
+* param[in]: nodeIn1 - Void pointer to first element in pqueue.
+* param[in]: nodeIn2 - Void pointer to second element in pqueue.
+* return: 0 if both nodes have same prio, 1 if nodeIn1 has higher prio, else -1
+*/
+int key_compare (void* nodeIn1, void* nodeIn2);
 
 
-/* support function for nodeTraverse!
-* description: Adds pathway huffman table (in huffTree) for a key.
-* param[in]: tree - The huffTree.
-* param[in]: key - The key.
-* param[in]: path - Pathway to the key. Note: pathway is allocated in stack
-* and not heap.
+/*
+* description: Computes code lengths by building a huffTree of only the keys
+* that have weight. If only one key has weight it gets length 1.
+* param[in]: freqTable - Weight of each key.
+* param[in]: size - Number of keys.
+* param[out]: lengths - Array of size keys to store code lengths in.
+* return: 1 if all codes fit in HUFFMAXCODELEN bits, else 0.
 */
-void huffTreeAddBitPath (huffTree *tree, int key, char *path);
+int huffTreeCodeLengths (const uint64_t *freqTable, int size,
+						 uint8_t *lengths);
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN HUFFTREE.C
 
 
 /* support function for huffTreeKill!
@@ -14,109 +14,539 @@
 /*
 * description: Control flow of program.
 * param[in]: Command  - -encode or -decode.
+* param[in]: Options - see huffman.h.
 * param[in]: file0 - name of file to be analysed (read).
-* param[in]: file1 - name of file to be encoded (read).
-* param[in]: file2 - name of file to be encoded (write).
+* param[in]: file1 - name of file to be encoded (read), "-" for stdin.
+* param[in]: file2 - name of file to be encoded (write), "-" for stdout.
 * return: 0 if input(s) is incorrect, else 1.
 */
 int main (int argc, char const *argv[]) {
 
-	if (fileValidation(argc, argv) == 0) {
+	huffOptions options;
 
+	if (parseArguments(argc, argv, &options) == 0 ||
+		fileValidation(&options) == 0) {
+
+		printf(" - quitting program\n");
+		return 0;
+	}
+
+	//One pool is shared by all parallel work of the run.
+	pool *workers = poolEmpty(options.threads);
+	options.pipe.workers = workers;
+
+	//Making freq. analysis and building tree via pqueue. Modes not using
+	//file0 get a tree of no counts, which is never used.
+	int file0 = usesFile0(&options);
+	uint64_t *freqTable = file0 ?
+						  freqAnalysis(options.file0, workers) :
+						  calloc(EXTASCIILEN, sizeof(uint64_t));
+	pqueue *pq = fillPqueue(freqTable, EXTASCIILEN);
+	huffTree *tree = fillhuffTree(pq, EXTASCIILEN);
+	if (huffTreeTraverse(tree) == 0) {
+
+		fprintf(stderr, "Codes from %s are longer than %d bits",
+				options.file0, HUFFMAXCODELEN);
 		printf(" - quitting program\n");
+		free(freqTable);
+		huffTreeKill(tree);
+		pqueue_kill(pq);
+		poolKill(workers);
 		return 0;
 	}
 
-	//Making freq. analysis and building tree via pqueue.
-	int* freqTable = freqAnalysis(argv[2]);
-	pqueue *pq = fillPqueue(freqTable);
-	huffTree *tree = fillhuffTree(pq);
-	huffTreeTraverse(tree);
+	//Encode or decode depending on command. Messages must not be mixed with
+	//output written to stdout.
+	FILE *log = strcmp(options.file2, "-") == 0 ? stderr : stdout;
+	int success = 1;
+	int encode = strcmp(options.command, "-encode") == 0;
+	if (options.archive && encode) {
+
+		success = archiveCreate(options.file1, options.file2, freqTable,
+								options.level, workers, log);
+	} else if (options.list) {
+
+		success = archiveList(options.file1, options.file2);
+	} else if (options.member != NULL) {
+
+		success = archiveExtractFile(options.file1, options.member,
+									 options.file2);
+	} else if (options.archive) {
+
+		success = archiveExtractAll(options.file1, options.file2, workers,
+									log);
+	} else if (options.range && !encode) {
+
+		success = checkpointDecodeFile(options.file1, options.file2, tree,
+									   options.rangeStart,
+									   options.rangeLength);
+	} else if (options.train) {
+
+		success = dictTrainFile(options.file1, options.file2,
+								options.nrOfTables, options.firstId, log);
+	} else if (options.batch) {
+
+		success = batchRun(encode, options.file1, options.file2, tree,
+						   &options.pipe, log);
+	} else if (encode) {
+
+		fprintf(log, "Encoding...\n");
+		if (options.order1) {
+
+			success = order1EncodeFile(options.file1, options.file2);
+		} else if (options.symbolKind >= 0) {
+
+			success = symbolEncodeFile(options.symbolKind, options.file1,
+									   options.file2);
+		} else if (options.blockSort) {
+
+			success = blockSortEncodeFile(options.file1, options.file2);
+		} else if (options.lz77) {
+
+			lz77Params params;
+			lz77ParamsSet(&params, options.windowBits, options.effort);
+			success = lz77EncodeFile(options.file1, options.file2, &params);
+		} else if (options.ans) {
+
+			success = ansEncodeFile(options.file1, options.file2);
+		} else if (options.filtered) {
+
+			success = filterEncodeFile(options.file1, options.file2,
+									   &options.filter);
+		} else if (options.adaptive) {
+
+			success = adaptiveEncodeFile(options.file1, options.file2,
+										 options.periodKiB);
+		} else if (options.dict != NULL) {
 
-	//Encode or decode depending on command
-	if (strcmp(argv[1], "-encode") == 0) {
+			success = dictEncodeFile(options.file1, options.file2,
+									 options.dict);
+		} else if (options.append) {
 
-		printf("Encoding...\n");
-		encodeFile(argv[3], argv[4], tree);
-		printf("Encoding complete!\n\n");
+			success = frameAppendFile(options.file1, options.file2,
+									  options.level >= LEVELAUTO ?
+									  options.level : FRAMEDEFAULTLEVEL,
+									  &options.target, tree, &options.pipe);
+		} else if (options.checkpointKiB > 0) {
+
+			success = checkpointEncodeFile(options.file1, options.file2, tree,
+										   options.checkpointKiB);
+		} else if (options.push) {
+
+			success = pushEncodeFile(options.file1, options.file2, tree);
+		} else if (options.framed || strcmp(options.file1, "-") == 0 ||
+				   strcmp(options.file2, "-") == 0) {
+
+			success = frameEncodeFile(options.file1, options.file2,
+									  options.level >= LEVELAUTO ?
+									  options.level : FRAMEDEFAULTLEVEL,
+									  &options.target, &options.pipe);
+		} else if (options.level >= LEVELAUTO) {
+
+			success = levelEncodeFile(options.file1, options.file2,
+									  options.level, &options.target);
+		} else {
+
+			success = encodeFile(options.file1, options.file2, tree);
+		}
+		if (success) {
+
+			fprintf(log, "Encoding complete!\n\n");
+		} else {
+
+			fprintf(log, " - quitting program\n");
+		}
 	} else {
 
-		printf("Decoding...\n");
-		decodeFile(argv[3], argv[4], tree);
-		printf("Decode complete!\n\n");
+		fprintf(log, "Decoding...\n");
+		if (options.dict != NULL) {
+
+			success = dictDecodeFile(options.file1, options.file2,
+									 options.dict);
+		} else {
+
+			success = decodeFile(options.file1, options.file2,
+								 file0 ? tree : NULL, &options.pipe);
+		}
+		if (success) {
+
+			fprintf(log, "Decode complete!\n\n");
+		} else {
+
+			fprintf(log, " - quitting program\n");
+		}
 	}
 
 	free(freqTable);
 	huffTreeKill(tree);
 	pqueue_kill(pq);
-	return 1;
+	poolKill(workers);
+	return success;
 }
 
 
 /*
-* description - Validates that input arguments in main func follows
-* given structure.
+* description - Splits input arguments of main func into command, options and
+* files.
 * param[in]: argc - Number of input arguments.
-* param[in]: argv - String array of input textfile names.
+* param[in]: argv - String array of input arguments.
+* param[out]: options - The parsed arguments.
+* return: 1 if arguments follow given structure, else 0.
+*/
+int parseArguments (int argc, char const *argv[], huffOptions *options) {
+
+	options -> order1 = 0;
+	options -> symbolKind = -1;
+	options -> blockSort = 0;
+	options -> lz77 = 0;
+	options -> ans = 0;
+	options -> filtered = 0;
+	options -> level = -1;
+	options -> adaptive = 0;
+	options -> framed = 0;
+	options -> push = 0;
+	options -> append = 0;
+	options -> batch = 0;
+	options -> archive = 0;
+	options -> list = 0;
+	options -> member = NULL;
+	options -> pipe.stats = 0;
+	options -> pipe.io.backend = STREAMBACKENDPLAIN;
+	options -> pipe.io.direct = 0;
+	options -> pipe.workers = NULL;
+	options -> threads = 0;
+	options -> periodKiB = ADAPTIVEDEFAULTPERIOD;
+	options -> checkpointKiB = 0;
+	options -> range = 0;
+	options -> train = 0;
+	options -> nrOfTables = 1;
+	options -> firstId = DICTDEFAULTID;
+	options -> dict = NULL;
+	options -> target.ratio = 0;
+	options -> target.speed = 0;
+	options -> windowBits = LZ77DEFAULTWINDOW;
+	options -> effort = LZ77DEFAULTEFFORT;
+
+	//Command, atleast zero options and then three files.
+	if (argc < 5) {
+
+		fprintf(stderr, "Could not execute, too few arguments");
+		return 0;
+	}
+
+	options -> command = argv[1];
+	options -> file0 = argv[argc - 3];
+	options -> file1 = argv[argc - 2];
+	options -> file2 = argv[argc - 1];
+
+	if (strcmp(argv[1], "-encode") != 0 && strcmp(argv[1], "-decode") != 0) {
+
+		fprintf(stderr, "'%s' is not a valid argument", argv[1]);
+		return 0;
+	}
+
+	for (int i = 2; i < argc - 3; i++) {
+
+		if (strcmp(argv[i], "-order1") == 0) {
+
+			options -> order1 = 1;
+		} else if (strcmp(argv[i], "-utf8") == 0) {
+
+			options -> symbolKind = SYMBOLUTF8;
+		} else if (strcmp(argv[i], "-word16") == 0) {
+
+			options -> symbolKind = SYMBOLWORD16;
+		} else if (strcmp(argv[i], "-bwt") == 0) {
+
+			options -> blockSort = 1;
+		} else if (strcmp(argv[i], "-lz77") == 0) {
+
+			options -> lz77 = 1;
+		} else if (strcmp(argv[i], "-ans") == 0) {
+
+			options -> ans = 1;
+		} else if (argv[i][0] == '-' && argv[i][1] >= '1' &&
+				   argv[i][1] <= '9' && argv[i][2] == '\0') {
+
+			options -> level = argv[i][1] - '0';
+		} else if (strcmp(argv[i], "--auto") == 0) {
+
+			options -> level = LEVELAUTO;
+		} else if (strcmp(argv[i], "-ratio") == 0 && i + 1 < argc - 3) {
+
+			i++;
+			options -> target.ratio = atof(argv[i]);
+		} else if (strcmp(argv[i], "-speed") == 0 && i + 1 < argc - 3) {
+
+			i++;
+			options -> target.speed = atof(argv[i]);
+		} else if (strcmp(argv[i], "-adaptive") == 0) {
+
+			options -> adaptive = 1;
+		} else if (strcmp(argv[i], "-stream") == 0) {
+
+			options -> framed = 1;
+		} else if (strcmp(argv[i], "-push") == 0) {
+
+			options -> push = 1;
+		} else if (strcmp(argv[i], "-append") == 0) {
+
+			options -> append = 1;
+		} else if (strcmp(argv[i], "-batch") == 0) {
+
+			options -> batch = 1;
+		} else if (strcmp(argv[i], "-archive") == 0) {
+
+			options -> archive = 1;
+		} else if (strcmp(argv[i], "-list") == 0) {
+
+			options -> list = 1;
+		} else if (strcmp(argv[i], "-member") == 0 && i + 1 < argc - 3) {
+
+			i++;
+			options -> member = argv[i];
+		} else if (strcmp(argv[i], "-stats") == 0) {
+
+			options -> pipe.stats = 1;
+		} else if (strcmp(argv[i], "-direct") == 0) {
+
+			options -> pipe.io.direct = 1;
+		} else if (strcmp(argv[i], "-io") == 0 && i + 1 < argc - 3) {
+
+			i++;
+			options -> pipe.io.backend = streamParseBackend(argv[i]);
+			if (options -> pipe.io.backend < 0) {
+
+				fprintf(stderr, "'%s' is not a valid io backend", argv[i]);
+				return 0;
+			}
+		} else if (strcmp(argv[i], "-T") == 0 && i + 1 < argc - 3) {
+
+			i++;
+			options -> threads = atoi(argv[i]);
+			if (options -> threads < 1 || options -> threads > MAXTHREADS) {
+
+				fprintf(stderr, "'%s' is not a valid number of threads",
+						argv[i]);
+				return 0;
+			}
+		} else if (strcmp(argv[i], "-period") == 0 && i + 1 < argc - 3) {
+
+			i++;
+			options -> periodKiB = atoll(argv[i]);
+			if (options -> periodKiB < 1 ||
+				options -> periodKiB > ADAPTIVEMAXPERIOD) {
+
+				fprintf(stderr, "'%s' is not a valid period", argv[i]);
+				return 0;
+			}
+		} else if (strcmp(argv[i], "-checkpoint") == 0 && i + 1 < argc - 3) {
+
+			i++;
+			options -> checkpointKiB = atoll(argv[i]);
+			if (options -> checkpointKiB < 1 ||
+				options -> checkpointKiB > CHECKPOINTMAXKIB) {
+
+				fprintf(stderr, "'%s' is not a valid checkpoint interval",
+						argv[i]);
+				return 0;
+			}
+		} else if (strcmp(argv[i], "-range") == 0 && i + 1 < argc - 3) {
+
+			i++;
+			options -> range = 1;
+			if (!checkpointParseRange(argv[i], &options -> rangeStart,
+									  &options -> rangeLength)) {
+
+				fprintf(stderr, "'%s' is not a valid range", argv[i]);
+				return 0;
+			}
+		} else if (strcmp(argv[i], "-train") == 0) {
+
+			options -> train = 1;
+		} else if (strcmp(argv[i], "-tables") == 0 && i + 1 < argc - 3) {
+
+			i++;
+			options -> nrOfTables = atoi(argv[i]);
+			if (options -> nrOfTables < 1 ||
+				options -> nrOfTables > CONTEXTMAXTABLES) {
+
+				fprintf(stderr, "'%s' is not a valid number of tables",
+						argv[i]);
+				return 0;
+			}
+		} else if (strcmp(argv[i], "-id") == 0 && i + 1 < argc - 3) {
+
+			i++;
+			long long id = atoll(argv[i]);
+			if (argv[i][0] < '0' || argv[i][0] > '9' ||
+				id >= (1LL << CONTEXTIDBITS)) {
+
+				fprintf(stderr, "'%s' is not a valid table id", argv[i]);
+				return 0;
+			}
+			options -> firstId = (uint32_t)id;
+		} else if (strcmp(argv[i], "-dict") == 0 && i + 1 < argc - 3) {
+
+			i++;
+			options -> dict = argv[i];
+		} else if (strcmp(argv[i], "-filter") == 0 && i + 1 < argc - 3) {
+
+			i++;
+			options -> filtered = 1;
+			if (!filterParse(argv[i], &options -> filter)) {
+
+				fprintf(stderr, "'%s' is not a valid filter", argv[i]);
+				return 0;
+			}
+		} else if (strcmp(argv[i], "-window") == 0 && i + 1 < argc - 3) {
+
+			i++;
+			options -> windowBits = atoi(argv[i]);
+			if (options -> windowBits < LZ77MINWINDOW ||
+				options -> windowBits > LZ77MAXWINDOW) {
+
+				fprintf(stderr, "'%s' is not a valid window", argv[i]);
+				return 0;
+			}
+		} else if (strcmp(argv[i], "-effort") == 0 && i + 1 < argc - 3) {
+
+			i++;
+			options -> effort = atoi(argv[i]);
+			if (options -> effort < 1 || options -> effort > 9) {
+
+				fprintf(stderr, "'%s' is not a valid effort", argv[i]);
+				return 0;
+			}
+		} else {
+
+			fprintf(stderr, "'%s' is not a valid option", argv[i]);
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+
+/*
+* description - Validates that files in parsed arguments can be read and
+* written.
+* param[in]: options - The parsed arguments.
 * return: 1 if files are valid, else 0.
 */
-int fileValidation (int argc, char const *argv[]) {
+int fileValidation (huffOptions *options) {
 
 	int valid = 1;
 	FILE *fp;
 
-	//If number of input arguments is else than 5.
-	if (argc != 5) {
+	//Stdin can only be read once, by file0 or by file1.
+	int file0 = usesFile0(options);
+	if (file0 && strcmp(options -> file0, "-") == 0 &&
+		strcmp(options -> file1, "-") == 0) {
 
-		fprintf(stderr, "Could not execute, too few/many arguments");
+		fprintf(stderr, "file0 and file1 can not both be stdin");
 		valid = 0;
 	}
 
-	//If command is else than -encode or -decode.
+	//Batch reads names from file1 and makes directory file2 itself.
+	if (options -> batch && (strcmp(options -> file1, "-") == 0 ||
+							 strcmp(options -> file2, "-") == 0)) {
 
-	if (valid == 1) {
+		fprintf(stderr, "-batch can not read or write stdin or stdout");
+		valid = 0;
+	}
 
-		if (strcmp(argv[1], "-encode") != 0 && strcmp(argv[1], "-decode") != 0) {
+	//Archives are mapped, so they are read from files only. Members and
+	//index are only read when decoding.
+	int archived = options -> archive || options -> list ||
+				   options -> member != NULL;
+	int encode = strcmp(options -> command, "-encode") == 0;
+	if (archived && !encode && strcmp(options -> file1, "-") == 0) {
 
-			fprintf(stderr, "'%s' is not a valid argument", argv[1]);
-			valid = 0;
-		}
+		fprintf(stderr, "An archive can not be read from stdin");
+		valid = 0;
 	}
+	if (encode && (options -> list || options -> member != NULL)) {
 
-	//Rest of function checks that files 1-3 can be read or written to.
+		fprintf(stderr, "-list and -member are only used with -decode");
+		valid = 0;
+	}
+	if (options -> archive && (strcmp(options -> file1, "-") == 0 ||
+							   (!encode && strcmp(options -> file2, "-") == 0))) {
 
-	if (valid == 1) {
+		fprintf(stderr, "-archive can not read stdin or write a directory "
+				"to stdout");
+		valid = 0;
+	}
 
-		fp = fopen(argv[2], "r");
+	//Frames are appended in place, after the frames already in file2.
+	if (options -> append && (!encode || strcmp(options -> file2, "-") == 0)) {
+
+		fprintf(stderr, "-append is only used with -encode to a file");
+		valid = 0;
+	}
+
+	//Samples are read by name from file1, as batch reads its files.
+	if (options -> train && (!encode || strcmp(options -> file1, "-") == 0)) {
+
+		fprintf(stderr, "-train is only used with -encode of samples named "
+				"by a directory or a file");
+		valid = 0;
+	}
+
+	//Ranges are read by seeking to checkpoints.
+	if (options -> range && (encode || strcmp(options -> file1, "-") == 0)) {
+
+		fprintf(stderr, "-range is only used with -decode of a file");
+		valid = 0;
+	}
+
+	//Checks that files 0-2 can be read or written to. "-" is stdin or stdout
+	//and always valid.
+
+	if (valid == 1 && file0 && strcmp(options -> file0, "-") != 0) {
+
+		fp = fopen(options -> file0, "r");
 		if (fp == NULL) {
 
-			fprintf(stderr, "Could not open %s", argv[2]);
+			fprintf(stderr, "Could not open %s", options -> file0);
 			valid = 0;
+		} else {
+
+			fclose(fp);
 		}
-		fclose(fp);
 	}
 
-	if (valid == 1) {
+	if (valid == 1 && strcmp(options -> file1, "-") != 0) {
 
-		fp = fopen(argv[3], "r");
+		fp = fopen(options -> file1, "r");
 		if (fp == NULL) {
 
-			fprintf(stderr, "Could not open %s", argv[3]);
+			fprintf(stderr, "Could not open %s", options -> file1);
 			valid = 0;
+		} else {
+
+			fclose(fp);
 		}
-		fclose(fp);
 	}
 
-	if (valid == 1) {
+	//Batch and extract of a whole archive make directory file2 themselves,
+	//and append must not truncate file2.
+	int keep = options -> batch || options -> append ||
+			   (options -> archive && !encode && !options -> list &&
+				options -> member == NULL);
+	if (valid == 1 && !keep && strcmp(options -> file2, "-") != 0) {
 
-		fp = fopen(argv[4], "w");
+		fp = fopen(options -> file2, "w");
 		if (fp == NULL) {
 
-			fprintf(stderr, "Could not open %s", argv[4]);
+			fprintf(stderr, "Could not open %s", options -> file2);
 			valid = 0;
+		} else {
 
+			fclose(fp);
 		}
-		fclose(fp);
 	}
 
 	return valid;
@@ -124,115 +554,157 @@ int fileValidation (int argc, char const *argv[]) {
 
 
 /*
-* description: Analyses how often each char of extended ascii is used in file0.
-* Allocates memory for int array.
-* param[in]: file0 - Name of file0.
-* return: Pointer to allocated array containing freq. results.
+* description - Tells if the mode of parsed arguments codes with the table of
+* file0. Other modes neither read nor check file0.
+* param[in]: options - The parsed arguments.
+* return: 1 if file0 is used, else 0.
 */
-int *freqAnalysis (char const *file0) {
+int usesFile0 (huffOptions *options) {
 
-	FILE *fp = fopen(file0, "r");
-	int *freqTable = malloc(sizeof(int) * EXTASCIILEN);
+	int encode = strcmp(options -> command, "-encode") == 0;
 
-	for (int i = 0; i < EXTASCIILEN; i++) {
+	//Same order of modes as in main.
+	if (options -> archive && encode) {
 
-		freqTable[i] = 0;
-	}
-    int currentChar = 0;
+		return 1;
+	} else if (options -> list || options -> member != NULL ||
+			   options -> archive || options -> train ||
+			   options -> dict != NULL) {
 
-    while ((currentChar = fgetc(fp)) >= 0) {
+		return 0;
+	} else if (options -> range || options -> batch) {
 
-		freqTable[currentChar]++;
-    }
+		return 1;
+	} else if (!encode) {
 
-	fclose(fp);
-	return freqTable;
-}
+		//Mode is read from header of file1. Stdin can not be read twice, so
+		//its mode is not known before decoding, and file0 is used if it can
+		//be opened. Modes coding with the table then fail without it.
+		if (strcmp(options -> file1, "-") == 0) {
 
+			FILE *fp = strcmp(options -> file0, "-") != 0 ?
+					   fopen(options -> file0, "r") : NULL;
+			if (fp != NULL) {
 
-/*
-* description: Enqueues pqueue with results of freq. analysis. Allocates
-* memory for pqueue.
-* param[in]: *freqTable - Pointer to allocated array containing freq. results.
-* return: pqueue filled with weighted nodes. Lesser weight is heigher prio.
-*/
-pqueue *fillPqueue (int *freqTable) {
+				fclose(fp);
+			}
+			return fp != NULL;
+		}
+		unsigned char header[FORMATHEADERSIZE];
+		int mode = FORMATMODESTATIC;
+		uint64_t length = 0;
+		FILE *fp = fopen(options -> file1, "rb");
+		if (fp != NULL) {
+
+			if (fread(header, 1, FORMATHEADERSIZE, fp) != FORMATHEADERSIZE ||
+				!formatParseHeader(header, &mode, &length)) {
+
+				mode = FORMATMODESTATIC;
+			}
+			fclose(fp);
+		}
+		return mode == FORMATMODESTATIC || mode == FORMATMODECHECKPOINT ||
+			   mode == FORMATMODEFRAMED || mode == FORMATMODEPUSH;
+	} else if (options -> order1 || options -> symbolKind >= 0 ||
+			   options -> blockSort || options -> lz77 || options -> ans ||
+			   options -> filtered || options -> adaptive) {
 
-	treeNode *tempNode;
-	pqueue *pq = pqueue_empty(key_compare);
-	for (int i = 0; i < EXTASCIILEN; i++) {
+		return 0;
+	} else if (options -> append || options -> checkpointKiB > 0 ||
+			   options -> push) {
 
-		tempNode = nodeNewLeaf(freqTable[i], (unsigned char)i);
-		pqueue_insert(pq, tempNode);
+		return 1;
 	}
-
-	return pq;
+	return !options -> framed && strcmp(options -> file1, "-") != 0 &&
+		   strcmp(options -> file2, "-") != 0 && options -> level < LEVELAUTO;
 }
 
 
 /*
-* description: Builds huffman tree with result of freq. analysis stored in
-* pqueue. Allocates memory for huffTree.
-* param[in]: *pq - pqueue filled with weighted nodes.
-* return: Weighted huffTree.
+* description: Analyses how often each char of extended ascii is used in file0.
+* Allocates memory for 64 bit counter array.
+* param[in]: file0 - Name of file0.
+* param[in]: workers - Pool counting parts of file0 at once, NULL to count in
+* calling thread.
+* return: Pointer to allocated array containing freq. results.
 */
-huffTree *fillhuffTree (pqueue* pq) {
+uint64_t *freqAnalysis (char const *file0, pool *workers) {
 
-	huffTree *tree;
+	stream *in = streamOpenRead(file0);
+	uint64_t *freqTable = malloc(sizeof(uint64_t) * EXTASCIILEN);
+	unsigned char *chunk = malloc(FREQCHUNKSIZE);
+	int maxParts = poolSize(workers);
+	freqPart *parts = malloc(sizeof(freqPart) * maxParts);
+	int64_t length = 0;
 
-	while (!pqueue_is_empty(pq)) {
+	for (int i = 0; i < EXTASCIILEN; i++) {
 
-		treeNode *tempNode1;
-		treeNode *tempNode2;
-		treeNode *newNode;
+		freqTable[i] = 0;
+	}
 
-		tempNode1 = pqueue_inspect_first(pq);
-		pqueue_delete_first(pq);
+	while ((length = streamRead(in, chunk, FREQCHUNKSIZE)) > 0) {
 
-		if (!pqueue_is_empty(pq)) {
+		//Small chunks are not worth splitting among all workers.
+		int64_t nrOfParts = (length + FREQMINPART - 1) / FREQMINPART;
+		if (nrOfParts > maxParts) {
 
-			tempNode2 = pqueue_inspect_first(pq);
-			pqueue_delete_first(pq);
-		} else {
+			nrOfParts = maxParts;
+		}
+		int64_t share = (length + nrOfParts - 1) / nrOfParts;
+		poolGroup group;
 
-			tempNode2 = nodeNewLeaf(0, '\0');
+		poolGroupInit(&group);
+		for (int64_t i = 0; i < nrOfParts; i++) {
+
+			parts[i].text = &chunk[i * share];
+			parts[i].length = i * share + share > length ? length - i * share :
+							  share;
+			if (workers != NULL) {
+
+				poolSubmit(workers, &group, freqCount, &parts[i]);
+			} else {
+
+				freqCount(&parts[i]);
+			}
 		}
-		newNode = nodeNewNode(tempNode1, tempNode2);
+		if (workers != NULL) {
 
-		if (!pqueue_is_empty(pq)) {
+			poolWait(workers, &group);
+		}
 
-			pqueue_insert(pq, newNode);
-		} else {
+		for (int64_t i = 0; i < nrOfParts; i++) {
 
-			tree = huffTreeEmpty(newNode, EXTASCIILEN);
+			for (int j = 0; j < EXTASCIILEN; j++) {
+
+				freqTable[j] = freqTable[j] + parts[i].counts[j];
+			}
 		}
 	}
-	return tree;
+
+	streamClose(in);
+	free(parts);
+	free(chunk);
+	return freqTable;
 }
 
 
-/*
-* description: Help funtion for pqueue to compare to elements. Each element is
-* a node. Node with lesser weight has higher prio.
-* param[in]: nodeIn1 - Void pointer to first element in pqueue.
-* param[in]: nodeIn2 - Void pointer to second element in pqueue.
-* return: 0 if both nodes have same prio, 1 if nodeIn1 has higher prio, else -1
-*/
-int key_compare (void *nodeIn1, void *nodeIn2) {
+//SUPPORT FUNCTIONS FOR USE ONLY IN HUFFMAN.C
 
-	treeNode *node1 = nodeIn1;
-	treeNode *node2 = nodeIn2;
 
-	int largest = 0;
-
-	if (node1 -> weight > node2 -> weight) {
+/* support function for freqAnalysis!
+* description: Task counting chars of one part of a chunk.
+* param[in]: arg - The freqPart, counts are set.
+*/
+void freqCount (void *arg) {
 
-		largest = 1;
+	freqPart *part = arg;
 
-	} else if (node2 -> weight > node1 -> weight) {
+	for (int i = 0; i < EXTASCIILEN; i++) {
 
-		largest = -1;
+		part -> counts[i] = 0;
 	}
+	for (int64_t i = 0; i < part -> length; i++) {
 
-	return largest;
+		part -> counts[part -> text[i]]++;
+	}
 }
@@ -9,65 +9,190 @@
 *
 * PROGRAM INPUTS / OUTPUT:
 * param[in]: Command  - -encode or -decode.
-* param[in]: file0 - name of file to be analysed (read).
-* param[in]: file1 - name of file to be encoded (read).
-* param[in]: file2 - name of file to be encoded (write).
+* param[in]: Options - zero or more of:
+*	-order1 - encode with order-1 context tables stored in file2.
+*	-utf8 - encode UTF-8 code points as symbols, table stored in file2.
+*	-word16 - encode 16 bit words as symbols, table stored in file2.
+*	-bwt - encode blocks with bwt, mtf and rle before huffman coding.
+*	-lz77 - encode literals and matches with lz77 before huffman coding.
+*	-window bits - lz77 window of 2^bits chars, 10-20, default 15.
+*	-effort level - lz77 match search effort, 1-9, default 6.
+*	-ans - encode blocks with tANS or huffman, whichever is smaller.
+*	-filter name - filter binary data per block before coding, one of auto,
+*	none, shuffleN, deltaN or xorN where N is element size 1, 2, 4 or 8.
+*	-1 to -9 - encode with level, from stored to heaviest modelling.
+*	--auto - pick level by sampling file1, the lowest level coding the
+*	samples close to the smallest size.
+*	-ratio r - with --auto, pick lowest level reaching ratio r.
+*	-speed s - with --auto, pick best ratio of levels reaching s MB/s.
+*	-adaptive - encode in one pass with a model adapting to the chars read.
+*	-period k - adaptive model is rebuilt atleast every k KiB, default 16.
+*	-stream - encode as self-contained frames, see frame.h. Level is taken
+*	from -1 to -9 or --auto, default 4. Used by default when file1 or file2
+*	is "-" and no other mode is given.
+*	-push - encode with table of file0 by feeding a push encoder a chunk at
+*	a time, in blocks that can be decoded as they arrive. See push.h.
+*	-append - append file1 as frames to framed file file2, or write it if
+*	file2 is missing or empty, without reading the frames in file2. Frames
+*	reuse the table of file0 where it codes them well, else are coded with
+*	level of -1 to -9 or --auto, default 4. See frame.h.
+*	-stats - print busy and stall time of reading, coding and writing stages
+*	of framed encode and decode.
+*	-io name - file io of framed encode and decode, one of plain, pread or
+*	uring, default plain. uring falls back to pread where not available.
+*	-direct - with -io, open files with O_DIRECT to bypass the page cache.
+*	-T n - number of worker threads, default number of online CPUs. Workers
+*	count chars of file0 and code the frames of framed encode and decode.
+*	-batch - file1 is a directory or a file listing one file per line, and
+*	file2 a directory. Every file is coded with the table of file0 on the
+*	workers, see batch.h. Other mode options are not used.
+*	-archive - encode: file1 is a directory or a file listing one file per
+*	line, and every file is coded as a member of archive file2, with the
+*	table of file0 or, given -1 to -9, its own tables where smaller. Decode:
+*	file1 is an archive, and every member is written to directory file2.
+*	See archive.h.
+*	-member name - decode: write only member name of archive file1 to file2.
+*	-list - decode: write the index of archive file1 to file2.
+*	-checkpoint k - encode with table of file0 and a checkpoint every k KiB,
+*	so ranges can be decoded without decoding the file before them.
+*	-range start:len - decode: write only chars start to start + len of a
+*	file encoded with -checkpoint or the static table. See checkpoint.h.
+*	-train - encode: file1 is a directory or a file listing one sample file
+*	per line, and tables trained from the samples are written to table set
+*	file2. file0 is not used. See dict.h.
+*	-tables k - with -train, train up to k tables, 1-16, default 1. Samples
+*	are clustered by which table codes them best.
+*	-id n - with -train, ids of the tables start at n, 0-255, default 1.
+*	-dict file - encode file1 with the table of table set file coding it
+*	best, or decode file1 with the tables of file.
+* param[in]: file0 - name of file to be analysed (read). Only read, and only
+* needs to exist, for modes coding with its table: plain encode, -append,
+* -checkpoint, -push, -batch, -archive encode, and decode of files written
+* by these or by -stream. Give any name for the other modes.
+* param[in]: file1 - name of file to be encoded (read), "-" for stdin.
+* param[in]: file2 - name of file to be encoded (write), "-" for stdout.
 * return: 0 if input(s) is incorrect, else 1.
 */
 
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 
 #include "encode.h"
 #include "decode.h"
 #include "pqueue.h"
 #include "huffTree.h"
+#include "level.h"
+#include "frame.h"
+#include "stream.h"
+#include "pool.h"
+#include "batch.h"
+#include "archive.h"
+#include "checkpoint.h"
+#include "dict.h"
+#include "push.h"
 
 #define EXTASCIILEN 256
+//File0 is read FREQCHUNKSIZE chars at a time and each chunk counted by the
+//workers, with parts of atleast FREQMINPART chars.
+#define FREQCHUNKSIZE (1 << 23)
+#define FREQMINPART (1 << 16)
+#define MAXTHREADS 1024
+
+
+typedef struct huffOptions {
+
+	char const *command;
+	char const *file0;
+	char const *file1;
+	char const *file2;
+	int order1;
+	int symbolKind;
+	int blockSort;
+	int lz77;
+	int ans;
+	int filtered;
+	filterSpec filter;
+	int level;
+	int adaptive;
+	int framed;
+	int append;
+	int push;
+	int batch;
+	int archive;
+	int list;
+	char const *member;
+	pipelineConfig pipe;
+	int threads;
+	int64_t periodKiB;
+	int64_t checkpointKiB;
+	int range;
+	uint64_t rangeStart;
+	uint64_t rangeLength;
+	int train;
+	int nrOfTables;
+	uint32_t firstId;
+	char const *dict;
+	levelTarget target;
+	int windowBits;
+	int effort;
+} huffOptions;
+
 
 /*
-* description - Validates that input arguments in main func follows
-* given structure.
+* description - Splits input arguments of main func into command, options and
+* files.
 * param[in]: argc - Number of input arguments.
-* param[in]: argv - String array of input textfile names.
-* return: 1 if files are valid, else 0.
+* param[in]: argv - String array of input arguments.
+* param[out]: options - The parsed arguments.
+* return: 1 if arguments follow given structure, else 0.
 */
-int fileValidation (int argc, char const *argv[]);
+int parseArguments (int argc, char const *argv[], huffOptions *options);
 
 
 /*
-* description: Analyses how often each char of extended ascii is used in file0.
-* Allocates memory for int array.
-* param[in]: file0 - Name of file0.
-* return: Pointer to allocated array containing freq. results.
+* description - Validates that files in parsed arguments can be read and
+* written.
+* param[in]: options - The parsed arguments.
+* return: 1 if files are valid, else 0.
 */
-int *freqAnalysis (char const *file0);
+int fileValidation (huffOptions *options);
 
 
 /*
-* description: Enqueues pqueue with results of freq. analysis. Allocates
-* memory for pqueue.
-* param[in]: *freqTable - Pointer to allocated array containing freq. results.
-* return: pqueue filled with weighted nodes. Lesser weight is heigher prio.
+* description - Tells if the mode of parsed arguments codes with the table of
+* file0. Other modes neither read nor check file0.
+* param[in]: options - The parsed arguments.
+* return: 1 if file0 is used, else 0.
 */
-pqueue *fillPqueue (int *freqTable);
+int usesFile0 (huffOptions *options);
 
 
 /*
-* description: Builds huffman tree with result of freq. analysis stored in
-* pqueue. Allocates memory for huffTree.
-* param[in]: *pq - pqueue filled with weighted nodes.
-* return: Weighted huffTree.
+* description: Analyses how often each char of extended ascii is used in file0.
+* Allocates memory for 64 bit counter array.
+* param[in]: file0 - Name of file0.
+* param[in]: workers - Pool counting parts of file0 at once, NULL to count in
+* calling thread.
+* return: Pointer to allocated array containing freq. results.
 */
-huffTree *fillhuffTree (pqueue* pq);
+uint64_t *freqAnalysis (char const *file0, pool *workers);
 
 
-/*
-* description: Help funtion for pqueue to compare to elements. Each element is
-* a node. Node with lesser weight has higher prio.
-* param[in]: nodeIn1 - Void pointer to first element in pqueue.
-* param[in]: nodeIn2 - Void pointer to second element in pqueue.
-* return: 0 if both nodes have same prio, 1 if nodeIn1 has higher prio, else -1
+//SUPPORT FUNCTIONS FOR USE ONLY IN HUFFMAN.C
+
+
+typedef struct freqPart {
+
+	const unsigned char *text;
+	int64_t length;
+	uint64_t counts[EXTASCIILEN];
+} freqPart;
+
+
+/* support function for freqAnalysis!
+* description: Task counting chars of one part of a chunk.
+* param[in]: arg - The freqPart, counts are set.
 */
-int key_compare (void* nodeIn1, void* nodeIn2);
+void freqCount (void *arg);
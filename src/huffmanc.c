@@ -0,0 +1,92 @@
+/*
+* Huffman coding client.
+*
+* Has a file coded by a running huffmand, or prints its counts and latency
+* percentiles. Files encoded are written as by huffman -encode -dict with
+* the table set of the server, so either program can decode them.
+*
+* PROGRAM INPUTS / OUTPUT:
+* param[in]: Command - -encode, -decode or -stats.
+* param[in]: Options - zero or more of:
+*	-fd - pass file1 to the server as a descriptor instead of sending its
+*	chars, a memfd if file1 is not a regular file, and get the reply in a
+*	memfd. Used for files above 64 MiB without it.
+* param[in]: socket - name of the socket of the server.
+* param[in]: file1 - name of file to be coded (read), "-" for stdin. Not
+* given with -stats.
+* param[in]: file2 - name of file to be written, "-" for stdout. Not given
+* with -stats, which writes to stdout.
+* return: 0 if input(s) is incorrect or the request failed, else 1.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+
+#include "client.h"
+
+
+/*
+* description: Control flow of program.
+* param[in]: Command - -encode, -decode or -stats.
+* param[in]: Options - see above.
+* param[in]: socket - name of the socket of the server.
+* param[in]: file1 - name of file to be coded (read), "-" for stdin.
+* param[in]: file2 - name of file to be written, "-" for stdout.
+* return: 0 if input(s) is incorrect or the request failed, else 1.
+*/
+int main (int argc, char const *argv[]) {
+
+	int op = -1;
+	int passFd = 0;
+
+	if (argc >= 2 && strcmp(argv[1], "-encode") == 0) {
+
+		op = SERVEROPENCODE;
+	} else if (argc >= 2 && strcmp(argv[1], "-decode") == 0) {
+
+		op = SERVEROPDECODE;
+	} else if (argc >= 2 && strcmp(argv[1], "-stats") == 0) {
+
+		op = SERVEROPSTATS;
+	} else if (argc >= 2) {
+
+		fprintf(stderr, "'%s' is not a valid argument", argv[1]);
+		printf(" - quitting program\n");
+		return 0;
+	}
+
+	//Command, atleast zero options, the socket and the files.
+	int nrOfFiles = op == SERVEROPSTATS ? 0 : 2;
+	if (argc < 3 + nrOfFiles) {
+
+		fprintf(stderr, "Could not execute, too few arguments");
+		printf(" - quitting program\n");
+		return 0;
+	}
+
+	for (int i = 2; i < argc - 1 - nrOfFiles; i++) {
+
+		if (strcmp(argv[i], "-fd") == 0) {
+
+			passFd = 1;
+		} else {
+
+			fprintf(stderr, "'%s' is not a valid argument", argv[i]);
+			printf(" - quitting program\n");
+			return 0;
+		}
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+	char const *path = argv[argc - 1 - nrOfFiles];
+	char const *file1 = nrOfFiles > 0 ? argv[argc - 2] : NULL;
+	char const *file2 = nrOfFiles > 0 ? argv[argc - 1] : "-";
+	if (!clientFile(path, op, file1, file2, passFd)) {
+
+		printf(" - quitting program\n");
+		return 0;
+	}
+	return 1;
+}
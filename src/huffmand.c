@@ -0,0 +1,135 @@
+/*
+* Huffman coding server.
+*
+* Keeps the tables of a table set and a pool of workers ready, and codes
+* requests of clients on a Unix domain socket until it gets SIGINT or
+* SIGTERM. See server.h for the protocol, and huffmanc for a client.
+*
+* PROGRAM INPUTS / OUTPUT:
+* param[in]: Options - zero or more of:
+*	-dict file - code with the tables of table set file, see dict.h. Without
+*	it every message is coded with its own table.
+*	-T n - number of worker threads, default number of online CPUs.
+* param[in]: socket - name of the socket to listen on.
+* return: 0 if input(s) is incorrect or the socket could not be made, else 1.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+
+#include "server.h"
+#include "dict.h"
+
+#define MAXTHREADS 1024
+
+
+//Server stopped by the signal handler.
+static server *running = NULL;
+
+
+/*
+* description: Stops the running server.
+* param[in]: sig - The signal.
+*/
+void stopServer (int sig) {
+
+	(void)sig;
+	if (running != NULL) {
+
+		serverStop(running);
+	}
+}
+
+
+/*
+* description: Control flow of program.
+* param[in]: Options - see above.
+* param[in]: socket - name of the socket to listen on.
+* return: 0 if input(s) is incorrect or the socket could not be made, else 1.
+*/
+int main (int argc, char const *argv[]) {
+
+	char const *dictFile = NULL;
+	int threads = 0;
+
+	if (argc < 2) {
+
+		fprintf(stderr, "Could not execute, too few arguments");
+		printf(" - quitting program\n");
+		return 0;
+	}
+
+	for (int i = 1; i < argc - 1; i++) {
+
+		if (strcmp(argv[i], "-dict") == 0 && i + 1 < argc - 1) {
+
+			i++;
+			dictFile = argv[i];
+		} else if (strcmp(argv[i], "-T") == 0 && i + 1 < argc - 1) {
+
+			i++;
+			threads = atoi(argv[i]);
+			if (threads < 1 || threads > MAXTHREADS) {
+
+				fprintf(stderr, "'%s' is not a valid number of threads",
+						argv[i]);
+				printf(" - quitting program\n");
+				return 0;
+			}
+		} else {
+
+			fprintf(stderr, "'%s' is not a valid argument", argv[i]);
+			printf(" - quitting program\n");
+			return 0;
+		}
+	}
+
+	int count = 0;
+	contextTable **tables = NULL;
+	if (dictFile != NULL) {
+
+		tables = dictRead(dictFile, &count);
+		if (tables == NULL) {
+
+			fprintf(stderr, "%s is not a valid table set", dictFile);
+			printf(" - quitting program\n");
+			return 0;
+		}
+	}
+
+	//Server holds the tables it codes with.
+	server *s = serverEmpty(argv[argc - 1], tables, count, threads);
+	if (tables != NULL) {
+
+		dictKill(tables, count);
+	}
+	if (s == NULL) {
+
+		fprintf(stderr, "Could not listen on %s", argv[argc - 1]);
+		printf(" - quitting program\n");
+		return 0;
+	}
+
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = stopServer;
+	sigemptyset(&action.sa_mask);
+	running = s;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	printf("Serving %s with %d tables on %d workers\n", argv[argc - 1],
+		   count, poolSize(s -> workers));
+	fflush(stdout);
+	int success = serverServe(s);
+
+	char stats[SERVERSTATSSIZE];
+	serverStats(s, stats, SERVERSTATSSIZE);
+	printf("%s", stats);
+	running = NULL;
+	serverKill(s);
+	return success;
+}
@@ -0,0 +1,333 @@
+/*
+* level: Compression levels and automatic level selection. See level.h for
+* which engine each level uses.
+*/
+
+#include <string.h>
+#include <time.h>
+
+#include "level.h"
+#include "encode.h"
+#include "ans.h"
+#include "order1.h"
+#include "lz77.h"
+#include "blocksort.h"
+
+
+/*
+* description: Encodes chars in memory with engine of level.
+* param[in]: bs - The bitString.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[in]: level - LEVELMIN to LEVELMAX.
+* return: Mode of the payload, see format.h.
+*/
+int levelEncode (bitString *bs, const unsigned char *text, int64_t length,
+				 int level) {
+
+	lz77Params params;
+	int mode = FORMATMODESTORED;
+
+	if (level <= 1) {
+
+		bitStringAddBytes(bs, text, length);
+	} else if (level == 2) {
+
+		ansBlocksEncode(bs, text, length, LEVELSTATICBLOCK, ANSBACKENDHUFFMAN);
+		mode = FORMATMODEANS;
+	} else if (level == 3 || level == 4) {
+
+		ansBlocksEncode(bs, text, length, ANSBLOCKSIZE,
+						level == 3 ? ANSBACKENDHUFFMAN : ANSBACKENDAUTO);
+		mode = FORMATMODEANS;
+	} else if (level == 5) {
+
+		order1Model *model = order1Build(text, length);
+		order1WriteTables(model, bs);
+		order1Encode(model, bs, text, length);
+		order1Kill(model);
+		mode = FORMATMODEORDER1;
+	} else if (level <= 8) {
+
+		if (level == 6) {
+
+			lz77ParamsSet(&params, LZ77DEFAULTWINDOW, 3);
+		} else if (level == 7) {
+
+			lz77ParamsSet(&params, LZ77DEFAULTWINDOW, LZ77DEFAULTEFFORT);
+		} else {
+
+			lz77ParamsSet(&params, LZ77MAXWINDOW, 9);
+		}
+		lz77Encode(bs, text, length, &params);
+		mode = FORMATMODELZ77;
+	} else {
+
+		//Heaviest level keeps the smaller of block sorting and lz77 of
+		//level 8, so it never codes worse than level 8.
+		bitString *lz = bitStringEmpty();
+		lz77ParamsSet(&params, LZ77MAXWINDOW, 9);
+		lz77Encode(lz, text, length, &params);
+		bitStringGetEncode(lz);
+
+		blockSortEncode(bs, text, length, BLOCKSORTSIZE);
+		bitStringGetEncode(bs);
+		mode = FORMATMODEBLOCKSORT;
+		if (bitStringGetSize(lz) < bitStringGetSize(bs)) {
+
+			bitStringClear(bs);
+			bitStringAddBytes(bs, bitStringGetEncode(lz),
+							  bitStringGetSize(lz));
+			mode = FORMATMODELZ77;
+		}
+		bitStringKill(lz);
+	}
+
+	bitStringGetEncode(bs);
+	return mode;
+}
+
+
+/*
+* description: Decodes chars in memory coded by levelEncode.
+* param[in]: bs - The bitString.
+* param[in]: bitPos - Position of next bit to read. Moved past the chars.
+* param[in]: mode - Mode returned by levelEncode.
+* param[out]: text - Array to store atleast length chars in.
+* param[in]: length - Number of chars to decode.
+* return: 1 if chars could be decoded, else 0.
+*/
+int levelDecode (bitString *bs, int64_t *bitPos, int mode, unsigned char *text,
+				 int64_t length) {
+
+	if (mode == FORMATMODESTORED) {
+
+		//Stored chars start on a byte, as levelEncode adds them to an empty
+		//or byte aligned bitString.
+		if (*bitPos % 8 != 0 ||
+			bitStringGetSize(bs) - *bitPos / 8 < length) {
+
+			return 0;
+		}
+		memcpy(text, &bitStringGetEncode(bs)[*bitPos / 8], length);
+		*bitPos = *bitPos + length * 8;
+		return 1;
+	} else if (mode == FORMATMODEANS) {
+
+		return ansBlocksDecode(bs, bitPos, text, length);
+	} else if (mode == FORMATMODEORDER1) {
+
+		order1Model *model = order1ReadTables(bs, bitPos);
+		if (model == NULL) {
+
+			return 0;
+		}
+		int valid = order1Decode(model, bs, bitPos, text, length);
+		order1Kill(model);
+		return valid;
+	} else if (mode == FORMATMODELZ77) {
+
+		return lz77Decode(bs, bitPos, text, length);
+	} else if (mode == FORMATMODEBLOCKSORT) {
+
+		return blockSortDecode(bs, bitPos, text, length);
+	}
+	return 0;
+}
+
+
+/*
+* description: Picks level for chars by sampling them. With a target ratio
+* the lowest level reaching it is picked, with a target speed the level
+* with best ratio reaching it. Without targets the lowest level coding the
+* samples within LEVELDEFAULTSLACK of the smallest size is picked, the same
+* on every run. If no level reaches the target, the closest one is picked.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[in]: target - Target ratio or speed in MB/s, 0 if not used.
+* return: The level.
+*/
+int levelPick (const unsigned char *text, int64_t length,
+			   const levelTarget *target) {
+
+	int64_t sampleLength = 0;
+	unsigned char *sample = levelSample(text, length, &sampleLength);
+	int64_t size[LEVELMAX + 1];
+	double speed[LEVELMAX + 1];
+	int pick = LEVELMIN;
+
+	//Chars close to random, like already compressed data, are not worth
+	//trying to code.
+	if (sampleLength == 0 ||
+		levelEntropy(sample, sampleLength) >= LEVELSTOREDENTROPY) {
+
+		free(sample);
+		return LEVELMIN;
+	}
+
+	//Sizes of trials are the same on every run, timings are not, so they
+	//are only used for a target speed.
+	for (int level = LEVELMIN; level <= LEVELMAX; level++) {
+
+		bitString *bs = bitStringEmpty();
+		double start = levelNow();
+
+		levelEncode(bs, sample, sampleLength, level);
+		double time = levelNow() - start;
+
+		size[level] = bitStringGetSize(bs);
+		speed[level] = sampleLength / 1e6 / (time > 1e-9 ? time : 1e-9);
+		bitStringKill(bs);
+	}
+	free(sample);
+
+	int smallest = LEVELMIN;
+	for (int level = LEVELMIN; level <= LEVELMAX; level++) {
+
+		smallest = size[level] < size[smallest] ? level : smallest;
+	}
+
+	if (target -> speed > 0 && target -> ratio <= 0) {
+
+		//Best ratio among levels fast enough, else the fastest level.
+		int fastest = LEVELMIN;
+		pick = -1;
+		for (int level = LEVELMIN; level <= LEVELMAX; level++) {
+
+			if (speed[level] >= target -> speed &&
+				(pick < 0 || size[level] < size[pick])) {
+
+				pick = level;
+			}
+			if (speed[level] > speed[fastest]) {
+
+				fastest = level;
+			}
+		}
+		return pick < 0 ? fastest : pick;
+	}
+
+	//Lower levels are faster, so the lowest level reaching the ratio is
+	//picked, else the one with best ratio. Without target, the lowest level
+	//within LEVELDEFAULTSLACK of the smallest trial is picked.
+	for (int level = LEVELMIN; level <= LEVELMAX; level++) {
+
+		double ratio = (double)sampleLength / (size[level] + 1);
+		if (target -> ratio > 0 ? ratio >= target -> ratio :
+			size[level] <= size[smallest] +
+						   size[smallest] / LEVELDEFAULTSLACK) {
+
+			return level;
+		}
+	}
+	return smallest;
+}
+
+
+/*
+* description: Reads file, encodes it with engine of level and writes encoded
+* file.
+* param[in]: file1 - Name of file to be read and encoded.
+* param[in]: file2 - Name of file to be written as encoded file.
+* param[in]: level - LEVELMIN to LEVELMAX, or LEVELAUTO to pick by sampling.
+* param[in]: target - Target used by LEVELAUTO, see levelPick.
+* return: 1 if file2 was written, else 0.
+*/
+int levelEncodeFile (char const *file1, char const *file2, int level,
+					 const levelTarget *target) {
+
+	int64_t length = 0;
+	unsigned char *text = readPlainFile(file1, &length);
+	bitString *bs = bitStringEmpty();
+
+	if (level == LEVELAUTO) {
+
+		//Encoded file may be going to stdout, where it must not be mixed
+		//with messages.
+		FILE *log = strcmp(file2, "-") == 0 ? stderr : stdout;
+		level = levelPick(text, length, target);
+		fprintf(log, "Picked level %d\n", level);
+	}
+	int mode = levelEncode(bs, text, length, level);
+	int valid = writeEncode(file2, mode, length, bitStringGetEncode(bs),
+							bitStringGetSize(bs));
+
+	bitStringKill(bs);
+	free(text);
+	return valid;
+}
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN LEVEL.C
+
+
+/* support function for levelPick!
+* description: Copies LEVELSAMPLES blocks spread evenly over chars into one
+* array, or all chars if they are few.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[out]: sampleLength - Number of sampled chars.
+* return: Allocated array of sampled chars.
+*/
+unsigned char *levelSample (const unsigned char *text, int64_t length,
+							int64_t *sampleLength) {
+
+	int64_t size = (int64_t)LEVELSAMPLES * LEVELSAMPLESIZE;
+	unsigned char *sample = malloc(size);
+
+	if (length <= size) {
+
+		memcpy(sample, text, length);
+		*sampleLength = length;
+		return sample;
+	}
+
+	int64_t gap = (length - LEVELSAMPLESIZE) / (LEVELSAMPLES - 1);
+	for (int i = 0; i < LEVELSAMPLES; i++) {
+
+		memcpy(&sample[i * LEVELSAMPLESIZE], &text[i * gap], LEVELSAMPLESIZE);
+	}
+	*sampleLength = size;
+	return sample;
+}
+
+
+/* support function for levelPick!
+* description: Computes order-0 entropy of chars.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars, atleast 1.
+* return: Entropy in bits per char * 256.
+*/
+uint32_t levelEntropy (const unsigned char *text, int64_t length) {
+
+	uint64_t freqTable[256] = {0};
+	uint64_t bits = 0;
+
+	for (int64_t i = 0; i < length; i++) {
+
+		freqTable[text[i]]++;
+	}
+
+	//Sum of f * log2(length / f), with logarithms in fixed point.
+	for (int s = 0; s < 256; s++) {
+
+		if (freqTable[s] > 0) {
+
+			bits = bits + freqTable[s] *
+				   (ansLog2((uint32_t)length) - ansLog2((uint32_t)freqTable[s]));
+		}
+	}
+	return (uint32_t)(bits / length);
+}
+
+
+/* support function for levelPick!
+* description: Gets time from a monotonic clock.
+* return: Time in seconds.
+*/
+double levelNow (void) {
+
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
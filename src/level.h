@@ -0,0 +1,139 @@
+/*
+* level: Compression levels 1-9, each mapped to one of the coding engines,
+* and automatic level selection by sampling the input.
+*
+*   1 stored, chars copied as they are
+*   2 static order-0 huffman, one table per LEVELSTATICBLOCK chars
+*   3 huffman per block, see ans.h
+*   4 tANS or huffman per block, see ans.h
+*   5 order-1 context tables, see order1.h
+*   6 lz77, fast effort, see lz77.h
+*   7 lz77, default effort
+*   8 lz77, highest effort and largest window
+*   9 block sorting, see blocksort.h, or level 8 where that is smaller
+*
+* Higher levels model more and code smaller on typical input, and level 9
+* never codes larger than level 8.
+*
+* Automatic selection takes a few blocks spread over the input. If the
+* histogram entropy of the samples shows chars are close to random, input is
+* stored. Else each level is trial encoded on the samples, and the sizes
+* found there pick the level, so the same input always gets the same level.
+* Speeds of the trials are only used for a target speed.
+*/
+
+#ifndef LEVEL
+#define LEVEL
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "bitString.h"
+
+#define LEVELAUTO 0
+#define LEVELMIN 1
+#define LEVELMAX 9
+#define LEVELSAMPLES 4
+#define LEVELSAMPLESIZE (1 << 16)
+//Block size of level 2, gamma coded block lengths must fit 32 bits.
+#define LEVELSTATICBLOCK ((int64_t)1 << 30)
+//Entropy of samples, in bits per char * 256, at which input is stored.
+#define LEVELSTOREDENTROPY (256 * 79 / 10)
+//Without target, the lowest level whose trial is atmost 1/LEVELDEFAULTSLACK
+//bigger than the smallest trial is picked.
+#define LEVELDEFAULTSLACK 32
+
+
+typedef struct levelTarget {
+
+	double ratio;
+	double speed;
+} levelTarget;
+
+
+/*
+* description: Encodes chars in memory with engine of level.
+* param[in]: bs - The bitString.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[in]: level - LEVELMIN to LEVELMAX.
+* return: Mode of the payload, see format.h.
+*/
+int levelEncode (bitString *bs, const unsigned char *text, int64_t length,
+				 int level);
+
+
+/*
+* description: Decodes chars in memory coded by levelEncode.
+* param[in]: bs - The bitString.
+* param[in]: bitPos - Position of next bit to read. Moved past the chars.
+* param[in]: mode - Mode returned by levelEncode.
+* param[out]: text - Array to store atleast length chars in.
+* param[in]: length - Number of chars to decode.
+* return: 1 if chars could be decoded, else 0.
+*/
+int levelDecode (bitString *bs, int64_t *bitPos, int mode, unsigned char *text,
+				 int64_t length);
+
+
+/*
+* description: Picks level for chars by sampling them. With a target ratio
+* the lowest level reaching it is picked, with a target speed the level
+* with best ratio reaching it. Without targets the lowest level coding the
+* samples within LEVELDEFAULTSLACK of the smallest size is picked, the same
+* on every run. If no level reaches the target, the closest one is picked.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[in]: target - Target ratio or speed in MB/s, 0 if not used.
+* return: The level.
+*/
+int levelPick (const unsigned char *text, int64_t length,
+			   const levelTarget *target);
+
+
+/*
+* description: Reads file, encodes it with engine of level and writes encoded
+* file.
+* param[in]: file1 - Name of file to be read and encoded.
+* param[in]: file2 - Name of file to be written as encoded file.
+* param[in]: level - LEVELMIN to LEVELMAX, or LEVELAUTO to pick by sampling.
+* param[in]: target - Target used by LEVELAUTO, see levelPick.
+* return: 1 if file2 was written, else 0.
+*/
+int levelEncodeFile (char const *file1, char const *file2, int level,
+					 const levelTarget *target);
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN LEVEL.C
+
+
+/* support function for levelPick!
+* description: Copies LEVELSAMPLES blocks spread evenly over chars into one
+* array, or all chars if they are few.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[out]: sampleLength - Number of sampled chars.
+* return: Allocated array of sampled chars.
+*/
+unsigned char *levelSample (const unsigned char *text, int64_t length,
+							int64_t *sampleLength);
+
+
+/* support function for levelPick!
+* description: Computes order-0 entropy of chars.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars, atleast 1.
+* return: Entropy in bits per char * 256.
+*/
+uint32_t levelEntropy (const unsigned char *text, int64_t length);
+
+
+/* support function for levelPick!
+* description: Gets time from a monotonic clock.
+* return: Time in seconds.
+*/
+double levelNow (void);
+
+
+#endif //LEVEL
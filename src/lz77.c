@@ -0,0 +1,548 @@
+/*
+* lz77: Dictionary front end with hash chain match finder. Tokens are coded
+* with literal/length and distance tables built by huffTree. See lz77.h for
+* the layout of the payload.
+*/
+
+#include "lz77.h"
+#include "encode.h"
+
+//First length and number of extra bits of literal/length symbols 257-285.
+static const uint16_t lengthBase[29] = {
+
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59,
+	67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t lengthExtra[29] = {
+
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4,
+	5, 5, 5, 5, 0
+};
+
+//Chain length, lazy matching and nice length of effort levels 1-9.
+static const int effortChain[9] = {4, 8, 16, 32, 64, 128, 256, 1024, 4096};
+static const int effortNice[9] = {8, 16, 32, 32, 64, 128, 128, 258, 258};
+
+
+/*
+* description: Sets parameters for window size and effort level.
+* param[out]: params - The parameters.
+* param[in]: windowBits - Window is 2^windowBits chars, LZ77MINWINDOW to
+* LZ77MAXWINDOW.
+* param[in]: effort - 1 is fastest, 9 searches longest chains.
+*/
+void lz77ParamsSet (lz77Params *params, int windowBits, int effort) {
+
+	if (windowBits < LZ77MINWINDOW) {
+
+		windowBits = LZ77MINWINDOW;
+	} else if (windowBits > LZ77MAXWINDOW) {
+
+		windowBits = LZ77MAXWINDOW;
+	}
+	if (effort < 1) {
+
+		effort = 1;
+	} else if (effort > 9) {
+
+		effort = 9;
+	}
+
+	params -> windowBits = windowBits;
+	params -> maxChain = effortChain[effort - 1];
+	params -> lazy = effort >= 4;
+	params -> niceLength = effortNice[effort - 1];
+}
+
+
+/*
+* description: Encodes chars in memory as blocks of tokens and adds the blocks
+* to bitString.
+* param[in]: bs - The bitString.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[in]: params - Window and effort to use.
+*/
+void lz77Encode (bitString *bs, const unsigned char *text, int64_t length,
+				 const lz77Params *params) {
+
+	lz77Matcher m;
+	lz77Token *tokens = malloc(sizeof(lz77Token) * LZ77BLOCKTOKENS);
+	int count = 0;
+	int64_t pos = 0;
+	int pending = 0;
+	int pendingLength = 0;
+	int64_t pendingDistance = 0;
+
+	m.windowMask = ((int64_t)1 << params -> windowBits) - 1;
+	m.head = malloc(sizeof(int64_t) << LZ77HASHBITS);
+	m.prev = malloc(sizeof(int64_t) * (m.windowMask + 1));
+	for (int i = 0; i < (1 << LZ77HASHBITS); i++) {
+
+		m.head[i] = -1;
+	}
+
+	//With lazy matching the match at pos is held back one step, and is only
+	//used if the match at pos + 1 is not longer.
+	while (pos < length) {
+
+		int64_t distance = 0;
+		int matchLength = lz77FindMatch(&m, text, length, pos, params,
+										&distance);
+		lz77Insert(&m, text, length, pos);
+
+		if (pending) {
+
+			pending = 0;
+			if (pendingLength >= LZ77MINMATCH && matchLength <= pendingLength) {
+
+				tokens[count].distance = (uint32_t)pendingDistance;
+				tokens[count].value = (uint16_t)pendingLength;
+				count++;
+				for (int64_t p = pos + 1; p < pos - 1 + pendingLength; p++) {
+
+					lz77Insert(&m, text, length, p);
+				}
+				pos = pos - 1 + pendingLength;
+				matchLength = -1;
+			} else {
+
+				tokens[count].distance = 0;
+				tokens[count].value = text[pos - 1];
+				count++;
+			}
+			if (count == LZ77BLOCKTOKENS) {
+
+				lz77EncodeBlock(bs, tokens, count);
+				count = 0;
+			}
+			if (matchLength < 0) {
+
+				continue;
+			}
+		}
+
+		if (params -> lazy && matchLength < params -> niceLength) {
+
+			pending = 1;
+			pendingLength = matchLength;
+			pendingDistance = distance;
+			pos++;
+			continue;
+		}
+
+		if (matchLength >= LZ77MINMATCH) {
+
+			tokens[count].distance = (uint32_t)distance;
+			tokens[count].value = (uint16_t)matchLength;
+			for (int64_t p = pos + 1; p < pos + matchLength; p++) {
+
+				lz77Insert(&m, text, length, p);
+			}
+			pos = pos + matchLength;
+		} else {
+
+			tokens[count].distance = 0;
+			tokens[count].value = text[pos];
+			pos++;
+		}
+		count++;
+		if (count == LZ77BLOCKTOKENS) {
+
+			lz77EncodeBlock(bs, tokens, count);
+			count = 0;
+		}
+	}
+
+	//A match held back at the last char is too short to be used.
+	if (pending) {
+
+		tokens[count].distance = 0;
+		tokens[count].value = text[pos - 1];
+		count++;
+	}
+	if (count > 0) {
+
+		lz77EncodeBlock(bs, tokens, count);
+	}
+
+	free(m.prev);
+	free(m.head);
+	free(tokens);
+}
+
+
+/*
+* description: Decodes blocks of tokens from bitString.
+* param[in]: bs - The bitString.
+* param[in]: bitPos - Position of next bit to read. Moved past the blocks.
+* param[out]: text - Array to store atleast length chars in.
+* param[in]: length - Number of chars to decode.
+* return: 1 if all chars could be decoded, else 0.
+*/
+int lz77Decode (bitString *bs, int64_t *bitPos, unsigned char *text,
+				int64_t length) {
+
+	int64_t pos = 0;
+	int valid = 1;
+
+	while (valid && pos < length) {
+
+		uint32_t count = canonicalReadGamma(bs, bitPos);
+		uint8_t litLenLengths[LZ77LITLENSYMBOLS];
+		uint8_t distLengths[LZ77DISTSYMBOLS];
+
+		valid = count > 0 && count <= LZ77BLOCKTOKENS &&
+				canonicalReadLengths(bs, bitPos, litLenLengths,
+									 LZ77LITLENSYMBOLS) &&
+				canonicalReadLengths(bs, bitPos, distLengths, LZ77DISTSYMBOLS);
+		if (!valid) {
+
+			break;
+		}
+
+		canonicalDecoder *litLen = canonicalDecoderBuild(litLenLengths,
+														 LZ77LITLENSYMBOLS);
+		canonicalDecoder *dist = canonicalDecoderBuild(distLengths,
+													   LZ77DISTSYMBOLS);
+
+		for (uint32_t i = 0; valid && i < count; i++) {
+
+			int symbol = canonicalDecodeKey(litLen, bs, bitPos);
+
+			if (symbol >= 0 && symbol < 256 && pos < length) {
+
+				text[pos] = (unsigned char)symbol;
+				pos++;
+				continue;
+			}
+			if (symbol <= 256) {
+
+				valid = 0;
+				break;
+			}
+
+			int matchLength = lengthBase[symbol - 257] +
+							  canonicalReadBits(bs, bitPos,
+												lengthExtra[symbol - 257]);
+			int distSymbol = canonicalDecodeKey(dist, bs, bitPos);
+			int extra = 0;
+
+			if (distSymbol < 0) {
+
+				valid = 0;
+				break;
+			}
+			int64_t distance = lz77DistanceBase(distSymbol, &extra) +
+							   canonicalReadBits(bs, bitPos, extra);
+
+			if (distance > pos || matchLength > length - pos) {
+
+				valid = 0;
+				break;
+			}
+
+			//Copied one char at a time since match may overlap itself.
+			for (int j = 0; j < matchLength; j++) {
+
+				text[pos] = text[pos - distance];
+				pos++;
+			}
+		}
+
+		canonicalDecoderKill(dist);
+		canonicalDecoderKill(litLen);
+	}
+
+	return valid;
+}
+
+
+/*
+* description: Reads file, encodes it with lz77 and writes encoded file.
+* param[in]: file1 - Name of file to be read and encoded.
+* param[in]: file2 - Name of file to be written as encoded file.
+* param[in]: params - Window and effort to use.
+* return: 1 if file2 was written, else 0.
+*/
+int lz77EncodeFile (char const *file1, char const *file2,
+					const lz77Params *params) {
+
+	int64_t length = 0;
+	unsigned char *text = readPlainFile(file1, &length);
+	bitString *bs = bitStringEmpty();
+
+	lz77Encode(bs, text, length, params);
+
+	unsigned char *encode = bitStringGetEncode(bs);
+	int valid = writeEncode(file2, FORMATMODELZ77, length, encode,
+							bitStringGetSize(bs));
+
+	bitStringKill(bs);
+	free(text);
+	return valid;
+}
+
+
+/*
+* description: Decodes lz77 payload and writes decoded file.
+* param[in]: file2 - Name of file to write decode.
+* param[in]: bs - The bitString with payload after file header.
+* param[in]: originalLength - Number of chars to decode.
+* return: 1 if payload could be decoded, else 0.
+*/
+int lz77DecodeFile (char const *file2, bitString *bs, uint64_t originalLength) {
+
+	int64_t bitPos = 0;
+	unsigned char *text = NULL;
+
+	//Every token has a code of atleast one bit and gives atmost
+	//LZ77MAXMATCH chars.
+	if (formatLengthFits(originalLength, bitStringGetSize(bs),
+						 8 * LZ77MAXMATCH)) {
+
+		text = malloc(originalLength > 0 ? originalLength : 1);
+	}
+	if (text == NULL) {
+
+		return 0;
+	}
+	int valid = lz77Decode(bs, &bitPos, text, originalLength);
+
+	if (valid) {
+
+		valid = writePlainFile(file2, text, originalLength);
+	}
+
+	free(text);
+	return valid;
+}
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN LZ77.C
+
+
+/* support function for lz77Encode!
+* description: Adds position to the hash chains.
+* param[in]: m - The matcher.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[in]: pos - Position to add.
+*/
+void lz77Insert (lz77Matcher *m, const unsigned char *text, int64_t length,
+				 int64_t pos) {
+
+	if (pos + LZ77MINMATCH > length) {
+
+		return;
+	}
+
+	uint32_t key = text[pos] | (text[pos + 1] << 8) | (text[pos + 2] << 16);
+	uint32_t hash = (key * 2654435761u) >> (32 - LZ77HASHBITS);
+
+	m -> prev[pos & m -> windowMask] = m -> head[hash];
+	m -> head[hash] = pos;
+}
+
+
+/* support function for lz77Encode!
+* description: Finds longest match for chars at pos among earlier positions
+* in the hash chain, before pos itself is inserted.
+* param[in]: m - The matcher.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[in]: pos - Position to match.
+* param[in]: params - Window and effort to use.
+* param[out]: distance - Distance back to the match.
+* return: Length of match, 0 if shorter than LZ77MINMATCH.
+*/
+int lz77FindMatch (lz77Matcher *m, const unsigned char *text, int64_t length,
+				   int64_t pos, const lz77Params *params, int64_t *distance) {
+
+	if (pos + LZ77MINMATCH > length) {
+
+		return 0;
+	}
+
+	int64_t maxLength = length - pos < LZ77MAXMATCH ? length - pos :
+					   LZ77MAXMATCH;
+	uint32_t key = text[pos] | (text[pos + 1] << 8) | (text[pos + 2] << 16);
+	uint32_t hash = (key * 2654435761u) >> (32 - LZ77HASHBITS);
+	int64_t candidate = m -> head[hash];
+	int chain = params -> maxChain;
+	int best = 0;
+
+	//Positions a window or more back may have had their prev slot reused,
+	//so the walk stops there.
+	while (candidate >= 0 && pos - candidate <= m -> windowMask && chain > 0) {
+
+		const unsigned char *a = &text[candidate];
+		const unsigned char *b = &text[pos];
+
+		if (a[best] == b[best]) {
+
+			int n = 0;
+			while (n < maxLength && a[n] == b[n]) {
+
+				n++;
+			}
+			if (n > best) {
+
+				best = n;
+				*distance = pos - candidate;
+				if (n >= params -> niceLength || n == maxLength) {
+
+					break;
+				}
+			}
+		}
+
+		int64_t next = m -> prev[candidate & m -> windowMask];
+		if (next >= candidate) {
+
+			break;
+		}
+		candidate = next;
+		chain--;
+	}
+
+	//Short matches far back cost more bits than the literals they replace.
+	if (best < LZ77MINMATCH ||
+		(best == LZ77MINMATCH && *distance > LZ77TOOFAR)) {
+
+		return 0;
+	}
+	return best;
+}
+
+
+/* support function for lz77Encode!
+* description: Codes a block of tokens with tables of it's own.
+* param[in]: bs - The bitString.
+* param[in]: tokens - The tokens.
+* param[in]: count - Number of tokens.
+*/
+void lz77EncodeBlock (bitString *bs, const lz77Token *tokens, int count) {
+
+	uint64_t litLenFreq[LZ77LITLENSYMBOLS] = {0};
+	uint64_t distFreq[LZ77DISTSYMBOLS] = {0};
+	uint8_t litLenLengths[LZ77LITLENSYMBOLS];
+	uint8_t distLengths[LZ77DISTSYMBOLS];
+	huffCode litLenCodes[LZ77LITLENSYMBOLS];
+	huffCode distCodes[LZ77DISTSYMBOLS];
+
+	for (int i = 0; i < count; i++) {
+
+		if (tokens[i].distance == 0) {
+
+			litLenFreq[tokens[i].value]++;
+		} else {
+
+			litLenFreq[lz77LengthSymbol(tokens[i].value)]++;
+			distFreq[lz77DistanceSymbol(tokens[i].distance)]++;
+		}
+	}
+	lz77BuildCodes(litLenFreq, LZ77LITLENSYMBOLS, litLenLengths, litLenCodes);
+	lz77BuildCodes(distFreq, LZ77DISTSYMBOLS, distLengths, distCodes);
+
+	canonicalWriteGamma(bs, count);
+	canonicalWriteLengths(bs, litLenLengths, LZ77LITLENSYMBOLS);
+	canonicalWriteLengths(bs, distLengths, LZ77DISTSYMBOLS);
+
+	for (int i = 0; i < count; i++) {
+
+		if (tokens[i].distance == 0) {
+
+			huffCode hc = litLenCodes[tokens[i].value];
+			bitStringAddCode(bs, hc.code, hc.len);
+			continue;
+		}
+
+		int symbol = lz77LengthSymbol(tokens[i].value);
+		huffCode hc = litLenCodes[symbol];
+		bitStringAddCode(bs, hc.code, hc.len);
+		bitStringAddCode(bs, tokens[i].value - lengthBase[symbol - 257],
+						 lengthExtra[symbol - 257]);
+
+		int extra = 0;
+		symbol = lz77DistanceSymbol(tokens[i].distance);
+		uint32_t base = lz77DistanceBase(symbol, &extra);
+		hc = distCodes[symbol];
+		bitStringAddCode(bs, hc.code, hc.len);
+		bitStringAddCode(bs, tokens[i].distance - base, extra);
+	}
+}
+
+
+/* support function for lz77EncodeBlock!
+* description: Computes code lengths, with huffTree or canonicalCodeLengths
+* if tree codes are too long, and assigns canonical codes.
+* param[in]: freqTable - Number of times each symbol is used.
+* param[in]: size - Number of symbols.
+* param[out]: lengths - Array of size code lengths.
+* param[out]: codeTable - Array of size codes.
+*/
+void lz77BuildCodes (const uint64_t *freqTable, int size, uint8_t *lengths,
+					 huffCode *codeTable) {
+
+	if (!huffTreeCodeLengths(freqTable, size, lengths)) {
+
+		canonicalCodeLengths(freqTable, size, HUFFMAXCODELEN, lengths);
+	}
+	canonicalAssignCodes(lengths, size, codeTable);
+}
+
+
+/* support function for lz77EncodeBlock!
+* description: Finds literal/length symbol of match length.
+* param[in]: matchLength - LZ77MINMATCH to LZ77MAXMATCH.
+* return: The symbol.
+*/
+int lz77LengthSymbol (int matchLength) {
+
+	int i = 28;
+
+	while (lengthBase[i] > matchLength) {
+
+		i--;
+	}
+	return 257 + i;
+}
+
+
+/* support function for lz77EncodeBlock!
+* description: Finds distance symbol of match distance.
+* param[in]: distance - Atleast 1.
+* return: The symbol.
+*/
+int lz77DistanceSymbol (uint32_t distance) {
+
+	if (distance <= 4) {
+
+		return distance - 1;
+	}
+
+	uint32_t x = distance - 1;
+	int high = canonicalBitWidth(x) - 1;
+	return 2 * high + ((x >> (high - 1)) & 1);
+}
+
+
+/* support function for lz77Decode!
+* description: Gets first distance and number of extra bits of distance
+* symbol.
+* param[in]: symbol - The distance symbol.
+* param[out]: extra - Number of extra bits.
+* return: First distance of the symbol.
+*/
+uint32_t lz77DistanceBase (int symbol, int *extra) {
+
+	if (symbol < 4) {
+
+		*extra = 0;
+		return symbol + 1;
+	}
+
+	*extra = symbol / 2 - 1;
+	return ((2 + (symbol & 1)) << *extra) + 1;
+}
@@ -0,0 +1,197 @@
+/*
+* lz77: Dictionary front end. Text is parsed into literals and matches of
+* (length, distance) against the last window of chars, found with hash chains.
+* Tokens are coded with two huffman tables built by huffTree, one for
+* literals and match lengths and one for match distances, like deflate.
+*
+* Literal/length symbols are 0-255 for literals and 257-285 for lengths
+* 3-258, followed by extra bits as in deflate. Distance symbols 0-3 are
+* distances 1-4, symbol c >= 4 has c / 2 - 1 extra bits and starts at
+* ((2 + c % 2) << (c / 2 - 1)) + 1.
+*
+* Payload after file header, one entry per block until all chars are coded:
+*   gamma(number of tokens in block)
+*   code lengths of the LZ77LITLENSYMBOLS symbols, see canonicalWriteLengths
+*   code lengths of the LZ77DISTSYMBOLS symbols
+*   tokens, each a literal/length code with extra bits and for matches a
+*   distance code with extra bits
+*/
+
+#ifndef LZ77
+#define LZ77
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "huffTree.h"
+#include "bitString.h"
+#include "canonical.h"
+
+#define LZ77MINMATCH 3
+#define LZ77MAXMATCH 258
+#define LZ77TOOFAR 4096
+#define LZ77LITLENSYMBOLS 286
+#define LZ77DISTSYMBOLS 40
+#define LZ77MINWINDOW 10
+#define LZ77MAXWINDOW 20
+#define LZ77DEFAULTWINDOW 15
+#define LZ77DEFAULTEFFORT 6
+#define LZ77BLOCKTOKENS (1 << 16)
+#define LZ77HASHBITS 15
+
+
+typedef struct lz77Params {
+
+	int windowBits;
+	int maxChain;
+	int lazy;
+	int niceLength;
+} lz77Params;
+
+typedef struct lz77Token {
+
+	uint32_t distance;
+	uint16_t value;
+} lz77Token;
+
+typedef struct lz77Matcher {
+
+	int64_t *head;
+	int64_t *prev;
+	int64_t windowMask;
+} lz77Matcher;
+
+
+/*
+* description: Sets parameters for window size and effort level.
+* param[out]: params - The parameters.
+* param[in]: windowBits - Window is 2^windowBits chars, LZ77MINWINDOW to
+* LZ77MAXWINDOW.
+* param[in]: effort - 1 is fastest, 9 searches longest chains.
+*/
+void lz77ParamsSet (lz77Params *params, int windowBits, int effort);
+
+
+/*
+* description: Encodes chars in memory as blocks of tokens and adds the blocks
+* to bitString.
+* param[in]: bs - The bitString.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[in]: params - Window and effort to use.
+*/
+void lz77Encode (bitString *bs, const unsigned char *text, int64_t length,
+				 const lz77Params *params);
+
+
+/*
+* description: Decodes blocks of tokens from bitString.
+* param[in]: bs - The bitString.
+* param[in]: bitPos - Position of next bit to read. Moved past the blocks.
+* param[out]: text - Array to store atleast length chars in.
+* param[in]: length - Number of chars to decode.
+* return: 1 if all chars could be decoded, else 0.
+*/
+int lz77Decode (bitString *bs, int64_t *bitPos, unsigned char *text,
+				int64_t length);
+
+
+/*
+* description: Reads file, encodes it with lz77 and writes encoded file.
+* param[in]: file1 - Name of file to be read and encoded.
+* param[in]: file2 - Name of file to be written as encoded file.
+* param[in]: params - Window and effort to use.
+* return: 1 if file2 was written, else 0.
+*/
+int lz77EncodeFile (char const *file1, char const *file2,
+					const lz77Params *params);
+
+
+/*
+* description: Decodes lz77 payload and writes decoded file.
+* param[in]: file2 - Name of file to write decode.
+* param[in]: bs - The bitString with payload after file header.
+* param[in]: originalLength - Number of chars to decode.
+* return: 1 if payload could be decoded, else 0.
+*/
+int lz77DecodeFile (char const *file2, bitString *bs, uint64_t originalLength);
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN LZ77.C
+
+
+/* support function for lz77Encode!
+* description: Adds position to the hash chains.
+* param[in]: m - The matcher.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[in]: pos - Position to add.
+*/
+void lz77Insert (lz77Matcher *m, const unsigned char *text, int64_t length,
+				 int64_t pos);
+
+
+/* support function for lz77Encode!
+* description: Finds longest match for chars at pos among earlier positions
+* in the hash chain, before pos itself is inserted.
+* param[in]: m - The matcher.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[in]: pos - Position to match.
+* param[in]: params - Window and effort to use.
+* param[out]: distance - Distance back to the match.
+* return: Length of match, 0 if shorter than LZ77MINMATCH.
+*/
+int lz77FindMatch (lz77Matcher *m, const unsigned char *text, int64_t length,
+				   int64_t pos, const lz77Params *params, int64_t *distance);
+
+
+/* support function for lz77Encode!
+* description: Codes a block of tokens with tables of it's own.
+* param[in]: bs - The bitString.
+* param[in]: tokens - The tokens.
+* param[in]: count - Number of tokens.
+*/
+void lz77EncodeBlock (bitString *bs, const lz77Token *tokens, int count);
+
+
+/* support function for lz77EncodeBlock!
+* description: Computes code lengths, with huffTree or canonicalCodeLengths
+* if tree codes are too long, and assigns canonical codes.
+* param[in]: freqTable - Number of times each symbol is used.
+* param[in]: size - Number of symbols.
+* param[out]: lengths - Array of size code lengths.
+* param[out]: codeTable - Array of size codes.
+*/
+void lz77BuildCodes (const uint64_t *freqTable, int size, uint8_t *lengths,
+					 huffCode *codeTable);
+
+
+/* support function for lz77EncodeBlock!
+* description: Finds literal/length symbol of match length.
+* param[in]: matchLength - LZ77MINMATCH to LZ77MAXMATCH.
+* return: The symbol.
+*/
+int lz77LengthSymbol (int matchLength);
+
+
+/* support function for lz77EncodeBlock!
+* description: Finds distance symbol of match distance.
+* param[in]: distance - Atleast 1.
+* return: The symbol.
+*/
+int lz77DistanceSymbol (uint32_t distance);
+
+
+/* support function for lz77Decode!
+* description: Gets first distance and number of extra bits of distance
+* symbol.
+* param[in]: symbol - The distance symbol.
+* param[out]: extra - Number of extra bits.
+* return: First distance of the symbol.
+*/
+uint32_t lz77DistanceBase (int symbol, int *extra);
+
+
+#endif //LZ77
@@ -0,0 +1,71 @@
+/*
+* mtf: Move-to-front transform. Each char is replaced by it's position in a
+* list of recently used chars and then moved to front of the list.
+*/
+
+#include "mtf.h"
+
+
+/*
+* description: Transforms chars to positions in recently used list.
+* param[in]: in - The chars.
+* param[out]: out - Array to store n positions in.
+* param[in]: n - Number of chars.
+*/
+void mtfForward (const unsigned char *in, unsigned char *out, int64_t n) {
+
+	unsigned char list[256];
+
+	for (int i = 0; i < 256; i++) {
+
+		list[i] = (unsigned char)i;
+	}
+
+	for (int64_t i = 0; i < n; i++) {
+
+		unsigned char c = in[i];
+		int pos = 0;
+
+		//Shift chars down while searching, then put c in front.
+		unsigned char previous = list[0];
+		while (previous != c) {
+
+			pos++;
+			unsigned char temp = list[pos];
+			list[pos] = previous;
+			previous = temp;
+		}
+		list[0] = c;
+		out[i] = (unsigned char)pos;
+	}
+}
+
+
+/*
+* description: Transforms positions back to chars.
+* param[in]: in - The positions.
+* param[out]: out - Array to store n chars in.
+* param[in]: n - Number of positions.
+*/
+void mtfInverse (const unsigned char *in, unsigned char *out, int64_t n) {
+
+	unsigned char list[256];
+
+	for (int i = 0; i < 256; i++) {
+
+		list[i] = (unsigned char)i;
+	}
+
+	for (int64_t i = 0; i < n; i++) {
+
+		int pos = in[i];
+		unsigned char c = list[pos];
+
+		for (int j = pos; j > 0; j--) {
+
+			list[j] = list[j - 1];
+		}
+		list[0] = c;
+		out[i] = c;
+	}
+}
@@ -0,0 +1,33 @@
+/*
+* mtf: Move-to-front transform. Each char is replaced by it's position in a
+* list of recently used chars and then moved to front of the list, so runs
+* of the same char become runs of 0 and recent chars get small values.
+*/
+
+#ifndef MTF
+#define MTF
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+
+/*
+* description: Transforms chars to positions in recently used list.
+* param[in]: in - The chars.
+* param[out]: out - Array to store n positions in.
+* param[in]: n - Number of chars.
+*/
+void mtfForward (const unsigned char *in, unsigned char *out, int64_t n);
+
+
+/*
+* description: Transforms positions back to chars.
+* param[in]: in - The positions.
+* param[out]: out - Array to store n chars in.
+* param[in]: n - Number of positions.
+*/
+void mtfInverse (const unsigned char *in, unsigned char *out, int64_t n);
+
+
+#endif //MTF
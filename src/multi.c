@@ -0,0 +1,404 @@
+/*
+* multi: Encoder coding a batch of small messages at once. See multi.h.
+*/
+
+#include <string.h>
+
+#include "multi.h"
+#if MULTIAVX2
+#include <immintrin.h>
+#endif
+
+
+/*
+* description: Creates encoder without shared table. Allocates memory for
+* multiEncoder.
+* return: The multiEncoder.
+*/
+multiEncoder *multiEncoderEmpty (void) {
+
+	multiEncoder *m = calloc(1, sizeof(multiEncoder));
+	huffCode stored[CONTEXTSYMBOLS];
+
+	m -> enc = contextEncoderEmpty();
+	posix_memalign((void **)&m -> packed, CONTEXTALIGN,
+				   sizeof(uint64_t) * MULTITABLES * CONTEXTSYMBOLS);
+	memset(m -> packed, 0, sizeof(uint64_t) * MULTITABLES * CONTEXTSYMBOLS);
+
+	//Stored chars are coded as 8-bit codes of themselves.
+	for (int i = 0; i < CONTEXTSYMBOLS; i++) {
+
+		stored[i].code = (uint32_t)i;
+		stored[i].len = 8;
+	}
+	multiPack(m, MULTISTORED, stored);
+#if MULTIAVX2
+	m -> simd = __builtin_cpu_supports("avx2") ? 1 : 0;
+#endif
+	return m;
+}
+
+
+/*
+* description: Deallocates all memory of multiEncoder, and drops its holds
+* of its tables.
+* param[in]: m - The multiEncoder.
+*/
+void multiEncoderKill (multiEncoder *m) {
+
+	contextEncoderKill(m -> enc);
+	free(m -> packed);
+	free(m -> buffer);
+	free(m);
+}
+
+
+/*
+* description: Sets shared tables of encoder, as contextEncoderSetTables,
+* and packs their codes.
+* param[in]: m - The multiEncoder.
+* param[in]: tables - The tables.
+* param[in]: count - Number of tables, 0 to reset encoder to having no
+* shared table.
+* return: 1 if tables were set, 0 if count is above CONTEXTMAXTABLES.
+*/
+int multiEncoderSetTables (multiEncoder *m, contextTable *const *tables,
+						   int count) {
+
+	if (!contextEncoderSetTables(m -> enc, tables, count)) {
+
+		return 0;
+	}
+	for (int i = 0; i < count; i++) {
+
+		multiPack(m, i, tables[i] -> codes);
+	}
+	return 1;
+}
+
+
+/*
+* description: Encodes messages, each to the bytes contextEncode gives with
+* the same tables. Makes no allocation once encoder has coded a batch
+* atleast as big.
+* param[in]: m - The multiEncoder.
+* param[in]: texts - Chars of each message.
+* param[in]: lengths - Number of chars of each message.
+* param[in]: count - Number of messages.
+* param[out]: sizes - Number of bytes of each encoded message.
+* param[out]: out - Encoded messages one after another, owned by encoder and
+* valid until its next call.
+* return: Number of bytes of all encoded messages.
+*/
+int64_t multiEncode (multiEncoder *m, const unsigned char *const *texts,
+					 const int64_t *lengths, int count, int64_t *sizes,
+					 const unsigned char **out) {
+
+	//No kind is bigger than storing the chars, one byte more with its head.
+	int64_t need = MULTISLACK;
+	for (int i = 0; i < count; i++) {
+
+		need = need + lengths[i] + 1 + MULTISLACK;
+	}
+	if (need > m -> capacity) {
+
+		free(m -> buffer);
+		m -> buffer = malloc(need);
+		m -> capacity = need;
+	}
+
+	int next = 0;
+	int64_t pos = 0;
+#if MULTIAVX2
+	//Lanes are filled again as they end, until the batch runs out. The
+	//lanes still coding then are finished on their own.
+	if (m -> simd && count >= MULTILANES) {
+
+		for (int l = 0; l < MULTILANES; l++) {
+
+			sizes[next] = multiLoad(m, l, texts[next], lengths[next],
+									&m -> buffer[pos]);
+			pos = pos + sizes[next] + MULTISLACK;
+			next++;
+		}
+		int full = 1;
+		while (full) {
+
+			int64_t least = m -> lefts[0];
+			for (int l = 1; l < MULTILANES; l++) {
+
+				least = m -> lefts[l] < least ? m -> lefts[l] : least;
+			}
+			if (least >= 4) {
+
+				multiRun(m, least / 4);
+			}
+			for (int l = 0; l < MULTILANES && full; l++) {
+
+				if (m -> lefts[l] >= 4) {
+
+					continue;
+				}
+				multiFinish(m, l);
+				if (next == count) {
+
+					full = 0;
+					break;
+				}
+				sizes[next] = multiLoad(m, l, texts[next], lengths[next],
+										&m -> buffer[pos]);
+				pos = pos + sizes[next] + MULTISLACK;
+				next++;
+			}
+		}
+		for (int l = 0; l < MULTILANES; l++) {
+
+			if (m -> outs[l] != NULL) {
+
+				multiFinish(m, l);
+			}
+		}
+	}
+#endif
+	for (; next < count; next++) {
+
+		sizes[next] = multiLoad(m, 0, texts[next], lengths[next],
+								&m -> buffer[pos]);
+		multiFinish(m, 0);
+		pos = pos + sizes[next] + MULTISLACK;
+	}
+
+	//Messages are moved together, each to the end of the one before.
+	int64_t from = 0;
+	int64_t to = 0;
+	for (int i = 0; i < count; i++) {
+
+		memmove(&m -> buffer[to], &m -> buffer[from], sizes[i]);
+		from = from + sizes[i] + MULTISLACK;
+		to = to + sizes[i];
+	}
+	*out = m -> buffer;
+	return to;
+}
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN MULTI.C
+
+
+/* support function for multiEncoderSetTables and multiLoad!
+* description: Packs code table into packed table number index.
+* param[in]: m - The multiEncoder.
+* param[in]: index - Number of packed table.
+* param[in]: codes - CONTEXTSYMBOLS codes.
+*/
+void multiPack (multiEncoder *m, int index, const huffCode *codes) {
+
+	uint64_t *packed = &m -> packed[index * CONTEXTSYMBOLS];
+	int maxLen = 0;
+
+	for (int i = 0; i < CONTEXTSYMBOLS; i++) {
+
+		packed[i] = (uint64_t)codes[i].code | (uint64_t)codes[i].len << 32;
+		maxLen = codes[i].len > maxLen ? codes[i].len : maxLen;
+	}
+	m -> maxLens[index] = maxLen;
+}
+
+
+/* support function for multiEncode!
+* description: Picks kind and table of message, writes its head at out and
+* sets lane to code its chars after it.
+* param[in]: m - The multiEncoder.
+* param[in]: lane - Number of lane.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[in]: out - Where the encoded message starts.
+* return: Number of bytes of encoded message.
+*/
+int64_t multiLoad (multiEncoder *m, int lane, const unsigned char *text,
+				   int64_t length, unsigned char *out) {
+
+	int table = -1;
+	uint64_t bits = 0;
+	int kind = contextEncodeHead(m -> enc, text, length, &table, &bits);
+	bitString *bs = m -> enc -> bs;
+
+	if (kind == CONTEXTOWN) {
+
+		table = MULTIOWN + lane;
+		multiPack(m, table, m -> enc -> ownCodes);
+	} else if (kind == CONTEXTSTORED) {
+
+		table = MULTISTORED;
+	}
+
+	//Head leaves atmost 31 bits in the bitString, and lanes start with
+	//atmost 7, so whole bytes of them are written here.
+	if (bs -> length > 0) {
+
+		memcpy(out, bs -> encode, bs -> length);
+		out = out + bs -> length;
+	}
+	uint64_t nrOfBits = bs -> nrOfBits;
+	while (nrOfBits >= 8) {
+
+		nrOfBits = nrOfBits - 8;
+		*out++ = (unsigned char)(bs -> bitBuffer >> nrOfBits);
+	}
+
+	m -> texts[lane] = text;
+	m -> lefts[lane] = length;
+	m -> outs[lane] = out;
+	m -> bits[lane] = bs -> bitBuffer;
+	m -> nrOfBits[lane] = nrOfBits;
+	m -> tables[lane] = table * CONTEXTSYMBOLS;
+	return (int64_t)((bits + 7) / 8);
+}
+
+
+/* support function for multiEncode!
+* description: Codes chars left of lane one at a time, and pads the last
+* byte.
+* param[in]: m - The multiEncoder.
+* param[in]: lane - Number of lane.
+*/
+void multiFinish (multiEncoder *m, int lane) {
+
+	const uint64_t *packed = &m -> packed[m -> tables[lane]];
+	const unsigned char *text = m -> texts[lane];
+	unsigned char *out = m -> outs[lane];
+	uint64_t bits = m -> bits[lane];
+	uint64_t nrOfBits = m -> nrOfBits[lane];
+
+	//Buffer holds atmost 7 bits between chars, and codes are atmost 32.
+	for (int64_t i = 0; i < m -> lefts[lane]; i++) {
+
+		uint64_t entry = packed[text[i]];
+		bits = (bits << (entry >> 32)) | (entry & 0xffffffff);
+		nrOfBits = nrOfBits + (entry >> 32);
+		while (nrOfBits >= 8) {
+
+			nrOfBits = nrOfBits - 8;
+			*out++ = (unsigned char)(bits >> nrOfBits);
+		}
+	}
+	if (nrOfBits > 0) {
+
+		*out = (unsigned char)(bits << (8 - nrOfBits));
+	}
+	m -> lefts[lane] = 0;
+	m -> outs[lane] = NULL;
+}
+
+
+#if MULTIAVX2
+/* support function for multiEncode!
+* description: Codes 4 * steps chars of every lane with AVX2. Every lane
+* must have as many left.
+* param[in]: m - The multiEncoder.
+* param[in]: steps - Number of steps of 4 chars.
+*/
+__attribute__((target("avx2")))
+void multiRun (multiEncoder *m, int64_t steps) {
+
+	const __m256i swap = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0,
+										  15, 14, 13, 12, 11, 10, 9, 8,
+										  7, 6, 5, 4, 3, 2, 1, 0,
+										  15, 14, 13, 12, 11, 10, 9, 8);
+	const __m256i codeMask = _mm256_set1_epi64x(0xffffffff);
+	const __m256i bitMask = _mm256_set1_epi64x(7);
+	const __m256i width = _mm256_set1_epi64x(64);
+	const __m256i four = _mm256_set1_epi64x(4);
+	const __m128i charMask = _mm_set1_epi32(0xff);
+	const long long *packed = (const long long *)m -> packed;
+	uint64_t words[4] __attribute__((aligned(32)));
+	uint64_t addrs[4] __attribute__((aligned(32)));
+
+	//Buffers start a step with atmost 7 bits and are written out once
+	//perFlush codes more could fill their 64 bits.
+	int maxLen = 1;
+	for (int l = 0; l < MULTILANES; l++) {
+
+		int len = m -> maxLens[m -> tables[l] / CONTEXTSYMBOLS];
+		maxLen = len > maxLen ? len : maxLen;
+	}
+	int perFlush = (64 - 7) / maxLen;
+
+	//Lanes 0-3 are in the first vector of each pair, lanes 4-7 in the
+	//second.
+	__m256i texts[2];
+	__m256i outs[2];
+	__m256i bits[2];
+	__m256i nrOfBits[2];
+	__m128i tables[2];
+	for (int h = 0; h < 2; h++) {
+
+		texts[h] = _mm256_loadu_si256((const __m256i *)&m -> texts[4 * h]);
+		outs[h] = _mm256_loadu_si256((const __m256i *)&m -> outs[4 * h]);
+		bits[h] = _mm256_loadu_si256((const __m256i *)&m -> bits[4 * h]);
+		nrOfBits[h] = _mm256_loadu_si256((const __m256i *)
+										 &m -> nrOfBits[4 * h]);
+		tables[h] = _mm_loadu_si128((const __m128i *)&m -> tables[4 * h]);
+	}
+
+	for (int64_t s = 0; s < steps; s++) {
+
+		__m128i chars[2];
+		for (int h = 0; h < 2; h++) {
+
+			chars[h] = _mm256_i64gather_epi32(NULL, texts[h], 1);
+			texts[h] = _mm256_add_epi64(texts[h], four);
+		}
+		for (int c = 0; c < 4; c++) {
+
+			for (int h = 0; h < 2; h++) {
+
+				__m128i index = _mm_add_epi32(_mm_and_si128(chars[h],
+															charMask),
+											  tables[h]);
+				__m256i entry = _mm256_i32gather_epi64(packed, index, 8);
+				__m256i len = _mm256_srli_epi64(entry, 32);
+				bits[h] = _mm256_or_si256(_mm256_sllv_epi64(bits[h], len),
+										  _mm256_and_si256(entry, codeMask));
+				nrOfBits[h] = _mm256_add_epi64(nrOfBits[h], len);
+				chars[h] = _mm_srli_epi32(chars[h], 8);
+			}
+			if ((c + 1) % perFlush != 0 && c < 3) {
+
+				continue;
+			}
+
+			//Bits are moved to the top, bytes put in memory order, and 8
+			//bytes written, of which the whole ones are kept.
+			for (int h = 0; h < 2; h++) {
+
+				__m256i top = _mm256_sllv_epi64(bits[h],
+												_mm256_sub_epi64(width,
+																 nrOfBits[h]));
+				_mm256_store_si256((__m256i *)words,
+								   _mm256_shuffle_epi8(top, swap));
+				_mm256_store_si256((__m256i *)addrs, outs[h]);
+				for (int l = 0; l < 4; l++) {
+
+					memcpy((void *)(uintptr_t)addrs[l], &words[l], 8);
+				}
+				outs[h] = _mm256_add_epi64(outs[h],
+										   _mm256_srli_epi64(nrOfBits[h], 3));
+				nrOfBits[h] = _mm256_and_si256(nrOfBits[h], bitMask);
+			}
+		}
+	}
+
+	for (int h = 0; h < 2; h++) {
+
+		_mm256_storeu_si256((__m256i *)&m -> texts[4 * h], texts[h]);
+		_mm256_storeu_si256((__m256i *)&m -> outs[4 * h], outs[h]);
+		_mm256_storeu_si256((__m256i *)&m -> bits[4 * h], bits[h]);
+		_mm256_storeu_si256((__m256i *)&m -> nrOfBits[4 * h], nrOfBits[h]);
+	}
+	for (int l = 0; l < MULTILANES; l++) {
+
+		m -> lefts[l] = m -> lefts[l] - 4 * steps;
+	}
+}
+#endif
@@ -0,0 +1,159 @@
+/*
+* multi: Encoder coding a batch of small messages at once, one message per
+* lane. Each message is coded as contextEncode codes it, to the same bytes,
+* so a contextDecoder decodes it. See context.h.
+*
+* Kind and table of each message are picked one message at a time, as by
+* contextEncode. The codes are then packed for MULTILANES messages at once:
+* each lane has its own text, output and 64-bit bit buffer, and the lanes
+* take turns being given the next message of the batch as they end. With
+* AVX2, four chars of every lane are read by one gather, their codes by one
+* gather per char from packed code tables, and the bit buffers of all lanes
+* are shifted, added to and written out in vectors. Without AVX2, or with
+* simd set to 0, every lane is coded on its own, by the same steps.
+*
+* A packed code table has a 64-bit entry per char, the code in the low 32
+* bits and its length above them. The tables of the shared tables, of stored
+* chars and of the own table of each lane are kept in one array, so a lane
+* is set to a table by the index of its first entry.
+*/
+
+#ifndef MULTI
+#define MULTI
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "context.h"
+
+#define MULTILANES 8
+//Lanes write 8 bytes at a time, so messages are coded this far apart and
+//moved together after.
+#define MULTISLACK 8
+//Packed tables: shared tables, stored chars, then own table of each lane.
+#define MULTISTORED CONTEXTMAXTABLES
+#define MULTIOWN (CONTEXTMAXTABLES + 1)
+#define MULTITABLES (CONTEXTMAXTABLES + 1 + MULTILANES)
+//Lanes are coded with AVX2 where gcc can build it for x86-64.
+#if defined(__x86_64__) && defined(__GNUC__)
+#define MULTIAVX2 1
+#else
+#define MULTIAVX2 0
+#endif
+
+
+typedef struct multiEncoder {
+
+	contextEncoder *enc;
+	uint64_t *packed;
+	//Longest code of each packed table.
+	int maxLens[MULTITABLES];
+	//1 to code lanes with AVX2, set when the CPU has it.
+	int simd;
+	//State of lanes, each field in an array so it loads into a vector.
+	const unsigned char *texts[MULTILANES];
+	int64_t lefts[MULTILANES];
+	unsigned char *outs[MULTILANES];
+	uint64_t bits[MULTILANES];
+	uint64_t nrOfBits[MULTILANES];
+	int32_t tables[MULTILANES];
+	unsigned char *buffer;
+	int64_t capacity;
+} multiEncoder;
+
+
+/*
+* description: Creates encoder without shared table. Allocates memory for
+* multiEncoder.
+* return: The multiEncoder.
+*/
+multiEncoder *multiEncoderEmpty (void);
+
+
+/*
+* description: Deallocates all memory of multiEncoder, and drops its holds
+* of its tables.
+* param[in]: m - The multiEncoder.
+*/
+void multiEncoderKill (multiEncoder *m);
+
+
+/*
+* description: Sets shared tables of encoder, as contextEncoderSetTables,
+* and packs their codes.
+* param[in]: m - The multiEncoder.
+* param[in]: tables - The tables.
+* param[in]: count - Number of tables, 0 to reset encoder to having no
+* shared table.
+* return: 1 if tables were set, 0 if count is above CONTEXTMAXTABLES.
+*/
+int multiEncoderSetTables (multiEncoder *m, contextTable *const *tables,
+						   int count);
+
+
+/*
+* description: Encodes messages, each to the bytes contextEncode gives with
+* the same tables. Makes no allocation once encoder has coded a batch
+* atleast as big.
+* param[in]: m - The multiEncoder.
+* param[in]: texts - Chars of each message.
+* param[in]: lengths - Number of chars of each message.
+* param[in]: count - Number of messages.
+* param[out]: sizes - Number of bytes of each encoded message.
+* param[out]: out - Encoded messages one after another, owned by encoder and
+* valid until its next call.
+* return: Number of bytes of all encoded messages.
+*/
+int64_t multiEncode (multiEncoder *m, const unsigned char *const *texts,
+					 const int64_t *lengths, int count, int64_t *sizes,
+					 const unsigned char **out);
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN MULTI.C
+
+
+/* support function for multiEncoderSetTables and multiLoad!
+* description: Packs code table into packed table number index.
+* param[in]: m - The multiEncoder.
+* param[in]: index - Number of packed table.
+* param[in]: codes - CONTEXTSYMBOLS codes.
+*/
+void multiPack (multiEncoder *m, int index, const huffCode *codes);
+
+
+/* support function for multiEncode!
+* description: Picks kind and table of message, writes its head at out and
+* sets lane to code its chars after it.
+* param[in]: m - The multiEncoder.
+* param[in]: lane - Number of lane.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[in]: out - Where the encoded message starts.
+* return: Number of bytes of encoded message.
+*/
+int64_t multiLoad (multiEncoder *m, int lane, const unsigned char *text,
+				   int64_t length, unsigned char *out);
+
+
+/* support function for multiEncode!
+* description: Codes chars left of lane one at a time, and pads the last
+* byte.
+* param[in]: m - The multiEncoder.
+* param[in]: lane - Number of lane.
+*/
+void multiFinish (multiEncoder *m, int lane);
+
+
+#if MULTIAVX2
+/* support function for multiEncode!
+* description: Codes 4 * steps chars of every lane with AVX2. Every lane
+* must have as many left.
+* param[in]: m - The multiEncoder.
+* param[in]: steps - Number of steps of 4 chars.
+*/
+void multiRun (multiEncoder *m, int64_t steps);
+#endif
+
+
+#endif //MULTI
@@ -0,0 +1,365 @@
+/*
+* order1: Order-1 context mode. Each char is coded with a code table picked
+* by the char before it, so chars that often follow each other get short
+* codes. See order1.h for the layout of the payload.
+*/
+
+#include "order1.h"
+#include "encode.h"
+
+
+/*
+* description: Builds order-1 model from chars in memory. Allocates memory
+* for order1Model.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* return: The order1Model.
+*/
+order1Model *order1Build (const unsigned char *text, int64_t length) {
+
+	uint64_t (*freq)[ORDER1SYMBOLS] = calloc(ORDER1CONTEXTS,
+											 sizeof(*freq));
+	uint8_t (*own)[ORDER1SYMBOLS] = malloc(ORDER1CONTEXTS * sizeof(*own));
+	uint64_t total[ORDER1SYMBOLS] = {0};
+	uint8_t sharedLengths[ORDER1SYMBOLS];
+	int hasOwn[ORDER1CONTEXTS] = {0};
+	int nrOfOwn = 0;
+	unsigned char previous = 0;
+
+	for (int64_t i = 0; i < length; i++) {
+
+		freq[previous][text[i]]++;
+		total[text[i]]++;
+		previous = text[i];
+	}
+
+	//A context gets own table only if it beats the order-0 table including
+	//the cost of storing the table.
+	canonicalCodeLengths(total, ORDER1SYMBOLS, HUFFMAXCODELEN, sharedLengths);
+	for (int c = 0; c < ORDER1CONTEXTS; c++) {
+
+		if (canonicalCodeLengths(freq[c], ORDER1SYMBOLS, HUFFMAXCODELEN,
+								 own[c]) > 1) {
+
+			int64_t ownCost = order1CodeCost(freq[c], own[c]) +
+							  canonicalLengthsCost(own[c], ORDER1SYMBOLS);
+			int64_t sharedCost = order1CodeCost(freq[c], sharedLengths);
+
+			if (ownCost < sharedCost) {
+
+				hasOwn[c] = 1;
+				nrOfOwn++;
+			}
+		}
+	}
+
+	//Shared table is rebuilt from the contexts that ended up using it.
+	order1Model *model = order1Empty(nrOfOwn + 1);
+	for (int s = 0; s < ORDER1SYMBOLS; s++) {
+
+		total[s] = 0;
+	}
+
+	int table = 1;
+	for (int c = 0; c < ORDER1CONTEXTS; c++) {
+
+		if (hasOwn[c]) {
+
+			model -> tableOf[c] = table;
+			memcpy(model -> lengths[table], own[c], ORDER1SYMBOLS);
+			table++;
+		} else {
+
+			model -> tableOf[c] = 0;
+			for (int s = 0; s < ORDER1SYMBOLS; s++) {
+
+				total[s] = total[s] + freq[c][s];
+			}
+		}
+	}
+	canonicalCodeLengths(total, ORDER1SYMBOLS, HUFFMAXCODELEN,
+						 model -> lengths[0]);
+
+	for (int t = 0; t < model -> nrOfTables; t++) {
+
+		canonicalAssignCodes(model -> lengths[t], ORDER1SYMBOLS,
+							 model -> codes[t]);
+	}
+
+	free(own);
+	free(freq);
+	return model;
+}
+
+
+/*
+* description: Deallocates all memory allocated by order1Model.
+* param[in]: model - The order1Model.
+*/
+void order1Kill (order1Model *model) {
+
+	free(model -> lengths);
+	free(model -> codes);
+	free(model);
+}
+
+
+/*
+* description: Writes tables of model to bitString.
+* param[in]: model - The order1Model.
+* param[in]: bs - The bitString.
+*/
+void order1WriteTables (order1Model *model, bitString *bs) {
+
+	canonicalWriteGamma(bs, model -> nrOfTables);
+
+	if (model -> nrOfTables > 1) {
+
+		for (int c = 0; c < ORDER1CONTEXTS; c++) {
+
+			bitStringAddCode(bs, model -> tableOf[c] != 0, 1);
+		}
+	}
+
+	for (int t = 0; t < model -> nrOfTables; t++) {
+
+		canonicalWriteLengths(bs, model -> lengths[t], ORDER1SYMBOLS);
+	}
+}
+
+
+/*
+* description: Reads tables written by order1WriteTables and builds model.
+* Allocates memory for order1Model.
+* param[in]: bs - The bitString.
+* param[in]: bitPos - Position of next bit to read. Moved past the tables.
+* return: The order1Model, NULL if tables are not valid.
+*/
+order1Model *order1ReadTables (bitString *bs, int64_t *bitPos) {
+
+	uint32_t nrOfTables = canonicalReadGamma(bs, bitPos);
+
+	if (nrOfTables == 0 || nrOfTables > ORDER1CONTEXTS + 1) {
+
+		return NULL;
+	}
+
+	order1Model *model = order1Empty(nrOfTables);
+	int table = 1;
+
+	for (int c = 0; c < ORDER1CONTEXTS; c++) {
+
+		model -> tableOf[c] = 0;
+		if (nrOfTables > 1 && bitStringGetBit(bs, *bitPos)) {
+
+			model -> tableOf[c] = table;
+			table++;
+		}
+		if (nrOfTables > 1) {
+
+			(*bitPos)++;
+		}
+	}
+
+	int valid = (uint32_t)table == nrOfTables;
+	for (int t = 0; valid && t < model -> nrOfTables; t++) {
+
+		valid = canonicalReadLengths(bs, bitPos, model -> lengths[t],
+									 ORDER1SYMBOLS);
+	}
+
+	if (!valid) {
+
+		order1Kill(model);
+		return NULL;
+	}
+
+	for (int t = 0; t < model -> nrOfTables; t++) {
+
+		canonicalAssignCodes(model -> lengths[t], ORDER1SYMBOLS,
+							 model -> codes[t]);
+	}
+	return model;
+}
+
+
+/*
+* description: Encodes chars in memory with model and adds codes to
+* bitString.
+* param[in]: model - The order1Model.
+* param[in]: bs - The bitString.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+*/
+void order1Encode (order1Model *model, bitString *bs,
+				   const unsigned char *text, int64_t length) {
+
+	unsigned char previous = 0;
+
+	for (int64_t i = 0; i < length; i++) {
+
+		huffCode hc = model -> codes[model -> tableOf[previous]][text[i]];
+		bitStringAddCode(bs, hc.code, hc.len);
+		previous = text[i];
+	}
+}
+
+
+/*
+* description: Decodes chars from bitString with model.
+* param[in]: model - The order1Model.
+* param[in]: bs - The bitString.
+* param[in]: bitPos - Position of next bit to read. Moved past the codes.
+* param[out]: text - Array to store atleast length chars in.
+* param[in]: length - Number of chars to decode.
+* return: 1 if all chars could be decoded, 0 if codes are not valid or run
+* past the end of bitString.
+*/
+int order1Decode (order1Model *model, bitString *bs, int64_t *bitPos,
+				  unsigned char *text, int64_t length) {
+
+	canonicalDecoder **decoders = malloc(sizeof(canonicalDecoder*) *
+										 model -> nrOfTables);
+	unsigned char previous = 0;
+	int64_t end = bitStringGetSize(bs) * 8;
+	int valid = 1;
+
+	for (int t = 0; t < model -> nrOfTables; t++) {
+
+		decoders[t] = canonicalDecoderBuild(model -> lengths[t],
+											ORDER1SYMBOLS);
+	}
+
+	for (int64_t i = 0; valid && i < length; i++) {
+
+		int key = canonicalDecodeKey(decoders[model -> tableOf[previous]],
+									 bs, bitPos);
+		if (key < 0 || *bitPos > end) {
+
+			valid = 0;
+		} else {
+
+			text[i] = (unsigned char)key;
+			previous = (unsigned char)key;
+		}
+	}
+
+	for (int t = 0; t < model -> nrOfTables; t++) {
+
+		canonicalDecoderKill(decoders[t]);
+	}
+	free(decoders);
+	return valid;
+}
+
+
+/*
+* description: Reads file, builds order-1 model from it and writes encoded
+* file with tables in front of the codes.
+* param[in]: file1 - Name of file to be read and encoded.
+* param[in]: file2 - Name of file to be written as encoded file.
+* return: 1 if file2 was written, else 0.
+*/
+int order1EncodeFile (char const *file1, char const *file2) {
+
+	int64_t length = 0;
+	unsigned char *text = readPlainFile(file1, &length);
+	order1Model *model = order1Build(text, length);
+	bitString *bs = bitStringEmpty();
+
+	order1WriteTables(model, bs);
+	order1Encode(model, bs, text, length);
+
+	unsigned char *encode = bitStringGetEncode(bs);
+	int valid = writeEncode(file2, FORMATMODEORDER1, length, encode,
+							bitStringGetSize(bs));
+
+	bitStringKill(bs);
+	order1Kill(model);
+	free(text);
+	return valid;
+}
+
+
+/*
+* description: Decodes order-1 payload and writes decoded file.
+* param[in]: file2 - Name of file to write decode.
+* param[in]: bs - The bitString with payload after file header.
+* param[in]: originalLength - Number of chars to decode.
+* return: 1 if payload could be decoded, else 0.
+*/
+int order1DecodeFile (char const *file2, bitString *bs,
+					  uint64_t originalLength) {
+
+	int64_t bitPos = 0;
+	order1Model *model = order1ReadTables(bs, &bitPos);
+
+	if (model == NULL) {
+
+		return 0;
+	}
+
+	//Every char has a code of atleast one bit.
+	unsigned char *text = NULL;
+	if (formatLengthFits(originalLength, bitStringGetSize(bs), 8)) {
+
+		text = malloc(originalLength > 0 ? originalLength : 1);
+	}
+	if (text == NULL) {
+
+		order1Kill(model);
+		return 0;
+	}
+	int valid = order1Decode(model, bs, &bitPos, text, originalLength);
+
+	if (valid) {
+
+		valid = writePlainFile(file2, text, originalLength);
+	}
+
+	free(text);
+	order1Kill(model);
+	return valid;
+}
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN ORDER1.C
+
+
+/* support function for order1Build and order1ReadTables!
+* description: Allocates order1Model with room for nrOfTables tables.
+* param[in]: nrOfTables - Number of tables.
+* return: The order1Model.
+*/
+order1Model *order1Empty (int nrOfTables) {
+
+	order1Model *model = malloc(sizeof(order1Model));
+
+	model -> nrOfTables = nrOfTables;
+	model -> lengths = malloc(nrOfTables * sizeof(*model -> lengths));
+	model -> codes = malloc(nrOfTables * sizeof(*model -> codes));
+	return model;
+}
+
+
+/* support function for order1Build!
+* description: Computes number of bits it takes to code a histogram with
+* given code lengths.
+* param[in]: freqTable - The histogram.
+* param[in]: lengths - The code lengths.
+* return: Number of bits, -1 if a char in histogram has no code.
+*/
+int64_t order1CodeCost (const uint64_t *freqTable, const uint8_t *lengths) {
+
+	int64_t cost = 0;
+
+	for (int s = 0; s < ORDER1SYMBOLS; s++) {
+
+		if (freqTable[s] > 0 && lengths[s] == 0) {
+
+			return -1;
+		}
+		cost = cost + freqTable[s] * lengths[s];
+	}
+	return cost;
+}
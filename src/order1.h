@@ -0,0 +1,145 @@
+/*
+* order1: Order-1 context mode. Each char is coded with a code table picked
+* by the char before it, so chars that often follow each other get short
+* codes.
+*
+* A histogram is made for each of the 256 contexts. A context gets it's own
+* table only if that saves more bits than the table costs to store, all other
+* contexts share one table. Tables are stored as code lengths in front of the
+* codes, so the encoded file does not depend on the analysis file.
+*
+* Payload after file header:
+*   gamma(number of tables), table 0 is the shared table
+*   if more than one table: one bit per context, 1 if context has own table
+*   code lengths of each table, in table order
+*   codes of all chars, first char uses context 0
+*/
+
+#ifndef ORDER1
+#define ORDER1
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "huffTree.h"
+#include "bitString.h"
+#include "canonical.h"
+
+#define ORDER1CONTEXTS 256
+#define ORDER1SYMBOLS 256
+
+
+typedef struct order1Model {
+
+	int nrOfTables;
+	int tableOf[ORDER1CONTEXTS];
+	uint8_t (*lengths)[ORDER1SYMBOLS];
+	huffCode (*codes)[ORDER1SYMBOLS];
+} order1Model;
+
+
+/*
+* description: Builds order-1 model from chars in memory. Allocates memory
+* for order1Model.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* return: The order1Model.
+*/
+order1Model *order1Build (const unsigned char *text, int64_t length);
+
+
+/*
+* description: Deallocates all memory allocated by order1Model.
+* param[in]: model - The order1Model.
+*/
+void order1Kill (order1Model *model);
+
+
+/*
+* description: Writes tables of model to bitString.
+* param[in]: model - The order1Model.
+* param[in]: bs - The bitString.
+*/
+void order1WriteTables (order1Model *model, bitString *bs);
+
+
+/*
+* description: Reads tables written by order1WriteTables and builds model.
+* Allocates memory for order1Model.
+* param[in]: bs - The bitString.
+* param[in]: bitPos - Position of next bit to read. Moved past the tables.
+* return: The order1Model, NULL if tables are not valid.
+*/
+order1Model *order1ReadTables (bitString *bs, int64_t *bitPos);
+
+
+/*
+* description: Encodes chars in memory with model and adds codes to
+* bitString.
+* param[in]: model - The order1Model.
+* param[in]: bs - The bitString.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+*/
+void order1Encode (order1Model *model, bitString *bs,
+				   const unsigned char *text, int64_t length);
+
+
+/*
+* description: Decodes chars from bitString with model.
+* param[in]: model - The order1Model.
+* param[in]: bs - The bitString.
+* param[in]: bitPos - Position of next bit to read. Moved past the codes.
+* param[out]: text - Array to store atleast length chars in.
+* param[in]: length - Number of chars to decode.
+* return: 1 if all chars could be decoded, 0 if codes are not valid or run
+* past the end of bitString.
+*/
+int order1Decode (order1Model *model, bitString *bs, int64_t *bitPos,
+				  unsigned char *text, int64_t length);
+
+
+/*
+* description: Reads file, builds order-1 model from it and writes encoded
+* file with tables in front of the codes.
+* param[in]: file1 - Name of file to be read and encoded.
+* param[in]: file2 - Name of file to be written as encoded file.
+* return: 1 if file2 was written, else 0.
+*/
+int order1EncodeFile (char const *file1, char const *file2);
+
+
+/*
+* description: Decodes order-1 payload and writes decoded file.
+* param[in]: file2 - Name of file to write decode.
+* param[in]: bs - The bitString with payload after file header.
+* param[in]: originalLength - Number of chars to decode.
+* return: 1 if payload could be decoded, else 0.
+*/
+int order1DecodeFile (char const *file2, bitString *bs,
+					  uint64_t originalLength);
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN ORDER1.C
+
+
+/* support function for order1Build and order1ReadTables!
+* description: Allocates order1Model with room for nrOfTables tables.
+* param[in]: nrOfTables - Number of tables.
+* return: The order1Model.
+*/
+order1Model *order1Empty (int nrOfTables);
+
+
+/* support function for order1Build!
+* description: Computes number of bits it takes to code a histogram with
+* given code lengths.
+* param[in]: freqTable - The histogram.
+* param[in]: lengths - The code lengths.
+* return: Number of bits, -1 if a char in histogram has no code.
+*/
+int64_t order1CodeCost (const uint64_t *freqTable, const uint8_t *lengths);
+
+
+#endif //ORDER1
@@ -0,0 +1,327 @@
+/*
+* pipeline: Reading, coding and writing of blocks in their own threads,
+* connected by rings. See pipeline.h.
+*/
+
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "pipeline.h"
+
+
+/*
+* description: Creates pipeline and buffers of its blocks.
+* param[in]: read - Reading stage.
+* param[in]: code - Coding stage.
+* param[in]: write - Writing stage.
+* param[in]: state - Passed to every stage.
+* param[in]: inSize - Size of input buffer of each block.
+* param[in]: outSize - Size of output buffer of each block.
+* param[in]: workers - Pool coding blocks, NULL to code in coder thread.
+* return: The pipeline.
+*/
+pipeline *pipelineEmpty (pipelineStage read, pipelineStage code,
+						 pipelineStage write, void *state, int64_t inSize,
+						 int64_t outSize, pool *workers) {
+
+	pipeline *p = malloc(sizeof(pipeline));
+
+	p -> stages[PIPELINEREAD] = read;
+	p -> stages[PIPELINECODE] = code;
+	p -> stages[PIPELINEWRITE] = write;
+	p -> state = state;
+	p -> workers = workers;
+	p -> nrOfBlocks = PIPELINEBLOCKS;
+	if (workers != NULL) {
+
+		p -> nrOfBlocks = 2 * poolSize(workers) + 2;
+		if (p -> nrOfBlocks > PIPELINEMAXBLOCKS) {
+
+			p -> nrOfBlocks = PIPELINEMAXBLOCKS;
+		}
+	}
+
+	for (int i = 0; i < PIPELINESTAGES; i++) {
+
+		p -> rings[i] = ringEmpty();
+	}
+	p -> blocks = malloc(sizeof(pipelineBlock) * p -> nrOfBlocks);
+	for (int i = 0; i < p -> nrOfBlocks; i++) {
+
+		p -> blocks[i].in = malloc(inSize);
+		p -> blocks[i].out = malloc(outSize);
+		p -> blocks[i].owner = p;
+	}
+	return p;
+}
+
+
+/*
+* description: Frees memory of pipeline and its blocks.
+* param[in]: p - The pipeline.
+*/
+void pipelineKill (pipeline *p) {
+
+	for (int i = 0; i < PIPELINESTAGES; i++) {
+
+		ringKill(p -> rings[i]);
+	}
+	for (int i = 0; i < p -> nrOfBlocks; i++) {
+
+		free(p -> blocks[i].in);
+		free(p -> blocks[i].out);
+	}
+	free(p -> blocks);
+	free(p);
+}
+
+
+/*
+* description: Runs stages until reader sets last or a stage fails. Reader
+* and coder get own threads, writer runs in calling thread.
+* param[in]: p - The pipeline.
+* return: 1 if all stages succeeded, else 0.
+*/
+int pipelineRun (pipeline *p) {
+
+	pipelineWorker workers[PIPELINESTAGES];
+	pthread_t threads[PIPELINESTAGES];
+
+	//Rings may hold blocks of a failed run.
+	for (int i = 0; i < PIPELINESTAGES; i++) {
+
+		ringKill(p -> rings[i]);
+		p -> rings[i] = ringEmpty();
+		p -> busy[i] = 0;
+		p -> stall[i] = 0;
+	}
+	p -> failed = 0;
+	poolGroupInit(&p -> coding);
+
+	//All blocks start free, waiting for the reader.
+	for (int i = 0; i < p -> nrOfBlocks; i++) {
+
+		ringPush(p -> rings[PIPELINEREAD], &p -> blocks[i]);
+	}
+
+	for (int i = 0; i < PIPELINESTAGES; i++) {
+
+		workers[i].p = p;
+		workers[i].stage = i;
+	}
+	for (int i = PIPELINEREAD; i < PIPELINEWRITE; i++) {
+
+		pthread_create(&threads[i], NULL, pipelineStageRun, &workers[i]);
+	}
+	pipelineStageRun(&workers[PIPELINEWRITE]);
+	for (int i = PIPELINEREAD; i < PIPELINEWRITE; i++) {
+
+		pthread_join(threads[i], NULL);
+	}
+	//Blocks still being coded after a failure must not be freed yet.
+	if (p -> workers != NULL) {
+
+		poolWait(p -> workers, &p -> coding);
+	}
+
+	return !p -> failed;
+}
+
+
+/*
+* description: Prints busy and stall time of each stage of last run.
+* param[in]: p - The pipeline.
+* param[in]: fp - File to print to.
+*/
+void pipelinePrintStats (pipeline *p, FILE *fp) {
+
+	char const *names[PIPELINESTAGES] = {"read", "code", "write"};
+
+	for (int i = 0; i < PIPELINESTAGES; i++) {
+
+		fprintf(fp, "%-6s busy %8.3f s  stalled %8.3f s\n", names[i],
+				p -> busy[i], p -> stall[i]);
+	}
+}
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN PIPELINE.C
+
+
+/* support function for pipelineRun!
+* description: Thread of one stage. Takes blocks from ring of stage, handles
+* them and gives them to next stage until last block.
+* param[in]: arg - The pipelineWorker.
+* return: NULL.
+*/
+void *pipelineStageRun (void *arg) {
+
+	pipelineWorker *worker = arg;
+	pipeline *p = worker -> p;
+	int stage = worker -> stage;
+	ring *next = p -> rings[(stage + 1) % PIPELINESTAGES];
+	pipelineBlock *block = NULL;
+
+	while ((block = pipelineTake(p, stage)) != NULL) {
+
+		if (stage == PIPELINEREAD) {
+
+			block -> last = 0;
+		}
+
+		if (!block -> last && stage == PIPELINECODE && p -> workers != NULL) {
+
+			//Pool codes block, writer waits for it to be done.
+			__atomic_store_n(&block -> done, 0, __ATOMIC_RELEASE);
+			poolSubmit(p -> workers, &p -> coding, pipelineCodeTask, block);
+		} else if (!block -> last) {
+
+			int valid = stage != PIPELINEWRITE || p -> workers == NULL ||
+						pipelineAwait(p, block);
+
+			if (valid) {
+
+				double start = pipelineNow();
+				valid = p -> stages[stage](p -> state, block);
+				p -> busy[stage] = p -> busy[stage] + pipelineNow() - start;
+			}
+			if (!valid) {
+
+				__atomic_store_n(&p -> failed, 1, __ATOMIC_RELEASE);
+				break;
+			}
+		}
+
+		//Writer is last to see the last block, it is not passed on. Block
+		//belongs to next stage once pushed, so last is read before.
+		int last = block -> last;
+		if (last && stage == PIPELINEWRITE) {
+
+			break;
+		}
+		ringPush(next, block);
+		if (last) {
+
+			break;
+		}
+	}
+	return NULL;
+}
+
+
+/* support function for pipelineStageRun!
+* description: Takes next block from ring of stage, waiting while it is
+* empty. Time waited is added to stall of stage.
+* param[in]: p - The pipeline.
+* param[in]: stage - The stage.
+* return: The block, NULL if pipeline failed while waiting.
+*/
+pipelineBlock *pipelineTake (pipeline *p, int stage) {
+
+	pipelineBlock *block = ringPop(p -> rings[stage]);
+
+	if (block != NULL) {
+
+		return block;
+	}
+
+	double start = pipelineNow();
+	for (int tries = 0; block == NULL; tries++) {
+
+		if (__atomic_load_n(&p -> failed, __ATOMIC_ACQUIRE)) {
+
+			break;
+		}
+		pipelinePause(tries);
+		block = ringPop(p -> rings[stage]);
+	}
+
+	p -> stall[stage] = p -> stall[stage] + pipelineNow() - start;
+	return block;
+}
+
+
+/* support function for pipelineStageRun!
+* description: Task coding one block in the pool, sets done when finished.
+* param[in]: arg - The pipelineBlock.
+*/
+void pipelineCodeTask (void *arg) {
+
+	pipelineBlock *block = arg;
+	pipeline *p = block -> owner;
+	double start = pipelineNow();
+
+	block -> valid = p -> stages[PIPELINECODE](p -> state, block);
+	block -> busy = pipelineNow() - start;
+	if (!block -> valid) {
+
+		__atomic_store_n(&p -> failed, 1, __ATOMIC_RELEASE);
+	}
+	__atomic_store_n(&block -> done, 1, __ATOMIC_RELEASE);
+}
+
+
+/* support function for pipelineStageRun!
+* description: Waits until pool has coded block. Time waited is added to
+* stall of writer and coding time of block to busy of coder.
+* param[in]: p - The pipeline.
+* param[in]: block - The block.
+* return: 1 if block was coded, 0 if it or pipeline failed.
+*/
+int pipelineAwait (pipeline *p, pipelineBlock *block) {
+
+	double start = pipelineNow();
+
+	for (int tries = 0; !__atomic_load_n(&block -> done, __ATOMIC_ACQUIRE);
+		 tries++) {
+
+		if (__atomic_load_n(&p -> failed, __ATOMIC_ACQUIRE)) {
+
+			break;
+		}
+		pipelinePause(tries);
+	}
+
+	p -> stall[PIPELINEWRITE] = p -> stall[PIPELINEWRITE] + pipelineNow() - start;
+	if (!__atomic_load_n(&block -> done, __ATOMIC_ACQUIRE)) {
+
+		return 0;
+	}
+	//Coder thread adds no busy time when a pool codes, so writer may.
+	p -> busy[PIPELINECODE] = p -> busy[PIPELINECODE] + block -> busy;
+	return block -> valid;
+}
+
+
+/* support function for pipelineTake and pipelineAwait!
+* description: Backs off while waiting: spins first, then yields and then
+* sleeps.
+* param[in]: tries - Number of polls that found nothing so far.
+*/
+void pipelinePause (int tries) {
+
+	//Short waits spin, longer ones give the core to the other stages.
+	struct timespec nap = {0, PIPELINESLEEPNS};
+
+	if (tries >= 2 * PIPELINESPINS) {
+
+		nanosleep(&nap, NULL);
+	} else if (tries >= PIPELINESPINS) {
+
+		sched_yield();
+	}
+}
+
+
+/* support function for pipelineStageRun, pipelineTake and pipelineAwait!
+* description: Gets time from a monotonic clock.
+* return: Time in seconds.
+*/
+double pipelineNow (void) {
+
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
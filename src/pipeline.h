@@ -0,0 +1,194 @@
+/*
+* pipeline: Three stage pipeline running reading, coding and writing of
+* blocks in their own threads, so input, output and coding overlap.
+*
+* A fixed set of PIPELINEBLOCKS blocks, each with an input and an output
+* buffer, circles through three rings, one ahead of each stage: the reader
+* takes a free block and fills it, the coder codes it and the writer writes
+* it and gives it back as free.
+* Each ring has one producer and one consumer, see ring.h. As rings can hold
+* all blocks a push never waits, so a stage only waits when the ring it takes
+* blocks from is empty. That time is counted as the stall of the stage: a
+* reader stalls when coder or writer is slower, a writer when reader or coder
+* is slower.
+*
+* With a pool the coder only hands blocks to the pool, which codes several at
+* once, and passes them on straight away. Writer then waits for each block to
+* be coded in turn, so output keeps the order of input. There are more blocks
+* then, so every worker can have one.
+*/
+
+#ifndef PIPELINE
+#define PIPELINE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "ring.h"
+#include "stream.h"
+#include "pool.h"
+
+#define PIPELINEBLOCKS 4
+//Blocks with a pool are 2 per worker and 2 in reading and writing, atmost
+//what a ring holds.
+#define PIPELINEMAXBLOCKS RINGSIZE
+#define PIPELINESTAGES 3
+#define PIPELINEREAD 0
+#define PIPELINECODE 1
+#define PIPELINEWRITE 2
+//Empty polls of a ring before a waiting stage yields, and then sleeps.
+#define PIPELINESPINS 64
+#define PIPELINESLEEPNS 20000
+
+
+typedef struct pipelineConfig {
+
+	int stats;
+	streamConfig io;
+	pool *workers;
+} pipelineConfig;
+
+
+typedef struct pipelineBlock {
+
+	unsigned char *in;
+	unsigned char *out;
+	int64_t inLength;
+	int64_t outLength;
+	int64_t length;
+	int mode;
+	int last;
+	int done;
+	int valid;
+	double busy;
+	struct pipeline *owner;
+} pipelineBlock;
+
+
+/*
+* Stage of pipeline. Reader fills in of block, or sets last when input has
+* ended. Coder codes in into out and writer writes out. Coder and writer are
+* not called for the last block.
+* return: 1 if block was handled, 0 on error, which stops the pipeline.
+*/
+typedef int (*pipelineStage) (void *state, pipelineBlock *block);
+
+
+typedef struct pipeline {
+
+	pipelineStage stages[PIPELINESTAGES];
+	void *state;
+	ring *rings[PIPELINESTAGES];
+	pipelineBlock *blocks;
+	int nrOfBlocks;
+	pool *workers;
+	poolGroup coding;
+	int failed;
+	double busy[PIPELINESTAGES];
+	double stall[PIPELINESTAGES];
+} pipeline;
+
+
+/*
+* description: Creates pipeline and buffers of its blocks.
+* param[in]: read - Reading stage.
+* param[in]: code - Coding stage.
+* param[in]: write - Writing stage.
+* param[in]: state - Passed to every stage.
+* param[in]: inSize - Size of input buffer of each block.
+* param[in]: outSize - Size of output buffer of each block.
+* param[in]: workers - Pool coding blocks, NULL to code in coder thread.
+* return: The pipeline.
+*/
+pipeline *pipelineEmpty (pipelineStage read, pipelineStage code,
+						 pipelineStage write, void *state, int64_t inSize,
+						 int64_t outSize, pool *workers);
+
+
+/*
+* description: Frees memory of pipeline and its blocks.
+* param[in]: p - The pipeline.
+*/
+void pipelineKill (pipeline *p);
+
+
+/*
+* description: Runs stages until reader sets last or a stage fails. Reader
+* and coder get own threads, writer runs in calling thread.
+* param[in]: p - The pipeline.
+* return: 1 if all stages succeeded, else 0.
+*/
+int pipelineRun (pipeline *p);
+
+
+/*
+* description: Prints busy and stall time of each stage of last run.
+* param[in]: p - The pipeline.
+* param[in]: fp - File to print to.
+*/
+void pipelinePrintStats (pipeline *p, FILE *fp);
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN PIPELINE.C
+
+
+typedef struct pipelineWorker {
+
+	pipeline *p;
+	int stage;
+} pipelineWorker;
+
+
+/* support function for pipelineRun!
+* description: Thread of one stage. Takes blocks from ring of stage, handles
+* them and gives them to next stage until last block.
+* param[in]: arg - The pipelineWorker.
+* return: NULL.
+*/
+void *pipelineStageRun (void *arg);
+
+
+/* support function for pipelineStageRun!
+* description: Takes next block from ring of stage, waiting while it is
+* empty. Time waited is added to stall of stage.
+* param[in]: p - The pipeline.
+* param[in]: stage - The stage.
+* return: The block, NULL if pipeline failed while waiting.
+*/
+pipelineBlock *pipelineTake (pipeline *p, int stage);
+
+
+/* support function for pipelineStageRun!
+* description: Task coding one block in the pool, sets done when finished.
+* param[in]: arg - The pipelineBlock.
+*/
+void pipelineCodeTask (void *arg);
+
+
+/* support function for pipelineStageRun!
+* description: Waits until pool has coded block. Time waited is added to
+* stall of writer and coding time of block to busy of coder.
+* param[in]: p - The pipeline.
+* param[in]: block - The block.
+* return: 1 if block was coded, 0 if it or pipeline failed.
+*/
+int pipelineAwait (pipeline *p, pipelineBlock *block);
+
+
+/* support function for pipelineTake and pipelineAwait!
+* description: Backs off while waiting: spins first, then yields and then
+* sleeps.
+* param[in]: tries - Number of polls that found nothing so far.
+*/
+void pipelinePause (int tries);
+
+
+/* support function for pipelineStageRun, pipelineTake and pipelineAwait!
+* description: Gets time from a monotonic clock.
+* return: Time in seconds.
+*/
+double pipelineNow (void);
+
+
+#endif //PIPELINE
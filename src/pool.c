@@ -0,0 +1,316 @@
+/*
+* pool: Work-stealing thread pool. See pool.h.
+*/
+
+#include <string.h>
+#include <unistd.h>
+
+#include "pool.h"
+
+
+/*
+* description: Creates pool and starts its workers.
+* param[in]: nrOfThreads - Number of workers, below 1 for number of online
+* CPUs.
+* return: The pool.
+*/
+pool *poolEmpty (int nrOfThreads) {
+
+	pool *p = malloc(sizeof(pool));
+
+	if (nrOfThreads < 1) {
+
+		long online = sysconf(_SC_NPROCESSORS_ONLN);
+		nrOfThreads = online > 0 ? (int)online : 1;
+	}
+
+	p -> nrOfWorkers = nrOfThreads;
+	p -> threads = malloc(sizeof(pthread_t) * nrOfThreads);
+	p -> queued = 0;
+	p -> stop = 0;
+	pthread_key_create(&p -> self, NULL);
+	pthread_mutex_init(&p -> lock, NULL);
+	pthread_cond_init(&p -> wake, NULL);
+
+	//Last deque is shared by threads that are not workers.
+	p -> deques = malloc(sizeof(poolDeque) * (nrOfThreads + 1));
+	for (int i = 0; i <= nrOfThreads; i++) {
+
+		pthread_mutex_init(&p -> deques[i].lock, NULL);
+		p -> deques[i].tasks = malloc(sizeof(poolTask) * POOLDEQUESIZE);
+		p -> deques[i].top = 0;
+		p -> deques[i].bottom = 0;
+		p -> deques[i].capacity = POOLDEQUESIZE;
+	}
+
+	//Workers find their index in threads, so wait until all are stored.
+	pthread_mutex_lock(&p -> lock);
+	for (int i = 0; i < nrOfThreads; i++) {
+
+		pthread_create(&p -> threads[i], NULL, poolWorker, p);
+	}
+	pthread_mutex_unlock(&p -> lock);
+	return p;
+}
+
+
+/*
+* description: Stops workers when all queued tasks are done and frees pool.
+* param[in]: p - The pool.
+*/
+void poolKill (pool *p) {
+
+	pthread_mutex_lock(&p -> lock);
+	p -> stop = 1;
+	pthread_cond_broadcast(&p -> wake);
+	pthread_mutex_unlock(&p -> lock);
+
+	for (int i = 0; i < p -> nrOfWorkers; i++) {
+
+		pthread_join(p -> threads[i], NULL);
+	}
+	for (int i = 0; i <= p -> nrOfWorkers; i++) {
+
+		pthread_mutex_destroy(&p -> deques[i].lock);
+		free(p -> deques[i].tasks);
+	}
+
+	pthread_cond_destroy(&p -> wake);
+	pthread_mutex_destroy(&p -> lock);
+	pthread_key_delete(p -> self);
+	free(p -> deques);
+	free(p -> threads);
+	free(p);
+}
+
+
+/*
+* description: Gets number of workers.
+* param[in]: p - The pool, NULL for none.
+* return: Number of workers, 1 if p is NULL.
+*/
+int poolSize (pool *p) {
+
+	return p != NULL ? p -> nrOfWorkers : 1;
+}
+
+
+/*
+* description: Sets group to have no tasks.
+* param[in]: group - The group.
+*/
+void poolGroupInit (poolGroup *group) {
+
+	group -> pending = 0;
+}
+
+
+/*
+* description: Queues task. Called by a worker it goes to the deque of the
+* worker, else to the shared deque.
+* param[in]: p - The pool.
+* param[in]: group - Group task is counted in.
+* param[in]: run - Function of task.
+* param[in]: arg - Passed to run.
+*/
+void poolSubmit (pool *p, poolGroup *group, poolFunction run, void *arg) {
+
+	int me = poolSelf(p);
+	poolDeque *deque = &p -> deques[me >= 0 ? me : p -> nrOfWorkers];
+
+	__atomic_add_fetch(&group -> pending, 1, __ATOMIC_ACQ_REL);
+
+	pthread_mutex_lock(&deque -> lock);
+	if (deque -> bottom - deque -> top == deque -> capacity) {
+
+		//Grows into a new array, keeping tasks at the same positions mod size.
+		poolTask *tasks = malloc(sizeof(poolTask) * deque -> capacity * 2);
+		for (int64_t i = deque -> top; i < deque -> bottom; i++) {
+
+			tasks[i % (deque -> capacity * 2)] =
+				deque -> tasks[i % deque -> capacity];
+		}
+		free(deque -> tasks);
+		deque -> tasks = tasks;
+		deque -> capacity = deque -> capacity * 2;
+	}
+	poolTask *task = &deque -> tasks[deque -> bottom % deque -> capacity];
+	task -> run = run;
+	task -> arg = arg;
+	task -> group = group;
+	deque -> bottom++;
+	pthread_mutex_unlock(&deque -> lock);
+
+	//Counted before taking the lock, so a worker checking under the lock
+	//before sleeping can not miss it.
+	__atomic_add_fetch(&p -> queued, 1, __ATOMIC_ACQ_REL);
+	pthread_mutex_lock(&p -> lock);
+	pthread_cond_broadcast(&p -> wake);
+	pthread_mutex_unlock(&p -> lock);
+}
+
+
+/*
+* description: Runs queued tasks until all tasks of group are done, sleeping
+* when there is nothing to run.
+* param[in]: p - The pool.
+* param[in]: group - The group.
+*/
+void poolWait (pool *p, poolGroup *group) {
+
+	int me = poolSelf(p);
+	poolTask task;
+
+	while (__atomic_load_n(&group -> pending, __ATOMIC_ACQUIRE) > 0) {
+
+		if (poolFind(p, me, &task)) {
+
+			poolRun(p, &task);
+			continue;
+		}
+
+		pthread_mutex_lock(&p -> lock);
+		if (__atomic_load_n(&group -> pending, __ATOMIC_ACQUIRE) > 0 &&
+			__atomic_load_n(&p -> queued, __ATOMIC_ACQUIRE) == 0) {
+
+			pthread_cond_wait(&p -> wake, &p -> lock);
+		}
+		pthread_mutex_unlock(&p -> lock);
+	}
+}
+
+
+/*
+* description: Gets index of worker calling, so tasks can keep state per
+* worker without locks.
+* param[in]: p - The pool.
+* return: Index of worker, 0 to number of workers - 1, -1 if caller is not a
+* worker of p.
+*/
+int poolSelf (pool *p) {
+
+	poolDeque *deque = pthread_getspecific(p -> self);
+
+	return deque != NULL ? (int)(deque - p -> deques) : -1;
+}
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN POOL.C
+
+
+/* support function for poolEmpty!
+* description: Thread of one worker. Runs tasks, sleeping when there are
+* none, until pool is stopped and no tasks are left.
+* param[in]: arg - The pool.
+* return: NULL.
+*/
+void *poolWorker (void *arg) {
+
+	pool *p = arg;
+	poolTask task;
+	int me = 0;
+
+	//Index is found from position of own thread handle.
+	pthread_mutex_lock(&p -> lock);
+	while (me < p -> nrOfWorkers &&
+		   !pthread_equal(p -> threads[me], pthread_self())) {
+
+		me++;
+	}
+	pthread_mutex_unlock(&p -> lock);
+	pthread_setspecific(p -> self, &p -> deques[me]);
+
+	while (1) {
+
+		if (poolFind(p, me, &task)) {
+
+			poolRun(p, &task);
+			continue;
+		}
+
+		pthread_mutex_lock(&p -> lock);
+		while (!p -> stop && __atomic_load_n(&p -> queued, __ATOMIC_ACQUIRE) == 0) {
+
+			pthread_cond_wait(&p -> wake, &p -> lock);
+		}
+		int done = p -> stop &&
+				   __atomic_load_n(&p -> queued, __ATOMIC_ACQUIRE) == 0;
+		pthread_mutex_unlock(&p -> lock);
+
+		if (done) {
+
+			break;
+		}
+	}
+	return NULL;
+}
+
+
+/* support function for poolWorker and poolWait!
+* description: Takes a task, from bottom of own deque first and else from top
+* of the other deques.
+* param[in]: p - The pool.
+* param[in]: me - Index of worker, -1 if not a worker.
+* param[out]: task - The task.
+* return: 1 if a task was taken, else 0.
+*/
+int poolFind (pool *p, int me, poolTask *task) {
+
+	int count = p -> nrOfWorkers + 1;
+
+	if (me >= 0) {
+
+		poolDeque *own = &p -> deques[me];
+		pthread_mutex_lock(&own -> lock);
+		if (own -> bottom > own -> top) {
+
+			own -> bottom--;
+			*task = own -> tasks[own -> bottom % own -> capacity];
+			pthread_mutex_unlock(&own -> lock);
+			__atomic_sub_fetch(&p -> queued, 1, __ATOMIC_ACQ_REL);
+			return 1;
+		}
+		pthread_mutex_unlock(&own -> lock);
+	}
+
+	//Victims are tried starting next to own deque, spreading thieves out.
+	for (int i = 1; i <= count; i++) {
+
+		poolDeque *victim = &p -> deques[(me + count + i) % count];
+
+		if (victim == &p -> deques[me >= 0 ? me : count]) {
+
+			continue;
+		}
+		pthread_mutex_lock(&victim -> lock);
+		if (victim -> bottom > victim -> top) {
+
+			*task = victim -> tasks[victim -> top % victim -> capacity];
+			victim -> top++;
+			pthread_mutex_unlock(&victim -> lock);
+			__atomic_sub_fetch(&p -> queued, 1, __ATOMIC_ACQ_REL);
+			return 1;
+		}
+		pthread_mutex_unlock(&victim -> lock);
+	}
+	return 0;
+}
+
+
+/* support function for poolWorker and poolWait!
+* description: Runs task and wakes waiters if it was last of its group.
+* param[in]: p - The pool.
+* param[in]: task - The task.
+*/
+void poolRun (pool *p, poolTask *task) {
+
+	poolGroup *group = task -> group;
+
+	task -> run(task -> arg);
+	if (__atomic_sub_fetch(&group -> pending, 1, __ATOMIC_ACQ_REL) == 0) {
+
+		pthread_mutex_lock(&p -> lock);
+		pthread_cond_broadcast(&p -> wake);
+		pthread_mutex_unlock(&p -> lock);
+	}
+}
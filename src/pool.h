@@ -0,0 +1,159 @@
+/*
+* pool: Work-stealing thread pool shared by all parallel work.
+*
+* Each worker thread has its own deque of tasks. A worker pushes tasks it
+* creates to the bottom of its deque and takes its next task from there,
+* newest first, so related work stays on one core. When its deque is empty it
+* steals the oldest task from the top of another deque, so one big task
+* among many small ones does not leave cores idle. Threads that are not
+* workers push to one more deque, which only the workers steal from.
+*
+* Tasks are counted in groups. A thread waiting for a group runs queued tasks
+* while it waits, so tasks may wait for other tasks without using up the
+* workers.
+*/
+
+#ifndef POOL
+#define POOL
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#define POOLDEQUESIZE 64
+
+
+typedef void (*poolFunction) (void *arg);
+
+
+typedef struct poolGroup {
+
+	int64_t pending;
+} poolGroup;
+
+
+typedef struct poolTask {
+
+	poolFunction run;
+	void *arg;
+	poolGroup *group;
+} poolTask;
+
+
+typedef struct poolDeque {
+
+	pthread_mutex_t lock;
+	poolTask *tasks;
+	int64_t top;
+	int64_t bottom;
+	int64_t capacity;
+} poolDeque;
+
+
+typedef struct pool {
+
+	int nrOfWorkers;
+	pthread_t *threads;
+	poolDeque *deques;
+	pthread_key_t self;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	int64_t queued;
+	int stop;
+} pool;
+
+
+/*
+* description: Creates pool and starts its workers.
+* param[in]: nrOfThreads - Number of workers, below 1 for number of online
+* CPUs.
+* return: The pool.
+*/
+pool *poolEmpty (int nrOfThreads);
+
+
+/*
+* description: Stops workers when all queued tasks are done and frees pool.
+* param[in]: p - The pool.
+*/
+void poolKill (pool *p);
+
+
+/*
+* description: Gets number of workers.
+* param[in]: p - The pool, NULL for none.
+* return: Number of workers, 1 if p is NULL.
+*/
+int poolSize (pool *p);
+
+
+/*
+* description: Sets group to have no tasks.
+* param[in]: group - The group.
+*/
+void poolGroupInit (poolGroup *group);
+
+
+/*
+* description: Queues task. Called by a worker it goes to the deque of the
+* worker, else to the shared deque.
+* param[in]: p - The pool.
+* param[in]: group - Group task is counted in.
+* param[in]: run - Function of task.
+* param[in]: arg - Passed to run.
+*/
+void poolSubmit (pool *p, poolGroup *group, poolFunction run, void *arg);
+
+
+/*
+* description: Runs queued tasks until all tasks of group are done, sleeping
+* when there is nothing to run.
+* param[in]: p - The pool.
+* param[in]: group - The group.
+*/
+void poolWait (pool *p, poolGroup *group);
+
+
+/*
+* description: Gets index of worker calling, so tasks can keep state per
+* worker without locks.
+* param[in]: p - The pool.
+* return: Index of worker, 0 to number of workers - 1, -1 if caller is not a
+* worker of p.
+*/
+int poolSelf (pool *p);
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN POOL.C
+
+
+/* support function for poolEmpty!
+* description: Thread of one worker. Runs tasks, sleeping when there are
+* none, until pool is stopped and no tasks are left.
+* param[in]: arg - The pool.
+* return: NULL.
+*/
+void *poolWorker (void *arg);
+
+
+/* support function for poolWorker and poolWait!
+* description: Takes a task, from bottom of own deque first and else from top
+* of the other deques.
+* param[in]: p - The pool.
+* param[in]: me - Index of worker, -1 if not a worker.
+* param[out]: task - The task.
+* return: 1 if a task was taken, else 0.
+*/
+int poolFind (pool *p, int me, poolTask *task);
+
+
+/* support function for poolWorker and poolWait!
+* description: Runs task and wakes waiters if it was last of its group.
+* param[in]: p - The pool.
+* param[in]: task - The task.
+*/
+void poolRun (pool *p, poolTask *task);
+
+
+#endif //POOL
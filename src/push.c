@@ -0,0 +1,523 @@
+/*
+* push: Encoder and decoder fed by the caller. See push.h.
+*/
+
+#include <string.h>
+
+#include "push.h"
+
+
+/*
+* description: Creates encoder coding with tree. Allocates memory for
+* pushEncoder.
+* param[in]: tree - Tree that contains huffman table, used until encoder is
+* killed.
+* return: The pushEncoder.
+*/
+pushEncoder *pushEncoderEmpty (huffTree *tree) {
+
+	pushEncoder *enc = calloc(1, sizeof(pushEncoder));
+
+	enc -> codes = tree -> codeTable;
+	enc -> buffer = malloc(PUSHBUFFERSIZE);
+
+	//File header is given out first, as a closed block.
+	formatHeaderBytes(enc -> buffer, FORMATMODEPUSH, 0);
+	enc -> size = FORMATHEADERSIZE;
+	enc -> closed = 1;
+	return enc;
+}
+
+
+/*
+* description: Deallocates all memory of pushEncoder.
+* param[in]: enc - The pushEncoder.
+*/
+void pushEncoderKill (pushEncoder *enc) {
+
+	free(enc -> buffer);
+	free(enc);
+}
+
+
+/*
+* description: Codes chars. Stops when all input is taken and output is
+* given, or when output is full.
+* param[in]: enc - The pushEncoder.
+* param[in]: in - The chars.
+* param[in]: inLength - Number of chars.
+* param[out]: consumed - Number of chars taken from in.
+* param[out]: out - Array to store atmost outCapacity chars in.
+* param[in]: outCapacity - Size of out.
+* param[out]: produced - Number of chars stored in out.
+* return: 1 if chars could be coded, 0 if encoder was ended.
+*/
+int pushEncodeFeed (pushEncoder *enc, const unsigned char *in,
+					int64_t inLength, int64_t *consumed, unsigned char *out,
+					int64_t outCapacity, int64_t *produced) {
+
+	*consumed = 0;
+	*produced = 0;
+	if (enc -> ended) {
+
+		return 0;
+	}
+
+	while (1) {
+
+		if (!pushDrain(enc, out, outCapacity, produced) ||
+			*consumed == inLength) {
+
+			return 1;
+		}
+
+		int64_t n = inLength - *consumed;
+		if (n > PUSHBLOCKSIZE - enc -> nrOfChars) {
+
+			n = PUSHBLOCKSIZE - enc -> nrOfChars;
+		}
+
+		//Whole bytes are moved to the block as soon as there are any, so
+		//bits never holds more than 7 + HUFFMAXCODELEN bits.
+		const unsigned char *text = &in[*consumed];
+		unsigned char *block = enc -> buffer;
+		uint64_t bits = enc -> bits;
+		int nrOfBits = enc -> nrOfBits;
+		int64_t size = enc -> size;
+		for (int64_t i = 0; i < n; i++) {
+
+			huffCode hc = enc -> codes[text[i]];
+			bits = (bits << hc.len) | hc.code;
+			nrOfBits = nrOfBits + hc.len;
+			while (nrOfBits >= 8) {
+
+				nrOfBits = nrOfBits - 8;
+				block[size++] = (unsigned char)(bits >> nrOfBits);
+			}
+		}
+		enc -> bits = bits;
+		enc -> nrOfBits = nrOfBits;
+		enc -> size = size;
+		enc -> nrOfChars = enc -> nrOfChars + n;
+		*consumed = *consumed + n;
+
+		if (enc -> nrOfChars == PUSHBLOCKSIZE) {
+
+			pushCloseBlock(enc);
+		}
+	}
+}
+
+
+/*
+* description: Gives out all codes of chars fed so far, so a decoder can
+* decode all of them.
+* param[in]: enc - The pushEncoder.
+* param[out]: out - Array to store atmost outCapacity chars in.
+* param[in]: outCapacity - Size of out.
+* param[out]: produced - Number of chars stored in out.
+* return: 1 if all codes were given out, 0 if out was filled first and
+* flush must be called again.
+*/
+int pushEncodeFlush (pushEncoder *enc, unsigned char *out,
+					 int64_t outCapacity, int64_t *produced) {
+
+	*produced = 0;
+	if (!enc -> closed && enc -> nrOfChars > 0) {
+
+		pushCloseBlock(enc);
+	}
+	return pushDrain(enc, out, outCapacity, produced);
+}
+
+
+/*
+* description: Gives out all codes and the end of stream marker. Nothing can
+* be fed after it.
+* param[in]: enc - The pushEncoder.
+* param[out]: out - Array to store atmost outCapacity chars in.
+* param[in]: outCapacity - Size of out.
+* param[out]: produced - Number of chars stored in out.
+* return: 1 if stream is complete, 0 if out was filled first and end must be
+* called again.
+*/
+int pushEncodeEnd (pushEncoder *enc, unsigned char *out, int64_t outCapacity,
+				   int64_t *produced) {
+
+	if (enc -> ended) {
+
+		*produced = 0;
+		return pushDrain(enc, out, outCapacity, produced);
+	}
+	if (!pushEncodeFlush(enc, out, outCapacity, produced)) {
+
+		return 0;
+	}
+
+	//Marker is given out as a closed block, after which none is opened.
+	formatPutU32(enc -> buffer, 0);
+	formatPutU64(&enc -> buffer[PUSHBLOCKHEADERSIZE], enc -> total);
+	enc -> size = PUSHMARKERSIZE;
+	enc -> sent = 0;
+	enc -> closed = 1;
+	enc -> ended = 1;
+	return pushDrain(enc, out, outCapacity, produced);
+}
+
+
+/*
+* description: Creates decoder decoding with tree. Allocates memory for
+* pushDecoder.
+* param[in]: tree - Tree that contains huffman table, used until decoder is
+* killed.
+* return: The pushDecoder.
+*/
+pushDecoder *pushDecoderEmpty (huffTree *tree) {
+
+	pushDecoder *dec = calloc(1, sizeof(pushDecoder));
+
+	dec -> root = huffTreeGetRoot(tree);
+	dec -> node = dec -> root;
+	dec -> phase = PUSHFILEHEADER;
+	return dec;
+}
+
+
+/*
+* description: Deallocates all memory of pushDecoder.
+* param[in]: dec - The pushDecoder.
+*/
+void pushDecoderKill (pushDecoder *dec) {
+
+	free(dec);
+}
+
+
+/*
+* description: Decodes coded chars. Stops when all input is taken, when
+* output is full, or at end of stream.
+* param[in]: dec - The pushDecoder.
+* param[in]: in - The coded chars.
+* param[in]: inLength - Number of coded chars.
+* param[out]: consumed - Number of chars taken from in.
+* param[out]: out - Array to store atmost outCapacity chars in.
+* param[in]: outCapacity - Size of out.
+* param[out]: produced - Number of chars stored in out.
+* return: 1 if input is valid so far, 0 if it is corrupt.
+*/
+int pushDecodeFeed (pushDecoder *dec, const unsigned char *in,
+					int64_t inLength, int64_t *consumed, unsigned char *out,
+					int64_t outCapacity, int64_t *produced) {
+
+	static const int headerSizes[] = {FORMATHEADERSIZE, PUSHBLOCKHEADERSIZE,
+									  PUSHMARKERSIZE - PUSHBLOCKHEADERSIZE};
+
+	*consumed = 0;
+	*produced = 0;
+	while (dec -> phase != PUSHDONE && dec -> phase != PUSHCORRUPT) {
+
+		if (dec -> phase == PUSHCODES) {
+
+			if (!pushDecodeCodes(dec, in, inLength, consumed, out,
+								 outCapacity, produced)) {
+
+				dec -> phase = PUSHCORRUPT;
+			} else if (dec -> left > 0) {
+
+				return 1;
+			} else {
+
+				//Padding of the last byte of block is not used.
+				dec -> bitsLeft = 0;
+				dec -> phase = PUSHBLOCKHEADER;
+			}
+			continue;
+		}
+
+		//A header may come in pieces, so its bytes are gathered first.
+		int need = headerSizes[dec -> phase];
+		int64_t n = inLength - *consumed;
+		if (n > need - dec -> headerSize) {
+
+			n = need - dec -> headerSize;
+		}
+		memcpy(&dec -> header[dec -> headerSize], &in[*consumed], n);
+		dec -> headerSize = dec -> headerSize + n;
+		*consumed = *consumed + n;
+		if (dec -> headerSize < need) {
+
+			return 1;
+		}
+		dec -> headerSize = 0;
+
+		int mode = -1;
+		uint64_t length = 0;
+		if (dec -> phase == PUSHFILEHEADER) {
+
+			dec -> phase = formatParseHeader(dec -> header, &mode, &length) &&
+						   mode == FORMATMODEPUSH ? PUSHBLOCKHEADER :
+						   PUSHCORRUPT;
+		} else if (dec -> phase == PUSHBLOCKHEADER) {
+
+			dec -> left = formatGetU32(dec -> header);
+			dec -> phase = dec -> left == 0 ? PUSHTOTAL :
+						   dec -> left > PUSHBLOCKSIZE ? PUSHCORRUPT :
+						   PUSHCODES;
+		} else {
+
+			dec -> phase = formatGetU64(dec -> header) == dec -> total ?
+						   PUSHDONE : PUSHCORRUPT;
+		}
+	}
+	return dec -> phase == PUSHDONE;
+}
+
+
+/*
+* description: Checks that decoder has read a whole stream.
+* param[in]: dec - The pushDecoder.
+* return: 1 if end of stream was read and is valid, else 0.
+*/
+int pushDecodeEnd (pushDecoder *dec) {
+
+	return dec -> phase == PUSHDONE;
+}
+
+
+/*
+* description: Encodes file1 by feeding a push encoder PUSHCHUNKSIZE chars
+* at a time.
+* param[in]: file1 - Name of file to be read, "-" for stdin.
+* param[in]: file2 - Name of file to be written, "-" for stdout.
+* param[in]: tree - Tree that contains huffman table.
+* return: 1 if file2 was written, else 0.
+*/
+int pushEncodeFile (char const *file1, char const *file2, huffTree *tree) {
+
+	stream *in = streamOpenRead(file1);
+	if (in == NULL) {
+
+		fprintf(stderr, "Could not read %s\n", file1);
+		return 0;
+	}
+	stream *out = streamOpenWrite(file2);
+	if (out == NULL) {
+
+		fprintf(stderr, "Could not write %s\n", file2);
+		streamClose(in);
+		return 0;
+	}
+
+	unsigned char *text = malloc(PUSHCHUNKSIZE);
+	unsigned char *codes = malloc(PUSHCHUNKSIZE);
+	pushEncoder *enc = pushEncoderEmpty(tree);
+	int64_t consumed = 0;
+	int64_t produced = 0;
+	int64_t got = 0;
+	int valid = 1;
+
+	while (valid && (got = streamRead(in, text, PUSHCHUNKSIZE)) > 0) {
+
+		for (int64_t done = 0; done < got && valid; done = done + consumed) {
+
+			pushEncodeFeed(enc, &text[done], got - done, &consumed, codes,
+						   PUSHCHUNKSIZE, &produced);
+			valid = streamWrite(out, codes, produced);
+		}
+	}
+	int complete = 0;
+	while (valid && !complete) {
+
+		complete = pushEncodeEnd(enc, codes, PUSHCHUNKSIZE, &produced);
+		valid = streamWrite(out, codes, produced);
+	}
+
+	valid = streamClose(out) && valid;
+	streamClose(in);
+	if (!valid) {
+
+		fprintf(stderr, "Could not write %s\n", file2);
+	}
+	pushEncoderKill(enc);
+	free(codes);
+	free(text);
+	return valid;
+}
+
+
+/*
+* description: Decodes payload of a push mode file as it is read.
+* param[in]: in - Encoded stream, positioned after file header.
+* param[in]: file2 - Name of file to be written, "-" for stdout.
+* param[in]: tree - Tree that contains huffman table.
+* return: 1 if a whole valid stream was decoded and written, else 0.
+*/
+int pushDecodeStream (stream *in, char const *file2, huffTree *tree) {
+
+	stream *out = streamOpenWrite(file2);
+	if (out == NULL) {
+
+		return 0;
+	}
+
+	unsigned char *codes = malloc(PUSHCHUNKSIZE);
+	unsigned char *text = malloc(PUSHCHUNKSIZE);
+	pushDecoder *dec = pushDecoderEmpty(tree);
+	int64_t consumed = 0;
+	int64_t produced = 0;
+	int64_t got = 0;
+	int valid = 1;
+
+	//File header was read by the caller, so it is fed from its fields.
+	formatHeaderBytes(codes, FORMATMODEPUSH, 0);
+	pushDecodeFeed(dec, codes, FORMATHEADERSIZE, &consumed, text,
+				   PUSHCHUNKSIZE, &produced);
+
+	//Input after end of stream is not valid.
+	while (valid && (got = streamRead(in, codes, PUSHCHUNKSIZE)) > 0) {
+
+		for (int64_t done = 0; done < got && valid; done = done + consumed) {
+
+			valid = pushDecodeFeed(dec, &codes[done], got - done, &consumed,
+								   text, PUSHCHUNKSIZE, &produced) &&
+					streamWrite(out, text, produced) &&
+					(consumed > 0 || produced > 0);
+		}
+	}
+	valid = pushDecodeEnd(dec) && valid;
+
+	valid = streamClose(out) && valid;
+	pushDecoderKill(dec);
+	free(text);
+	free(codes);
+	return valid;
+}
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN PUSH.C
+
+
+/* support function for pushEncodeFeed and pushEncodeFlush!
+* description: Pads open block to a whole byte and writes its number of
+* chars in front, so it can be given out.
+* param[in]: enc - The pushEncoder.
+*/
+void pushCloseBlock (pushEncoder *enc) {
+
+	if (enc -> nrOfBits > 0) {
+
+		enc -> buffer[enc -> size++] =
+			(unsigned char)(enc -> bits << (8 - enc -> nrOfBits));
+	}
+	formatPutU32(enc -> buffer, (uint32_t)enc -> nrOfChars);
+	enc -> total = enc -> total + enc -> nrOfChars;
+	enc -> bits = 0;
+	enc -> nrOfBits = 0;
+	enc -> nrOfChars = 0;
+	enc -> sent = 0;
+	enc -> closed = 1;
+}
+
+
+/* support function for pushEncodeFeed, pushEncodeFlush and pushEncodeEnd!
+* description: Gives out bytes of closed block that fit in out, and opens a
+* new block when all are given.
+* param[in]: enc - The pushEncoder.
+* param[out]: out - Array to store atmost outCapacity chars in.
+* param[in]: outCapacity - Size of out.
+* param[in,out]: produced - Number of chars stored in out.
+* return: 1 if all bytes were given out, else 0.
+*/
+int pushDrain (pushEncoder *enc, unsigned char *out, int64_t outCapacity,
+			   int64_t *produced) {
+
+	if (!enc -> closed) {
+
+		return 1;
+	}
+
+	int64_t n = enc -> size - enc -> sent;
+	if (n > outCapacity - *produced) {
+
+		n = outCapacity - *produced;
+	}
+	memcpy(&out[*produced], &enc -> buffer[enc -> sent], n);
+	enc -> sent = enc -> sent + n;
+	*produced = *produced + n;
+	if (enc -> sent < enc -> size) {
+
+		return 0;
+	}
+
+	//Room for number of chars is kept in front of the codes. After the end
+	//marker no block is opened.
+	if (!enc -> ended) {
+
+		enc -> size = PUSHBLOCKHEADERSIZE;
+		enc -> sent = 0;
+		enc -> closed = 0;
+	}
+	return 1;
+}
+
+
+/* support function for pushDecodeFeed!
+* description: Decodes codes of block until block, input or output ends.
+* param[in]: dec - The pushDecoder.
+* param[in]: in - The coded chars.
+* param[in]: inLength - Number of coded chars.
+* param[in,out]: consumed - Number of chars taken from in.
+* param[out]: out - Array to store atmost outCapacity chars in.
+* param[in]: outCapacity - Size of out.
+* param[in,out]: produced - Number of chars stored in out.
+* return: 1 if codes are valid, 0 if a code has no char.
+*/
+int pushDecodeCodes (pushDecoder *dec, const unsigned char *in,
+					 int64_t inLength, int64_t *consumed, unsigned char *out,
+					 int64_t outCapacity, int64_t *produced) {
+
+	treeNode *node = dec -> node;
+	uint64_t left = dec -> left;
+	unsigned byte = dec -> byte;
+	int bitsLeft = dec -> bitsLeft;
+	int64_t pos = *consumed;
+	int64_t put = *produced;
+	int valid = 1;
+
+	//A char is only put when a code ends, so output can only fill up
+	//between codes, and node is kept when input ends within one.
+	while (left > 0 && put < outCapacity) {
+
+		if (bitsLeft == 0) {
+
+			if (pos == inLength) {
+
+				break;
+			}
+			byte = in[pos++];
+			bitsLeft = 8;
+		}
+		bitsLeft--;
+		node = (byte >> bitsLeft) & 1 ? node -> right : node -> left;
+		if (node -> left == NULL) {
+
+			if (node -> key < 0) {
+
+				valid = 0;
+				break;
+			}
+			out[put++] = (unsigned char)node -> key;
+			node = dec -> root;
+			left--;
+		}
+	}
+
+	dec -> node = node;
+	dec -> left = left;
+	dec -> byte = (unsigned char)byte;
+	dec -> bitsLeft = bitsLeft;
+	dec -> total = dec -> total + (put - *produced);
+	*consumed = pos;
+	*produced = put;
+	return valid;
+}
@@ -0,0 +1,255 @@
+/*
+* push: Encoder and decoder fed by the caller, a chunk at a time, for
+* services that get data in chunks of any size and can not block on a file.
+*
+* Each feed takes chars from an input array and puts chars in an output
+* array, and tells how many of each it used. All state between feeds is in
+* the encoder or decoder: codes not yet whole bytes, the block being coded,
+* and the node of the tree a code read so far has reached. So input can end
+* anywhere, even within a code, and the next feed goes on from there. When
+* output is full a feed stops, and the rest is given by the next feed.
+*
+* Chars are coded with the tree of file0, as in static mode. Codes are
+* gathered in blocks of atmost PUSHBLOCKSIZE chars, and a block is given
+* out when it is full, or when the encoder is flushed or ended, so the
+* decoder knows where the codes of a flushed block end.
+*
+* Payload after file header, length in file header being 0, for each block:
+*   4 bytes   number of chars in block, 1 to PUSHBLOCKSIZE
+*   codes of the chars, padded to a whole byte
+* and after the last block:
+*   4 bytes   0, end of stream marker
+*   8 bytes   number of chars in all blocks
+* Integers are little endian.
+*/
+
+#ifndef PUSH
+#define PUSH
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "huffTree.h"
+#include "stream.h"
+#include "format.h"
+
+#define PUSHBLOCKSIZE (1 << 14)
+#define PUSHBLOCKHEADERSIZE 4
+#define PUSHMARKERSIZE 12
+//Bytes of a full block, its codes being atmost HUFFMAXCODELEN bits each.
+#define PUSHBUFFERSIZE (PUSHBLOCKHEADERSIZE + PUSHBLOCKSIZE * \
+						(HUFFMAXCODELEN / 8) + 1)
+//Chars read and written at a time by pushEncodeFile and pushDecodeStream.
+#define PUSHCHUNKSIZE (1 << 16)
+//Phases of decoder, the first three gather bytes of a header.
+#define PUSHFILEHEADER 0
+#define PUSHBLOCKHEADER 1
+#define PUSHTOTAL 2
+#define PUSHCODES 3
+#define PUSHDONE 4
+#define PUSHCORRUPT 5
+
+
+typedef struct pushEncoder {
+
+	const huffCode *codes;
+	//Bytes of file header, of a block or of end marker. A block is open
+	//while codes are added, and closed when its bytes are given out.
+	unsigned char *buffer;
+	int64_t size;
+	int64_t sent;
+	int closed;
+	int64_t nrOfChars;
+	//Codes not yet whole bytes, in the lowest nrOfBits bits.
+	uint64_t bits;
+	int nrOfBits;
+	uint64_t total;
+	int ended;
+} pushEncoder;
+
+
+typedef struct pushDecoder {
+
+	treeNode *root;
+	//Node reached by the bits of a code read so far.
+	treeNode *node;
+	int phase;
+	//Bytes of a file header, block header or total gathered so far.
+	unsigned char header[FORMATHEADERSIZE];
+	int headerSize;
+	//Chars of block not yet decoded.
+	uint64_t left;
+	uint64_t total;
+	//Bits of last byte read not yet used, in the lowest bitsLeft bits.
+	unsigned char byte;
+	int bitsLeft;
+} pushDecoder;
+
+
+/*
+* description: Creates encoder coding with tree. Allocates memory for
+* pushEncoder.
+* param[in]: tree - Tree that contains huffman table, used until encoder is
+* killed.
+* return: The pushEncoder.
+*/
+pushEncoder *pushEncoderEmpty (huffTree *tree);
+
+
+/*
+* description: Deallocates all memory of pushEncoder.
+* param[in]: enc - The pushEncoder.
+*/
+void pushEncoderKill (pushEncoder *enc);
+
+
+/*
+* description: Codes chars. Stops when all input is taken and output is
+* given, or when output is full.
+* param[in]: enc - The pushEncoder.
+* param[in]: in - The chars.
+* param[in]: inLength - Number of chars.
+* param[out]: consumed - Number of chars taken from in.
+* param[out]: out - Array to store atmost outCapacity chars in.
+* param[in]: outCapacity - Size of out.
+* param[out]: produced - Number of chars stored in out.
+* return: 1 if chars could be coded, 0 if encoder was ended.
+*/
+int pushEncodeFeed (pushEncoder *enc, const unsigned char *in,
+					int64_t inLength, int64_t *consumed, unsigned char *out,
+					int64_t outCapacity, int64_t *produced);
+
+
+/*
+* description: Gives out all codes of chars fed so far, so a decoder can
+* decode all of them.
+* param[in]: enc - The pushEncoder.
+* param[out]: out - Array to store atmost outCapacity chars in.
+* param[in]: outCapacity - Size of out.
+* param[out]: produced - Number of chars stored in out.
+* return: 1 if all codes were given out, 0 if out was filled first and
+* flush must be called again.
+*/
+int pushEncodeFlush (pushEncoder *enc, unsigned char *out,
+					 int64_t outCapacity, int64_t *produced);
+
+
+/*
+* description: Gives out all codes and the end of stream marker. Nothing can
+* be fed after it.
+* param[in]: enc - The pushEncoder.
+* param[out]: out - Array to store atmost outCapacity chars in.
+* param[in]: outCapacity - Size of out.
+* param[out]: produced - Number of chars stored in out.
+* return: 1 if stream is complete, 0 if out was filled first and end must be
+* called again.
+*/
+int pushEncodeEnd (pushEncoder *enc, unsigned char *out, int64_t outCapacity,
+				   int64_t *produced);
+
+
+/*
+* description: Creates decoder decoding with tree. Allocates memory for
+* pushDecoder.
+* param[in]: tree - Tree that contains huffman table, used until decoder is
+* killed.
+* return: The pushDecoder.
+*/
+pushDecoder *pushDecoderEmpty (huffTree *tree);
+
+
+/*
+* description: Deallocates all memory of pushDecoder.
+* param[in]: dec - The pushDecoder.
+*/
+void pushDecoderKill (pushDecoder *dec);
+
+
+/*
+* description: Decodes coded chars. Stops when all input is taken, when
+* output is full, or at end of stream.
+* param[in]: dec - The pushDecoder.
+* param[in]: in - The coded chars.
+* param[in]: inLength - Number of coded chars.
+* param[out]: consumed - Number of chars taken from in.
+* param[out]: out - Array to store atmost outCapacity chars in.
+* param[in]: outCapacity - Size of out.
+* param[out]: produced - Number of chars stored in out.
+* return: 1 if input is valid so far, 0 if it is corrupt.
+*/
+int pushDecodeFeed (pushDecoder *dec, const unsigned char *in,
+					int64_t inLength, int64_t *consumed, unsigned char *out,
+					int64_t outCapacity, int64_t *produced);
+
+
+/*
+* description: Checks that decoder has read a whole stream.
+* param[in]: dec - The pushDecoder.
+* return: 1 if end of stream was read and is valid, else 0.
+*/
+int pushDecodeEnd (pushDecoder *dec);
+
+
+/*
+* description: Encodes file1 by feeding a push encoder PUSHCHUNKSIZE chars
+* at a time.
+* param[in]: file1 - Name of file to be read, "-" for stdin.
+* param[in]: file2 - Name of file to be written, "-" for stdout.
+* param[in]: tree - Tree that contains huffman table.
+* return: 1 if file2 was written, else 0.
+*/
+int pushEncodeFile (char const *file1, char const *file2, huffTree *tree);
+
+
+/*
+* description: Decodes payload of a push mode file as it is read.
+* param[in]: in - Encoded stream, positioned after file header.
+* param[in]: file2 - Name of file to be written, "-" for stdout.
+* param[in]: tree - Tree that contains huffman table.
+* return: 1 if a whole valid stream was decoded and written, else 0.
+*/
+int pushDecodeStream (stream *in, char const *file2, huffTree *tree);
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN PUSH.C
+
+
+/* support function for pushEncodeFeed and pushEncodeFlush!
+* description: Pads open block to a whole byte and writes its number of
+* chars in front, so it can be given out.
+* param[in]: enc - The pushEncoder.
+*/
+void pushCloseBlock (pushEncoder *enc);
+
+
+/* support function for pushEncodeFeed, pushEncodeFlush and pushEncodeEnd!
+* description: Gives out bytes of closed block that fit in out, and opens a
+* new block when all are given.
+* param[in]: enc - The pushEncoder.
+* param[out]: out - Array to store atmost outCapacity chars in.
+* param[in]: outCapacity - Size of out.
+* param[in,out]: produced - Number of chars stored in out.
+* return: 1 if all bytes were given out, else 0.
+*/
+int pushDrain (pushEncoder *enc, unsigned char *out, int64_t outCapacity,
+			   int64_t *produced);
+
+
+/* support function for pushDecodeFeed!
+* description: Decodes codes of block until block, input or output ends.
+* param[in]: dec - The pushDecoder.
+* param[in]: in - The coded chars.
+* param[in]: inLength - Number of coded chars.
+* param[in,out]: consumed - Number of chars taken from in.
+* param[out]: out - Array to store atmost outCapacity chars in.
+* param[in]: outCapacity - Size of out.
+* param[in,out]: produced - Number of chars stored in out.
+* return: 1 if codes are valid, 0 if a code has no char.
+*/
+int pushDecodeCodes (pushDecoder *dec, const unsigned char *in,
+					 int64_t inLength, int64_t *consumed, unsigned char *out,
+					 int64_t outCapacity, int64_t *produced);
+
+
+#endif //PUSH
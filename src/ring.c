@@ -0,0 +1,75 @@
+/*
+* ring: Bounded lock-free queue of pointers between one producer thread and
+* one consumer thread.
+*/
+
+#include "ring.h"
+
+
+/*
+* description: Creates empty ring.
+* return: The ring.
+*/
+ring *ringEmpty (void) {
+
+	ring *r = malloc(sizeof(ring));
+
+	r -> head = 0;
+	r -> tail = 0;
+	return r;
+}
+
+
+/*
+* description: Frees memory of ring, not of items left in it.
+* param[in]: r - The ring.
+*/
+void ringKill (ring *r) {
+
+	free(r);
+}
+
+
+/*
+* description: Adds item last in ring. Only called by the producer.
+* param[in]: r - The ring.
+* param[in]: item - The item, not NULL.
+* return: 1 if item was added, 0 if ring is full.
+*/
+int ringPush (ring *r, void *item) {
+
+	uint64_t tail = r -> tail;
+	uint64_t head = __atomic_load_n(&r -> head, __ATOMIC_ACQUIRE);
+
+	if (tail - head == RINGSIZE) {
+
+		return 0;
+	}
+
+	//Release makes the slot visible to the consumer before the new tail.
+	r -> slots[tail & (RINGSIZE - 1)] = item;
+	__atomic_store_n(&r -> tail, tail + 1, __ATOMIC_RELEASE);
+	return 1;
+}
+
+
+/*
+* description: Removes first item of ring. Only called by the consumer.
+* param[in]: r - The ring.
+* return: The item, NULL if ring is empty.
+*/
+void *ringPop (ring *r) {
+
+	uint64_t head = r -> head;
+	uint64_t tail = __atomic_load_n(&r -> tail, __ATOMIC_ACQUIRE);
+
+	if (head == tail) {
+
+		return NULL;
+	}
+
+	//Slot is read before the new head lets the producer reuse it.
+	void *item = r -> slots[head & (RINGSIZE - 1)];
+	__atomic_store_n(&r -> head, head + 1, __ATOMIC_RELEASE);
+	return item;
+}
@@ -0,0 +1,63 @@
+/*
+* ring: Bounded lock-free queue of pointers between exactly one producer
+* thread and one consumer thread. The producer only writes tail and the
+* consumer only writes head, so no locks are needed, only acquire and release
+* ordering on the two positions. Head and tail are kept on separate cache
+* lines so the two threads do not slow each other down.
+*/
+
+#ifndef RING
+#define RING
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+//Number of slots, a power of 2.
+#define RINGSIZE 16
+#define RINGCACHELINE 64
+
+
+typedef struct ring {
+
+	void *slots[RINGSIZE];
+	char padHead[RINGCACHELINE];
+	uint64_t head;
+	char padTail[RINGCACHELINE - sizeof(uint64_t)];
+	uint64_t tail;
+	char padEnd[RINGCACHELINE - sizeof(uint64_t)];
+} ring;
+
+
+/*
+* description: Creates empty ring.
+* return: The ring.
+*/
+ring *ringEmpty (void);
+
+
+/*
+* description: Frees memory of ring, not of items left in it.
+* param[in]: r - The ring.
+*/
+void ringKill (ring *r);
+
+
+/*
+* description: Adds item last in ring. Only called by the producer.
+* param[in]: r - The ring.
+* param[in]: item - The item, not NULL.
+* return: 1 if item was added, 0 if ring is full.
+*/
+int ringPush (ring *r, void *item);
+
+
+/*
+* description: Removes first item of ring. Only called by the consumer.
+* param[in]: r - The ring.
+* return: The item, NULL if ring is empty.
+*/
+void *ringPop (ring *r);
+
+
+#endif //RING
@@ -0,0 +1,105 @@
+/*
+* rle: Zero run length coding of move-to-front output. See rle.h for how runs
+* are written.
+*/
+
+#include "rle.h"
+
+
+/*
+* description: Codes zero runs of values.
+* param[in]: in - The values.
+* param[in]: n - Number of values.
+* param[out]: out - Array to store symbols in. n symbols is always enough.
+* return: Number of symbols written.
+*/
+int64_t rleZeroEncode (const unsigned char *in, int64_t n, uint16_t *out) {
+
+	int64_t count = 0;
+	int64_t run = 0;
+
+	for (int64_t i = 0; i <= n; i++) {
+
+		if (i < n && in[i] == 0) {
+
+			run++;
+			continue;
+		}
+
+		//Bijective base 2 never needs more digits than the run is long.
+		while (run > 0) {
+
+			if (run & 1) {
+
+				out[count] = RLERUNA;
+				run = (run - 1) / 2;
+			} else {
+
+				out[count] = RLERUNB;
+				run = (run - 2) / 2;
+			}
+			count++;
+		}
+
+		if (i < n) {
+
+			out[count] = (uint16_t)in[i] + 1;
+			count++;
+		}
+	}
+	return count;
+}
+
+
+/*
+* description: Decodes zero run symbols back to values.
+* param[in]: in - The symbols.
+* param[in]: count - Number of symbols.
+* param[out]: out - Array to store values in.
+* param[in]: n - Number of values out has room for.
+* return: Number of values written, -1 if symbols give more than n values.
+*/
+int64_t rleZeroDecode (const uint16_t *in, int64_t count, unsigned char *out,
+					   int64_t n) {
+
+	int64_t written = 0;
+	int64_t run = 0;
+	int digit = 0;
+
+	for (int64_t i = 0; i <= count; i++) {
+
+		if (i < count && (in[i] == RLERUNA || in[i] == RLERUNB)) {
+
+			if (digit > 40) {
+
+				return -1;
+			}
+			run = run + ((int64_t)(in[i] == RLERUNA ? 1 : 2) << digit);
+			digit++;
+			continue;
+		}
+
+		if (run > n - written) {
+
+			return -1;
+		}
+		for (int64_t j = 0; j < run; j++) {
+
+			out[written] = 0;
+			written++;
+		}
+		run = 0;
+		digit = 0;
+
+		if (i < count) {
+
+			if (written >= n || in[i] >= RLESYMBOLS) {
+
+				return -1;
+			}
+			out[written] = (unsigned char)(in[i] - 1);
+			written++;
+		}
+	}
+	return written;
+}
@@ -0,0 +1,43 @@
+/*
+* rle: Zero run length coding of move-to-front output.
+*
+* Runs of 0 are written as the run length in bijective base 2, with the
+* digits RLERUNA (1) and RLERUNB (2), least significant first. Any other
+* value v is written as v + 1. Output alphabet is RLESYMBOLS symbols.
+*/
+
+#ifndef RLE
+#define RLE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#define RLERUNA 0
+#define RLERUNB 1
+#define RLESYMBOLS 257
+
+
+/*
+* description: Codes zero runs of values.
+* param[in]: in - The values.
+* param[in]: n - Number of values.
+* param[out]: out - Array to store symbols in. n symbols is always enough.
+* return: Number of symbols written.
+*/
+int64_t rleZeroEncode (const unsigned char *in, int64_t n, uint16_t *out);
+
+
+/*
+* description: Decodes zero run symbols back to values.
+* param[in]: in - The symbols.
+* param[in]: count - Number of symbols.
+* param[out]: out - Array to store values in.
+* param[in]: n - Number of values out has room for.
+* return: Number of values written, -1 if symbols give more than n values.
+*/
+int64_t rleZeroDecode (const uint16_t *in, int64_t count, unsigned char *out,
+					   int64_t n);
+
+
+#endif //RLE
@@ -0,0 +1,1011 @@
+/*
+* server: Coding server on a Unix domain socket. See server.h.
+*/
+
+//memfd_create, accept4 and file seals are not part of POSIX.
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#include "server.h"
+#include "format.h"
+#include "stream.h"
+
+
+/*
+* description: Creates server listening on socket path. Tables are held by
+* the server. Allocates memory for server.
+* param[in]: path - Name of the socket, removed first if it is a socket.
+* param[in]: tables - The tables.
+* param[in]: count - Number of tables, 0 to code every message with its own
+* table.
+* param[in]: nrOfThreads - Number of workers, below 1 for number of online
+* CPUs.
+* return: The server, NULL if the socket could not be made.
+*/
+server *serverEmpty (char const *path, contextTable *const *tables, int count,
+					 int nrOfThreads) {
+
+	struct sockaddr_un addr;
+	struct stat info;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(addr.sun_path) || count > CONTEXTMAXTABLES) {
+
+		return NULL;
+	}
+	strcpy(addr.sun_path, path);
+
+	//A socket left by a server that was not stopped is replaced, any other
+	//file is not.
+	if (lstat(path, &info) == 0 && S_ISSOCK(info.st_mode)) {
+
+		unlink(path);
+	}
+
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+
+		return NULL;
+	}
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+
+		close(fd);
+		return NULL;
+	}
+	if (listen(fd, SOMAXCONN) != 0 ||
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0) {
+
+		close(fd);
+		unlink(path);
+		return NULL;
+	}
+
+	server *s = calloc(1, sizeof(server));
+	if (pipe2(s -> wake, O_CLOEXEC | O_NONBLOCK) != 0) {
+
+		close(fd);
+		unlink(path);
+		free(s);
+		return NULL;
+	}
+	s -> listenFd = fd;
+	s -> path = malloc(strlen(path) + 1);
+	strcpy(s -> path, path);
+	s -> workers = poolEmpty(nrOfThreads);
+	poolGroupInit(&s -> group);
+	s -> nrOfTables = count;
+
+	int n = poolSize(s -> workers) + 1;
+	s -> encoders = malloc(sizeof(contextEncoder *) * n);
+	s -> decoders = malloc(sizeof(contextDecoder *) * n);
+	for (int i = 0; i < n; i++) {
+
+		s -> encoders[i] = contextEncoderEmpty();
+		s -> decoders[i] = contextDecoderEmpty();
+		contextEncoderSetTables(s -> encoders[i], tables, count);
+		contextDecoderSetTables(s -> decoders[i], tables, count);
+	}
+	s -> conns = malloc(sizeof(serverConnection *) * SERVERMAXCONNECTIONS);
+	return s;
+}
+
+
+/*
+* description: Serves requests until serverStop is called, then waits for
+* requests being served.
+* param[in]: s - The server.
+* return: 1 if server was stopped, 0 on error.
+*/
+int serverServe (server *s) {
+
+	//Listening socket and wake pipe come first, then the idle connections.
+	struct pollfd *fds = malloc(sizeof(struct pollfd) *
+								(SERVERMAXCONNECTIONS + 2));
+	int *polled = malloc(sizeof(int) * (SERVERMAXCONNECTIONS + 2));
+	unsigned char drain[64];
+	int valid = 1;
+
+	while (!__atomic_load_n(&s -> stop, __ATOMIC_ACQUIRE)) {
+
+		int n = 2;
+		fds[0].fd = s -> listenFd;
+		fds[0].events = POLLIN;
+		fds[1].fd = s -> wake[0];
+		fds[1].events = POLLIN;
+		for (int i = 0; i < s -> nrOfConns; i++) {
+
+			if (__atomic_load_n(&s -> conns[i] -> state, __ATOMIC_ACQUIRE) ==
+				SERVERIDLE) {
+
+				fds[n].fd = s -> conns[i] -> fd;
+				fds[n].events = POLLIN;
+				polled[n] = i;
+				n++;
+			}
+		}
+
+		if (poll(fds, n, -1) < 0) {
+
+			if (errno == EINTR) {
+
+				continue;
+			}
+			valid = 0;
+			break;
+		}
+
+		if (fds[1].revents != 0) {
+
+			while (read(s -> wake[0], drain, sizeof(drain)) > 0) {}
+		}
+
+		//Only a whole request is handed over, a closed or broken connection
+		//is closed below.
+		for (int i = 2; i < n; i++) {
+
+			if (fds[i].revents == 0) {
+
+				continue;
+			}
+			serverConnection *conn = s -> conns[polled[i]];
+			int received = serverReceive(conn);
+			if (received <= 0) {
+
+				conn -> state = received < 0 ? SERVERCLOSED : SERVERIDLE;
+				continue;
+			}
+			conn -> state = SERVERBUSY;
+			int64_t queued = __atomic_add_fetch(&s -> queued, 1,
+												__ATOMIC_RELAXED);
+			if (queued > s -> maxQueued) {
+
+				__atomic_store_n(&s -> maxQueued, queued, __ATOMIC_RELAXED);
+			}
+			poolSubmit(s -> workers, &s -> group, serverHandle, conn);
+		}
+
+		//Connections closed by their worker are not used by it again.
+		for (int i = 0; i < s -> nrOfConns; i++) {
+
+			serverConnection *conn = s -> conns[i];
+			if (__atomic_load_n(&conn -> state, __ATOMIC_ACQUIRE) ==
+				SERVERCLOSED) {
+
+				if (conn -> passFd >= 0) {
+
+					close(conn -> passFd);
+				}
+				close(conn -> fd);
+				free(conn -> in);
+				free(conn -> out);
+				free(conn);
+				s -> conns[i] = s -> conns[s -> nrOfConns - 1];
+				__atomic_store_n(&s -> nrOfConns, s -> nrOfConns - 1,
+								 __ATOMIC_RELAXED);
+				i--;
+			}
+		}
+
+		if (fds[0].revents != 0) {
+
+			serverAccept(s);
+		}
+	}
+
+	poolWait(s -> workers, &s -> group);
+	free(polled);
+	free(fds);
+	return valid;
+}
+
+
+/*
+* description: Makes serverServe return. Safe from any thread and from a
+* signal handler.
+* param[in]: s - The server.
+*/
+void serverStop (server *s) {
+
+	unsigned char c = 0;
+
+	__atomic_store_n(&s -> stop, 1, __ATOMIC_RELEASE);
+
+	//A full pipe wakes the polling thread as well.
+	if (write(s -> wake[1], &c, 1) < 0) {
+
+		return;
+	}
+}
+
+
+/*
+* description: Closes connections and socket, removes socket file and
+* deallocates all memory of server.
+* param[in]: s - The server, not being served.
+*/
+void serverKill (server *s) {
+
+	int n = poolSize(s -> workers) + 1;
+
+	poolKill(s -> workers);
+	for (int i = 0; i < n; i++) {
+
+		contextEncoderKill(s -> encoders[i]);
+		contextDecoderKill(s -> decoders[i]);
+	}
+	for (int i = 0; i < s -> nrOfConns; i++) {
+
+		if (s -> conns[i] -> passFd >= 0) {
+
+			close(s -> conns[i] -> passFd);
+		}
+		close(s -> conns[i] -> fd);
+		free(s -> conns[i] -> in);
+		free(s -> conns[i] -> out);
+		free(s -> conns[i]);
+	}
+	close(s -> listenFd);
+	close(s -> wake[0]);
+	close(s -> wake[1]);
+	unlink(s -> path);
+	free(s -> path);
+	free(s -> encoders);
+	free(s -> decoders);
+	free(s -> conns);
+	free(s);
+}
+
+
+/*
+* description: Writes counts and latency percentiles of server as text.
+* param[in]: s - The server.
+* param[out]: text - Array of atleast size chars.
+* param[in]: size - Size of text.
+* return: Number of chars written, without the ending '\0'.
+*/
+int64_t serverStats (server *s, char *text, int64_t size) {
+
+	uint64_t counts[SERVERBUCKETS];
+	uint64_t total = 0;
+
+	for (int i = 0; i < SERVERBUCKETS; i++) {
+
+		counts[i] = __atomic_load_n(&s -> latency[i], __ATOMIC_RELAXED);
+		total = total + counts[i];
+	}
+
+	int n = snprintf(text, size,
+					 "requests %lld\nfailed %lld\nconnections %d\n"
+					 "workers %d\ntables %d\nqueued %lld\nmax queued %lld\n"
+					 "latency us p50 %.1f p90 %.1f p99 %.1f p99.9 %.1f\n",
+					 (long long)__atomic_load_n(&s -> requests,
+												__ATOMIC_RELAXED),
+					 (long long)__atomic_load_n(&s -> failed,
+												__ATOMIC_RELAXED),
+					 __atomic_load_n(&s -> nrOfConns, __ATOMIC_RELAXED),
+					 poolSize(s -> workers), s -> nrOfTables,
+					 (long long)__atomic_load_n(&s -> queued,
+												__ATOMIC_RELAXED),
+					 (long long)__atomic_load_n(&s -> maxQueued,
+												__ATOMIC_RELAXED),
+					 serverPercentile(counts, total, 0.5) / 1000,
+					 serverPercentile(counts, total, 0.9) / 1000,
+					 serverPercentile(counts, total, 0.99) / 1000,
+					 serverPercentile(counts, total, 0.999) / 1000);
+	return n < 0 ? 0 : (n < size ? n : size - 1);
+}
+
+
+/*
+* description: Stores header as SERVERHEADERSIZE bytes.
+* param[out]: header - Pointer to atleast SERVERHEADERSIZE bytes.
+* param[in]: op - Op of a request, status of a reply.
+* param[in]: flags - Flags.
+* param[in]: length - Length of payload.
+*/
+void serverHeaderBytes (unsigned char *header, int op, int flags,
+						uint64_t length) {
+
+	memset(header, 0, SERVERHEADERSIZE);
+	header[0] = (unsigned char)op;
+	header[1] = (unsigned char)flags;
+	formatPutU64(&header[8], length);
+}
+
+
+/*
+* description: Sends header, and passes descriptor with it.
+* param[in]: sock - The socket.
+* param[in]: header - SERVERHEADERSIZE bytes.
+* param[in]: passFd - Descriptor to pass, -1 for none.
+* return: 1 if header was sent, else 0.
+*/
+int serverSendHeader (int sock, const unsigned char *header, int passFd) {
+
+	struct msghdr msg;
+	struct iovec iov;
+	union {
+
+		struct cmsghdr align;
+		char buf[CMSG_SPACE(sizeof(int))];
+	} control;
+
+	memset(&msg, 0, sizeof(msg));
+	iov.iov_base = (void *)header;
+	iov.iov_len = SERVERHEADERSIZE;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	if (passFd >= 0) {
+
+		memset(&control, 0, sizeof(control));
+		msg.msg_control = control.buf;
+		msg.msg_controllen = sizeof(control.buf);
+		struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg -> cmsg_level = SOL_SOCKET;
+		cmsg -> cmsg_type = SCM_RIGHTS;
+		cmsg -> cmsg_len = CMSG_LEN(sizeof(int));
+		memcpy(CMSG_DATA(cmsg), &passFd, sizeof(int));
+	}
+
+	ssize_t sent = -1;
+	do {
+
+		sent = sendmsg(sock, &msg, MSG_NOSIGNAL);
+	} while (sent < 0 && errno == EINTR);
+	if (sent <= 0) {
+
+		return 0;
+	}
+
+	//Descriptor went with the first chars, the rest are sent plain.
+	return serverSendAll(sock, &header[sent], SERVERHEADERSIZE - sent);
+}
+
+
+/*
+* description: Receives header, and a descriptor passed with it.
+* param[in]: sock - The socket.
+* param[out]: header - Pointer to atleast SERVERHEADERSIZE bytes.
+* param[out]: passFd - Descriptor passed, -1 for none. Owned by caller.
+* return: 1 if header was received, 0 at end of input or on error.
+*/
+int serverRecvHeader (int sock, unsigned char *header, int *passFd) {
+
+	struct msghdr msg;
+	struct iovec iov;
+	union {
+
+		struct cmsghdr align;
+		char buf[CMSG_SPACE(sizeof(int))];
+	} control;
+
+	*passFd = -1;
+	memset(&msg, 0, sizeof(msg));
+	iov.iov_base = header;
+	iov.iov_len = SERVERHEADERSIZE;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf;
+	msg.msg_controllen = sizeof(control.buf);
+
+	ssize_t got = -1;
+	do {
+
+		got = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+	} while (got < 0 && errno == EINTR);
+	if (got <= 0) {
+
+		return 0;
+	}
+
+	for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL;
+		 cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+
+		if (cmsg -> cmsg_level == SOL_SOCKET &&
+			cmsg -> cmsg_type == SCM_RIGHTS &&
+			cmsg -> cmsg_len >= CMSG_LEN(sizeof(int))) {
+
+			memcpy(passFd, CMSG_DATA(cmsg), sizeof(int));
+		}
+	}
+
+	if (got < SERVERHEADERSIZE &&
+		streamReadFd(sock, &header[got], SERVERHEADERSIZE - got) !=
+		SERVERHEADERSIZE - got) {
+
+		if (*passFd >= 0) {
+
+			close(*passFd);
+			*passFd = -1;
+		}
+		return 0;
+	}
+	return 1;
+}
+
+
+/*
+* description: Sends all chars. Interrupted and partial sends are retried,
+* and a closed peer does not raise SIGPIPE.
+* param[in]: sock - The socket.
+* param[in]: buf - The chars.
+* param[in]: n - Number of chars.
+* return: 1 if all chars were sent, else 0.
+*/
+int serverSendAll (int sock, const unsigned char *buf, int64_t n) {
+
+	int64_t done = 0;
+
+	while (done < n) {
+
+		ssize_t sent = send(sock, &buf[done], n - done, MSG_NOSIGNAL);
+		if (sent < 0 && errno == EINTR) {
+
+			continue;
+		}
+		if (sent <= 0) {
+
+			return 0;
+		}
+		done = done + sent;
+	}
+	return 1;
+}
+
+
+/*
+* description: Creates memfd holding head and then body, sealed so it can
+* not be changed.
+* param[in]: head - First part of chars.
+* param[in]: headLength - Length of first part.
+* param[in]: body - Second part of chars.
+* param[in]: bodyLength - Length of second part.
+* return: The descriptor, -1 on error.
+*/
+int serverMemfd (const unsigned char *head, int64_t headLength,
+				 const unsigned char *body, int64_t bodyLength) {
+
+	int fd = memfd_create("huffman", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+
+	if (fd < 0) {
+
+		return -1;
+	}
+	if (!streamPwriteFd(fd, head, headLength, 0) ||
+		!streamPwriteFd(fd, body, bodyLength, headLength) || !serverSeal(fd)) {
+
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN SERVER.C
+
+
+/* support function for serverServe!
+* description: Accepts waiting connections.
+* param[in]: s - The server.
+*/
+void serverAccept (server *s) {
+
+	struct timeval timeout;
+
+	timeout.tv_sec = SERVERTIMEOUT;
+	timeout.tv_usec = 0;
+	while (1) {
+
+		int fd = accept4(s -> listenFd, NULL, NULL, SOCK_CLOEXEC);
+		if (fd < 0) {
+
+			if (errno == EINTR) {
+
+				continue;
+			}
+			return;
+		}
+		if (s -> nrOfConns == SERVERMAXCONNECTIONS) {
+
+			close(fd);
+			continue;
+		}
+		//Requests are read without blocking, only replies can wait.
+		setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+		serverConnection *conn = calloc(1, sizeof(serverConnection));
+		conn -> s = s;
+		conn -> fd = fd;
+		conn -> passFd = -1;
+		conn -> state = SERVERIDLE;
+		s -> conns[s -> nrOfConns] = conn;
+		__atomic_store_n(&s -> nrOfConns, s -> nrOfConns + 1,
+						 __ATOMIC_RELAXED);
+	}
+}
+
+
+/* support function for serverServe!
+* description: Reads what has come of the request of a connection without
+* blocking, and keeps it with the connection until the request is whole.
+* param[in]: conn - The serverConnection.
+* return: 1 if request is whole, 0 if more is to come, -1 if connection
+* was ended or broke.
+*/
+int serverReceive (serverConnection *conn) {
+
+	while (1) {
+
+		int inHeader = conn -> headerGot < SERVERHEADERSIZE;
+		uint64_t length = formatGetU64(&conn -> header[8]);
+
+		//A payload passed by descriptor or too big to be inline is not
+		//read from the socket, its worker finds it.
+		if (!inHeader && ((conn -> header[1] & SERVERFD) ||
+						  length > SERVERINLINEMAX ||
+						  conn -> payloadGot == (int64_t)length)) {
+
+			return 1;
+		}
+
+		int64_t got = -1;
+		if (inHeader) {
+
+			got = serverReceiveHeader(conn);
+		} else {
+
+			got = recv(conn -> fd, &conn -> in[conn -> payloadGot],
+					   length - conn -> payloadGot, MSG_DONTWAIT);
+		}
+		if (got < 0 && errno == EINTR) {
+
+			continue;
+		}
+		if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+
+			return 0;
+		}
+		if (got <= 0) {
+
+			return -1;
+		}
+
+		if (!inHeader) {
+
+			conn -> payloadGot = conn -> payloadGot + got;
+			continue;
+		}
+		if (conn -> headerGot == 0) {
+
+			conn -> start = serverNow();
+		}
+		conn -> headerGot = conn -> headerGot + got;
+		length = formatGetU64(&conn -> header[8]);
+		if (conn -> headerGot == SERVERHEADERSIZE &&
+			!(conn -> header[1] & SERVERFD) && length <= SERVERINLINEMAX) {
+
+			serverReserve(&conn -> in, &conn -> inCapacity, length);
+		}
+	}
+}
+
+
+/* support function for serverReceive!
+* description: Reads chars of header without blocking, and keeps a
+* descriptor passed with them.
+* param[in]: conn - The serverConnection.
+* return: Number of chars read, 0 at end of input, -1 on error or if none
+* have come.
+*/
+int64_t serverReceiveHeader (serverConnection *conn) {
+
+	struct msghdr msg;
+	struct iovec iov;
+	union {
+
+		struct cmsghdr align;
+		char buf[CMSG_SPACE(sizeof(int))];
+	} control;
+
+	memset(&msg, 0, sizeof(msg));
+	iov.iov_base = &conn -> header[conn -> headerGot];
+	iov.iov_len = SERVERHEADERSIZE - conn -> headerGot;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf;
+	msg.msg_controllen = sizeof(control.buf);
+
+	ssize_t got = recvmsg(conn -> fd, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+	if (got <= 0) {
+
+		return got;
+	}
+
+	//Only the first descriptor of a request is kept.
+	for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL;
+		 cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+
+		if (cmsg -> cmsg_level == SOL_SOCKET &&
+			cmsg -> cmsg_type == SCM_RIGHTS &&
+			cmsg -> cmsg_len >= CMSG_LEN(sizeof(int))) {
+
+			int fd = -1;
+			memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+			if (conn -> passFd < 0) {
+
+				conn -> passFd = fd;
+			} else {
+
+				close(fd);
+			}
+		}
+	}
+	return got;
+}
+
+
+/* support function for serverServe!
+* description: Serves the whole request of a connection and gives it back
+* to be polled. Runs as a task of the pool.
+* param[in]: arg - The serverConnection.
+*/
+void serverHandle (void *arg) {
+
+	serverConnection *conn = arg;
+	server *s = conn -> s;
+	uint64_t length = formatGetU64(&conn -> header[8]);
+	int flags = conn -> header[1];
+	int mapped = 0;
+	int status = -1;
+	const unsigned char *in = NULL;
+
+	__atomic_sub_fetch(&s -> queued, 1, __ATOMIC_RELAXED);
+
+	//Inline payload was read by the polling thread.
+	if ((flags & SERVERFD) && conn -> passFd >= 0 && length <= INT64_MAX) {
+
+		in = serverLoad(conn, conn -> passFd, length, &mapped);
+	} else if (!(flags & SERVERFD) && length <= SERVERINLINEMAX) {
+
+		in = conn -> in;
+	}
+
+	if (in != NULL) {
+
+		status = serverReply(conn, conn -> header[0], in, length,
+							 flags & SERVERFD);
+	} else if (serverSend(conn -> fd, SERVERINVALID, NULL, 0, NULL, 0, 0)) {
+
+		status = SERVERINVALID;
+	}
+
+	if (mapped && length > 0) {
+
+		munmap((void *)in, length);
+	}
+	if (conn -> passFd >= 0) {
+
+		close(conn -> passFd);
+	}
+	conn -> passFd = -1;
+	conn -> headerGot = 0;
+	conn -> payloadGot = 0;
+	if (status >= 0) {
+
+		serverRecord(s, serverNow() - conn -> start);
+		__atomic_add_fetch(&s -> requests, 1, __ATOMIC_RELAXED);
+	}
+	if (status > 0) {
+
+		__atomic_add_fetch(&s -> failed, 1, __ATOMIC_RELAXED);
+	}
+
+	//An invalid request may have left part of its payload unread, so the
+	//connection can not be read from again.
+	int state = status == SERVEROK || status == SERVERCORRUPT ? SERVERIDLE :
+				SERVERCLOSED;
+	__atomic_store_n(&conn -> state, state, __ATOMIC_RELEASE);
+
+	//A full pipe wakes the polling thread as well.
+	unsigned char c = 0;
+	if (write(s -> wake[1], &c, 1) < 0) {
+
+		return;
+	}
+}
+
+
+/* support function for serverHandle!
+* description: Codes payload of a request and sends the reply.
+* param[in]: conn - The serverConnection.
+* param[in]: op - Op of the request.
+* param[in]: in - Payload.
+* param[in]: length - Length of payload.
+* param[in]: fdReply - 1 to send reply in a memfd.
+* return: Status sent, -1 if reply could not be sent.
+*/
+int serverReply (serverConnection *conn, int op, const unsigned char *in,
+				 int64_t length, int fdReply) {
+
+	server *s = conn -> s;
+	int me = poolSelf(s -> workers) + 1;
+	unsigned char head[FORMATHEADERSIZE];
+
+	if (op == SERVEROPENCODE) {
+
+		const unsigned char *message = NULL;
+		int64_t size = contextEncode(s -> encoders[me], in, length, &message);
+		formatHeaderBytes(head, FORMATMODEDICT, length);
+		return serverSend(conn -> fd, SERVEROK, head, FORMATHEADERSIZE,
+						  message, size, fdReply) ? SERVEROK : -1;
+	}
+
+	if (op == SERVEROPSTATS) {
+
+		serverReserve(&conn -> out, &conn -> outCapacity, SERVERSTATSSIZE);
+		int64_t n = serverStats(s, (char *)conn -> out, SERVERSTATSSIZE);
+		return serverSend(conn -> fd, SERVEROK, NULL, 0, conn -> out, n,
+						  fdReply) ? SERVEROK : -1;
+	}
+
+	if (op != SERVEROPDECODE) {
+
+		return serverSend(conn -> fd, SERVERINVALID, NULL, 0, NULL, 0, 0) ?
+			   SERVERINVALID : -1;
+	}
+
+	//Every char is atleast one bit, so a corrupt length is caught before
+	//memory is allocated for it.
+	int mode = -1;
+	uint64_t chars = 0;
+	if (length < FORMATHEADERSIZE || !formatParseHeader(in, &mode, &chars) ||
+		mode != FORMATMODEDICT ||
+		chars > (uint64_t)(length - FORMATHEADERSIZE) * 8) {
+
+		return serverSend(conn -> fd, SERVERCORRUPT, NULL, 0, NULL, 0, 0) ?
+			   SERVERCORRUPT : -1;
+	}
+
+	//Chars are decoded straight into the memfd of the reply, else into the
+	//buffer of the connection.
+	int fd = -1;
+	unsigned char *text = fdReply && chars > 0 ?
+						  serverMapMemfd(chars, &fd) : NULL;
+	if (text == NULL) {
+
+		serverReserve(&conn -> out, &conn -> outCapacity, chars);
+		text = conn -> out;
+	}
+	int valid = contextDecode(s -> decoders[me], &in[FORMATHEADERSIZE],
+							  length - FORMATHEADERSIZE, text, chars);
+	int status = valid ? SERVEROK : SERVERCORRUPT;
+
+	if (fd < 0) {
+
+		return serverSend(conn -> fd, status, NULL, 0, text,
+						  valid ? chars : 0, 0) ? status : -1;
+	}
+
+	unsigned char header[SERVERHEADERSIZE];
+	munmap(text, chars);
+	valid = valid && serverSeal(fd);
+	serverHeaderBytes(header, status, valid ? SERVERFD : 0, valid ? chars : 0);
+	int sent = serverSendHeader(conn -> fd, header, valid ? fd : -1);
+	close(fd);
+	return sent ? status : -1;
+}
+
+
+/* support function for serverReply!
+* description: Sends reply, inline or in a memfd.
+* param[in]: sock - The socket.
+* param[in]: status - Status of the reply.
+* param[in]: head - First part of payload.
+* param[in]: headLength - Length of first part.
+* param[in]: body - Second part of payload.
+* param[in]: bodyLength - Length of second part.
+* param[in]: fdReply - 1 to send payload in a memfd.
+* return: 1 if reply was sent, else 0.
+*/
+int serverSend (int sock, int status, const unsigned char *head,
+				int64_t headLength, const unsigned char *body,
+				int64_t bodyLength, int fdReply) {
+
+	unsigned char header[SERVERHEADERSIZE];
+	int64_t length = headLength + bodyLength;
+
+	//Reply is sent inline if no memfd can be made.
+	int fd = fdReply ? serverMemfd(head, headLength, body, bodyLength) : -1;
+	if (fd >= 0) {
+
+		serverHeaderBytes(header, status, SERVERFD, length);
+		int sent = serverSendHeader(sock, header, fd);
+		close(fd);
+		return sent;
+	}
+
+	serverHeaderBytes(header, status, 0, length);
+	return serverSendHeader(sock, header, -1) &&
+		   serverSendAll(sock, head, headLength) &&
+		   serverSendAll(sock, body, bodyLength);
+}
+
+
+/* support function for serverReply!
+* description: Creates memfd of length bytes, mapped to be written.
+* param[in]: length - Number of bytes, atleast 1.
+* param[out]: fd - The descriptor, -1 on error.
+* return: The bytes, NULL on error.
+*/
+unsigned char *serverMapMemfd (int64_t length, int *fd) {
+
+	*fd = memfd_create("huffman", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (*fd < 0) {
+
+		return NULL;
+	}
+
+	void *bytes = MAP_FAILED;
+	if (ftruncate(*fd, length) == 0) {
+
+		bytes = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0);
+	}
+	if (bytes == MAP_FAILED) {
+
+		close(*fd);
+		*fd = -1;
+		return NULL;
+	}
+	return bytes;
+}
+
+
+/* support function for serverMemfd and serverReply!
+* description: Seals memfd, so it can not be changed.
+* param[in]: fd - The descriptor.
+* return: 1 if memfd was sealed, else 0.
+*/
+int serverSeal (int fd) {
+
+	return fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW |
+				 F_SEAL_WRITE | F_SEAL_SEAL) == 0;
+}
+
+
+/* support function for serverHandle!
+* description: Gets first length bytes of a passed descriptor. A memfd
+* sealed against shrinking is mapped, other files are read into the buffer
+* of the connection.
+* param[in]: conn - The serverConnection.
+* param[in]: fd - The descriptor.
+* param[in]: length - Number of bytes.
+* param[out]: mapped - 1 if the bytes are mapped, to be unmapped with munmap.
+* return: The bytes, NULL if the file is shorter or can not be read.
+*/
+const unsigned char *serverLoad (serverConnection *conn, int fd,
+								 int64_t length, int *mapped) {
+
+	struct stat info;
+
+	*mapped = 0;
+	if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) ||
+		info.st_size < length) {
+
+		return NULL;
+	}
+
+	int seals = fcntl(fd, F_GET_SEALS);
+	if (length > 0 && seals >= 0 && (seals & F_SEAL_SHRINK)) {
+
+		void *bytes = mmap(NULL, length, PROT_READ, MAP_PRIVATE | MAP_POPULATE,
+						   fd, 0);
+		if (bytes != MAP_FAILED) {
+
+			*mapped = 1;
+			return bytes;
+		}
+	}
+
+	serverReserve(&conn -> in, &conn -> inCapacity, length);
+	if (streamPreadFd(fd, conn -> in, length, 0) != length) {
+
+		return NULL;
+	}
+	return conn -> in;
+}
+
+
+/* support function for serverReceive, serverLoad and serverReply!
+* description: Grows array to atleast n chars. Contents are not kept.
+* param[in,out]: buf - The array.
+* param[in,out]: capacity - Size of the array.
+* param[in]: n - Number of chars needed.
+*/
+void serverReserve (unsigned char **buf, int64_t *capacity, int64_t n) {
+
+	if (*buf != NULL && *capacity >= n) {
+
+		return;
+	}
+	free(*buf);
+	*capacity = n > *capacity * 2 ? n : *capacity * 2;
+	*buf = malloc(*capacity + 1);
+}
+
+
+/* support function for serverHandle!
+* description: Counts latency of a request in its bucket.
+* param[in]: s - The server.
+* param[in]: nanos - Latency in nanoseconds.
+*/
+void serverRecord (server *s, int64_t nanos) {
+
+	uint64_t value = nanos > 0 ? (uint64_t)nanos : 0;
+	int bucket = (int)value;
+
+	//Bucket is the power of two and the next SERVERSUBBITS bits below it.
+	if (value >= SERVERSUBBUCKETS) {
+
+		int top = 63 - __builtin_clzll(value);
+		bucket = (top - SERVERSUBBITS + 1) * SERVERSUBBUCKETS +
+				 (int)((value >> (top - SERVERSUBBITS)) &
+					   (SERVERSUBBUCKETS - 1));
+	}
+	__atomic_add_fetch(&s -> latency[bucket], 1, __ATOMIC_RELAXED);
+}
+
+
+/* support function for serverStats!
+* description: Finds latency below which a share of the requests were
+* served, as the upper bound of its bucket.
+* param[in]: counts - Requests counted in each bucket.
+* param[in]: total - Number of requests counted.
+* param[in]: share - The share, 0 to 1.
+* return: The latency in nanoseconds.
+*/
+double serverPercentile (const uint64_t *counts, uint64_t total, double share) {
+
+	uint64_t seen = 0;
+
+	for (int i = 0; i < SERVERBUCKETS && total > 0; i++) {
+
+		seen = seen + counts[i];
+		if (seen >= share * total) {
+
+			if (i < SERVERSUBBUCKETS) {
+
+				return i + 1;
+			}
+			int top = i / SERVERSUBBUCKETS + SERVERSUBBITS - 1;
+			int sub = i % SERVERSUBBUCKETS;
+			return (double)(SERVERSUBBUCKETS + sub + 1) *
+				   (double)((uint64_t)1 << (top - SERVERSUBBITS));
+		}
+	}
+	return 0;
+}
+
+
+/* support function for serverReceive and serverHandle!
+* description: Gets time of a monotonic clock.
+* return: The time in nanoseconds.
+*/
+int64_t serverNow (void) {
+
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
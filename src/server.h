@@ -0,0 +1,366 @@
+/*
+* server: Coding server on a Unix domain socket, run by huffmand.
+*
+* Short runs pay more for starting a process and building tables than for
+* coding. The server builds its tables and starts its workers once and then
+* codes requests of any number of clients. Messages are coded with
+* contextEncode and the shared tables of a table set, see context.h and
+* dict.h, and each worker has its own encoder and decoder, so a warm server
+* makes no table and few allocations per request.
+*
+* One thread polls the listening socket and the idle connections, and reads
+* requests without blocking. What has come of a request is kept with its
+* connection, and the connection is handed to the pool only once the
+* request is whole, so a slow or stalled client holds no worker. The worker
+* codes the request, sends the reply and gives the connection back to be
+* polled. So each connection has atmost one request being served, and
+* replies come in the order of the requests.
+*
+* Request and reply, integers little endian:
+*   SERVERHEADERSIZE bytes header:
+*     1 byte   op of a request, status of a reply
+*     1 byte   flags
+*     6 bytes  reserved, 0
+*     8 bytes  length of payload
+*   payload, unless SERVERFD is set
+*
+* With SERVERFD the payload is not sent on the socket. A descriptor of it is
+* passed with the header instead, so big payloads are not copied through the
+* socket. A memfd sealed against shrinking is mapped, and any other file is
+* read from the descriptor, as a file cut while it is mapped would crash the
+* server. A request with SERVERFD gets its reply in a sealed memfd too.
+*
+* Payload of SERVEROPENCODE is chars, and of its reply a file as written by
+* huffman -encode -dict, a FORMATMODEDICT header and one message. So a
+* reply can be decoded by huffman -decode -dict with the same table set, and
+* files it writes can be decoded by the server. SERVEROPSTATS has no
+* payload, and its reply is text with counts of requests, number of
+* requests queued for a worker, and percentiles of the time from a request
+* being seen to its reply being sent.
+*/
+
+#ifndef SERVER
+#define SERVER
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "context.h"
+#include "pool.h"
+
+#define SERVERHEADERSIZE 16
+#define SERVEROPENCODE 1
+#define SERVEROPDECODE 2
+#define SERVEROPSTATS 3
+#define SERVEROK 0
+//Request is not valid, the connection is closed after the reply.
+#define SERVERINVALID 1
+//Payload of decode is not a file coded with the table set of the server.
+#define SERVERCORRUPT 2
+#define SERVERFD 1
+//Bigger payloads must be passed with SERVERFD.
+#define SERVERINLINEMAX ((int64_t)64 << 20)
+#define SERVERMAXCONNECTIONS 1024
+//Seconds a worker waits for a reply to be taken, so a stalled client can
+//not hold it.
+#define SERVERTIMEOUT 5
+#define SERVERSTATSSIZE 512
+//Latency histogram has SERVERSUBBUCKETS buckets per power of two nanoseconds.
+#define SERVERSUBBITS 2
+#define SERVERSUBBUCKETS (1 << SERVERSUBBITS)
+#define SERVERBUCKETS (64 * SERVERSUBBUCKETS)
+#define SERVERIDLE 0
+#define SERVERBUSY 1
+#define SERVERCLOSED 2
+
+
+struct server;
+
+
+typedef struct serverConnection {
+
+	struct server *s;
+	int fd;
+	//SERVERIDLE, SERVERBUSY or SERVERCLOSED, read by the polling thread.
+	int state;
+	//Time the first chars of the request were read, in nanoseconds.
+	int64_t start;
+	//Request read so far by the polling thread: header, descriptor passed
+	//with it, -1 for none, and chars of an inline payload in in.
+	unsigned char header[SERVERHEADERSIZE];
+	int headerGot;
+	int passFd;
+	int64_t payloadGot;
+	unsigned char *in;
+	int64_t inCapacity;
+	unsigned char *out;
+	int64_t outCapacity;
+} serverConnection;
+
+
+typedef struct server {
+
+	int listenFd;
+	char *path;
+	//Pipe waking the polling thread when a connection is given back or the
+	//server is stopped.
+	int wake[2];
+	int stop;
+	pool *workers;
+	poolGroup group;
+	int nrOfTables;
+	//Encoder and decoder of each worker, at index of worker + 1, and of a
+	//thread that is not a worker at 0.
+	contextEncoder **encoders;
+	contextDecoder **decoders;
+	serverConnection **conns;
+	int nrOfConns;
+	int64_t requests;
+	int64_t failed;
+	int64_t queued;
+	int64_t maxQueued;
+	uint64_t latency[SERVERBUCKETS];
+} server;
+
+
+/*
+* description: Creates server listening on socket path. Tables are held by
+* the server. Allocates memory for server.
+* param[in]: path - Name of the socket, removed first if it is a socket.
+* param[in]: tables - The tables.
+* param[in]: count - Number of tables, 0 to code every message with its own
+* table.
+* param[in]: nrOfThreads - Number of workers, below 1 for number of online
+* CPUs.
+* return: The server, NULL if the socket could not be made.
+*/
+server *serverEmpty (char const *path, contextTable *const *tables, int count,
+					 int nrOfThreads);
+
+
+/*
+* description: Serves requests until serverStop is called, then waits for
+* requests being served.
+* param[in]: s - The server.
+* return: 1 if server was stopped, 0 on error.
+*/
+int serverServe (server *s);
+
+
+/*
+* description: Makes serverServe return. Safe from any thread and from a
+* signal handler.
+* param[in]: s - The server.
+*/
+void serverStop (server *s);
+
+
+/*
+* description: Closes connections and socket, removes socket file and
+* deallocates all memory of server.
+* param[in]: s - The server, not being served.
+*/
+void serverKill (server *s);
+
+
+/*
+* description: Writes counts and latency percentiles of server as text.
+* param[in]: s - The server.
+* param[out]: text - Array of atleast size chars.
+* param[in]: size - Size of text.
+* return: Number of chars written, without the ending '\0'.
+*/
+int64_t serverStats (server *s, char *text, int64_t size);
+
+
+/*
+* description: Stores header as SERVERHEADERSIZE bytes.
+* param[out]: header - Pointer to atleast SERVERHEADERSIZE bytes.
+* param[in]: op - Op of a request, status of a reply.
+* param[in]: flags - Flags.
+* param[in]: length - Length of payload.
+*/
+void serverHeaderBytes (unsigned char *header, int op, int flags,
+						uint64_t length);
+
+
+/*
+* description: Sends header, and passes descriptor with it.
+* param[in]: sock - The socket.
+* param[in]: header - SERVERHEADERSIZE bytes.
+* param[in]: passFd - Descriptor to pass, -1 for none.
+* return: 1 if header was sent, else 0.
+*/
+int serverSendHeader (int sock, const unsigned char *header, int passFd);
+
+
+/*
+* description: Receives header, and a descriptor passed with it.
+* param[in]: sock - The socket.
+* param[out]: header - Pointer to atleast SERVERHEADERSIZE bytes.
+* param[out]: passFd - Descriptor passed, -1 for none. Owned by caller.
+* return: 1 if header was received, 0 at end of input or on error.
+*/
+int serverRecvHeader (int sock, unsigned char *header, int *passFd);
+
+
+/*
+* description: Sends all chars. Interrupted and partial sends are retried,
+* and a closed peer does not raise SIGPIPE.
+* param[in]: sock - The socket.
+* param[in]: buf - The chars.
+* param[in]: n - Number of chars.
+* return: 1 if all chars were sent, else 0.
+*/
+int serverSendAll (int sock, const unsigned char *buf, int64_t n);
+
+
+/*
+* description: Creates memfd holding head and then body, sealed so it can
+* not be changed.
+* param[in]: head - First part of chars.
+* param[in]: headLength - Length of first part.
+* param[in]: body - Second part of chars.
+* param[in]: bodyLength - Length of second part.
+* return: The descriptor, -1 on error.
+*/
+int serverMemfd (const unsigned char *head, int64_t headLength,
+				 const unsigned char *body, int64_t bodyLength);
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN SERVER.C
+
+
+/* support function for serverServe!
+* description: Accepts waiting connections.
+* param[in]: s - The server.
+*/
+void serverAccept (server *s);
+
+
+/* support function for serverServe!
+* description: Reads what has come of the request of a connection without
+* blocking, and keeps it with the connection until the request is whole.
+* param[in]: conn - The serverConnection.
+* return: 1 if request is whole, 0 if more is to come, -1 if connection
+* was ended or broke.
+*/
+int serverReceive (serverConnection *conn);
+
+
+/* support function for serverReceive!
+* description: Reads chars of header without blocking, and keeps a
+* descriptor passed with them.
+* param[in]: conn - The serverConnection.
+* return: Number of chars read, 0 at end of input, -1 on error or if none
+* have come.
+*/
+int64_t serverReceiveHeader (serverConnection *conn);
+
+
+/* support function for serverServe!
+* description: Serves the whole request of a connection and gives it back
+* to be polled. Runs as a task of the pool.
+* param[in]: arg - The serverConnection.
+*/
+void serverHandle (void *arg);
+
+
+/* support function for serverHandle!
+* description: Codes payload of a request and sends the reply.
+* param[in]: conn - The serverConnection.
+* param[in]: op - Op of the request.
+* param[in]: in - Payload.
+* param[in]: length - Length of payload.
+* param[in]: fdReply - 1 to send reply in a memfd.
+* return: Status sent, -1 if reply could not be sent.
+*/
+int serverReply (serverConnection *conn, int op, const unsigned char *in,
+				 int64_t length, int fdReply);
+
+
+/* support function for serverReply!
+* description: Sends reply, inline or in a memfd.
+* param[in]: sock - The socket.
+* param[in]: status - Status of the reply.
+* param[in]: head - First part of payload.
+* param[in]: headLength - Length of first part.
+* param[in]: body - Second part of payload.
+* param[in]: bodyLength - Length of second part.
+* param[in]: fdReply - 1 to send payload in a memfd.
+* return: 1 if reply was sent, else 0.
+*/
+int serverSend (int sock, int status, const unsigned char *head,
+				int64_t headLength, const unsigned char *body,
+				int64_t bodyLength, int fdReply);
+
+
+/* support function for serverReply!
+* description: Creates memfd of length bytes, mapped to be written.
+* param[in]: length - Number of bytes, atleast 1.
+* param[out]: fd - The descriptor, -1 on error.
+* return: The bytes, NULL on error.
+*/
+unsigned char *serverMapMemfd (int64_t length, int *fd);
+
+
+/* support function for serverMemfd and serverReply!
+* description: Seals memfd, so it can not be changed.
+* param[in]: fd - The descriptor.
+* return: 1 if memfd was sealed, else 0.
+*/
+int serverSeal (int fd);
+
+
+/* support function for serverHandle!
+* description: Gets first length bytes of a passed descriptor. A memfd
+* sealed against shrinking is mapped, other files are read into the buffer
+* of the connection.
+* param[in]: conn - The serverConnection.
+* param[in]: fd - The descriptor.
+* param[in]: length - Number of bytes.
+* param[out]: mapped - 1 if the bytes are mapped, to be unmapped with munmap.
+* return: The bytes, NULL if the file is shorter or can not be read.
+*/
+const unsigned char *serverLoad (serverConnection *conn, int fd,
+								 int64_t length, int *mapped);
+
+
+/* support function for serverReceive, serverLoad and serverReply!
+* description: Grows array to atleast n chars. Contents are not kept.
+* param[in,out]: buf - The array.
+* param[in,out]: capacity - Size of the array.
+* param[in]: n - Number of chars needed.
+*/
+void serverReserve (unsigned char **buf, int64_t *capacity, int64_t n);
+
+
+/* support function for serverHandle!
+* description: Counts latency of a request in its bucket.
+* param[in]: s - The server.
+* param[in]: nanos - Latency in nanoseconds.
+*/
+void serverRecord (server *s, int64_t nanos);
+
+
+/* support function for serverStats!
+* description: Finds latency below which a share of the requests were
+* served, as the upper bound of its bucket.
+* param[in]: counts - Requests counted in each bucket.
+* param[in]: total - Number of requests counted.
+* param[in]: share - The share, 0 to 1.
+* return: The latency in nanoseconds.
+*/
+double serverPercentile (const uint64_t *counts, uint64_t total, double share);
+
+
+/* support function for serverReceive and serverHandle!
+* description: Gets time of a monotonic clock.
+* return: The time in nanoseconds.
+*/
+int64_t serverNow (void);
+
+
+#endif //SERVER
@@ -0,0 +1,832 @@
+/*
+* stream: Buffered input and output on file descriptors, "-" being stdin or
+* stdout. See stream.h for the backends.
+*/
+
+//O_DIRECT is not part of POSIX.
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "stream.h"
+
+
+/*
+* description: Opens file with backend of config.
+* param[in]: name - Name of file, "-" for stdin or stdout.
+* param[in]: writing - 1 to create or truncate file and write it, 0 to read.
+* param[in]: config - Backend and O_DIRECT, NULL for plain.
+* return: The stream, NULL if file could not be opened.
+*/
+stream *streamOpen (char const *name, int writing, const streamConfig *config) {
+
+	int backend = config != NULL ? config -> backend : STREAMBACKENDPLAIN;
+	int direct = config != NULL && config -> direct;
+
+	if (strcmp(name, "-") == 0) {
+
+		return streamEmpty(writing ? STDOUT_FILENO : STDIN_FILENO, writing, 1,
+						   STREAMBACKENDPLAIN, 0);
+	}
+
+	int flags = writing ? O_WRONLY | O_CREAT | O_TRUNC : O_RDONLY;
+	int fd = open(name, flags | (direct ? O_DIRECT : 0), 0666);
+
+	//Some file systems, like tmpfs, do not allow O_DIRECT.
+	if (fd < 0 && direct) {
+
+		direct = 0;
+		fd = open(name, flags, 0666);
+	}
+	if (fd < 0) {
+
+		return NULL;
+	}
+	return streamEmpty(fd, writing, 0, backend, direct);
+}
+
+
+/*
+* description: Opens file for reading.
+* param[in]: name - Name of file, "-" for stdin.
+* return: The stream, NULL if file could not be opened.
+*/
+stream *streamOpenRead (char const *name) {
+
+	return streamOpen(name, 0, NULL);
+}
+
+
+/*
+* description: Opens file for writing, created or truncated.
+* param[in]: name - Name of file, "-" for stdout.
+* return: The stream, NULL if file could not be opened.
+*/
+stream *streamOpenWrite (char const *name) {
+
+	return streamOpen(name, 1, NULL);
+}
+
+
+/*
+* description: Opens file for writing at offset, created if it does not
+* exist. Chars after offset are overwritten, and kept if not written over.
+* param[in]: name - Name of file.
+* param[in]: offset - Offset of first write.
+* return: The stream, NULL if file could not be opened.
+*/
+stream *streamOpenAt (char const *name, int64_t offset) {
+
+	int fd = open(name, O_WRONLY | O_CREAT, 0666);
+
+	if (fd < 0) {
+
+		return NULL;
+	}
+	if (lseek(fd, offset, SEEK_SET) != offset) {
+
+		close(fd);
+		return NULL;
+	}
+	return streamEmpty(fd, 1, 0, STREAMBACKENDPLAIN, 0);
+}
+
+
+/*
+* description: Flushes and closes stream and frees it's memory. Stdin and
+* stdout are flushed but left open.
+* param[in]: s - The stream.
+* return: 1 if all reads and writes succeeded, else 0.
+*/
+int streamClose (stream *s) {
+
+	int valid = 1;
+
+	if (s -> writing) {
+
+		valid = streamFlush(s);
+	}
+	if (s -> ring != NULL) {
+
+		streamUringFinish(s);
+		uringKill(s -> ring);
+	}
+	if (!s -> isStd && close(s -> fd) != 0) {
+
+		valid = 0;
+	}
+	valid = valid && !s -> error;
+
+	free(s -> memory);
+	free(s);
+	return valid;
+}
+
+
+/*
+* description: Reads chars, waiting until all are read or input ends.
+* param[in]: s - The stream.
+* param[out]: buf - Array to store atleast n chars in.
+* param[in]: n - Number of chars to read.
+* return: Number of chars read, less than n only at end of input or error.
+*/
+int64_t streamRead (stream *s, void *buf, int64_t n) {
+
+	unsigned char *out = buf;
+	int64_t done = 0;
+
+	while (done < n) {
+
+		if (s -> pos < s -> fill) {
+
+			int64_t chunk = s -> fill - s -> pos;
+			if (chunk > n - done) {
+
+				chunk = n - done;
+			}
+			memcpy(&out[done], &s -> buffer[s -> pos], chunk);
+			s -> pos = s -> pos + chunk;
+			done = done + chunk;
+			continue;
+		}
+		if (s -> eof || s -> error) {
+
+			break;
+		}
+
+		//Big plain reads skip the buffer, other backends need its alignment
+		//or offsets.
+		int64_t got;
+		if (n - done >= s -> capacity && s -> backend == STREAMBACKENDPLAIN &&
+			!s -> direct) {
+
+			got = streamReadFd(s -> fd, &out[done], n - done);
+			done = done + (got > 0 ? got : 0);
+		} else {
+
+			got = streamFill(s);
+			s -> pos = 0;
+			s -> fill = got > 0 ? got : 0;
+		}
+
+		if (got < 0) {
+
+			s -> error = 1;
+		} else if (got == 0) {
+
+			s -> eof = 1;
+		}
+	}
+	return done;
+}
+
+
+/*
+* description: Reads one char.
+* param[in]: s - The stream.
+* return: The char, -1 at end of input.
+*/
+int streamGetc (stream *s) {
+
+	unsigned char c;
+
+	if (s -> pos < s -> fill) {
+
+		c = s -> buffer[s -> pos];
+		s -> pos++;
+		return c;
+	}
+	return streamRead(s, &c, 1) == 1 ? c : -1;
+}
+
+
+/*
+* description: Reads all chars left in stream.
+* param[in]: s - The stream.
+* param[out]: length - Number of chars read.
+* return: Allocated array of the chars.
+*/
+unsigned char *streamReadAll (stream *s, int64_t *length) {
+
+	int64_t capacity = STREAMBUFFERSIZE;
+	unsigned char *text = malloc(capacity);
+	int64_t got = 0;
+
+	*length = 0;
+	do {
+
+		if (*length == capacity) {
+
+			capacity = capacity * 2;
+			text = realloc(text, capacity);
+		}
+		got = streamRead(s, &text[*length], capacity - *length);
+		*length = *length + got;
+	} while (got > 0 && !s -> eof);
+
+	return text;
+}
+
+
+/*
+* description: Writes chars.
+* param[in]: s - The stream.
+* param[in]: buf - The chars.
+* param[in]: n - Number of chars.
+* return: 1 if chars were written or buffered, else 0.
+*/
+int streamWrite (stream *s, const void *buf, int64_t n) {
+
+	const unsigned char *in = buf;
+
+	while (n > 0) {
+
+		//Big plain writes skip the buffer, like big reads.
+		if (s -> fill == 0 && n >= s -> capacity &&
+			s -> backend == STREAMBACKENDPLAIN && !s -> direct) {
+
+			if (!streamWriteFd(s -> fd, in, n)) {
+
+				s -> error = 1;
+				return 0;
+			}
+			return 1;
+		}
+
+		int64_t chunk = s -> capacity - s -> fill;
+		if (chunk > n) {
+
+			chunk = n;
+		}
+		memcpy(&s -> buffer[s -> fill], in, chunk);
+		s -> fill = s -> fill + chunk;
+		in = in + chunk;
+		n = n - chunk;
+
+		if (s -> fill == s -> capacity && !streamFlush(s)) {
+
+			return 0;
+		}
+	}
+	return 1;
+}
+
+
+/*
+* description: Writes one char.
+* param[in]: s - The stream.
+* param[in]: c - The char.
+* return: 1 if char was written or buffered, else 0.
+*/
+int streamPutc (stream *s, int c) {
+
+	if (s -> fill == s -> capacity && !streamFlush(s)) {
+
+		return 0;
+	}
+	s -> buffer[s -> fill] = (unsigned char)c;
+	s -> fill++;
+	return 1;
+}
+
+
+/*
+* description: Writes buffered chars to descriptor.
+* param[in]: s - The stream.
+* return: 1 if all chars were written, else 0.
+*/
+int streamFlush (stream *s) {
+
+	if (s -> fill > 0 && !s -> error && !streamDrain(s)) {
+
+		s -> error = 1;
+	}
+	s -> fill = 0;
+	return !s -> error;
+}
+
+
+/*
+* description: Checks if stream is a file that can be written at an offset,
+* not a pipe or terminal.
+* param[in]: s - The stream.
+* return: 1 if stream can seek, else 0.
+*/
+int streamSeekable (stream *s) {
+
+	return lseek(s -> fd, 0, SEEK_CUR) >= 0;
+}
+
+
+/*
+* description: Flushes stream and writes chars at offset from start of file,
+* without moving the position of next write.
+* param[in]: s - A seekable stream opened for writing.
+* param[in]: offset - Offset from start of file.
+* param[in]: buf - The chars.
+* param[in]: n - Number of chars.
+* return: 1 if chars were written, else 0.
+*/
+int streamWriteAt (stream *s, int64_t offset, const void *buf, int64_t n) {
+
+	if (!streamFlush(s)) {
+
+		return 0;
+	}
+	if (s -> ring != NULL) {
+
+		streamUringFinish(s);
+	}
+	if (s -> direct) {
+
+		streamDirectOff(s);
+	}
+	if (!streamPwriteFd(s -> fd, buf, n, offset)) {
+
+		s -> error = 1;
+		return 0;
+	}
+	return 1;
+}
+
+
+/*
+* description: Parses name of backend.
+* param[in]: name - plain, pread or uring.
+* return: The backend, -1 if name is not a backend.
+*/
+int streamParseBackend (char const *name) {
+
+	if (strcmp(name, "plain") == 0) {
+
+		return STREAMBACKENDPLAIN;
+	} else if (strcmp(name, "pread") == 0) {
+
+		return STREAMBACKENDPREAD;
+	} else if (strcmp(name, "uring") == 0) {
+
+		return STREAMBACKENDURING;
+	}
+	return -1;
+}
+
+
+/*
+* description: Gets name of backend stream ended up with.
+* param[in]: s - The stream.
+* return: Name of backend.
+*/
+char const *streamBackendName (stream *s) {
+
+	char const *names[3] = {"plain", "pread", "uring"};
+	return names[s -> backend];
+}
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN STREAM.C
+
+
+/* support function for streamOpen!
+* description: Creates stream of open descriptor.
+* param[in]: fd - The descriptor.
+* param[in]: writing - 1 if stream is written, 0 if read.
+* param[in]: isStd - 1 if descriptor is stdin or stdout.
+* param[in]: backend - Wanted backend, plain is used for stdin and stdout.
+* param[in]: direct - 1 if descriptor was opened with O_DIRECT.
+* return: The stream.
+*/
+stream *streamEmpty (int fd, int writing, int isStd, int backend, int direct) {
+
+	stream *s = malloc(sizeof(stream));
+	void *memory = NULL;
+
+	memset(s, 0, sizeof(stream));
+	s -> fd = fd;
+	s -> writing = writing;
+	s -> isStd = isStd;
+	s -> direct = direct;
+	s -> held = -1;
+
+	//Offsets mean nothing on pipes.
+	s -> backend = isStd || lseek(fd, 0, SEEK_CUR) < 0 ? STREAMBACKENDPLAIN :
+				   backend;
+
+	posix_memalign(&memory, STREAMALIGN, STREAMBUFFERSIZE);
+	s -> memory = memory;
+	s -> buffer = s -> memory;
+	s -> capacity = STREAMBUFFERSIZE;
+
+	if (s -> backend == STREAMBACKENDURING && !streamUringStart(s)) {
+
+		s -> backend = STREAMBACKENDPREAD;
+	}
+	return s;
+}
+
+
+/* support function for streamRead!
+* description: Refills buffer with next chars of file.
+* param[in]: s - The stream.
+* return: Number of chars read, 0 at end of file, -1 on error.
+*/
+int64_t streamFill (stream *s) {
+
+	if (s -> backend == STREAMBACKENDURING) {
+
+		return streamUringFill(s);
+	} else if (s -> backend == STREAMBACKENDPREAD) {
+
+		int64_t got = streamPreadFd(s -> fd, s -> buffer, s -> capacity,
+									s -> offset);
+		s -> offset = s -> offset + (got > 0 ? got : 0);
+		return got;
+	}
+	return streamReadFd(s -> fd, s -> buffer, s -> capacity);
+}
+
+
+/* support function for streamFlush!
+* description: Writes chars in buffer to file.
+* param[in]: s - The stream.
+* return: 1 if chars were written or queued, else 0.
+*/
+int streamDrain (stream *s) {
+
+	if (s -> backend == STREAMBACKENDURING) {
+
+		return streamUringDrain(s);
+	}
+
+	//A part of a block is only written at the end, O_DIRECT is not needed
+	//after it.
+	if (s -> direct && s -> fill % STREAMALIGN != 0) {
+
+		streamDirectOff(s);
+	}
+	if (s -> backend == STREAMBACKENDPREAD) {
+
+		int valid = streamPwriteFd(s -> fd, s -> buffer, s -> fill,
+								   s -> offset);
+		s -> offset = s -> offset + s -> fill;
+		return valid;
+	}
+	return streamWriteFd(s -> fd, s -> buffer, s -> fill);
+}
+
+
+/* support function for streamEmpty!
+* description: Sets up io_uring, registers file and buffers and, when
+* reading, queues the first reads.
+* param[in]: s - The stream.
+* return: 1 if io_uring could be used, else 0.
+*/
+int streamUringStart (stream *s) {
+
+	void *memory = NULL;
+	struct iovec buffers[STREAMURINGDEPTH];
+
+	s -> ring = uringEmpty(2 * STREAMURINGDEPTH);
+	if (s -> ring == NULL) {
+
+		return 0;
+	}
+
+	free(s -> memory);
+	posix_memalign(&memory, STREAMALIGN,
+				   (size_t)STREAMURINGDEPTH * STREAMURINGBLOCK);
+	s -> memory = memory;
+	for (int i = 0; i < STREAMURINGDEPTH; i++) {
+
+		buffers[i].iov_base = &s -> memory[(int64_t)i * STREAMURINGBLOCK];
+		buffers[i].iov_len = STREAMURINGBLOCK;
+	}
+	uringSetFile(s -> ring, s -> fd);
+	uringRegisterBuffers(s -> ring, buffers, STREAMURINGDEPTH);
+
+	s -> capacity = STREAMURINGBLOCK;
+	s -> buffer = s -> memory;
+	s -> slot = 0;
+
+	//All buffers are read ahead from the start.
+	if (!s -> writing) {
+
+		for (int i = 0; i < STREAMURINGDEPTH; i++) {
+
+			s -> slotOffset[i] = s -> offset;
+			s -> busy[i] = uringQueue(s -> ring, 0, buffers[i].iov_base,
+									  STREAMURINGBLOCK, s -> offset, i, i);
+			s -> offset = s -> offset + STREAMURINGBLOCK;
+		}
+		uringSubmit(s -> ring);
+	}
+	return 1;
+}
+
+
+/* support function for streamFill!
+* description: Queues read of buffer just used, if input has not ended, and
+* waits for the next buffer.
+* param[in]: s - The stream.
+* return: Number of chars read, 0 at end of file, -1 on error.
+*/
+int64_t streamUringFill (stream *s) {
+
+	int held = s -> held;
+
+	if (held >= 0 && !s -> ended) {
+
+		unsigned char *buffer = &s -> memory[(int64_t)held * STREAMURINGBLOCK];
+		s -> slotOffset[held] = s -> offset;
+		s -> busy[held] = uringQueue(s -> ring, 0, buffer, STREAMURINGBLOCK,
+									 s -> offset, held, held);
+		s -> offset = s -> offset + STREAMURINGBLOCK;
+		uringSubmit(s -> ring);
+	}
+
+	int slot = s -> slot;
+	while (s -> busy[slot]) {
+
+		if (!streamUringCollect(s)) {
+
+			return -1;
+		}
+	}
+	s -> held = slot;
+	s -> slot = (slot + 1) % STREAMURINGDEPTH;
+	s -> buffer = &s -> memory[(int64_t)slot * STREAMURINGBLOCK];
+
+	int64_t got = s -> result[slot];
+	if (got < 0 || s -> ended) {
+
+		return s -> ended ? 0 : -1;
+	}
+
+	//A short read is the end of the file, unless the kernel stopped early,
+	//then the rest is read here.
+	if (got < STREAMURINGBLOCK) {
+
+		struct stat st;
+		if (fstat(s -> fd, &st) != 0) {
+
+			return -1;
+		}
+		if (s -> slotOffset[slot] + got < st.st_size) {
+
+			if (s -> direct) {
+
+				return -1;
+			}
+			int64_t more = streamPreadFd(s -> fd, &s -> buffer[got],
+										 STREAMURINGBLOCK - got,
+										 s -> slotOffset[slot] + got);
+			if (more < 0) {
+
+				return -1;
+			}
+			got = got + more;
+		}
+		s -> ended = got < STREAMURINGBLOCK;
+	}
+	return got;
+}
+
+
+/* support function for streamDrain!
+* description: Queues write of buffer and waits until next buffer is free.
+* param[in]: s - The stream.
+* return: 1 if write was queued, else 0.
+*/
+int streamUringDrain (stream *s) {
+
+	int slot = s -> slot;
+
+	//Part of a block at the end is written when all else is done.
+	if (s -> direct && s -> fill % STREAMALIGN != 0) {
+
+		streamUringFinish(s);
+		streamDirectOff(s);
+		int valid = streamPwriteFd(s -> fd, s -> buffer, s -> fill,
+								   s -> offset);
+		s -> offset = s -> offset + s -> fill;
+		return valid && !s -> error;
+	}
+
+	s -> slotLength[slot] = s -> fill;
+	s -> busy[slot] = uringQueue(s -> ring, 1, s -> buffer, s -> fill,
+								 s -> offset, slot, slot);
+	if (!s -> busy[slot] || !uringSubmit(s -> ring)) {
+
+		return 0;
+	}
+	s -> offset = s -> offset + s -> fill;
+
+	slot = (slot + 1) % STREAMURINGDEPTH;
+	while (s -> busy[slot]) {
+
+		if (!streamUringCollect(s)) {
+
+			return 0;
+		}
+	}
+	s -> slot = slot;
+	s -> buffer = &s -> memory[(int64_t)slot * STREAMURINGBLOCK];
+	return !s -> error;
+}
+
+
+/* support function for streamUringFill and streamUringDrain!
+* description: Takes one completed request and marks its buffer free. A
+* write that was not complete sets error of stream.
+* param[in]: s - The stream.
+* return: 1 if a request completed, else 0.
+*/
+int streamUringCollect (stream *s) {
+
+	uint64_t slot = 0;
+	int result = 0;
+
+	if (!uringWait(s -> ring, &slot, &result)) {
+
+		s -> error = 1;
+		return 0;
+	}
+	s -> busy[slot] = 0;
+	s -> result[slot] = result;
+	if (s -> writing && result != s -> slotLength[slot]) {
+
+		s -> error = 1;
+	}
+	return 1;
+}
+
+
+/* support function for streamClose, streamWriteAt and streamUringDrain!
+* description: Waits until all requests in flight have completed.
+* param[in]: s - The stream.
+*/
+void streamUringFinish (stream *s) {
+
+	for (int i = 0; i < STREAMURINGDEPTH; i++) {
+
+		while (s -> busy[i]) {
+
+			if (!streamUringCollect(s)) {
+
+				return;
+			}
+		}
+	}
+}
+
+
+/* support function for streamDrain, streamWriteAt and streamUringDrain!
+* description: Turns off O_DIRECT, used before writes that are not whole
+* STREAMALIGN blocks.
+* param[in]: s - The stream.
+*/
+void streamDirectOff (stream *s) {
+
+	int flags = fcntl(s -> fd, F_GETFL);
+
+	if (flags >= 0) {
+
+		fcntl(s -> fd, F_SETFL, flags & ~O_DIRECT);
+	}
+	s -> direct = 0;
+}
+
+
+/* support function for streamFill, streamDrain and streamUringFill!
+* description: Reads at offset until n chars are read or file ends.
+* Interrupted reads are retried.
+* param[in]: fd - The descriptor.
+* param[out]: buf - Array to store atleast n chars in.
+* param[in]: n - Largest number of chars to read.
+* param[in]: offset - Offset in file.
+* return: Number of chars read, -1 on error.
+*/
+int64_t streamPreadFd (int fd, unsigned char *buf, int64_t n, int64_t offset) {
+
+	int64_t done = 0;
+
+	while (done < n) {
+
+		ssize_t got = pread(fd, &buf[done], n - done, offset + done);
+
+		if (got < 0 && errno == EINTR) {
+
+			continue;
+		}
+		if (got < 0) {
+
+			return done > 0 ? done : -1;
+		}
+		if (got == 0) {
+
+			break;
+		}
+		done = done + got;
+	}
+	return done;
+}
+
+
+/* support function for streamDrain, streamWriteAt and streamUringDrain!
+* description: Writes all chars at offset. Interrupted and partial writes
+* are retried.
+* param[in]: fd - The descriptor.
+* param[in]: buf - The chars.
+* param[in]: n - Number of chars.
+* param[in]: offset - Offset in file.
+* return: 1 if all chars were written, else 0.
+*/
+int streamPwriteFd (int fd, const unsigned char *buf, int64_t n,
+					int64_t offset) {
+
+	int64_t done = 0;
+
+	while (done < n) {
+
+		ssize_t put = pwrite(fd, &buf[done], n - done, offset + done);
+
+		if (put < 0 && errno == EINTR) {
+
+			continue;
+		}
+		if (put <= 0) {
+
+			return 0;
+		}
+		done = done + put;
+	}
+	return 1;
+}
+
+
+/* support function for streamRead and streamFill!
+* description: Reads from descriptor until n chars are read, input ends or an
+* error occurs. Interrupted reads are retried.
+* param[in]: fd - The descriptor.
+* param[out]: buf - Array to store atleast n chars in.
+* param[in]: n - Largest number of chars to read.
+* return: Number of chars read, -1 on error.
+*/
+int64_t streamReadFd (int fd, unsigned char *buf, int64_t n) {
+
+	int64_t done = 0;
+
+	//Pipes hand over a few KiB per read, so keep reading to fill the buffer.
+	while (done < n) {
+
+		ssize_t got = read(fd, &buf[done], n - done);
+
+		if (got < 0 && errno == EINTR) {
+
+			continue;
+		}
+		if (got < 0) {
+
+			return done > 0 ? done : -1;
+		}
+		if (got == 0) {
+
+			break;
+		}
+		done = done + got;
+	}
+	return done;
+}
+
+
+/* support function for streamWrite and streamDrain!
+* description: Writes all chars to descriptor. Interrupted and partial writes
+* are retried.
+* param[in]: fd - The descriptor.
+* param[in]: buf - The chars.
+* param[in]: n - Number of chars.
+* return: 1 if all chars were written, else 0.
+*/
+int streamWriteFd (int fd, const unsigned char *buf, int64_t n) {
+
+	int64_t done = 0;
+
+	while (done < n) {
+
+		ssize_t put = write(fd, &buf[done], n - done);
+
+		if (put < 0 && errno == EINTR) {
+
+			continue;
+		}
+		if (put <= 0) {
+
+			return 0;
+		}
+		done = done + put;
+	}
+	return 1;
+}
@@ -0,0 +1,335 @@
+/*
+* stream: Buffered input and output on file descriptors. All reading of input
+* and writing of output goes through here, so the name "-" can be used for
+* stdin and stdout and reads and writes are done STREAMBUFFERSIZE bytes at a
+* time. Requests bigger than the buffer go straight to the descriptor.
+*
+* Files opened by name can use one of three backends:
+*   plain  read and write, the only one for stdin, stdout and pipes
+*   pread  pread and pwrite at offsets kept by the stream
+*   uring  io_uring with STREAMURINGDEPTH buffers of STREAMURINGBLOCK bytes,
+*          registered with the kernel, on a fixed file. Reads are issued
+*          ahead of use and writes return as soon as they are queued, so
+*          several are in flight while chars are coded. Falls back to pread
+*          where io_uring is not available.
+* Files can also be opened with O_DIRECT, bypassing the page cache. Buffers
+* are aligned for it, and the last part of a written file, which is not a
+* whole number of STREAMALIGN blocks, is written without it.
+*/
+
+#ifndef STREAM
+#define STREAM
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "uring.h"
+
+#define STREAMBUFFERSIZE (1 << 20)
+#define STREAMALIGN 4096
+#define STREAMBACKENDPLAIN 0
+#define STREAMBACKENDPREAD 1
+#define STREAMBACKENDURING 2
+#define STREAMURINGDEPTH 8
+#define STREAMURINGBLOCK (1 << 18)
+
+
+typedef struct streamConfig {
+
+	int backend;
+	int direct;
+} streamConfig;
+
+
+typedef struct stream {
+
+	int fd;
+	int writing;
+	int isStd;
+	int backend;
+	int direct;
+	unsigned char *buffer;
+	unsigned char *memory;
+	int64_t capacity;
+	int64_t fill;
+	int64_t pos;
+	int64_t offset;
+	int eof;
+	int error;
+	uring *ring;
+	int slot;
+	int held;
+	int ended;
+	int busy[STREAMURINGDEPTH];
+	int64_t slotOffset[STREAMURINGDEPTH];
+	int64_t slotLength[STREAMURINGDEPTH];
+	int64_t result[STREAMURINGDEPTH];
+} stream;
+
+
+/*
+* description: Opens file with backend of config.
+* param[in]: name - Name of file, "-" for stdin or stdout.
+* param[in]: writing - 1 to create or truncate file and write it, 0 to read.
+* param[in]: config - Backend and O_DIRECT, NULL for plain.
+* return: The stream, NULL if file could not be opened.
+*/
+stream *streamOpen (char const *name, int writing, const streamConfig *config);
+
+
+/*
+* description: Opens file for reading.
+* param[in]: name - Name of file, "-" for stdin.
+* return: The stream, NULL if file could not be opened.
+*/
+stream *streamOpenRead (char const *name);
+
+
+/*
+* description: Opens file for writing, created or truncated.
+* param[in]: name - Name of file, "-" for stdout.
+* return: The stream, NULL if file could not be opened.
+*/
+stream *streamOpenWrite (char const *name);
+
+
+/*
+* description: Opens file for writing at offset, created if it does not
+* exist. Chars after offset are overwritten, and kept if not written over.
+* param[in]: name - Name of file.
+* param[in]: offset - Offset of first write.
+* return: The stream, NULL if file could not be opened.
+*/
+stream *streamOpenAt (char const *name, int64_t offset);
+
+
+/*
+* description: Flushes and closes stream and frees it's memory. Stdin and
+* stdout are flushed but left open.
+* param[in]: s - The stream.
+* return: 1 if all reads and writes succeeded, else 0.
+*/
+int streamClose (stream *s);
+
+
+/*
+* description: Reads chars, waiting until all are read or input ends.
+* param[in]: s - The stream.
+* param[out]: buf - Array to store atleast n chars in.
+* param[in]: n - Number of chars to read.
+* return: Number of chars read, less than n only at end of input or error.
+*/
+int64_t streamRead (stream *s, void *buf, int64_t n);
+
+
+/*
+* description: Reads one char.
+* param[in]: s - The stream.
+* return: The char, -1 at end of input.
+*/
+int streamGetc (stream *s);
+
+
+/*
+* description: Reads all chars left in stream.
+* param[in]: s - The stream.
+* param[out]: length - Number of chars read.
+* return: Allocated array of the chars.
+*/
+unsigned char *streamReadAll (stream *s, int64_t *length);
+
+
+/*
+* description: Writes chars.
+* param[in]: s - The stream.
+* param[in]: buf - The chars.
+* param[in]: n - Number of chars.
+* return: 1 if chars were written or buffered, else 0.
+*/
+int streamWrite (stream *s, const void *buf, int64_t n);
+
+
+/*
+* description: Writes one char.
+* param[in]: s - The stream.
+* param[in]: c - The char.
+* return: 1 if char was written or buffered, else 0.
+*/
+int streamPutc (stream *s, int c);
+
+
+/*
+* description: Writes buffered chars to descriptor.
+* param[in]: s - The stream.
+* return: 1 if all chars were written, else 0.
+*/
+int streamFlush (stream *s);
+
+
+/*
+* description: Checks if stream is a file that can be written at an offset,
+* not a pipe or terminal.
+* param[in]: s - The stream.
+* return: 1 if stream can seek, else 0.
+*/
+int streamSeekable (stream *s);
+
+
+/*
+* description: Flushes stream and writes chars at offset from start of file,
+* without moving the position of next write.
+* param[in]: s - A seekable stream opened for writing.
+* param[in]: offset - Offset from start of file.
+* param[in]: buf - The chars.
+* param[in]: n - Number of chars.
+* return: 1 if chars were written, else 0.
+*/
+int streamWriteAt (stream *s, int64_t offset, const void *buf, int64_t n);
+
+
+/*
+* description: Parses name of backend.
+* param[in]: name - plain, pread or uring.
+* return: The backend, -1 if name is not a backend.
+*/
+int streamParseBackend (char const *name);
+
+
+/*
+* description: Gets name of backend stream ended up with.
+* param[in]: s - The stream.
+* return: Name of backend.
+*/
+char const *streamBackendName (stream *s);
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN STREAM.C
+
+
+/* support function for streamOpen!
+* description: Creates stream of open descriptor.
+* param[in]: fd - The descriptor.
+* param[in]: writing - 1 if stream is written, 0 if read.
+* param[in]: isStd - 1 if descriptor is stdin or stdout.
+* param[in]: backend - Wanted backend, plain is used for stdin and stdout.
+* param[in]: direct - 1 if descriptor was opened with O_DIRECT.
+* return: The stream.
+*/
+stream *streamEmpty (int fd, int writing, int isStd, int backend, int direct);
+
+
+/* support function for streamRead!
+* description: Refills buffer with next chars of file.
+* param[in]: s - The stream.
+* return: Number of chars read, 0 at end of file, -1 on error.
+*/
+int64_t streamFill (stream *s);
+
+
+/* support function for streamFlush!
+* description: Writes chars in buffer to file.
+* param[in]: s - The stream.
+* return: 1 if chars were written or queued, else 0.
+*/
+int streamDrain (stream *s);
+
+
+/* support function for streamEmpty!
+* description: Sets up io_uring, registers file and buffers and, when
+* reading, queues the first reads.
+* param[in]: s - The stream.
+* return: 1 if io_uring could be used, else 0.
+*/
+int streamUringStart (stream *s);
+
+
+/* support function for streamFill!
+* description: Queues read of buffer just used, if input has not ended, and
+* waits for the next buffer.
+* param[in]: s - The stream.
+* return: Number of chars read, 0 at end of file, -1 on error.
+*/
+int64_t streamUringFill (stream *s);
+
+
+/* support function for streamDrain!
+* description: Queues write of buffer and waits until next buffer is free.
+* param[in]: s - The stream.
+* return: 1 if write was queued, else 0.
+*/
+int streamUringDrain (stream *s);
+
+
+/* support function for streamUringFill and streamUringDrain!
+* description: Takes one completed request and marks its buffer free. A
+* write that was not complete sets error of stream.
+* param[in]: s - The stream.
+* return: 1 if a request completed, else 0.
+*/
+int streamUringCollect (stream *s);
+
+
+/* support function for streamClose, streamWriteAt and streamUringDrain!
+* description: Waits until all requests in flight have completed.
+* param[in]: s - The stream.
+*/
+void streamUringFinish (stream *s);
+
+
+/* support function for streamDrain, streamWriteAt and streamUringDrain!
+* description: Turns off O_DIRECT, used before writes that are not whole
+* STREAMALIGN blocks.
+* param[in]: s - The stream.
+*/
+void streamDirectOff (stream *s);
+
+
+/* support function for streamFill, streamDrain and streamUringFill!
+* description: Reads at offset until n chars are read or file ends.
+* Interrupted reads are retried.
+* param[in]: fd - The descriptor.
+* param[out]: buf - Array to store atleast n chars in.
+* param[in]: n - Largest number of chars to read.
+* param[in]: offset - Offset in file.
+* return: Number of chars read, -1 on error.
+*/
+int64_t streamPreadFd (int fd, unsigned char *buf, int64_t n, int64_t offset);
+
+
+/* support function for streamDrain, streamWriteAt and streamUringDrain!
+* description: Writes all chars at offset. Interrupted and partial writes
+* are retried.
+* param[in]: fd - The descriptor.
+* param[in]: buf - The chars.
+* param[in]: n - Number of chars.
+* param[in]: offset - Offset in file.
+* return: 1 if all chars were written, else 0.
+*/
+int streamPwriteFd (int fd, const unsigned char *buf, int64_t n,
+					int64_t offset);
+
+
+/* support function for streamRead and streamFill!
+* description: Reads from descriptor until n chars are read, input ends or an
+* error occurs. Interrupted reads are retried.
+* param[in]: fd - The descriptor.
+* param[out]: buf - Array to store atleast n chars in.
+* param[in]: n - Largest number of chars to read.
+* return: Number of chars read, -1 on error.
+*/
+int64_t streamReadFd (int fd, unsigned char *buf, int64_t n);
+
+
+/* support function for streamWrite and streamDrain!
+* description: Writes all chars to descriptor. Interrupted and partial writes
+* are retried.
+* param[in]: fd - The descriptor.
+* param[in]: buf - The chars.
+* param[in]: n - Number of chars.
+* return: 1 if all chars were written, else 0.
+*/
+int streamWriteFd (int fd, const unsigned char *buf, int64_t n);
+
+
+#endif //STREAM
@@ -0,0 +1,363 @@
+/*
+* symbol: Extended alphabets. Splits text into symbols larger than a char
+* and codes them with a canonical code over the symbols actually used. See
+* symbol.h for the layout of the payload.
+*/
+
+#include "symbol.h"
+#include "encode.h"
+
+
+/*
+* description: Gets alphabet size of a kind of symbols, including the raw
+* byte symbols.
+* param[in]: kind - SYMBOLUTF8 or SYMBOLWORD16.
+* return: Number of possible symbols.
+*/
+uint32_t symbolAlphabetSize (int kind) {
+
+	if (kind == SYMBOLUTF8) {
+
+		return SYMBOLUTF8RAW + 256;
+	}
+	return SYMBOLWORD16RAW + 256;
+}
+
+
+/*
+* description: Reads next symbol from text.
+* param[in]: kind - SYMBOLUTF8 or SYMBOLWORD16.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[in]: pos - Position of next char to read. Moved past the symbol.
+* return: The symbol.
+*/
+uint32_t symbolNext (int kind, const unsigned char *text, int64_t length,
+					 int64_t *pos) {
+
+	if (kind == SYMBOLUTF8) {
+
+		return symbolNextUtf8(text, length, pos);
+	}
+
+	if (*pos + 1 < length) {
+
+		uint32_t word = text[*pos] | (uint32_t)text[*pos + 1] << 8;
+		*pos = *pos + 2;
+		return word;
+	}
+
+	(*pos)++;
+	return SYMBOLWORD16RAW + text[*pos - 1];
+}
+
+
+/*
+* description: Writes the chars of a symbol.
+* param[in]: kind - SYMBOLUTF8 or SYMBOLWORD16.
+* param[in]: symbol - The symbol.
+* param[out]: out - Array of atleast 4 chars.
+* return: Number of chars written.
+*/
+int symbolJoin (int kind, uint32_t symbol, unsigned char *out) {
+
+	if (kind == SYMBOLWORD16) {
+
+		if (symbol >= SYMBOLWORD16RAW) {
+
+			out[0] = (unsigned char)(symbol - SYMBOLWORD16RAW);
+			return 1;
+		}
+		out[0] = (unsigned char)symbol;
+		out[1] = (unsigned char)(symbol >> 8);
+		return 2;
+	}
+
+	if (symbol >= SYMBOLUTF8RAW) {
+
+		out[0] = (unsigned char)(symbol - SYMBOLUTF8RAW);
+		return 1;
+	} else if (symbol < 0x80) {
+
+		out[0] = (unsigned char)symbol;
+		return 1;
+	} else if (symbol < 0x800) {
+
+		out[0] = (unsigned char)(0xC0 | (symbol >> 6));
+		out[1] = (unsigned char)(0x80 | (symbol & 0x3F));
+		return 2;
+	} else if (symbol < 0x10000) {
+
+		out[0] = (unsigned char)(0xE0 | (symbol >> 12));
+		out[1] = (unsigned char)(0x80 | ((symbol >> 6) & 0x3F));
+		out[2] = (unsigned char)(0x80 | (symbol & 0x3F));
+		return 3;
+	}
+
+	out[0] = (unsigned char)(0xF0 | (symbol >> 18));
+	out[1] = (unsigned char)(0x80 | ((symbol >> 12) & 0x3F));
+	out[2] = (unsigned char)(0x80 | ((symbol >> 6) & 0x3F));
+	out[3] = (unsigned char)(0x80 | (symbol & 0x3F));
+	return 4;
+}
+
+
+/*
+* description: Encodes chars in memory as symbols and adds used symbols,
+* code lengths and codes to bitString.
+* param[in]: kind - SYMBOLUTF8 or SYMBOLWORD16.
+* param[in]: bs - The bitString.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+*/
+void symbolEncode (int kind, bitString *bs, const unsigned char *text,
+				   int64_t length) {
+
+	uint32_t alphabetSize = symbolAlphabetSize(kind);
+	uint64_t *freqTable = calloc(alphabetSize, sizeof(uint64_t));
+	int32_t *denseKey = malloc(sizeof(int32_t) * alphabetSize);
+	uint32_t *symbols = malloc(sizeof(uint32_t) * alphabetSize);
+	int64_t pos = 0;
+	int size = 0;
+
+	while (pos < length) {
+
+		freqTable[symbolNext(kind, text, length, &pos)]++;
+	}
+
+	//Only used symbols get a key, so tables stay as small as the text needs.
+	//Compacting in place is safe since size never passes s.
+	for (uint32_t s = 0; s < alphabetSize; s++) {
+
+		if (freqTable[s] > 0) {
+
+			freqTable[size] = freqTable[s];
+			symbols[size] = s;
+			denseKey[s] = size;
+			size++;
+		}
+	}
+
+	canonicalWriteGamma(bs, size + 1);
+	for (int i = 0; i < size; i++) {
+
+		canonicalWriteGamma(bs, i == 0 ? symbols[0] + 1 :
+								symbols[i] - symbols[i - 1]);
+	}
+
+	uint8_t *lengths = malloc(size + 1);
+	huffCode *codeTable = malloc(sizeof(huffCode) * (size + 1));
+
+	canonicalCodeLengths(freqTable, size, HUFFMAXCODELEN, lengths);
+	canonicalAssignCodes(lengths, size, codeTable);
+	canonicalWriteLengths(bs, lengths, size);
+
+	pos = 0;
+	while (pos < length) {
+
+		huffCode hc = codeTable[denseKey[symbolNext(kind, text, length, &pos)]];
+		bitStringAddCode(bs, hc.code, hc.len);
+	}
+
+	free(codeTable);
+	free(lengths);
+	free(symbols);
+	free(denseKey);
+	free(freqTable);
+}
+
+
+/*
+* description: Decodes symbols from bitString until length chars are written.
+* param[in]: kind - SYMBOLUTF8 or SYMBOLWORD16.
+* param[in]: bs - The bitString.
+* param[in]: bitPos - Position of next bit to read. Moved past the codes.
+* param[out]: text - Array to store atleast length chars in.
+* param[in]: length - Number of chars to decode.
+* return: 1 if all chars could be decoded, 0 if codes are not valid or run
+* past the end of bitString.
+*/
+int symbolDecode (int kind, bitString *bs, int64_t *bitPos,
+				  unsigned char *text, int64_t length) {
+
+	uint32_t alphabetSize = symbolAlphabetSize(kind);
+	uint32_t size = canonicalReadGamma(bs, bitPos);
+
+	if (size == 0 || size - 1 > alphabetSize) {
+
+		return 0;
+	}
+	size--;
+
+	uint32_t *symbols = malloc(sizeof(uint32_t) * (size + 1));
+	uint8_t *lengths = malloc(size + 1);
+	int64_t symbol = -1;
+	int valid = 1;
+
+	for (uint32_t i = 0; valid && i < size; i++) {
+
+		uint32_t gap = canonicalReadGamma(bs, bitPos);
+
+		symbol = symbol + gap;
+		valid = gap > 0 && symbol < alphabetSize;
+		symbols[i] = (uint32_t)symbol;
+	}
+
+	if (valid) {
+
+		valid = canonicalReadLengths(bs, bitPos, lengths, size);
+	}
+
+	if (valid) {
+
+		canonicalDecoder *dec = canonicalDecoderBuild(lengths, size);
+		unsigned char chars[4];
+		int64_t end = bitStringGetSize(bs) * 8;
+		int64_t pos = 0;
+
+		while (valid && pos < length) {
+
+			int key = canonicalDecodeKey(dec, bs, bitPos);
+			int n = key < 0 ? 0 : symbolJoin(kind, symbols[key], chars);
+
+			if (n == 0 || pos + n > length || *bitPos > end) {
+
+				valid = 0;
+			} else {
+
+				memcpy(&text[pos], chars, n);
+				pos = pos + n;
+			}
+		}
+		canonicalDecoderKill(dec);
+	}
+
+	free(lengths);
+	free(symbols);
+	return valid;
+}
+
+
+/*
+* description: Reads file, encodes it as symbols and writes encoded file.
+* param[in]: kind - SYMBOLUTF8 or SYMBOLWORD16.
+* param[in]: file1 - Name of file to be read and encoded.
+* param[in]: file2 - Name of file to be written as encoded file.
+* return: 1 if file2 was written, else 0.
+*/
+int symbolEncodeFile (int kind, char const *file1, char const *file2) {
+
+	int64_t length = 0;
+	unsigned char *text = readPlainFile(file1, &length);
+	bitString *bs = bitStringEmpty();
+	int mode = kind == SYMBOLUTF8 ? FORMATMODEUTF8 : FORMATMODEWORD16;
+
+	symbolEncode(kind, bs, text, length);
+
+	unsigned char *encode = bitStringGetEncode(bs);
+	int valid = writeEncode(file2, mode, length, encode,
+							bitStringGetSize(bs));
+
+	bitStringKill(bs);
+	free(text);
+	return valid;
+}
+
+
+/*
+* description: Decodes symbol payload and writes decoded file.
+* param[in]: kind - SYMBOLUTF8 or SYMBOLWORD16.
+* param[in]: file2 - Name of file to write decode.
+* param[in]: bs - The bitString with payload after file header.
+* param[in]: originalLength - Number of chars to decode.
+* return: 1 if payload could be decoded, else 0.
+*/
+int symbolDecodeFile (int kind, char const *file2, bitString *bs,
+					  uint64_t originalLength) {
+
+	int64_t bitPos = 0;
+	unsigned char *text = NULL;
+
+	//Every symbol has a code of atleast one bit, and is atmost 4 chars of
+	//UTF-8 or 2 chars of a word.
+	uint64_t perByte = kind == SYMBOLUTF8 ? 8 * 4 : 8 * 2;
+	if (formatLengthFits(originalLength, bitStringGetSize(bs), perByte)) {
+
+		text = malloc(originalLength > 0 ? originalLength : 1);
+	}
+	if (text == NULL) {
+
+		return 0;
+	}
+	int valid = symbolDecode(kind, bs, &bitPos, text, originalLength);
+
+	if (valid) {
+
+		valid = writePlainFile(file2, text, originalLength);
+	}
+
+	free(text);
+	return valid;
+}
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN SYMBOL.C
+
+
+/* support function for symbolNext!
+* description: Reads next UTF-8 code point. Overlong forms, surrogates and
+* code points above 0x10FFFF are not valid, so joining a code point always
+* gives back the same chars.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[in]: pos - Position of next char to read. Moved past the symbol.
+* return: The code point, or SYMBOLUTF8RAW + char if not valid UTF-8.
+*/
+uint32_t symbolNextUtf8 (const unsigned char *text, int64_t length,
+						 int64_t *pos) {
+
+	const unsigned char *c = &text[*pos];
+	int64_t left = length - *pos;
+	uint32_t low = 0x80; //Allowed range of second char.
+	uint32_t high = 0xBF;
+	int n = 0;
+
+	if (c[0] < 0x80) {
+
+		(*pos)++;
+		return c[0];
+	} else if (c[0] >= 0xC2 && c[0] <= 0xDF) {
+
+		n = 2;
+	} else if (c[0] >= 0xE0 && c[0] <= 0xEF) {
+
+		n = 3;
+		low = c[0] == 0xE0 ? 0xA0 : 0x80;
+		high = c[0] == 0xED ? 0x9F : 0xBF;
+	} else if (c[0] >= 0xF0 && c[0] <= 0xF4) {
+
+		n = 4;
+		low = c[0] == 0xF0 ? 0x90 : 0x80;
+		high = c[0] == 0xF4 ? 0x8F : 0xBF;
+	}
+
+	int valid = n > 0 && left >= n && c[1] >= low && c[1] <= high;
+	for (int i = 2; valid && i < n; i++) {
+
+		valid = (c[i] & 0xC0) == 0x80;
+	}
+
+	if (!valid) {
+
+		(*pos)++;
+		return SYMBOLUTF8RAW + c[0];
+	}
+
+	uint32_t symbol = c[0] & (0x7F >> n);
+	for (int i = 1; i < n; i++) {
+
+		symbol = (symbol << 6) | (c[i] & 0x3F);
+	}
+	*pos = *pos + n;
+	return symbol;
+}
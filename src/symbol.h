@@ -0,0 +1,131 @@
+/*
+* symbol: Extended alphabets. Splits text into symbols larger than a char
+* and codes them with a canonical code over the symbols actually used.
+*
+* SYMBOLUTF8 splits text into UTF-8 code points, so a char like å costs one
+* code instead of two. Bytes that are not valid UTF-8 become raw symbols.
+* SYMBOLWORD16 splits text into 16 bit little endian words, for UTF-16 or
+* numeric data. An odd last byte becomes a raw symbol.
+*
+* Payload after file header:
+*   gamma(number of used symbols + 1), then gamma coded gaps between used
+*   symbols in ascending order
+*   code lengths of used symbols, see canonicalWriteLengths
+*   codes of all symbols
+*/
+
+#ifndef SYMBOL
+#define SYMBOL
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "huffTree.h"
+#include "bitString.h"
+#include "canonical.h"
+
+#define SYMBOLUTF8 0
+#define SYMBOLWORD16 1
+
+//Raw bytes are stored as symbols after the last real symbol of the kind.
+#define SYMBOLUTF8RAW 0x110000
+#define SYMBOLWORD16RAW 0x10000
+
+
+/*
+* description: Gets alphabet size of a kind of symbols, including the raw
+* byte symbols.
+* param[in]: kind - SYMBOLUTF8 or SYMBOLWORD16.
+* return: Number of possible symbols.
+*/
+uint32_t symbolAlphabetSize (int kind);
+
+
+/*
+* description: Reads next symbol from text.
+* param[in]: kind - SYMBOLUTF8 or SYMBOLWORD16.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[in]: pos - Position of next char to read. Moved past the symbol.
+* return: The symbol.
+*/
+uint32_t symbolNext (int kind, const unsigned char *text, int64_t length,
+					 int64_t *pos);
+
+
+/*
+* description: Writes the chars of a symbol.
+* param[in]: kind - SYMBOLUTF8 or SYMBOLWORD16.
+* param[in]: symbol - The symbol.
+* param[out]: out - Array of atleast 4 chars.
+* return: Number of chars written.
+*/
+int symbolJoin (int kind, uint32_t symbol, unsigned char *out);
+
+
+/*
+* description: Encodes chars in memory as symbols and adds used symbols,
+* code lengths and codes to bitString.
+* param[in]: kind - SYMBOLUTF8 or SYMBOLWORD16.
+* param[in]: bs - The bitString.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+*/
+void symbolEncode (int kind, bitString *bs, const unsigned char *text,
+				   int64_t length);
+
+
+/*
+* description: Decodes symbols from bitString until length chars are written.
+* param[in]: kind - SYMBOLUTF8 or SYMBOLWORD16.
+* param[in]: bs - The bitString.
+* param[in]: bitPos - Position of next bit to read. Moved past the codes.
+* param[out]: text - Array to store atleast length chars in.
+* param[in]: length - Number of chars to decode.
+* return: 1 if all chars could be decoded, 0 if codes are not valid or run
+* past the end of bitString.
+*/
+int symbolDecode (int kind, bitString *bs, int64_t *bitPos,
+				  unsigned char *text, int64_t length);
+
+
+/*
+* description: Reads file, encodes it as symbols and writes encoded file.
+* param[in]: kind - SYMBOLUTF8 or SYMBOLWORD16.
+* param[in]: file1 - Name of file to be read and encoded.
+* param[in]: file2 - Name of file to be written as encoded file.
+* return: 1 if file2 was written, else 0.
+*/
+int symbolEncodeFile (int kind, char const *file1, char const *file2);
+
+
+/*
+* description: Decodes symbol payload and writes decoded file.
+* param[in]: kind - SYMBOLUTF8 or SYMBOLWORD16.
+* param[in]: file2 - Name of file to write decode.
+* param[in]: bs - The bitString with payload after file header.
+* param[in]: originalLength - Number of chars to decode.
+* return: 1 if payload could be decoded, else 0.
+*/
+int symbolDecodeFile (int kind, char const *file2, bitString *bs,
+					  uint64_t originalLength);
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN SYMBOL.C
+
+
+/* support function for symbolNext!
+* description: Reads next UTF-8 code point. Overlong forms, surrogates and
+* code points above 0x10FFFF are not valid, so joining a code point always
+* gives back the same chars.
+* param[in]: text - The chars.
+* param[in]: length - Number of chars.
+* param[in]: pos - Position of next char to read. Moved past the symbol.
+* return: The code point, or SYMBOLUTF8RAW + char if not valid UTF-8.
+*/
+uint32_t symbolNextUtf8 (const unsigned char *text, int64_t length,
+						 int64_t *pos);
+
+
+#endif //SYMBOL
@@ -0,0 +1,164 @@
+/*
+* tableCache: Lock free cache of compiled contextTables. See tableCache.h.
+*/
+
+#include <string.h>
+
+#include "tableCache.h"
+
+
+/*
+* description: Creates empty cache. Allocates memory for tableCache.
+* return: The tableCache.
+*/
+tableCache *tableCacheEmpty (void) {
+
+	return calloc(1, sizeof(tableCache));
+}
+
+
+/*
+* description: Drops holds of all tables of cache and deallocates its memory.
+* No thread may use the cache or a table found in it without holding it.
+* param[in]: cache - The tableCache.
+*/
+void tableCacheKill (tableCache *cache) {
+
+	//Every table bound to an id is also in a content slot.
+	for (int i = 0; i < TABLECACHESLOTS; i++) {
+
+		if (cache -> byContent[i] != NULL) {
+
+			contextTableKill(cache -> byContent[i]);
+		}
+	}
+	free(cache);
+}
+
+
+/*
+* description: Finds table bound to id. Safe from any thread.
+* param[in]: cache - The tableCache.
+* param[in]: id - Id of the table.
+* return: The contextTable, valid while the cache lives, NULL if no table
+* has id.
+*/
+contextTable *tableCacheGet (tableCache *cache, uint32_t id) {
+
+	if (id >= TABLECACHEIDS) {
+
+		return NULL;
+	}
+	return __atomic_load_n(&cache -> byId[id], __ATOMIC_ACQUIRE);
+}
+
+
+/*
+* description: Adds table and binds its id to it if the id is free, unless a
+* table with the same id and code lengths is cached already. Safe from any
+* thread.
+* param[in]: cache - The tableCache.
+* param[in]: table - The contextTable, held by the cache if added.
+* return: The cached table, valid while the cache lives, NULL if the cache
+* is full.
+*/
+contextTable *tableCacheAdd (tableCache *cache, contextTable *table) {
+
+	int slot = -1;
+	contextTable *found = tableCacheProbe(cache, table -> lengths,
+										  table -> hash, table -> id, &slot);
+
+	//A slot lost to another thread is probed again from the start, as the
+	//other thread may have added the same table.
+	while (found == NULL && slot >= 0) {
+
+		contextTable *empty = NULL;
+		if (__atomic_compare_exchange_n(&cache -> byContent[slot], &empty,
+										table, 0, __ATOMIC_ACQ_REL,
+										__ATOMIC_ACQUIRE)) {
+
+			//Caller holds table until this returns, so it can not be freed
+			//before the hold of the cache is taken.
+			contextTableHold(table);
+			empty = NULL;
+			__atomic_compare_exchange_n(&cache -> byId[table -> id], &empty,
+										table, 0, __ATOMIC_ACQ_REL,
+										__ATOMIC_ACQUIRE);
+			return table;
+		}
+		found = tableCacheProbe(cache, table -> lengths, table -> hash,
+								table -> id, &slot);
+	}
+	return found;
+}
+
+
+/*
+* description: Finds table with id and code lengths, and builds and adds it
+* if it is not cached. Safe from any thread.
+* param[in]: cache - The tableCache.
+* param[in]: lengths - CONTEXTSYMBOLS code lengths.
+* param[in]: id - Id of the table.
+* return: The cached table, valid while the cache lives, NULL if lengths
+* are not valid or the cache is full.
+*/
+contextTable *tableCacheIntern (tableCache *cache, const uint8_t *lengths,
+								uint32_t id) {
+
+	int slot = -1;
+	contextTable *found = tableCacheProbe(cache, lengths,
+										  contextHash(lengths), id, &slot);
+
+	if (found != NULL) {
+
+		return found;
+	}
+
+	contextTable *table = contextTableFromLengths(lengths, id);
+	if (table == NULL) {
+
+		return NULL;
+	}
+	found = tableCacheAdd(cache, table);
+	contextTableKill(table);
+	return found;
+}
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN TABLECACHE.C
+
+
+/* support function for tableCacheAdd and tableCacheIntern!
+* description: Probes content slots for a table with id and code lengths.
+* param[in]: cache - The tableCache.
+* param[in]: lengths - CONTEXTSYMBOLS code lengths.
+* param[in]: hash - Hash of lengths, see contextTable.
+* param[in]: id - Id of the table.
+* param[out]: slot - Index of the table, or of the first empty slot, -1 if
+* neither was found.
+* return: The table, NULL if it is not cached.
+*/
+contextTable *tableCacheProbe (tableCache *cache, const uint8_t *lengths,
+							   uint64_t hash, uint32_t id, int *slot) {
+
+	//Slots are never emptied, so an empty slot ends the probe.
+	uint64_t start = (hash ^ (id * 0x9E3779B97F4A7C15ULL)) >> 7;
+
+	for (int i = 0; i < TABLECACHESLOTS; i++) {
+
+		*slot = (int)((start + i) % TABLECACHESLOTS);
+		contextTable *table = __atomic_load_n(&cache -> byContent[*slot],
+											  __ATOMIC_ACQUIRE);
+		if (table == NULL) {
+
+			return NULL;
+		}
+		if (table -> hash == hash && table -> id == id &&
+			memcmp(table -> lengths, lengths, CONTEXTSYMBOLS) == 0) {
+
+			return table;
+		}
+	}
+	*slot = -1;
+	return NULL;
+}
@@ -0,0 +1,104 @@
+/*
+* tableCache: Compiled contextTables shared by many decoders and threads, and
+* found by id or by content without locks.
+*
+* A table added to the cache is held by it until the cache is killed, so a
+* table found in the cache can be used without holding it for as long as
+* the cache lives. Each slot is set once, from empty to a table, by compare
+* and swap, and read with an acquire load. So finding a table costs a few
+* loads and never waits, and nothing is rebuilt once a table is cached. Two
+* threads adding the same table at once both get the one set first.
+*
+* Each id has a slot, bound to the first table added with that id. Tables
+* are found by content in TABLECACHESLOTS slots, probed from the hash of
+* their code lengths and id.
+*/
+
+#ifndef TABLECACHE
+#define TABLECACHE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "context.h"
+
+#define TABLECACHESLOTS 1024
+#define TABLECACHEIDS (1 << CONTEXTIDBITS)
+
+
+typedef struct tableCache {
+
+	contextTable *byId[TABLECACHEIDS];
+	contextTable *byContent[TABLECACHESLOTS];
+} tableCache;
+
+
+/*
+* description: Creates empty cache. Allocates memory for tableCache.
+* return: The tableCache.
+*/
+tableCache *tableCacheEmpty (void);
+
+
+/*
+* description: Drops holds of all tables of cache and deallocates its memory.
+* No thread may use the cache or a table found in it without holding it.
+* param[in]: cache - The tableCache.
+*/
+void tableCacheKill (tableCache *cache);
+
+
+/*
+* description: Finds table bound to id. Safe from any thread.
+* param[in]: cache - The tableCache.
+* param[in]: id - Id of the table.
+* return: The contextTable, valid while the cache lives, NULL if no table
+* has id.
+*/
+contextTable *tableCacheGet (tableCache *cache, uint32_t id);
+
+
+/*
+* description: Adds table and binds its id to it if the id is free, unless a
+* table with the same id and code lengths is cached already. Safe from any
+* thread.
+* param[in]: cache - The tableCache.
+* param[in]: table - The contextTable, held by the cache if added.
+* return: The cached table, valid while the cache lives, NULL if the cache
+* is full.
+*/
+contextTable *tableCacheAdd (tableCache *cache, contextTable *table);
+
+
+/*
+* description: Finds table with id and code lengths, and builds and adds it
+* if it is not cached. Safe from any thread.
+* param[in]: cache - The tableCache.
+* param[in]: lengths - CONTEXTSYMBOLS code lengths.
+* param[in]: id - Id of the table.
+* return: The cached table, valid while the cache lives, NULL if lengths
+* are not valid or the cache is full.
+*/
+contextTable *tableCacheIntern (tableCache *cache, const uint8_t *lengths,
+								uint32_t id);
+
+
+//SUPPORT FUNCTIONS FOR USE ONLY IN TABLECACHE.C
+
+
+/* support function for tableCacheAdd and tableCacheIntern!
+* description: Probes content slots for a table with id and code lengths.
+* param[in]: cache - The tableCache.
+* param[in]: lengths - CONTEXTSYMBOLS code lengths.
+* param[in]: hash - Hash of lengths, see contextTable.
+* param[in]: id - Id of the table.
+* param[out]: slot - Index of the table, or of the first empty slot, -1 if
+* neither was found.
+* return: The table, NULL if it is not cached.
+*/
+contextTable *tableCacheProbe (tableCache *cache, const uint8_t *lengths,
+							   uint64_t hash, uint32_t id, int *slot);
+
+
+#endif //TABLECACHE
@@ -0,0 +1,272 @@
+/*
+* uring: Minimal io_uring interface made with raw system calls. See uring.h.
+*/
+
+//syscall() is not part of POSIX.
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "uring.h"
+
+
+/*
+* description: Creates io_uring instance.
+* param[in]: entries - Number of requests that can be queued at once.
+* return: The uring, NULL if io_uring is not supported or not allowed.
+*/
+uring *uringEmpty (unsigned entries) {
+
+	struct io_uring_params params;
+
+	memset(&params, 0, sizeof(params));
+	int fd = syscall(__NR_io_uring_setup, entries, &params);
+	if (fd < 0) {
+
+		return NULL;
+	}
+
+	uring *u = malloc(sizeof(uring));
+	memset(u, 0, sizeof(uring));
+	u -> fd = fd;
+	u -> file = -1;
+	u -> sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	u -> cqRingSize = params.cq_off.cqes +
+					  params.cq_entries * sizeof(struct io_uring_cqe);
+	u -> sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+
+	//Newer kernels map both rings with one mmap.
+	int single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if (single && u -> cqRingSize > u -> sqRingSize) {
+
+		u -> sqRingSize = u -> cqRingSize;
+	}
+	u -> sqRing = mmap(NULL, u -> sqRingSize, PROT_READ | PROT_WRITE,
+					   MAP_SHARED, fd, IORING_OFF_SQ_RING);
+	u -> cqRing = single ? u -> sqRing :
+				  mmap(NULL, u -> cqRingSize, PROT_READ | PROT_WRITE,
+					   MAP_SHARED, fd, IORING_OFF_CQ_RING);
+	u -> sqes = mmap(NULL, u -> sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+					 fd, IORING_OFF_SQES);
+
+	if (u -> sqRing == MAP_FAILED || u -> cqRing == MAP_FAILED ||
+		u -> sqes == MAP_FAILED) {
+
+		if (u -> sqes != MAP_FAILED) {
+
+			munmap(u -> sqes, u -> sqesSize);
+		}
+		if (!single && u -> cqRing != MAP_FAILED) {
+
+			munmap(u -> cqRing, u -> cqRingSize);
+		}
+		if (u -> sqRing != MAP_FAILED) {
+
+			munmap(u -> sqRing, u -> sqRingSize);
+		}
+		close(fd);
+		free(u);
+		return NULL;
+	}
+
+	char *sq = u -> sqRing;
+	char *cq = u -> cqRing;
+	u -> sqHead = (unsigned *)(sq + params.sq_off.head);
+	u -> sqTail = (unsigned *)(sq + params.sq_off.tail);
+	u -> sqArray = (unsigned *)(sq + params.sq_off.array);
+	u -> sqMask = *(unsigned *)(sq + params.sq_off.ring_mask);
+	u -> sqEntries = *(unsigned *)(sq + params.sq_off.ring_entries);
+	u -> cqHead = (unsigned *)(cq + params.cq_off.head);
+	u -> cqTail = (unsigned *)(cq + params.cq_off.tail);
+	u -> cqMask = *(unsigned *)(cq + params.cq_off.ring_mask);
+	u -> cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+	return u;
+}
+
+
+/*
+* description: Waits for requests in flight and frees the uring.
+* param[in]: u - The uring.
+*/
+void uringKill (uring *u) {
+
+	uint64_t data = 0;
+	int result = 0;
+
+	//Kernel may still use the buffers of requests in flight.
+	while (uringWait(u, &data, &result)) {
+
+		;
+	}
+
+	munmap(u -> sqes, u -> sqesSize);
+	if (u -> cqRing != u -> sqRing) {
+
+		munmap(u -> cqRing, u -> cqRingSize);
+	}
+	munmap(u -> sqRing, u -> sqRingSize);
+	close(u -> fd);
+	free(u);
+}
+
+
+/*
+* description: Sets file all requests are made on, registered as fixed file
+* if the kernel allows.
+* param[in]: u - The uring.
+* param[in]: fd - Descriptor of the file.
+*/
+void uringSetFile (uring *u, int fd) {
+
+	int32_t files[1] = {fd};
+
+	u -> file = fd;
+	u -> fixedFile = syscall(__NR_io_uring_register, u -> fd,
+							 IORING_REGISTER_FILES, files, 1) == 0;
+}
+
+
+/*
+* description: Registers buffers, so requests on them use fixed buffers.
+* param[in]: u - The uring.
+* param[in]: buffers - Address and length of each buffer.
+* param[in]: count - Number of buffers.
+* return: 1 if buffers were registered, else 0 and requests use the buffers
+* as plain memory.
+*/
+int uringRegisterBuffers (uring *u, const struct iovec *buffers, int count) {
+
+	u -> fixedBuffers = syscall(__NR_io_uring_register, u -> fd,
+								IORING_REGISTER_BUFFERS, buffers, count) == 0;
+	return u -> fixedBuffers;
+}
+
+
+/*
+* description: Queues read or write of file. Request is not started until
+* uringSubmit or uringWait is called.
+* param[in]: u - The uring.
+* param[in]: write - 1 to write, 0 to read.
+* param[in]: buffer - Memory to read to or write from.
+* param[in]: length - Number of bytes.
+* param[in]: offset - Offset in file.
+* param[in]: bufferIndex - Index of registered buffer holding memory.
+* param[in]: data - Value given back with the result.
+* return: 1 if request was queued, 0 if submission ring is full.
+*/
+int uringQueue (uring *u, int write, void *buffer, unsigned length,
+				uint64_t offset, int bufferIndex, uint64_t data) {
+
+	unsigned tail = *u -> sqTail;
+	unsigned head = __atomic_load_n(u -> sqHead, __ATOMIC_ACQUIRE);
+
+	if (tail - head == u -> sqEntries) {
+
+		return 0;
+	}
+
+	unsigned index = tail & u -> sqMask;
+	struct io_uring_sqe *sqe = &u -> sqes[index];
+
+	memset(sqe, 0, sizeof(*sqe));
+	if (u -> fixedBuffers) {
+
+		sqe -> opcode = write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+		sqe -> buf_index = bufferIndex;
+	} else {
+
+		sqe -> opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+	}
+	if (u -> fixedFile) {
+
+		sqe -> flags = IOSQE_FIXED_FILE;
+		sqe -> fd = 0;
+	} else {
+
+		sqe -> fd = u -> file;
+	}
+	sqe -> addr = (uint64_t)(uintptr_t)buffer;
+	sqe -> len = length;
+	sqe -> off = offset;
+	sqe -> user_data = data;
+
+	//Entry must be visible to the kernel before the new tail.
+	u -> sqArray[index] = index;
+	__atomic_store_n(u -> sqTail, tail + 1, __ATOMIC_RELEASE);
+	u -> queued++;
+	return 1;
+}
+
+
+/*
+* description: Starts all queued requests.
+* param[in]: u - The uring.
+* return: 1 if requests were started, else 0.
+*/
+int uringSubmit (uring *u) {
+
+	while (u -> queued > 0) {
+
+		int started = syscall(__NR_io_uring_enter, u -> fd, u -> queued, 0, 0,
+							  NULL, 0);
+
+		if (started < 0 && errno == EINTR) {
+
+			continue;
+		}
+		if (started <= 0) {
+
+			return 0;
+		}
+		u -> queued = u -> queued - started;
+		u -> inFlight = u -> inFlight + started;
+	}
+	return 1;
+}
+
+
+/*
+* description: Takes result of next completed request, waiting if none has
+* completed. Queued requests are started first.
+* param[in]: u - The uring.
+* param[out]: data - Value given with the request.
+* param[out]: result - Bytes read or written, negative errno on error.
+* return: 1 if a result was taken, 0 if no request is in flight or waiting
+* failed.
+*/
+int uringWait (uring *u, uint64_t *data, int *result) {
+
+	if (!uringSubmit(u)) {
+
+		return 0;
+	}
+
+	while (u -> inFlight > 0) {
+
+		unsigned head = *u -> cqHead;
+		unsigned tail = __atomic_load_n(u -> cqTail, __ATOMIC_ACQUIRE);
+
+		if (head != tail) {
+
+			struct io_uring_cqe *cqe = &u -> cqes[head & u -> cqMask];
+
+			*data = cqe -> user_data;
+			*result = cqe -> res;
+			__atomic_store_n(u -> cqHead, head + 1, __ATOMIC_RELEASE);
+			u -> inFlight--;
+			return 1;
+		}
+
+		int waited = syscall(__NR_io_uring_enter, u -> fd, 0, 1,
+							 IORING_ENTER_GETEVENTS, NULL, 0);
+		if (waited < 0 && errno != EINTR) {
+
+			return 0;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,120 @@
+/*
+* uring: Minimal io_uring interface made with raw system calls, as liburing
+* is not used. Reads and writes are queued on the submission ring, handed to
+* the kernel in one system call and their results are taken from the
+* completion ring, so several of them can be in flight at once.
+*
+* One file can be registered, and is then used as a fixed file so the kernel
+* does not look it up for each request. Buffers can be registered, so the
+* kernel maps them once and reads and writes use them as fixed buffers. If
+* registering fails, plain file descriptors and buffers are used instead.
+*/
+
+#ifndef URING
+#define URING
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+
+typedef struct uring {
+
+	int fd;
+	int file;
+	int fixedFile;
+	int fixedBuffers;
+	unsigned *sqHead;
+	unsigned *sqTail;
+	unsigned *sqArray;
+	unsigned sqMask;
+	unsigned sqEntries;
+	unsigned *cqHead;
+	unsigned *cqTail;
+	unsigned cqMask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	void *sqRing;
+	size_t sqRingSize;
+	void *cqRing;
+	size_t cqRingSize;
+	size_t sqesSize;
+	unsigned queued;
+	unsigned inFlight;
+} uring;
+
+
+/*
+* description: Creates io_uring instance.
+* param[in]: entries - Number of requests that can be queued at once.
+* return: The uring, NULL if io_uring is not supported or not allowed.
+*/
+uring *uringEmpty (unsigned entries);
+
+
+/*
+* description: Waits for requests in flight and frees the uring.
+* param[in]: u - The uring.
+*/
+void uringKill (uring *u);
+
+
+/*
+* description: Sets file all requests are made on, registered as fixed file
+* if the kernel allows.
+* param[in]: u - The uring.
+* param[in]: fd - Descriptor of the file.
+*/
+void uringSetFile (uring *u, int fd);
+
+
+/*
+* description: Registers buffers, so requests on them use fixed buffers.
+* param[in]: u - The uring.
+* param[in]: buffers - Address and length of each buffer.
+* param[in]: count - Number of buffers.
+* return: 1 if buffers were registered, else 0 and requests use the buffers
+* as plain memory.
+*/
+int uringRegisterBuffers (uring *u, const struct iovec *buffers, int count);
+
+
+/*
+* description: Queues read or write of file. Request is not started until
+* uringSubmit or uringWait is called.
+* param[in]: u - The uring.
+* param[in]: write - 1 to write, 0 to read.
+* param[in]: buffer - Memory to read to or write from.
+* param[in]: length - Number of bytes.
+* param[in]: offset - Offset in file.
+* param[in]: bufferIndex - Index of registered buffer holding memory.
+* param[in]: data - Value given back with the result.
+* return: 1 if request was queued, 0 if submission ring is full.
+*/
+int uringQueue (uring *u, int write, void *buffer, unsigned length,
+				uint64_t offset, int bufferIndex, uint64_t data);
+
+
+/*
+* description: Starts all queued requests.
+* param[in]: u - The uring.
+* return: 1 if requests were started, else 0.
+*/
+int uringSubmit (uring *u);
+
+
+/*
+* description: Takes result of next completed request, waiting if none has
+* completed. Queued requests are started first.
+* param[in]: u - The uring.
+* param[out]: data - Value given with the request.
+* param[out]: result - Bytes read or written, negative errno on error.
+* return: 1 if a result was taken, 0 if no request is in flight or waiting
+* failed.
+*/
+int uringWait (uring *u, uint64_t *data, int *result);
+
+
+#endif //URING